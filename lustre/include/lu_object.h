@@ -1550,6 +1550,9 @@ struct lu_tgt_qos {
 						       * every obj*/
 	__u64			 ltq_weight;	/* net weighting */
 	time64_t		 ltq_used;	/* last used time, seconds */
+	atomic_t		 ltq_allocs;	/* objects allocated since
+						 * penalties were updated */
+	__u32			 ltq_load;	/* weighted I/O load, 0-1024 */
 	bool			 ltq_usable:1;	/* usable for striping */
 };
 
@@ -1592,6 +1595,7 @@ struct lu_qos {
 	__u32			 lq_active_svr_count;
 	unsigned int		 lq_prio_free;   /* priority for free space */
 	unsigned int		 lq_threshold_rr;/* priority for rr */
+	unsigned int		 lq_prio_load;   /* priority for I/O load */
 	struct lu_qos_rr	 lq_rr;          /* round robin qos data */
 	unsigned long		 lq_dirty:1,     /* recalc qos data */
 				 lq_same_space:1,/* the servers all have approx.
@@ -1643,6 +1647,7 @@ bool ltd_qos_is_usable(struct lu_tgt_descs *ltd);
 int ltd_qos_penalties_calc(struct lu_tgt_descs *ltd);
 int ltd_qos_update(struct lu_tgt_descs *ltd, struct lu_tgt_desc *tgt,
 		   __u64 *total_wt);
+unsigned int ltd_qos_allocs_fold(struct lu_tgt_descs *ltd);
 
 static inline struct lu_tgt_desc *ltd_first_tgt(struct lu_tgt_descs *ltd)
 {
@@ -117,10 +117,25 @@ struct target_distribute_txn_data {
 	void			*tdtd_show_retrievers_cbdata;
 };
 
+/* per-CPT cache of grant space released by tgt_grant_commit() */
+struct tg_grant_cache {
+	/* grant released by committed writes, still accounted in
+	 * tgd_tot_granted and tgd_tot_pending */
+	u64			 tgc_released;
+	/* part of tgc_released which was really written, still to be taken
+	 * out of tgd_osfs.os_bavail */
+	u64			 tgc_written;
+};
+
 struct tg_grants_data {
 	/* grants: all values in bytes */
 	/* grant lock to protect all grant counters */
 	spinlock_t		 tgd_grant_lock;
+	/* per-CPT lock protecting tgd_grant_caches, also taken by
+	 * tgt_grant_commit() to release ted_pending of an export */
+	struct cfs_percpt_lock	*tgd_grant_pcl;
+	/* grant released at commit and not folded into global counters yet */
+	struct tg_grant_cache	**tgd_grant_caches;
 	/* total amount of dirty data reported by clients in incoming obdo */
 	u64			 tgd_tot_dirty;
 	/* sum of filesystem space granted to clients for async writes */
@@ -199,6 +214,22 @@ struct lu_target {
 	unsigned long		**lut_reply_bitmap;
 	/** target sync count, used for debug & test */
 	atomic_t		 lut_sync_count;
+	/* group commit of sync requests, see tgt_sync() */
+	wait_queue_head_t	 lut_commit_waitq;
+	/** highest transno an async commit was started for,
+	 * protected by lut_translock */
+	__u64			 lut_sync_kicked;
+	/** serializes full device syncs */
+	struct mutex		 lut_sync_mutex;
+	/** full device syncs started and completed, and the result of
+	 * the last one, protected by lut_sync_mutex */
+	__u64			 lut_sync_started;
+	__u64			 lut_sync_done;
+	int			 lut_sync_rc;
+	/** object sync requests released by a group commit, and async
+	 * commits started for them, used for debug & test */
+	atomic_t		 lut_sync_group_reqs;
+	atomic_t		 lut_sync_group_commits;
 
 	/** cross MDT locks which should trigger Sync-on-Lock-Cancel */
 	spinlock_t		 lut_slc_locks_guard;
@@ -431,6 +462,7 @@ int tgt_sec_ctx_fini(struct tgt_session_info *tsi);
 int tgt_sendpage(struct tgt_session_info *tsi, struct lu_rdpg *rdpg, int nob);
 int tgt_send_buffer(struct tgt_session_info *tsi, struct lu_rdbuf *rdbuf);
 int tgt_validate_obdo(struct tgt_session_info *tsi, struct obdo *oa);
+void tgt_mult_trans_enable(struct tgt_session_info *tsi);
 int tgt_sync(const struct lu_env *env, struct lu_target *tgt,
 	     struct dt_object *obj, __u64 start, __u64 end);
 
@@ -519,6 +519,11 @@ int llapi_changelog_recv(void *priv, struct changelog_rec **rech);
 int llapi_changelog_in_buf(void *priv);
 int llapi_changelog_free(struct changelog_rec **rech);
 int llapi_changelog_get_fd(void *priv);
+/* Batched access to the records of a reader started with
+ * CHANGELOG_FLAG_RING. Records are not copied nor converted. */
+int llapi_changelog_recv_batch(void *priv, struct changelog_rec **recs,
+			       int nr_recs);
+int llapi_changelog_release_batch(void *priv);
 /* Allow records up to endrec to be destroyed; requires registered id. */
 int llapi_changelog_clear(const char *mdtname, const char *idstr,
 			  long long endrec);
@@ -68,6 +68,11 @@ extern struct kset *ldlm_svc_kset;
  * client shows interest in that lock, e.g. glimpse is occured. */
 #define LDLM_DIRTY_AGE_LIMIT (10)
 #define LDLM_DEFAULT_PARALLEL_AST_LIMIT 1024
+/* number of times a reused (hot) unused lock may be skipped by LRU
+ * cancellation before it is canceled like a one-shot lock */
+#define LDLM_DEFAULT_LRU_HOT_MAX	3
+/* slots remembering resources recently canceled from the LRU, power of 2 */
+#define LDLM_LRU_GHOST_SIZE		512
 
 /**
  * LDLM non-error return states
@@ -448,6 +453,25 @@ struct ldlm_namespace {
 	 */
 	ktime_t			ns_max_age;
 
+	/**
+	 * Client only: LRU cancellation prefers one-shot locks. A lock on a
+	 * resource which was reused from the LRU is moved back to the LRU
+	 * tail instead of being canceled, at most ns_lru_hot_max times.
+	 * 0 disables it.
+	 */
+	unsigned int		ns_lru_hot_max;
+	/**
+	 * Hashes of the resources whose locks were canceled from the LRU,
+	 * so that a resource enqueued again soon after its cancellation is
+	 * seen as hot. Slots are read and written locklessly, a lost update
+	 * only loses some history.
+	 */
+	__u32			*ns_lru_ghost;
+	/** Number of hot locks moved back to the LRU tail. */
+	atomic64_t		ns_lru_second_chances;
+	/** Number of resources enqueued again after an LRU cancellation. */
+	atomic64_t		ns_lru_refaults;
+
 	/**
 	 * Server only: number of times we evicted clients due to lack of reply
 	 * to ASTs.
@@ -931,6 +955,12 @@ struct ldlm_lock {
 	/** Local PID of process which created this lock. */
 	__u32			l_pid;
 
+	/**
+	 * Lock is accounted in l_export->exp_granted_locks, protected by
+	 * the resource lock. \see ldlm_reclaim_add
+	 */
+	bool			l_exp_counted;
+
 	/**
 	 * Number of times blocking AST was sent for this lock.
 	 * This is for debugging. Valid values are 0 and 1, if there is an
@@ -1083,6 +1113,12 @@ struct ldlm_resource {
 	/** is lvb initialized ? */
 	bool			lr_lvb_initialized;
 
+	/**
+	 * Client only: number of times locks of this resource were reused
+	 * from the LRU, capped by ns_lru_hot_max.
+	 */
+	atomic_t		lr_lru_hits;
+
 	/** List of references to this resource. For debugging. */
 	struct lu_ref		lr_reference;
 };
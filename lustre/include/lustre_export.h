@@ -100,7 +100,7 @@ struct tg_export_data {
 	/* grants */
 	long			ted_dirty;    /* in bytes */
 	long			ted_grant;    /* in bytes */
-	long			ted_pending;  /* bytes just being written */
+	atomic_long_t		ted_pending;  /* bytes just being written */
 	__u8			ted_pagebits; /* log2 of client page size */
 
 	/**
@@ -108,7 +108,9 @@ struct tg_export_data {
 	 */
 	spinlock_t		ted_fmd_lock; /* protects ted_fmd_list */
 	struct list_head	ted_fmd_list; /* FIDs being modified */
+	struct rhashtable	ted_fmd_hash; /* FMDs in ted_fmd_list by FID */
 	int			ted_fmd_count;/* items in ted_fmd_list */
+	bool			ted_fmd_hash_inited; /* ted_fmd_hash is set up */
 };
 
 /**
@@ -200,6 +202,8 @@ struct obd_export {
 	/** Number of queued replay requests to be processes */
 	atomic_t		exp_replay_count;
 	atomic_t		exp_locks_count; /** Lock references */
+	/** Granted server locks accounted by ldlm_reclaim_add() */
+	atomic_t		exp_granted_locks;
 #if LUSTRE_TRACKS_LOCK_EXP_REFS
 	struct list_head	exp_locks_list;
 	spinlock_t		exp_locks_list_guard;
@@ -273,7 +273,12 @@ struct llog_handle {
 	 * case, after it will have reached LLOG_HDR_BITMAP_SIZE, llh_cat_idx
 	 * will become its upper limit */
 	int			 lgh_last_idx;
+	/* held shared by appenders until their records are written and
+	 * exclusively by readers waiting for in-flight records */
 	struct rw_semaphore	 lgh_last_sem;
+	/* end of the last reserved record, appenders may run concurrently
+	 * so the object size may lag behind it */
+	__u64			 lgh_write_offset;
 	__u64			 lgh_cur_offset; /* used for test only */
 	struct llog_ctxt	*lgh_ctxt;
 	union {
@@ -306,6 +311,11 @@ int llog_osd_put_cat_list(const struct lu_env *env, struct dt_device *d,
  * instead of objects with local FID. */
 #define LLOG_CTXT_FLAG_NORMAL_FID	 0x00000004
 
+/* Records of a plain llog under this context must be stored in the order
+ * their lop_write_rec() is called, e.g. changelog records which take their
+ * cr_index there. Appends to such llogs stay exclusive. */
+#define LLOG_CTXT_FLAG_ORDERED		 0x00000008
+
 struct llog_ctxt {
         int                      loc_idx; /* my index the obd array of ctxt's */
         struct obd_device       *loc_obd; /* points back to the containing obd*/
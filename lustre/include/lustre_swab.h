@@ -91,6 +91,7 @@ void lustre_swab_lfsck_request(struct lfsck_request *lr);
 void lustre_swab_lfsck_reply(struct lfsck_reply *lr);
 void lustre_swab_obdo(struct obdo *o);
 void lustre_swab_ost_body(struct ost_body *b);
+void lustre_swab_ost_setattr_rec(struct ost_setattr_rec *osr);
 void lustre_swab_ost_last_id(__u64 *id);
 int lustre_swab_fiemap(struct fiemap *fiemap, __u32 len);
 void lustre_swab_fiemap_info_key(struct ll_fiemap_info_key *fiemap_info);
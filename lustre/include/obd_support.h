@@ -242,6 +242,7 @@ extern char obd_jobid_var[];
 #define OBD_FAIL_MDS_RMFID_NET		 0x166
 #define OBD_FAIL_MDS_CREATE_RACE	 0x167
 #define OBD_FAIL_MDS_STATFS_SPOOF	 0x168
+#define OBD_FAIL_MDS_DESTROY_DELAY	 0x16a
 
 /* layout lock */
 #define OBD_FAIL_MDS_NO_LL_GETATTR	 0x170
@@ -341,6 +342,7 @@ extern char obd_jobid_var[];
 #define OBD_FAIL_OST_2BIG_NIOBUF	 0x248
 #define OBD_FAIL_OST_FALLOCATE_NET	 0x249
 #define OBD_FAIL_OST_WR_ATTR_DELAY	 0x250
+#define OBD_FAIL_OST_SETATTR_BATCH_NET	 0x251
 
 #define OBD_FAIL_LDLM                    0x300
 #define OBD_FAIL_LDLM_NAMESPACE_NEW      0x301
@@ -520,6 +522,7 @@ extern char obd_jobid_var[];
 #define OBD_FAIL_QUOTA_DELAY_REINT       0xA03
 #define OBD_FAIL_QUOTA_RECOVERABLE_ERR   0xA04
 #define OBD_FAIL_QUOTA_INIT              0xA05
+#define OBD_FAIL_QUOTA_DQACQ_BATCH_NET   0xA06
 
 #define OBD_FAIL_LPROC_REMOVE            0xB00
 
@@ -560,6 +563,7 @@ extern char obd_jobid_var[];
 #define OBD_FAIL_PLAIN_RECORDS			    0x1319
 #define OBD_FAIL_CATALOG_FULL_CHECK		    0x131a
 #define OBD_FAIL_CATLIST			    0x131b
+#define OBD_FAIL_LLOG_WRITE_REC_FAIL		    0x131c
 
 #define OBD_FAIL_LLITE                              0x1400
 #define OBD_FAIL_LLITE_FAULT_TRUNC_RACE             0x1401
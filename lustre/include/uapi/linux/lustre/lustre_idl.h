@@ -849,6 +849,10 @@ struct ptlrpc_body_v2 {
 #define OBD_CONNECT2_ENCRYPT		0x8000ULL /* client-to-disk encrypt */
 #define OBD_CONNECT2_FIDMAP	       0x10000ULL /* FID map */
 #define OBD_CONNECT2_GETATTR_PFID      0x20000ULL /* pack parent FID in getattr */
+/* 0x40000 - 0x8000000000 are used by upstream Lustre, do not reuse them */
+#define OBD_CONNECT2_LSOM_TRUST    0x10000000000ULL /* OBD_MD_FLLAZYTRUST */
+#define OBD_CONNECT2_DQACQ_BATCH   0x20000000000ULL /* QUOTA_DQACQ_BATCH RPC */
+#define OBD_CONNECT2_SETATTR_BATCH 0x40000000000ULL /* OST_SETATTR_BATCH RPC */
 /* XXX README XXX:
  * Please DO NOT add flag values here before first ensuring that this same
  * flag value is not in use on some other branch.  Please clear any such
@@ -907,7 +911,9 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT2_PCC | \
 				OBD_CONNECT2_CRUSH | \
 				OBD_CONNECT2_ENCRYPT | \
-				OBD_CONNECT2_GETATTR_PFID)
+				OBD_CONNECT2_GETATTR_PFID | \
+				OBD_CONNECT2_LSOM_TRUST | \
+				OBD_CONNECT2_DQACQ_BATCH)
 
 #define OST_CONNECT_SUPPORTED  (OBD_CONNECT_SRVLOCK | OBD_CONNECT_GRANT | \
 				OBD_CONNECT_REQPORTAL | OBD_CONNECT_VERSION | \
@@ -929,7 +935,8 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT_SHORTIO | OBD_CONNECT_FLAGS2)
 
 #define OST_CONNECT_SUPPORTED2 (OBD_CONNECT2_LOCKAHEAD | OBD_CONNECT2_INC_XID |\
-				OBD_CONNECT2_ENCRYPT)
+				OBD_CONNECT2_ENCRYPT | \
+				OBD_CONNECT2_SETATTR_BATCH)
 
 #define ECHO_CONNECT_SUPPORTED (OBD_CONNECT_FID)
 #define ECHO_CONNECT_SUPPORTED2 0
@@ -1058,6 +1065,8 @@ enum ost_cmd {
 	OST_QUOTA_ADJUST_QUNIT = 20, /* not used since 2.4 */
 	OST_LADVISE    = 21,
 	OST_FALLOCATE  = 22,
+	/* 23 is OST_SEEK in upstream Lustre */
+	OST_SETATTR_BATCH = 24,
 	OST_LAST_OPC /* must be < 33 to avoid MDS_GETATTR */
 };
 #define OST_FIRST_OPC  OST_REPLY
@@ -1324,6 +1333,9 @@ lov_mds_md_max_stripe_count(__kernel_size_t buf_size, __u32 lmm_magic)
 #define OBD_MD_FLLAZYBLOCKS  (0x0800000000000000ULL) /* Lazy blocks */
 #define OBD_MD_FLBTIME       (0x1000000000000000ULL) /* birth time */
 #define OBD_MD_ENCCTX        (0x2000000000000000ULL) /* embed encryption ctx */
+/*	OBD_MD_NAMEHASH      (0x4000000000000000ULL) used by upstream Lustre */
+#define OBD_MD_FLLAZYTRUST   (0x8000000000000000ULL) /* lazy size/blocks are
+							* current, no writers */
 
 #define OBD_MD_FLALLQUOTA (OBD_MD_FLUSRQUOTA | \
 			   OBD_MD_FLGRPQUOTA | \
@@ -1534,6 +1546,12 @@ struct quota_body {
 /* qb_usage is the current qunit (in kbytes/inodes) when quota_body is used in
  * quota reply */
 #define qb_qunit	qb_usage
+/* qb_padding is the per-ID status when quota_body is used in the reply of
+ * QUOTA_DQACQ_BATCH */
+#define qb_rc		qb_padding
+
+/* maximum number of quota IDs in one QUOTA_DQACQ_BATCH request */
+#define QUOTA_DQACQ_BATCH_MAX	32
 
 #define QUOTA_DQACQ_FL_ACQ	0x1  /* acquire quota */
 #define QUOTA_DQACQ_FL_PREACQ	0x2  /* pre-acquire */
@@ -1626,6 +1644,7 @@ struct lquota_lvb {
 enum quota_cmd {
 	QUOTA_DQACQ	= 601,
 	QUOTA_DQREL	= 602,
+	QUOTA_DQACQ_BATCH = 603,
 	QUOTA_LAST_OPC
 };
 #define QUOTA_FIRST_OPC	QUOTA_DQACQ
@@ -2829,6 +2848,10 @@ struct llog_size_change_rec {
 
 /* changelog llog name, needed by client replicators */
 #define CHANGELOG_CATALOG "changelog_catalog"
+/* name of changelog shard catalogs 1 .. CHANGELOG_MAX_SHARDS - 1, shard 0
+ * is CHANGELOG_CATALOG itself. Readers merge the shards by cr_index. */
+#define CHANGELOG_CATALOG_SHARD "changelog_catalog_s%u"
+#define CHANGELOG_MAX_SHARDS 32
 
 struct changelog_setinfo {
         __u64 cs_recno;
@@ -2844,6 +2867,9 @@ struct llog_changelog_rec {
 
 #define CHANGELOG_USER_PREFIX "cl"
 
+/* flags of a changelog user, stored in cur_hdr.lrh_id */
+#define CLU_F_SHARDS	0x00000001	/* reads all CHANGELOG_CATALOG_SHARD */
+
 struct llog_changelog_user_rec {
 	struct llog_rec_hdr   cur_hdr;
 	__u32                 cur_id;
@@ -3138,6 +3164,19 @@ struct ost_body {
 	struct obdo oa;
 };
 
+/* one object of OST_SETATTR_BATCH, the ownership change carried by a
+ * MDS_SETATTR64_REC llog record */
+struct ost_setattr_rec {
+	struct ost_id	osr_oi;
+	__u64		osr_valid;	/* OBD_MD_FL{UID,GID,PROJID} */
+	__u32		osr_uid;
+	__u32		osr_gid;
+	__u32		osr_projid;
+	__s32		osr_rc;		/* result for this object in reply */
+};
+
+#define OST_SETATTR_BATCH_MAX	64
+
 /* Key for FIEMAP to be used in get_info calls */
 struct ll_fiemap_info_key {
 	char		lfik_name[8];
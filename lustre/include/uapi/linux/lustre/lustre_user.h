@@ -286,9 +286,10 @@ struct obd_statfs {
 					/* used in QoS code to find preferred
 					 * OSTs */
 	__u32           os_granted;	/* space granted for MDS */
-	__u32           os_spare3;	/* Unused padding fields.  Remember */
-	__u32           os_spare4;	/* to fix lustre_swab_obd_statfs() */
-	__u32           os_spare5;
+	__u32           os_io_rate;	/* recent read+write rate, MiB/s */
+	__u32           os_io_inflight;	/* bulk I/O requests in progress */
+	__u32           os_spare5;	/* Unused padding fields.  Remember */
+					/* to fix lustre_swab_obd_statfs() */
 	__u32           os_spare6;
 	__u32           os_spare7;
 	__u32           os_spare8;
@@ -1669,6 +1670,9 @@ enum changelog_send_flag {
 	CHANGELOG_FLAG_JOBID       = 0x04,
 	/* Pack additional flag bits into the changelog record */
 	CHANGELOG_FLAG_EXTRA_FLAGS = 0x08,
+	/* Receive records through a ring mapped from the changelog device
+	 * instead of read() calls, see struct changelog_ring_hdr. */
+	CHANGELOG_FLAG_RING        = 0x10,
 };
 
 enum changelog_send_extra_flag {
@@ -2102,6 +2106,52 @@ enum changelog_message_type {
 	CL_EOF    = 11, /* at end of current changelog */
 };
 
+/*
+ * Changelog record ring, shared between the changelog character device and
+ * its reader through mmap() of the device at offset 0. The mapping starts
+ * with this header, records are stored from crh_data_offset on.
+ *
+ * The kernel appends struct changelog_ring_rec entries and then advances
+ * crh_head, the reader consumes entries up to crh_head and then advances
+ * crh_tail. Both are byte counts that only grow, the position of an entry
+ * in the record area is the count modulo crh_data_size. If the kernel
+ * waits for room, it sets CHANGELOG_RING_WAKEUP and the reader has to call
+ * OBD_IOC_CHLG_RING_WAKE after advancing crh_tail.
+ */
+#define CHANGELOG_RING_MAGIC	0xC1A6F1A6
+
+enum changelog_ring_flags {
+	/* no more records, the changelog was read to its end */
+	CHANGELOG_RING_EOF	= 0x01,
+	/* reading the changelog failed, see crh_error */
+	CHANGELOG_RING_ERROR	= 0x02,
+	/* the kernel waits for the reader to free some room */
+	CHANGELOG_RING_WAKEUP	= 0x04,
+};
+
+struct changelog_ring_hdr {
+	__u32	crh_magic;
+	__u32	crh_flags;		/* enum changelog_ring_flags */
+	__u64	crh_data_offset;	/* offset of the record area */
+	__u64	crh_data_size;		/* size of the record area */
+	__u64	crh_head;		/* bytes produced, set by the kernel */
+	__u64	crh_tail;		/* bytes consumed, set by the reader */
+	__s32	crh_error;		/* with CHANGELOG_RING_ERROR */
+	__u32	crh_padding;
+};
+
+struct changelog_ring_rec {
+	__u32			crr_len;	/* 0: wrap to the area start */
+	__u32			crr_padding;
+	struct changelog_rec	crr_rec[0];
+};
+
+/* entries are 8 bytes aligned */
+static inline __kernel_size_t changelog_ring_rec_size(__kernel_size_t len)
+{
+	return (sizeof(struct changelog_ring_rec) + len + 7) & ~7;
+}
+
 /********* Misc **********/
 
 struct ioc_data_version {
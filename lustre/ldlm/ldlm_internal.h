@@ -173,6 +173,9 @@ int ldlm_lock_remove_from_lru_nolock(struct ldlm_lock *lock);
 void ldlm_lock_add_to_lru_nolock(struct ldlm_lock *lock);
 void ldlm_lock_add_to_lru(struct ldlm_lock *lock);
 void ldlm_lock_touch_in_lru(struct ldlm_lock *lock);
+void ldlm_resource_lru_hit(struct ldlm_resource *res);
+void ldlm_lru_ghost_add(struct ldlm_resource *res);
+void ldlm_lru_ghost_check(struct ldlm_resource *res);
 void ldlm_lock_destroy_nolock(struct ldlm_lock *lock);
 
 int ldlm_export_cancel_blocked_locks(struct obd_export *exp);
@@ -422,13 +425,18 @@ extern __u64 ldlm_reclaim_threshold;
 extern __u64 ldlm_lock_limit;
 extern __u64 ldlm_reclaim_threshold_mb;
 extern __u64 ldlm_lock_limit_mb;
+extern unsigned int ldlm_export_lock_soft_limit;
+extern unsigned int ldlm_export_lock_hard_limit;
 extern struct percpu_counter ldlm_granted_total;
 #endif
 int ldlm_reclaim_setup(void);
 void ldlm_reclaim_cleanup(void);
 void ldlm_reclaim_add(struct ldlm_lock *lock);
 void ldlm_reclaim_del(struct ldlm_lock *lock);
+void ldlm_reclaim_add_export(struct ldlm_lock *lock);
 bool ldlm_reclaim_full(void);
+bool ldlm_reclaim_export_full(struct obd_export *exp);
+__u64 ldlm_reclaim_export_slv(struct obd_export *exp, __u64 slv);
 
 static inline bool ldlm_res_eq(const struct ldlm_res_id *res0,
 			       const struct ldlm_res_id *res1)
@@ -3121,7 +3121,9 @@ int target_pack_pool_reply(struct ptlrpc_request *req)
 	obd = req->rq_export->exp_obd;
 
 	read_lock(&obd->obd_pool_lock);
-	lustre_msg_set_slv(req->rq_repmsg, obd->obd_pool_slv);
+	lustre_msg_set_slv(req->rq_repmsg,
+			   ldlm_reclaim_export_slv(req->rq_export,
+						   obd->obd_pool_slv));
 	lustre_msg_set_limit(req->rq_repmsg, obd->obd_pool_limit);
 	read_unlock(&obd->obd_pool_lock);
 
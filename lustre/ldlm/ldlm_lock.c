@@ -350,11 +350,70 @@ void ldlm_lock_touch_in_lru(struct ldlm_lock *lock)
 	if (!list_empty(&lock->l_lru)) {
 		ldlm_lock_remove_from_lru_nolock(lock);
 		ldlm_lock_add_to_lru_nolock(lock);
+		ldlm_resource_lru_hit(lock->l_resource);
 	}
 	spin_unlock(&ns->ns_lock);
 	EXIT;
 }
 
+/**
+ * Account a reuse of an unused lock of resource \a res, so that LRU
+ * cancellation prefers one-shot locks over the locks of \a res.
+ */
+void ldlm_resource_lru_hit(struct ldlm_resource *res)
+{
+	struct ldlm_namespace *ns = ldlm_res_to_ns(res);
+
+	if (atomic_read(&res->lr_lru_hits) < ns->ns_lru_hot_max)
+		atomic_inc(&res->lr_lru_hits);
+}
+
+static inline __u32 ldlm_lru_ghost_hash(const struct ldlm_res_id *name)
+{
+	/* 0 marks an empty slot */
+	return cfs_hash_djb2_hash(name, sizeof(*name), ~0U) | 1;
+}
+
+/**
+ * Remember that a lock of resource \a res is canceled from the LRU.
+ */
+void ldlm_lru_ghost_add(struct ldlm_resource *res)
+{
+	struct ldlm_namespace *ns = ldlm_res_to_ns(res);
+	__u32 hash;
+
+	if (ns->ns_lru_ghost == NULL)
+		return;
+
+	hash = ldlm_lru_ghost_hash(&res->lr_name);
+	WRITE_ONCE(ns->ns_lru_ghost[hash & (LDLM_LRU_GHOST_SIZE - 1)], hash);
+}
+
+/**
+ * Check whether the new resource \a res had its locks canceled from the
+ * LRU recently. Such a resource is enqueued again soon after the
+ * cancellation, count it and start it as a hot resource.
+ */
+void ldlm_lru_ghost_check(struct ldlm_resource *res)
+{
+	struct ldlm_namespace *ns = ldlm_res_to_ns(res);
+	__u32 *slot;
+	__u32 hash;
+
+	if (ns->ns_lru_ghost == NULL)
+		return;
+
+	hash = ldlm_lru_ghost_hash(&res->lr_name);
+	slot = &ns->ns_lru_ghost[hash & (LDLM_LRU_GHOST_SIZE - 1)];
+	if (READ_ONCE(*slot) != hash)
+		return;
+
+	WRITE_ONCE(*slot, 0);
+	atomic64_inc(&ns->ns_lru_refaults);
+	if (ns->ns_lru_hot_max > 0)
+		atomic_set(&res->lr_lru_hits, 1);
+}
+
 /**
  * Helper to destroy a locked lock.
  *
@@ -753,7 +812,8 @@ EXPORT_SYMBOL(ldlm_lock_addref);
 void ldlm_lock_addref_internal_nolock(struct ldlm_lock *lock,
 				      enum ldlm_mode mode)
 {
-        ldlm_lock_remove_from_lru(lock);
+	if (ldlm_lock_remove_from_lru(lock))
+		ldlm_resource_lru_hit(lock->l_resource);
         if (mode & (LCK_NL | LCK_CR | LCK_PR)) {
                 lock->l_readers++;
                 lu_ref_add_atomic(&lock->l_reference, "reader", lock);
@@ -1297,6 +1297,11 @@ int ldlm_handle_enqueue0(struct ldlm_namespace *ns,
 				  "Too many granted locks, reject current enqueue request and let the client retry later");
 			GOTO(out, rc = -EINPROGRESS);
 		}
+		if (ldlm_reclaim_export_full(req->rq_export)) {
+			DEBUG_REQ(D_DLMTRACE, req,
+				  "Too many granted locks for this export, reject current enqueue request and let the client retry later");
+			GOTO(out, rc = -EINPROGRESS);
+		}
 	}
 
 	/* The lock's callback data might be set in the policy function */
@@ -1410,6 +1415,9 @@ existing_lock:
 	dlm_rep->lock_flags = ldlm_flags_to_wire(flags);
 	lock->l_flags |= flags & LDLM_FL_INHERIT_MASK;
 
+	/* a lock replaced by the intent policy was granted without export */
+	ldlm_reclaim_add_export(lock);
+
 	/*
 	 * Don't move a pending lock onto the export if it has already been
 	 * disconnected due to eviction (b=5683) or server umount (b=24324).
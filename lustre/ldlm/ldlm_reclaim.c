@@ -48,6 +48,16 @@
  * ldlm_reclaim_threshold & ldlm_lock_limit is set to 20% & 30% of the
  * total memory by default. It is tunable via proc entry, when it's set
  * to 0, the feature is disabled.
+ *
+ * To keep a single client from using most of them, two per-export limits
+ * on the granted locks count are used as well, 0 disables them:
+ *
+ * ldlm_export_lock_soft_limit: An export holding more locks gets a lower
+ * SLV in its replies, so that a client with LRU resize shrinks its LRU,
+ * and its locks are revoked first when the server reclaims locks.
+ *
+ * ldlm_export_lock_hard_limit: An export holding more locks gets
+ * -EINPROGRESS for its enqueue requests, as for ldlm_lock_limit.
  */
 
 #ifdef HAVE_SERVER_SUPPORT
@@ -61,6 +71,9 @@ __u64 ldlm_lock_limit;
 __u64 ldlm_reclaim_threshold_mb;
 __u64 ldlm_lock_limit_mb;
 
+unsigned int ldlm_export_lock_soft_limit;
+unsigned int ldlm_export_lock_hard_limit;
+
 struct percpu_counter		ldlm_granted_total;
 static atomic_t			ldlm_nr_reclaimer;
 static s64			ldlm_last_reclaim_age_ns;
@@ -73,6 +86,7 @@ struct ldlm_reclaim_cb_data {
 	int			 rcd_cursor;
 	int			 rcd_start;
 	bool			 rcd_skip;
+	bool			 rcd_heavy;
 	s64			 rcd_age_ns;
 	struct cfs_hash_bd	*rcd_prev_bd;
 };
@@ -92,6 +106,14 @@ static inline bool ldlm_lock_reclaimable(struct ldlm_lock *lock)
 	return false;
 }
 
+static inline bool ldlm_export_lock_heavy(struct obd_export *exp)
+{
+	unsigned int soft = ldlm_export_lock_soft_limit;
+
+	return exp != NULL && soft != 0 &&
+	       (s64)atomic_read(&exp->exp_granted_locks) > soft;
+}
+
 /**
  * Callback function for revoking locks from certain resource.
  *
@@ -142,6 +164,9 @@ static int ldlm_reclaim_lock_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 		if (!ldlm_lock_reclaimable(lock))
 			continue;
 
+		if (data->rcd_heavy && !ldlm_export_lock_heavy(lock->l_export))
+			continue;
+
 		if (!OBD_FAIL_CHECK(OBD_FAIL_LDLM_WATERMARK_LOW) &&
 		    ktime_before(ktime_get(),
 				 ktime_add_ns(lock->l_last_used,
@@ -174,10 +199,12 @@ static int ldlm_reclaim_lock_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
  * \param[in] skip	scan from the first lock on resource if the
  *			'skip' is false, otherwise, continue scan
  *			from the last scanned position
+ * \param[in] heavy	only revoke locks of the exports over
+ *			ldlm_export_lock_soft_limit
  * \param[out] count	count of lock still to be revoked
  */
 static void ldlm_reclaim_res(struct ldlm_namespace *ns, int *count,
-			     s64 age_ns, bool skip)
+			     s64 age_ns, bool skip, bool heavy)
 {
 	struct ldlm_reclaim_cb_data	data;
 	int				idx, type, start;
@@ -203,6 +230,7 @@ static void ldlm_reclaim_res(struct ldlm_namespace *ns, int *count,
 	data.rcd_total = *count;
 	data.rcd_age_ns = age_ns;
 	data.rcd_skip = skip;
+	data.rcd_heavy = heavy;
 	data.rcd_prev_bd = NULL;
 	start = ns->ns_reclaim_start % CFS_HASH_NBKT(ns->ns_rs_hash);
 
@@ -241,46 +269,67 @@ static inline s64 ldlm_reclaim_age(void)
 }
 
 /**
- * Revoke certain amount of locks from all the server namespaces
- * in a roundrobin manner. Lock age is used to avoid reclaim on
- * the non-aged locks.
+ * Go once through all the server namespaces in a roundrobin manner to
+ * revoke locks, see ldlm_reclaim_res().
+ *
+ * \retval 0		success
+ * \retval -ENOENT	no server namespace
  */
-static void ldlm_reclaim_ns(void)
+static int ldlm_reclaim_all_ns(int *count, s64 age_ns, bool skip, bool heavy)
 {
 	struct ldlm_namespace	*ns;
-	int			 count = LDLM_RECLAIM_BATCH;
 	int			 ns_nr, nr_processed;
 	enum ldlm_side		 ns_cli = LDLM_NAMESPACE_SERVER;
-	s64 age_ns;
-	bool			 skip = true;
-	ENTRY;
-
-	if (!atomic_add_unless(&ldlm_nr_reclaimer, 1, 1)) {
-		EXIT;
-		return;
-	}
 
-	age_ns = ldlm_reclaim_age();
-again:
 	nr_processed = 0;
 	ns_nr = ldlm_namespace_nr_read(ns_cli);
-	while (count > 0 && nr_processed < ns_nr) {
+	while (*count > 0 && nr_processed < ns_nr) {
 		mutex_lock(ldlm_namespace_lock(ns_cli));
 
 		if (list_empty(ldlm_namespace_list(ns_cli))) {
 			mutex_unlock(ldlm_namespace_lock(ns_cli));
-			goto out;
+			return -ENOENT;
 		}
 
 		ns = ldlm_namespace_first_locked(ns_cli);
 		ldlm_namespace_move_to_active_locked(ns, ns_cli);
 		mutex_unlock(ldlm_namespace_lock(ns_cli));
 
-		ldlm_reclaim_res(ns, &count, age_ns, skip);
+		ldlm_reclaim_res(ns, count, age_ns, skip, heavy);
 		ldlm_namespace_put(ns);
 		nr_processed++;
 	}
 
+	return 0;
+}
+
+/**
+ * Revoke certain amount of locks from all the server namespaces
+ * in a roundrobin manner. Lock age is used to avoid reclaim on
+ * the non-aged locks. The locks of the exports over their soft
+ * limit are revoked first.
+ */
+static void ldlm_reclaim_ns(void)
+{
+	int			 count = LDLM_RECLAIM_BATCH;
+	s64 age_ns;
+	bool			 skip = true;
+	ENTRY;
+
+	if (!atomic_add_unless(&ldlm_nr_reclaimer, 1, 1)) {
+		EXIT;
+		return;
+	}
+
+	if (ldlm_export_lock_soft_limit != 0 &&
+	    ldlm_reclaim_all_ns(&count, LDLM_RECLAIM_AGE_MIN, skip, true) < 0)
+		goto out;
+
+	age_ns = ldlm_reclaim_age();
+again:
+	if (ldlm_reclaim_all_ns(&count, age_ns, skip, false) < 0)
+		goto out;
+
 	if (count > 0 && age_ns > LDLM_RECLAIM_AGE_MIN) {
 		age_ns >>= 1;
 		if (age_ns < (LDLM_RECLAIM_AGE_MIN * 2))
@@ -301,6 +350,10 @@ void ldlm_reclaim_add(struct ldlm_lock *lock)
 	if (!ldlm_lock_reclaimable(lock))
 		return;
 	percpu_counter_add(&ldlm_granted_total, 1);
+	if (lock->l_export != NULL) {
+		atomic_inc(&lock->l_export->exp_granted_locks);
+		lock->l_exp_counted = true;
+	}
 	lock->l_last_used = ktime_get();
 }
 
@@ -309,6 +362,25 @@ void ldlm_reclaim_del(struct ldlm_lock *lock)
 	if (!ldlm_lock_reclaimable(lock))
 		return;
 	percpu_counter_sub(&ldlm_granted_total, 1);
+	if (lock->l_exp_counted) {
+		atomic_dec(&lock->l_export->exp_granted_locks);
+		lock->l_exp_counted = false;
+	}
+}
+
+/**
+ * Account a granted lock to its export, if it was granted before it got
+ * one. This is the case of the locks granted by the intent policy of the
+ * MDT, see mdt_intent_lock_replace(). Called under the resource lock.
+ */
+void ldlm_reclaim_add_export(struct ldlm_lock *lock)
+{
+	if (lock->l_exp_counted || lock->l_export == NULL ||
+	    !ldlm_is_granted(lock) || ldlm_is_destroyed(lock) ||
+	    !ldlm_lock_reclaimable(lock))
+		return;
+	atomic_inc(&lock->l_export->exp_granted_locks);
+	lock->l_exp_counted = true;
 }
 
 /**
@@ -342,6 +414,38 @@ bool ldlm_reclaim_full(void)
 	return false;
 }
 
+/**
+ * Check on the granted locks of an export: return true if it reaches
+ * ldlm_export_lock_hard_limit, otherwise return false.
+ */
+bool ldlm_reclaim_export_full(struct obd_export *exp)
+{
+	unsigned int hard = ldlm_export_lock_hard_limit;
+
+	return hard != 0 &&
+	       (s64)atomic_read(&exp->exp_granted_locks) > hard;
+}
+
+/**
+ * Return the SLV to send to \a exp: the server SLV \a slv, lowered in
+ * proportion of the locks the export holds over its soft limit, so that
+ * the client cancels more locks from its LRU.
+ */
+__u64 ldlm_reclaim_export_slv(struct obd_export *exp, __u64 slv)
+{
+	unsigned int soft = ldlm_export_lock_soft_limit;
+	unsigned int granted;
+
+	if (!ldlm_export_lock_heavy(exp))
+		return slv;
+
+	granted = atomic_read(&exp->exp_granted_locks);
+	slv = div_u64(slv, granted) * soft;
+
+	/* 0 would mean no SLV to the client */
+	return max_t(__u64, slv, 1);
+}
+
 static inline __u64 ldlm_ratio2locknr(int ratio)
 {
 	__u64 locknr;
@@ -399,6 +503,20 @@ void ldlm_reclaim_del(struct ldlm_lock *lock)
 {
 }
 
+void ldlm_reclaim_add_export(struct ldlm_lock *lock)
+{
+}
+
+bool ldlm_reclaim_export_full(struct obd_export *exp)
+{
+	return false;
+}
+
+__u64 ldlm_reclaim_export_slv(struct obd_export *exp, __u64 slv)
+{
+	return slv;
+}
+
 int ldlm_reclaim_setup(void)
 {
 	return 0;
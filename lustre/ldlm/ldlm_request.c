@@ -1743,6 +1743,44 @@ ldlm_cancel_aged_no_wait_policy(struct ldlm_namespace *ns,
 	return ldlm_cancel_no_wait_policy(ns, lock, added, min);
 }
 
+/**
+ * Give a hot lock, i.e. a lock whose resource had locks reused from the
+ * LRU, one more round in the LRU instead of canceling it, so that cold
+ * one-shot locks are canceled first. Every round consumes one hit of the
+ * resource, and locks unused for ns_max_age are never kept.
+ *
+ * \retval true the lock was moved to the LRU tail
+ * \retval false the lock should be canceled
+ */
+static bool ldlm_lru_second_chance(struct ldlm_namespace *ns,
+				   struct ldlm_lock *lock, ktime_t last_use)
+{
+	struct ldlm_resource *res = lock->l_resource;
+	bool moved = false;
+
+	if (ns->ns_lru_hot_max == 0 || atomic_read(&res->lr_lru_hits) == 0)
+		return false;
+
+	if (ktime_after(ktime_get(), ktime_add(last_use, ns->ns_max_age)))
+		return false;
+
+	spin_lock(&ns->ns_lock);
+	/* the lock must not have been used since the policy check */
+	if (!list_empty(&lock->l_lru) && !ldlm_is_canceling(lock) &&
+	    !ktime_compare(last_use, lock->l_last_used) &&
+	    atomic_add_unless(&res->lr_lru_hits, -1, 0)) {
+		ldlm_lock_remove_from_lru_nolock(lock);
+		ldlm_lock_add_to_lru_nolock(lock);
+		moved = true;
+	}
+	spin_unlock(&ns->ns_lock);
+
+	if (moved)
+		atomic64_inc(&ns->ns_lru_second_chances);
+
+	return moved;
+}
+
 typedef enum ldlm_policy_res
 (*ldlm_cancel_lru_policy_t)(struct ldlm_namespace *ns, struct ldlm_lock *lock,
 			    int added, int min);
@@ -1781,6 +1819,8 @@ ldlm_cancel_lru_policy(struct ldlm_namespace *ns, enum ldlm_lru_flags lru_flags)
  *
  * Locks are cancelled according to the LRU resize policy (SLV from server)
  * if LRU resize is enabled; otherwise, the "aged policy" is used;
+ * locks of resources reused from the LRU get some extra rounds in the LRU,
+ * see ldlm_lru_second_chance().
  *
  * LRU flags:
  * ----------------------------------------
@@ -1899,6 +1939,13 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 			continue;
 		}
 
+		if (!(lru_flags & LDLM_LRU_FLAG_CLEANUP) &&
+		    ldlm_lru_second_chance(ns, lock, last_use)) {
+			lu_ref_del(&lock->l_reference, __func__, current);
+			LDLM_LOCK_RELEASE(lock);
+			continue;
+		}
+
 		lock_res_and_lock(lock);
 		/* Check flags again under the lock. */
 		if (ldlm_is_canceling(lock) ||
@@ -1952,6 +1999,8 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 		 */
 		LASSERT(list_empty(&lock->l_bl_ast));
 		list_add(&lock->l_bl_ast, cancels);
+		if (!(lru_flags & LDLM_LRU_FLAG_CLEANUP))
+			ldlm_lru_ghost_add(lock->l_resource);
 		unlock_res_and_lock(lock);
 		lu_ref_del(&lock->l_reference, __FUNCTION__, current);
 		added++;
@@ -224,6 +224,12 @@ static struct ldebugfs_vars ldlm_debugfs_list[] = {
 	{ .name =	"lock_granted_count",
 	  .fops =	&ldlm_granted_fops,
 	  .data =	&ldlm_granted_total },
+	{ .name =	"lock_export_soft_limit",
+	  .fops =	&ldlm_rw_uint_fops,
+	  .data =	&ldlm_export_lock_soft_limit },
+	{ .name =	"lock_export_hard_limit",
+	  .fops =	&ldlm_rw_uint_fops,
+	  .data =	&ldlm_export_lock_hard_limit },
 #endif
 	{ NULL }
 };
@@ -410,6 +416,54 @@ static ssize_t lru_max_age_store(struct kobject *kobj, struct attribute *attr,
 }
 LUSTRE_RW_ATTR(lru_max_age);
 
+static ssize_t lru_hot_max_show(struct kobject *kobj, struct attribute *attr,
+				char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+
+	return sprintf(buf, "%u\n", ns->ns_lru_hot_max);
+}
+
+static ssize_t lru_hot_max_store(struct kobject *kobj, struct attribute *attr,
+				 const char *buffer, size_t count)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+	unsigned int tmp;
+	int err;
+
+	err = kstrtouint(buffer, 10, &tmp);
+	if (err != 0)
+		return -EINVAL;
+
+	ns->ns_lru_hot_max = tmp;
+
+	return count;
+}
+LUSTRE_RW_ATTR(lru_hot_max);
+
+static ssize_t lru_second_chances_show(struct kobject *kobj,
+				       struct attribute *attr, char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+
+	return sprintf(buf, "%lld\n",
+		       (s64)atomic64_read(&ns->ns_lru_second_chances));
+}
+LUSTRE_RO_ATTR(lru_second_chances);
+
+static ssize_t lru_refaults_show(struct kobject *kobj, struct attribute *attr,
+				 char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+
+	return sprintf(buf, "%lld\n", (s64)atomic64_read(&ns->ns_lru_refaults));
+}
+LUSTRE_RO_ATTR(lru_refaults);
+
 static ssize_t early_lock_cancel_show(struct kobject *kobj,
 				      struct attribute *attr,
 				      char *buf)
@@ -625,6 +679,9 @@ static struct attribute *ldlm_ns_attrs[] = {
 	&lustre_attr_lock_unused_count.attr,
 	&lustre_attr_lru_size.attr,
 	&lustre_attr_lru_max_age.attr,
+	&lustre_attr_lru_hot_max.attr,
+	&lustre_attr_lru_second_chances.attr,
+	&lustre_attr_lru_refaults.attr,
 	&lustre_attr_early_lock_cancel.attr,
 	&lustre_attr_dirty_age_limit.attr,
 #ifdef HAVE_SERVER_SUPPORT
@@ -905,6 +962,9 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	ns->ns_nr_unused          = 0;
 	ns->ns_max_unused         = LDLM_DEFAULT_LRU_SIZE;
 	ns->ns_max_age            = ktime_set(LDLM_DEFAULT_MAX_ALIVE, 0);
+	ns->ns_lru_hot_max        = LDLM_DEFAULT_LRU_HOT_MAX;
+	atomic64_set(&ns->ns_lru_second_chances, 0);
+	atomic64_set(&ns->ns_lru_refaults, 0);
 	ns->ns_ctime_age_limit    = LDLM_CTIME_AGE_LIMIT;
 	ns->ns_dirty_age_limit    = ktime_set(LDLM_DIRTY_AGE_LIMIT, 0);
 	ns->ns_timeouts           = 0;
@@ -915,6 +975,10 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	ns->ns_last_pos		  = &ns->ns_unused_list;
 	ns->ns_flags		  = 0;
 
+	/* optional, failing to allocate it only disables refault tracking */
+	if (client == LDLM_NAMESPACE_CLIENT)
+		OBD_ALLOC_PTR_ARRAY(ns->ns_lru_ghost, LDLM_LRU_GHOST_SIZE);
+
 	rc = ldlm_namespace_sysfs_register(ns);
 	if (rc) {
 		CERROR("Can't initialize ns sysfs, rc %d\n", rc);
@@ -942,6 +1006,8 @@ out_sysfs:
 	ldlm_namespace_sysfs_unregister(ns);
 	ldlm_namespace_cleanup(ns, 0);
 out_hash:
+	if (ns->ns_lru_ghost != NULL)
+		OBD_FREE_PTR_ARRAY(ns->ns_lru_ghost, LDLM_LRU_GHOST_SIZE);
 	OBD_FREE_PTR_ARRAY_LARGE(ns->ns_rs_buckets, 1 << ns->ns_bucket_bits);
 	kfree(ns->ns_name);
 	cfs_hash_putref(ns->ns_rs_hash);
@@ -1211,6 +1277,8 @@ void ldlm_namespace_free_post(struct ldlm_namespace *ns)
 	ldlm_namespace_debugfs_unregister(ns);
 	ldlm_namespace_sysfs_unregister(ns);
 	cfs_hash_putref(ns->ns_rs_hash);
+	if (ns->ns_lru_ghost != NULL)
+		OBD_FREE_PTR_ARRAY(ns->ns_lru_ghost, LDLM_LRU_GHOST_SIZE);
 	OBD_FREE_PTR_ARRAY_LARGE(ns->ns_rs_buckets, 1 << ns->ns_bucket_bits);
 	kfree(ns->ns_name);
 	/* Namespace \a ns should be not on list at this time, otherwise
@@ -1387,6 +1455,7 @@ static struct ldlm_resource *ldlm_resource_new(enum ldlm_type ldlm_type)
 	 * immediatelly acquire mutex here. */
 	mutex_init(&res->lr_lvb_mutex);
 	res->lr_lvb_initialized = false;
+	atomic_set(&res->lr_lru_hits, 0);
 
 	return res;
 }
@@ -1475,6 +1544,9 @@ found:
 
 	OBD_FAIL_TIMEOUT(OBD_FAIL_LDLM_CREATE_RESOURCE, 2);
 
+	if (ns_is_client(ns))
+		ldlm_lru_ghost_check(res);
+
 	/* Let's see if we happened to be the very first resource in this
 	 * namespace. If so, and this is a client namespace, we need to move
 	 * the namespace into the active namespaces list to be patrolled by
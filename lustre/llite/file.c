@@ -301,6 +301,53 @@ int ll_md_real_close(struct inode *inode, fmode_t fmode)
 	RETURN(rc);
 }
 
+/**
+ * Account a read-only open of a regular file for the open cache, and tell
+ * whether an OPEN lock should be requested with it. Holding the lock keeps
+ * the MDS open handle cached at close, so that the following opens of the
+ * file are served locally without open/close RPCs. Called with
+ * lli_och_mutex held.
+ */
+static bool ll_open_cache_check(struct inode *inode, struct lookup_intent *it)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	struct ll_inode_info *lli = ll_i2info(inode);
+	ktime_t now = ktime_get();
+
+	if (!S_ISREG(inode->i_mode) || sbi->ll_oc_thrsh_count == 0 ||
+	    it->it_flags & (FMODE_WRITE | FMODE_EXEC | O_CREAT))
+		return false;
+
+	if (ktime_ms_delta(now, lli->lli_open_last_time) > sbi->ll_oc_thrsh_ms)
+		lli->lli_open_thrsh_count = 0;
+	lli->lli_open_last_time = now;
+	if (lli->lli_open_thrsh_count < UINT_MAX)
+		lli->lli_open_thrsh_count++;
+
+	return lli->lli_open_thrsh_count >= sbi->ll_oc_thrsh_count;
+}
+
+/**
+ * Whether a read open handle cached by the open cache should be closed,
+ * because the file was not opened again for ll_oc_max_ms.
+ */
+static bool ll_open_cache_expired(struct inode *inode)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	struct ll_inode_info *lli = ll_i2info(inode);
+	bool expired;
+
+	if (!S_ISREG(inode->i_mode) || sbi->ll_oc_thrsh_count == 0)
+		return false;
+
+	mutex_lock(&lli->lli_och_mutex);
+	expired = ktime_ms_delta(ktime_get(), lli->lli_open_last_time) >
+		  sbi->ll_oc_max_ms;
+	mutex_unlock(&lli->lli_och_mutex);
+
+	return expired;
+}
+
 static int ll_md_close(struct inode *inode, struct file *file)
 {
 	union ldlm_policy_data policy = {
@@ -356,6 +403,7 @@ static int ll_md_close(struct inode *inode, struct file *file)
 
 	/* LU-4398: do not cache write open lock if the file has exec bit */
 	if ((lockmode == LCK_CW && inode->i_mode & S_IXUGO) ||
+	    (lockmode == LCK_CR && ll_open_cache_expired(inode)) ||
 	    !md_lock_match(ll_i2mdexp(inode), flags, ll_inode2fid(inode),
 			   LDLM_IBITS, &policy, lockmode, &lockh))
 		rc = ll_md_real_close(inode, fd->fd_omode);
@@ -833,6 +881,8 @@ restart:
 			ll_release_openhandle(file_dentry(file), it);
 		}
 		(*och_usecount)++;
+		if (S_ISREG(inode->i_mode))
+			lli->lli_open_last_time = ktime_get();
 
 		rc = ll_local_open(file, it, fd, NULL);
 		if (rc) {
@@ -845,6 +895,7 @@ restart:
 		if (!it->it_disposition) {
 			struct dentry *dentry = file_dentry(file);
 			struct ll_dentry_data *ldd;
+			bool open_lock = ll_open_cache_check(inode, it);
 
 			/* We cannot just request lock handle now, new ELC code
 			 * means that one of other OPEN locks for this file
@@ -877,6 +928,12 @@ restart:
 					it->it_flags |= MDS_OPEN_LOCK;
 			}
 
+			/* file is reopened frequently, cache its open handle */
+			if (open_lock &&
+			    !filename_is_volatile(dentry->d_name.name,
+						  dentry->d_name.len, NULL))
+				it->it_flags |= MDS_OPEN_LOCK;
+
 			/*
 			 * Always specify MDS_OPEN_BY_FID because we don't want
 			 * to get file with different fid.
@@ -4843,6 +4900,11 @@ int ll_getattr_dentry(struct dentry *de, struct kstat *stat, u32 request_mask,
 	if (flags & AT_STATX_DONT_SYNC)
 		GOTO(fill_attr, rc = 0);
 
+	/* only a getattr reply received below may be trusted, the
+	 * cached attributes may predate a write open by another client
+	 * while the UPDATE lock is still held
+	 */
+	ll_file_clear_flag(lli, LLIF_LAZY_TRUST);
 	rc = ll_inode_revalidate(de, IT_GETATTR);
 	if (rc < 0)
 		RETURN(rc);
@@ -4880,6 +4942,29 @@ int ll_getattr_dentry(struct dentry *de, struct kstat *stat, u32 request_mask,
 			GOTO(fill_attr, rc);
 		}
 
+		/*
+		 * The MDT returns OBD_MD_FLLAZYTRUST if the lazy size and
+		 * blocks are up to date and no client has the file open for
+		 * write. If enabled, use them and skip the glimpse, unless
+		 * this client is writing the file itself or the attributes
+		 * did not come from a getattr RPC sent by this call.
+		 */
+		if (ll_sbi_has_lsom_trust(sbi) &&
+		    ll_file_test_and_clear_flag(lli, LLIF_LAZY_TRUST) &&
+		    lli->lli_attr_valid & OBD_MD_FLLAZYSIZE &&
+		    lli->lli_attr_valid & OBD_MD_FLLAZYBLOCKS &&
+		    lli->lli_attr_valid & OBD_MD_FLMTIME &&
+		    !lli->lli_open_fd_write_count) {
+			i_size_write(inode, lli->lli_lazysize);
+			inode->i_blocks = lli->lli_lazyblocks;
+			inode->i_mtime.tv_sec = lli->lli_mtime;
+			if (lli->lli_attr_valid & OBD_MD_FLATIME)
+				inode->i_atime.tv_sec = lli->lli_atime;
+			if (lli->lli_attr_valid & OBD_MD_FLCTIME)
+				inode->i_ctime.tv_sec = lli->lli_ctime;
+			GOTO(fill_attr, rc);
+		}
+
 		/* In case of restore, the MDT has the right size and has
 		 * already send it back without granting the layout lock,
 		 * inode is up-to-date so glimpse is useless.
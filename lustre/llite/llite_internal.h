@@ -236,6 +236,12 @@ struct ll_inode_info {
 			__u64			 lli_attr_valid;
 			__u64			 lli_lazysize;
 			__u64			 lli_lazyblocks;
+
+			/* open cache: consecutive opens within
+			 * ll_oc_thrsh_ms, protected by lli_och_mutex
+			 */
+			__u32			 lli_open_thrsh_count;
+			ktime_t			 lli_open_last_time;
 		};
 	};
 
@@ -403,6 +409,8 @@ enum ll_file_flags {
 	LLIF_PROJECT_INHERIT	= 3,
 	/* update atime from MDS even if it's older than local inode atime. */
 	LLIF_UPDATE_ATIME	= 4,
+	/* lazy size and blocks of the last getattr reply are current */
+	LLIF_LAZY_TRUST		= 5,
 
 };
 
@@ -640,6 +648,7 @@ enum stats_track_type {
 #define LL_SBI_FILE_HEAT    0x4000000 /* file heat support */
 #define LL_SBI_TEST_DUMMY_ENCRYPTION    0x8000000 /* test dummy encryption */
 #define LL_SBI_ENCRYPT	   0x10000000 /* client side encryption */
+#define LL_SBI_LSOM_TRUST  0x20000000 /* stat() uses LSOM without writers */
 #define LL_SBI_FLAGS { 	\
 	"nolck",	\
 	"checksum",	\
@@ -670,6 +679,7 @@ enum stats_track_type {
 	"file_heat",	\
 	"test_dummy_encryption", \
 	"noencrypt",	\
+	"lsom_trust",	\
 }
 
 /* This is embedded into llite super-blocks to keep track of connect
@@ -765,6 +775,15 @@ struct ll_sb_info {
 	unsigned int		  ll_heat_decay_weight;
 	unsigned int		  ll_heat_period_second;
 
+	/* Open cache: request an OPEN lock to keep the MDS open handle
+	 * after ll_oc_thrsh_count opens, each within ll_oc_thrsh_ms of the
+	 * previous one, and drop the cached handle at close if the file
+	 * was last opened more than ll_oc_max_ms ago.
+	 */
+	unsigned int		  ll_oc_thrsh_count;
+	unsigned int		  ll_oc_thrsh_ms;
+	unsigned int		  ll_oc_max_ms;
+
 	/* filesystem fsname */
 	char			  ll_fsname[LUSTRE_MAXFSNAME + 1];
 
@@ -774,6 +793,10 @@ struct ll_sb_info {
 
 #define SBI_DEFAULT_HEAT_DECAY_WEIGHT	((80 * 256 + 50) / 100)
 #define SBI_DEFAULT_HEAT_PERIOD_SECOND	(60)
+
+#define SBI_DEFAULT_OPENCACHE_THRESHOLD_COUNT	(5)
+#define SBI_DEFAULT_OPENCACHE_THRESHOLD_MS	(100)		/* 0.1 second */
+#define SBI_DEFAULT_OPENCACHE_MAX_MS		(60000)		/* 1 minute */
 /*
  * per file-descriptor read-ahead data.
  */
@@ -944,6 +967,11 @@ static inline bool ll_sbi_has_file_heat(struct ll_sb_info *sbi)
 	return !!(sbi->ll_flags & LL_SBI_FILE_HEAT);
 }
 
+static inline bool ll_sbi_has_lsom_trust(struct ll_sb_info *sbi)
+{
+	return !!(sbi->ll_flags & LL_SBI_LSOM_TRUST);
+}
+
 void ll_ras_enter(struct file *f, loff_t pos, size_t count);
 
 /* llite/lcommon_misc.c */
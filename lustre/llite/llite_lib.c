@@ -178,6 +178,11 @@ static struct ll_sb_info *ll_init_sbi(void)
 	/* Per-filesystem file heat */
 	sbi->ll_heat_decay_weight = SBI_DEFAULT_HEAT_DECAY_WEIGHT;
 	sbi->ll_heat_period_second = SBI_DEFAULT_HEAT_PERIOD_SECOND;
+
+	/* Per-filesystem open cache */
+	sbi->ll_oc_thrsh_count = SBI_DEFAULT_OPENCACHE_THRESHOLD_COUNT;
+	sbi->ll_oc_thrsh_ms = SBI_DEFAULT_OPENCACHE_THRESHOLD_MS;
+	sbi->ll_oc_max_ms = SBI_DEFAULT_OPENCACHE_MAX_MS;
 	RETURN(sbi);
 out_destroy_ra:
 	destroy_workqueue(sbi->ll_ra_info.ll_readahead_wq);
@@ -277,7 +282,8 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt)
 				   OBD_CONNECT2_ASYNC_DISCARD |
 				   OBD_CONNECT2_PCC |
 				   OBD_CONNECT2_CRUSH |
-				   OBD_CONNECT2_GETATTR_PFID;
+				   OBD_CONNECT2_GETATTR_PFID |
+				   OBD_CONNECT2_LSOM_TRUST;
 
 #ifdef HAVE_LRU_RESIZE_SUPPORT
         if (sbi->ll_flags & LL_SBI_LRU_RESIZE)
@@ -1051,6 +1057,8 @@ void ll_lli_init(struct ll_inode_info *lli)
 		mutex_init(&lli->lli_group_mutex);
 		lli->lli_group_users = 0;
 		lli->lli_group_gid = 0;
+		lli->lli_open_thrsh_count = 0;
+		lli->lli_open_last_time = ktime_set(0, 0);
 	}
 	mutex_init(&lli->lli_layout_mutex);
 	memset(lli->lli_jobid, 0, sizeof(lli->lli_jobid));
@@ -2374,6 +2382,12 @@ int ll_update_inode(struct inode *inode, struct lustre_md *md)
 			lli->lli_lazyblocks = body->mbo_blocks;
 	}
 
+	if (body->mbo_valid & OBD_MD_FLLAZYTRUST &&
+	    exp_connect_flags2(sbi->ll_md_exp) & OBD_CONNECT2_LSOM_TRUST)
+		ll_file_set_flag(lli, LLIF_LAZY_TRUST);
+	else
+		ll_file_clear_flag(lli, LLIF_LAZY_TRUST);
+
 	if (body->mbo_valid & OBD_MD_TSTATE) {
 		/* Set LLIF_FILE_RESTORING if restore ongoing and
 		 * clear it when done to ensure to start again
@@ -2259,6 +2259,8 @@ static void __exit lod_exit(void)
 	}
 
 	class_unregister_type(LUSTRE_LOD_NAME);
+	/* wait for QoS snapshots freed by RCU callback */
+	rcu_barrier();
 	lu_kmem_fini(lod_caches);
 }
 
@@ -54,11 +54,33 @@
 #define LMVEA_DELETE_VALUES(count, offset)				\
 	((count) == 0 && (offset) == (typeof(offset))(-1))
 
+/*
+ * Weights of the usable OSTs of a pool, built under lq_rw_sem and then
+ * read without lock by QoS allocation until it's replaced.
+ */
+struct lod_qos_snapshot {
+	struct rcu_head		 lqs_rcu;
+	atomic_t		 lqs_ref;
+	/* objects allocated with this snapshot */
+	atomic_t		 lqs_allocs;
+	/* rebuild after this many allocations, or after lqs_expire */
+	unsigned int		 lqs_alloc_max;
+	time64_t		 lqs_expire;
+	/* allocation failed with this snapshot, rebuild */
+	bool			 lqs_stale;
+	__u32			 lqs_count;
+	size_t			 lqs_size;
+	/* OST indices, and cumulative weights for weighted random pick */
+	__u32			*lqs_idx;
+	__u64			*lqs_cum_weight;
+};
+
 struct pool_desc {
 	char			 pool_name[LOV_MAXPOOLNAME + 1];
 	struct lu_tgt_pool	 pool_obds;	/* pool members */
 	atomic_t		 pool_refcount;
 	struct lu_qos_rr	 pool_rr;
+	struct lod_qos_snapshot	*pool_qos_snap;	/* QoS weights */
 	struct rhash_head	 pool_hash;	/* access by poolname */
 	struct list_head	 pool_list;
 	struct rcu_head		 pool_rcu;
@@ -112,6 +134,8 @@ struct lod_device {
 
 	/* Description of OST */
 	struct lod_tgt_descs  lod_ost_descs;
+	/* QoS weights of all OSTs */
+	struct lod_qos_snapshot *lod_ost_qos_snap;
 	/* Description of MDT */
 	struct lod_tgt_descs  lod_mdt_descs;
 
@@ -694,6 +718,7 @@ __u16 lod_get_stripe_count(struct lod_device *lod, struct lod_object *lo,
 			   __u16 stripe_count, bool overstriping);
 void lod_qos_statfs_update(const struct lu_env *env, struct lod_device *lod,
 			   struct lu_tgt_descs *ltd);
+void lod_qos_snapshot_drop(struct lod_qos_snapshot **slot);
 
 /* lproc_lod.c */
 int lod_procfs_init(struct lod_device *lod);
@@ -195,7 +195,9 @@ int lod_add_device(const struct lu_env *env, struct lod_device *lod,
 					   OBD_CONNECT_VERSION |
 					   OBD_CONNECT_PINGLESS |
 					   OBD_CONNECT_LFSCK |
-					   OBD_CONNECT_BULK_MBITS;
+					   OBD_CONNECT_BULK_MBITS |
+					   OBD_CONNECT_FLAGS2;
+		data->ocd_connect_flags2 = OBD_CONNECT2_SETATTR_BATCH;
 
 		data->ocd_group = tgt_index;
 		ltd = &lod->lod_ost_descs;
@@ -2246,6 +2248,7 @@ int lod_pools_fini(struct lod_device *lod)
 	}
 
 	lod_pool_hash_destroy(&lod->lod_pools_hash_body);
+	lod_qos_snapshot_drop(&lod->lod_ost_qos_snap);
 	tgt_pool_free(&lod->lod_ost_descs.ltd_qos.lq_rr.lqr_pool);
 	tgt_pool_free(&lod->lod_ost_descs.ltd_tgt_pool);
 	tgt_pool_free(&lod->lod_mdt_descs.ltd_qos.lq_rr.lqr_pool);
@@ -101,6 +101,7 @@ void lod_pool_putref(struct pool_desc *pool)
 		LASSERT(pool->pool_proc_entry == NULL);
 		tgt_pool_free(&(pool->pool_rr.lqr_pool));
 		tgt_pool_free(&(pool->pool_obds));
+		lod_qos_snapshot_drop(&pool->pool_qos_snap);
 		kfree_rcu(pool, pool_rcu);
 		EXIT;
 	}
@@ -566,6 +567,7 @@ int lod_pool_add(struct obd_device *obd, char *poolname, char *ostname)
 		GOTO(out, rc);
 
 	pool->pool_rr.lqr_dirty = 1;
+	lod_qos_snapshot_drop(&pool->pool_qos_snap);
 
 	CDEBUG(D_CONFIG, "Added %s to "LOV_POOLNAMEF" as member %d\n",
 			ostname, poolname,  pool_tgt_count(pool));
@@ -626,6 +628,7 @@ int lod_pool_remove(struct obd_device *obd, char *poolname, char *ostname)
 
 	tgt_pool_remove(&pool->pool_obds, ost->ltd_index);
 	pool->pool_rr.lqr_dirty = 1;
+	lod_qos_snapshot_drop(&pool->pool_qos_snap);
 
 	CDEBUG(D_CONFIG, "%s removed from "LOV_POOLNAMEF"\n", ostname,
 	       poolname);
@@ -203,6 +203,7 @@ void lod_qos_statfs_update(const struct lu_env *env, struct lod_device *lod,
 	struct lu_tgt_desc *tgt;
 	time64_t max_age;
 	u64 avail;
+	u32 rate, inflight;
 	ENTRY;
 
 	max_age = ktime_get_seconds() - 2 * ltd->ltd_lov_desc.ld_qos_maxage;
@@ -218,10 +219,14 @@ void lod_qos_statfs_update(const struct lu_env *env, struct lod_device *lod,
 
 	ltd_foreach_tgt(ltd, tgt) {
 		avail = tgt->ltd_statfs.os_bavail;
+		rate = tgt->ltd_statfs.os_io_rate;
+		inflight = tgt->ltd_statfs.os_io_inflight;
 		if (lod_statfs_and_check(env, lod, ltd, tgt, 0))
 			continue;
 
-		if (tgt->ltd_statfs.os_bavail != avail)
+		if (tgt->ltd_statfs.os_bavail != avail ||
+		    tgt->ltd_statfs.os_io_rate != rate ||
+		    tgt->ltd_statfs.os_io_inflight != inflight)
 			/* recalculate weigths */
 			ltd->ltd_qos.lq_dirty = 1;
 	}
@@ -1371,6 +1376,269 @@ out:
 	RETURN(rc);
 }
 
+static void lod_qos_snapshot_free_rcu(struct rcu_head *head)
+{
+	struct lod_qos_snapshot *snap;
+
+	snap = container_of(head, struct lod_qos_snapshot, lqs_rcu);
+	OBD_FREE_LARGE(snap, snap->lqs_size);
+}
+
+static void lod_qos_snapshot_put(struct lod_qos_snapshot *snap)
+{
+	if (atomic_dec_and_test(&snap->lqs_ref))
+		call_rcu(&snap->lqs_rcu, lod_qos_snapshot_free_rcu);
+}
+
+static struct lod_qos_snapshot *
+lod_qos_snapshot_get(struct lod_qos_snapshot **slot)
+{
+	struct lod_qos_snapshot *snap;
+
+	rcu_read_lock();
+	snap = rcu_dereference(*slot);
+	if (snap && !atomic_inc_not_zero(&snap->lqs_ref))
+		snap = NULL;
+	rcu_read_unlock();
+
+	return snap;
+}
+
+static void lod_qos_snapshot_publish(struct lod_qos_snapshot **slot,
+				     struct lod_qos_snapshot *snap)
+{
+	struct lod_qos_snapshot *old;
+
+	/* xchg() is a full barrier, @snap is initialized before seen */
+	old = xchg(slot, snap);
+	if (old)
+		lod_qos_snapshot_put(old);
+}
+
+/**
+ * Drop QoS snapshot, the next allocation will build a new one.
+ *
+ * \param[in] slot	snapshot pointer of LOD device or pool
+ */
+void lod_qos_snapshot_drop(struct lod_qos_snapshot **slot)
+{
+	lod_qos_snapshot_publish(slot, NULL);
+}
+
+static bool lod_qos_snapshot_stale(struct lu_tgt_descs *ltd,
+				   struct lod_qos_snapshot *snap)
+{
+	return READ_ONCE(snap->lqs_stale) || ltd->ltd_qos.lq_dirty ||
+	       atomic_read(&snap->lqs_allocs) >= snap->lqs_alloc_max ||
+	       ktime_get_seconds() > snap->lqs_expire;
+}
+
+/**
+ * Build QoS snapshot of OSTs in \a osts.
+ *
+ * Penalties are recalculated with the allocations made since the last
+ * build, then the weights of usable OSTs are saved in a new snapshot which
+ * replaces the old one. Caller must hold lq_rw_sem for write.
+ *
+ * \param[in] env	execution environment for this thread
+ * \param[in] lod	LOD device
+ * \param[in] pool	pool, or NULL for all OSTs
+ * \param[in] slot	snapshot pointer of LOD device or pool
+ *
+ * \retval 0		on success
+ * \retval -EAGAIN	QoS can't be used, or no OST is usable
+ * \retval negative	errno on failure
+ */
+static int lod_qos_snapshot_build(const struct lu_env *env,
+				  struct lod_device *lod,
+				  struct pool_desc *pool,
+				  struct lod_qos_snapshot **slot)
+{
+	struct lu_tgt_descs *ltd = &lod->lod_ost_descs;
+	struct lod_qos_snapshot *snap = NULL;
+	struct lu_tgt_pool *osts;
+	struct lod_tgt_desc *ost;
+	__u64 total_weight = 0;
+	size_t size;
+	__u32 count = 0;
+	__u32 idx;
+	int i;
+	int rc;
+
+	ENTRY;
+
+	if (!ltd_qos_is_usable(ltd))
+		GOTO(out, rc = -EAGAIN);
+
+	rc = ltd_qos_penalties_calc(ltd);
+	if (rc)
+		GOTO(out, rc);
+
+	ltd_qos_allocs_fold(ltd);
+
+	if (pool) {
+		down_read(&pool_tgt_rw_sem(pool));
+		osts = &pool->pool_obds;
+	} else {
+		osts = &ltd->ltd_tgt_pool;
+	}
+
+	size = sizeof(*snap) +
+	       osts->op_count * (sizeof(__u64) + sizeof(__u32));
+	OBD_ALLOC_LARGE(snap, size);
+	if (!snap)
+		GOTO(out_pool, rc = -ENOMEM);
+
+	snap->lqs_size = size;
+	snap->lqs_cum_weight = (__u64 *)(snap + 1);
+	snap->lqs_idx = (__u32 *)(snap->lqs_cum_weight + osts->op_count);
+
+	for (i = 0; i < osts->op_count; i++) {
+		idx = osts->op_array[i];
+		if (!test_bit(idx, lod->lod_ost_bitmap))
+			continue;
+
+		ost = OST_TGT(lod, idx);
+		if (lod_statfs_and_check(env, lod, ltd, ost, 0))
+			continue;
+
+		if (ost->ltd_statfs.os_state & OS_STATFS_DEGRADED)
+			continue;
+
+		/* Fail Check before osc_precreate() is called
+		 * so we can only 'fail' single OSC.
+		 */
+		if (OBD_FAIL_CHECK(OBD_FAIL_MDS_OSC_PRECREATE) && idx == 0)
+			continue;
+
+		lu_tgt_qos_weight_calc(ost);
+		total_weight += ost->ltd_qos.ltq_weight;
+		snap->lqs_cum_weight[count] = total_weight;
+		snap->lqs_idx[count] = idx;
+		count++;
+	}
+
+	QOS_DEBUG("found %d good osts\n", count);
+
+	if (!count) {
+		OBD_FREE_LARGE(snap, size);
+		snap = NULL;
+		GOTO(out_pool, rc = -EAGAIN);
+	}
+
+	atomic_set(&snap->lqs_ref, 1);
+	atomic_set(&snap->lqs_allocs, 0);
+	snap->lqs_count = count;
+	/* rebuilt after one allocation per two OSTs, so that the penalty of
+	 * an OST is applied before it is likely to be picked again */
+	snap->lqs_alloc_max = max(count / 2, 1U);
+	snap->lqs_expire = ktime_get_seconds() +
+			   ltd->ltd_lov_desc.ld_qos_maxage;
+	rc = 0;
+
+out_pool:
+	if (pool)
+		up_read(&pool_tgt_rw_sem(pool));
+out:
+	/* drop old snapshot on failure */
+	lod_qos_snapshot_publish(slot, snap);
+
+	RETURN(rc);
+}
+
+/* pick OST index with weights as probability */
+static __u32 lod_qos_snapshot_pick(struct lod_qos_snapshot *snap)
+{
+	__u64 total = snap->lqs_cum_weight[snap->lqs_count - 1];
+	__u64 rand;
+	__u32 lo = 0;
+	__u32 hi = snap->lqs_count - 1;
+	__u32 mid;
+
+	if (!total)
+		return snap->lqs_idx[lu_prandom_u64_max(snap->lqs_count)];
+
+	/* find the first OST whose cumulative weight is above @rand, so that
+	 * 0-weight OSTs are never picked
+	 */
+	rand = lu_prandom_u64_max(total);
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (snap->lqs_cum_weight[mid] > rand)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return snap->lqs_idx[lo];
+}
+
+/**
+ * Try to allocate the next stripe on OST \a idx.
+ *
+ * \retval 0		object is declared on OST
+ * \retval negative	OST can't be used
+ */
+static int lod_qos_snapshot_try(const struct lu_env *env,
+				struct lod_object *lo,
+				struct lod_layout_component *lod_comp,
+				__u32 idx, __u32 nfound,
+				struct dt_object **stripe, __u32 *ost_indices,
+				struct thandle *th, bool *overstriped,
+				__u64 reserve)
+{
+	struct lod_device *lod = lu2lod_dev(lo->ldo_obj.do_lu.lo_dev);
+	struct lod_avoid_guide *lag = &lod_env_info(env)->lti_avoid;
+	struct lod_tgt_desc *ost;
+	struct dt_object *o;
+	int rc;
+
+	/* OST could be removed after snapshot was built */
+	if (!test_bit(idx, lod->lod_ost_bitmap))
+		return -EAGAIN;
+
+	if (lod_should_avoid_ost(lo, lag, idx))
+		return -EAGAIN;
+
+	/*
+	 * do not put >1 objects on a single OST, except for
+	 * overstriping
+	 */
+	if ((lod_comp_is_ost_used(env, lo, idx)) &&
+	    !(lod_comp->llc_pattern & LOV_PATTERN_OVERSTRIPING))
+		return -EAGAIN;
+
+	if (lod_qos_is_tgt_used(env, idx, nfound)) {
+		if (!(lod_comp->llc_pattern & LOV_PATTERN_OVERSTRIPING))
+			return -EAGAIN;
+		*overstriped = true;
+	}
+
+	ost = OST_TGT(lod, idx);
+	rc = lod_statfs_and_check(env, lod, &lod->lod_ost_descs, ost, reserve);
+	if (rc)
+		return rc;
+
+	if (ost->ltd_statfs.os_state & OS_STATFS_DEGRADED)
+		return -EAGAIN;
+
+	QOS_DEBUG("stripe=%d to idx=%d\n", nfound, idx);
+	o = lod_qos_declare_object_on(env, lod, idx, th);
+	if (IS_ERR(o)) {
+		QOS_DEBUG("can't declare object on #%u: %d\n",
+			  idx, (int) PTR_ERR(o));
+		return PTR_ERR(o);
+	}
+
+	lod_avoid_update(lo, lag);
+	lod_qos_tgt_in_use(env, nfound, idx);
+	stripe[nfound] = o;
+	ost_indices[nfound] = idx;
+	atomic_inc(&ost->ltd_qos.ltq_allocs);
+
+	return 0;
+}
+
 /**
  * Allocate a striping using an algorithm with weights.
  *
@@ -1388,10 +1656,12 @@ out:
  * No concurrent allocation is allowed on the object and this must be ensured
  * by the caller. All the internal structures are protected by the function.
  *
- * The algorithm has two steps: find available OSTs and calculate their
- * weights, then select the OSTs with their weights used as the probability.
- * An OST with a higher weight is proportionately more likely to be selected
- * than one with a lower weight.
+ * The weights of usable OSTs are kept in a snapshot shared by all
+ * allocations, which select OSTs with their weights used as the probability
+ * without taking any lock. An OST with a higher weight is proportionately
+ * more likely to be selected than one with a lower weight. The snapshot is
+ * rebuilt by one allocating thread under lq_rw_sem when it's outdated, while
+ * the others keep using the old one.
  *
  * \param[in] env		execution environment for this thread
  * \param[in] lo		LOD object
@@ -1413,14 +1683,12 @@ static int lod_ost_alloc_qos(const struct lu_env *env, struct lod_object *lo,
 {
 	struct lod_layout_component *lod_comp;
 	struct lod_device *lod = lu2lod_dev(lo->ldo_obj.do_lu.lo_dev);
-	struct lod_avoid_guide *lag = &lod_env_info(env)->lti_avoid;
-	struct lod_tgt_desc *ost;
-	struct dt_object *o;
-	__u64 total_weight = 0;
+	struct lu_tgt_descs *ltd = &lod->lod_ost_descs;
+	struct lod_qos_snapshot **slot = &lod->lod_ost_qos_snap;
+	struct lod_qos_snapshot *snap;
 	struct pool_desc *pool = NULL;
-	struct lu_tgt_pool *osts;
 	unsigned int i;
-	__u32 nfound, good_osts, stripe_count, stripe_count_min;
+	__u32 nfound, stripe_count, stripe_count_min, tries;
 	bool overstriped = false;
 	int stripes_per_ost = 1;
 	int rc = 0;
@@ -1435,156 +1703,87 @@ static int lod_ost_alloc_qos(const struct lu_env *env, struct lod_object *lo,
 
 	if (lod_comp->llc_pool != NULL)
 		pool = lod_find_pool(lod, lod_comp->llc_pool);
-
-	if (pool != NULL) {
-		down_read(&pool_tgt_rw_sem(pool));
-		osts = &(pool->pool_obds);
-	} else {
-		osts = &lod->lod_ost_descs.ltd_tgt_pool;
-	}
+	if (pool != NULL)
+		slot = &pool->pool_qos_snap;
 
 	/* Detect -EAGAIN early, before expensive lock is taken. */
-	if (!ltd_qos_is_usable(&lod->lod_ost_descs))
-		GOTO(out_nolock, rc = -EAGAIN);
-
-	if (lod_comp->llc_pattern & LOV_PATTERN_OVERSTRIPING)
-		stripes_per_ost =
-			(lod_comp->llc_stripe_count - 1)/osts->op_count + 1;
-
-	/* Do actual allocation, use write lock here. */
-	down_write(&lod->lod_ost_descs.ltd_qos.lq_rw_sem);
-
-	/*
-	 * Check again, while we were sleeping on @lq_rw_sem things could
-	 * change.
-	 */
-	if (!ltd_qos_is_usable(&lod->lod_ost_descs))
-		GOTO(out, rc = -EAGAIN);
-
-	rc = ltd_qos_penalties_calc(&lod->lod_ost_descs);
-	if (rc)
-		GOTO(out, rc);
-
-	rc = lod_qos_tgt_in_use_clear(env, lod_comp->llc_stripe_count);
-	if (rc)
-		GOTO(out, rc);
-
-	good_osts = 0;
-	/* Find all the OSTs that are valid stripe candidates */
-	for (i = 0; i < osts->op_count; i++) {
-		if (!test_bit(osts->op_array[i], lod->lod_ost_bitmap))
-			continue;
-
-		ost = OST_TGT(lod, osts->op_array[i]);
-		ost->ltd_qos.ltq_usable = 0;
+	if (!ltd_qos_is_usable(ltd))
+		GOTO(out_pool, rc = -EAGAIN);
 
-		rc = lod_statfs_and_check(env, lod, &lod->lod_ost_descs,
-					  ost, reserve);
-		if (rc) {
-			/* this OSP doesn't feel well */
-			continue;
-		}
+	snap = lod_qos_snapshot_get(slot);
+	if (!snap || lod_qos_snapshot_stale(ltd, snap)) {
+		/* without a snapshot wait for it, otherwise let one thread
+		 * rebuild it, and others use the old one
+		 */
+		if (!snap)
+			down_write(&ltd->ltd_qos.lq_rw_sem);
+		else if (!down_write_trylock(&ltd->ltd_qos.lq_rw_sem))
+			goto alloc;
 
-		if (ost->ltd_statfs.os_state & OS_STATFS_DEGRADED)
-			continue;
+		if (snap)
+			lod_qos_snapshot_put(snap);
 
-		/* Fail Check before osc_precreate() is called
-		 * so we can only 'fail' single OSC.
+		/*
+		 * Check again, while we were sleeping on @lq_rw_sem the
+		 * snapshot could be rebuilt.
 		 */
-		if (OBD_FAIL_CHECK(OBD_FAIL_MDS_OSC_PRECREATE) &&
-				   osts->op_array[i] == 0)
-			continue;
-
-		ost->ltd_qos.ltq_usable = 1;
-		lu_tgt_qos_weight_calc(ost);
-		total_weight += ost->ltd_qos.ltq_weight;
+		snap = lod_qos_snapshot_get(slot);
+		if (!snap || lod_qos_snapshot_stale(ltd, snap)) {
+			if (snap)
+				lod_qos_snapshot_put(snap);
+			rc = lod_qos_snapshot_build(env, lod, pool, slot);
+			snap = rc ? NULL : lod_qos_snapshot_get(slot);
+		}
+		up_write(&ltd->ltd_qos.lq_rw_sem);
 
-		good_osts++;
+		if (!snap)
+			GOTO(out_pool, rc = rc ?: -EAGAIN);
 	}
 
-	QOS_DEBUG("found %d good osts\n", good_osts);
-
-	if (good_osts < stripe_count_min)
+alloc:
+	if (snap->lqs_count < stripe_count_min)
 		GOTO(out, rc = -EAGAIN);
 
+	if (lod_comp->llc_pattern & LOV_PATTERN_OVERSTRIPING)
+		stripes_per_ost = (stripe_count - 1) / snap->lqs_count + 1;
+
 	/* If we do not have enough OSTs for the requested stripe count, do not
 	 * put more stripes per OST than requested.
 	 */
-	if (stripe_count / stripes_per_ost > good_osts)
-		stripe_count = good_osts * stripes_per_ost;
-
-	/* Find enough OSTs with weighted random allocation. */
-	nfound = 0;
-	while (nfound < stripe_count) {
-		u64 rand, cur_weight;
-
-		cur_weight = 0;
-		rc = -ENOSPC;
-
-		rand = lu_prandom_u64_max(total_weight);
-
-		/* On average, this will hit larger-weighted OSTs more often.
-		 * 0-weight OSTs will always get used last (only when rand=0)
-		 */
-		for (i = 0; i < osts->op_count; i++) {
-			__u32 idx = osts->op_array[i];
-
-			if (lod_should_avoid_ost(lo, lag, idx))
-				continue;
-
-			ost = OST_TGT(lod, idx);
-
-			if (!ost->ltd_qos.ltq_usable)
-				continue;
-
-			cur_weight += ost->ltd_qos.ltq_weight;
-			QOS_DEBUG("stripe_count=%d nfound=%d cur_weight=%llu "
-				  "rand=%llu total_weight=%llu\n",
-				  stripe_count, nfound, cur_weight, rand,
-				  total_weight);
-
-			if (cur_weight < rand)
-				continue;
-
-			QOS_DEBUG("stripe=%d to idx=%d\n", nfound, idx);
-			/*
-			 * do not put >1 objects on a single OST, except for
-			 * overstriping
-			 */
-			if ((lod_comp_is_ost_used(env, lo, idx)) &&
-			    !(lod_comp->llc_pattern & LOV_PATTERN_OVERSTRIPING))
-				continue;
-
-			if (lod_qos_is_tgt_used(env, idx, nfound)) {
-				if (lod_comp->llc_pattern &
-				    LOV_PATTERN_OVERSTRIPING)
-					overstriped = true;
-				else
-					continue;
-			}
+	if (stripe_count / stripes_per_ost > snap->lqs_count)
+		stripe_count = snap->lqs_count * stripes_per_ost;
 
-			o = lod_qos_declare_object_on(env, lod, idx, th);
-			if (IS_ERR(o)) {
-				QOS_DEBUG("can't declare object on #%u: %d\n",
-					  idx, (int) PTR_ERR(o));
-				continue;
-			}
+	rc = lod_qos_tgt_in_use_clear(env, lod_comp->llc_stripe_count);
+	if (rc)
+		GOTO(out, rc);
 
-			lod_avoid_update(lo, lag);
-			lod_qos_tgt_in_use(env, nfound, idx);
-			stripe[nfound] = o;
-			ost_indices[nfound] = idx;
-			ltd_qos_update(&lod->lod_ost_descs, ost, &total_weight);
+	/* Find enough OSTs with weighted random allocation, then fall back to
+	 * walk all OSTs in case OSTs picked are not usable.
+	 */
+	nfound = 0;
+	tries = 2 * stripe_count + 8;
+	while (nfound < stripe_count && tries-- > 0) {
+		if (!lod_qos_snapshot_try(env, lo, lod_comp,
+					  lod_qos_snapshot_pick(snap), nfound,
+					  stripe, ost_indices, th,
+					  &overstriped, reserve))
 			nfound++;
-			rc = 0;
-			break;
-		}
+	}
 
-		if (rc) {
-			/* no OST found on this iteration, give up */
-			break;
+	if (nfound < stripe_count) {
+		__u32 start = lu_prandom_u64_max(snap->lqs_count);
+
+		for (i = 0; i < snap->lqs_count * stripes_per_ost &&
+			    nfound < stripe_count; i++) {
+			if (!lod_qos_snapshot_try(env, lo, lod_comp,
+					snap->lqs_idx[(start + i) %
+						      snap->lqs_count],
+					nfound, stripe, ost_indices, th,
+					&overstriped, reserve))
+				nfound++;
 		}
 	}
+	atomic_add(nfound, &snap->lqs_allocs);
 
 	if (unlikely(nfound != stripe_count)) {
 		/*
@@ -1603,10 +1802,15 @@ static int lod_ost_alloc_qos(const struct lu_env *env, struct lod_object *lo,
 		}
 
 		/* makes sense to rebalance next time */
-		lod->lod_ost_descs.ltd_qos.lq_dirty = 1;
-		lod->lod_ost_descs.ltd_qos.lq_same_space = 0;
+		WRITE_ONCE(snap->lqs_stale, true);
+		down_write(&ltd->ltd_qos.lq_rw_sem);
+		ltd->ltd_qos.lq_dirty = 1;
+		ltd->ltd_qos.lq_same_space = 0;
+		up_write(&ltd->ltd_qos.lq_rw_sem);
 
 		rc = -EAGAIN;
+	} else {
+		rc = 0;
 	}
 
 	/* If there are enough OSTs, a component with overstriping requessted
@@ -1616,11 +1820,9 @@ static int lod_ost_alloc_qos(const struct lu_env *env, struct lod_object *lo,
 		lod_comp->llc_pattern &= ~LOV_PATTERN_OVERSTRIPING;
 
 out:
-	up_write(&lod->lod_ost_descs.ltd_qos.lq_rw_sem);
-
-out_nolock:
+	lod_qos_snapshot_put(snap);
+out_pool:
 	if (pool != NULL) {
-		up_read(&pool_tgt_rw_sem(pool));
 		/* put back ref got by lod_find_pool() */
 		lod_pool_putref(pool);
 	}
@@ -586,6 +586,48 @@ static ssize_t qos_prio_free_store(struct kobject *kobj, struct attribute *attr,
 LUSTRE_RW_ATTR(mdt_qos_prio_free);
 LUSTRE_RW_ATTR(qos_prio_free);
 
+/**
+ * Show QoS I/O load priority parameter.
+ *
+ * The relative weight given to recent OST bandwidth and in-flight bulk I/O
+ * (as reported by the OSTs in statfs) when computing allocation weights.
+ * At 0% only free space and penalties are considered.
+ */
+static ssize_t qos_prio_load_show(struct kobject *kobj,
+				  struct attribute *attr, char *buf)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct lod_device *lod = dt2lod_dev(dt);
+
+	return snprintf(buf, PAGE_SIZE, "%d%%\n",
+		(lod->lod_ost_descs.ltd_qos.lq_prio_load * 100 + 255) >> 8);
+}
+
+static ssize_t qos_prio_load_store(struct kobject *kobj, struct attribute *attr,
+				   const char *buffer, size_t count)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct lod_device *lod = dt2lod_dev(dt);
+	struct lu_qos *qos = &lod->lod_ost_descs.ltd_qos;
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val > 100)
+		return -EINVAL;
+	qos->lq_prio_load = (val << 8) / 100;
+	qos->lq_dirty = 1;
+	qos->lq_reset = 1;
+
+	return count;
+}
+LUSTRE_RW_ATTR(qos_prio_load);
+
 /**
  * Show threshold for "same space on all OSTs" rule.
  */
@@ -1053,6 +1095,7 @@ static struct attribute *lod_attrs[] = {
 	&lustre_attr_numobd.attr,
 	&lustre_attr_qos_maxage.attr,
 	&lustre_attr_qos_prio_free.attr,
+	&lustre_attr_qos_prio_load.attr,
 	&lustre_attr_qos_threshold_rr.attr,
 	&lustre_attr_mdt_stripecount.attr,
 	&lustre_attr_mdt_stripetype.attr,
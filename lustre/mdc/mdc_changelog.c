@@ -35,6 +35,7 @@
 #include <linux/poll.h>
 #include <linux/device.h>
 #include <linux/cdev.h>
+#include <linux/vmalloc.h>
 
 #include <lustre_log.h>
 #include <uapi/linux/lustre/lustre_ioctl.h>
@@ -71,6 +72,24 @@ struct chlg_registered_dev {
 	struct list_head	 ced_link;
 };
 
+/* Records read from one changelog shard catalog, not merged yet */
+struct chlg_shard {
+	/* Reader state the shard belongs to */
+	struct chlg_reader_state   *cs_crs;
+	/* Catalog handle, only valid while the shard is being read */
+	struct llog_handle	   *cs_llh;
+	/* Position to resume reading from */
+	unsigned int		    cs_last_catidx;
+	unsigned int		    cs_last_idx;
+	/* Index of the last record read from this shard */
+	__u64			    cs_last_index;
+	/* List of chlg_rec_entry::enq_linkage items, in index order */
+	struct list_head	    cs_recs;
+	unsigned int		    cs_count;
+	/* Reading stopped at the prefetch limit, more records follow */
+	bool			    cs_full;
+};
+
 struct chlg_reader_state {
 	/* Shortcut to the corresponding OBD device */
 	struct obd_device	   *crs_obd;
@@ -97,6 +116,28 @@ struct chlg_reader_state {
 	unsigned int		    crs_last_catidx;
 	unsigned int		    crs_last_idx;
 	bool			    crs_poll;
+	/* Index following the last record queued for the consumer */
+	__u64			    crs_next_index;
+	/* The changelog has several shards to be merged by index */
+	bool			    crs_sharded;
+	/* Shard records are left to read or to merge right away */
+	bool			    crs_more;
+	/* Time the merge started to wait for the missing crs_next_index */
+	ktime_t			    crs_gap_start;
+	unsigned int		    crs_shard_count;
+	struct chlg_shard	    crs_shards[CHANGELOG_MAX_SHARDS];
+	/* Record ring mapped by the reader. crs_ring_new is set by
+	 * chlg_mmap(), the loader then moves the queued records into it and
+	 * sets crs_ring, which replaces crs_rec_queue from then on. Only
+	 * crh_tail is read back from the shared header, the other values
+	 * are kept here. */
+	struct changelog_ring_hdr  *crs_ring_new;
+	struct changelog_ring_hdr  *crs_ring;
+	/* Serializes chlg_mmap() calls */
+	struct mutex		    crs_ring_mutex;
+	char			   *crs_ring_data;
+	__u64			    crs_ring_size;
+	__u64			    crs_ring_head;
 };
 
 struct chlg_rec_entry {
@@ -111,6 +152,11 @@ struct chlg_rec_entry {
 enum {
 	/* Number of records to prefetch locally. */
 	CDEV_CHLG_MAX_PREFETCH = 1024,
+	/* Milliseconds to wait for a missing index to show up in a shard
+	 * before records are returned past it. */
+	CDEV_CHLG_GAP_TIMEOUT_MS = 1000,
+	/* Largest record ring, the smallest one holds a full prefetch queue */
+	CDEV_CHLG_RING_MAX_SIZE = 256 << 20,
 };
 
 DEFINE_IDR(mdc_changelog_minor_idr);
@@ -188,6 +234,243 @@ static inline void chlg_obd_put(struct chlg_registered_dev *dev,
 	class_decref(obd, "changelog", dev);
 }
 
+/**
+ * Copy a changelog record into a new queue entry.
+ */
+static struct chlg_rec_entry *
+chlg_rec_entry_alloc(struct llog_changelog_rec *rec)
+{
+	struct chlg_rec_entry *enq;
+	size_t len;
+
+	len = changelog_rec_size(&rec->cr) + rec->cr.cr_namelen;
+	OBD_ALLOC(enq, sizeof(*enq) + len);
+	if (enq == NULL)
+		return NULL;
+
+	INIT_LIST_HEAD(&enq->enq_linkage);
+	enq->enq_length = len;
+	memcpy(enq->enq_record, &rec->cr, len);
+
+	return enq;
+}
+
+static inline void enq_record_delete(struct chlg_rec_entry *rec);
+
+/* crh_tail is written by the reader, it must stay within the records
+ * written so far */
+static bool chlg_ring_tail_valid(struct chlg_reader_state *crs)
+{
+	__u64 tail = READ_ONCE(crs->crs_ring->crh_tail);
+
+	return tail <= crs->crs_ring_head &&
+	       crs->crs_ring_head - tail <= crs->crs_ring_size;
+}
+
+static bool chlg_ring_room(struct chlg_reader_state *crs, size_t need)
+{
+	__u64 head = crs->crs_ring_head;
+	__u64 tail = smp_load_acquire(&crs->crs_ring->crh_tail);
+	__u64 left = crs->crs_ring_size - head % crs->crs_ring_size;
+
+	/* an entry never wraps, the end of the area is skipped instead */
+	if (left < need)
+		need += left;
+
+	return head - tail <= crs->crs_ring_size - need;
+}
+
+/**
+ * Append a record to the ring mapped by the reader, if there is room.
+ *
+ * @param[in,out]  crs  Internal reader state.
+ * @param[in]      cr   Record to copy.
+ * @param[in]      len  Record length.
+ * @return 0 on success, -ENOSPC if the reader has to consume records first,
+ *	   -EINVAL if the reader corrupted crh_tail.
+ */
+static int chlg_ring_write(struct chlg_reader_state *crs,
+			   const struct changelog_rec *cr, size_t len)
+{
+	struct changelog_ring_rec *crr;
+	size_t need = changelog_ring_rec_size(len);
+	__u64 pos;
+
+	if (!chlg_ring_tail_valid(crs))
+		return -EINVAL;
+
+	if (!chlg_ring_room(crs, need))
+		return -ENOSPC;
+
+	pos = crs->crs_ring_head % crs->crs_ring_size;
+	if (crs->crs_ring_size - pos < need) {
+		crr = (struct changelog_ring_rec *)(crs->crs_ring_data + pos);
+		crr->crr_len = 0;
+		crs->crs_ring_head += crs->crs_ring_size - pos;
+		pos = 0;
+	}
+
+	crr = (struct changelog_ring_rec *)(crs->crs_ring_data + pos);
+	crr->crr_len = len;
+	crr->crr_padding = 0;
+	memcpy(crr->crr_rec, cr, len);
+	crs->crs_ring_head += need;
+
+	/* entry contents are visible before the new head */
+	smp_store_release(&crs->crs_ring->crh_head, crs->crs_ring_head);
+
+	smp_mb();
+	if (waitqueue_active(&crs->crs_waitq_cons))
+		wake_up_all(&crs->crs_waitq_cons);
+
+	return 0;
+}
+
+/**
+ * Append a record to the ring, waiting for the reader to make room.
+ * The reader is asked for a wakeup, the wait is also bounded in case it
+ * does not ask for it.
+ */
+static int chlg_ring_put(struct chlg_reader_state *crs,
+			 const struct changelog_rec *cr, size_t len)
+{
+	struct changelog_ring_hdr *hdr = crs->crs_ring;
+	size_t need = changelog_ring_rec_size(len);
+	int rc;
+
+	while ((rc = chlg_ring_write(crs, cr, len)) == -ENOSPC) {
+		WRITE_ONCE(hdr->crh_flags,
+			   READ_ONCE(hdr->crh_flags) | CHANGELOG_RING_WAKEUP);
+		/* pairs with the reader advancing crh_tail then checking
+		 * CHANGELOG_RING_WAKEUP */
+		smp_mb();
+		wait_event_interruptible_timeout(crs->crs_waitq_prod,
+				chlg_ring_room(crs, need) ||
+				kthread_should_stop(),
+				cfs_time_seconds(1));
+		WRITE_ONCE(hdr->crh_flags,
+			   READ_ONCE(hdr->crh_flags) & ~CHANGELOG_RING_WAKEUP);
+		if (kthread_should_stop())
+			return -EINTR;
+	}
+
+	return rc;
+}
+
+/* Tell the ring reader about EOF or an error */
+static void chlg_ring_set_state(struct chlg_reader_state *crs)
+{
+	struct changelog_ring_hdr *hdr = crs->crs_ring;
+	__u32 flags = READ_ONCE(hdr->crh_flags);
+
+	if (crs->crs_err < 0) {
+		hdr->crh_error = crs->crs_err;
+		flags |= CHANGELOG_RING_ERROR;
+	}
+	if (crs->crs_eof)
+		flags |= CHANGELOG_RING_EOF;
+	smp_store_release(&hdr->crh_flags, flags);
+}
+
+/**
+ * Switch to the ring mapped by the reader, called by the loader. The ring
+ * is emptied and is large enough for a full prefetch queue, which is moved
+ * into it so that records stay in order.
+ *
+ * @param[in,out]  crs  Internal reader state.
+ * @return 0 on success, negated error code if the reader corrupted the ring
+ *	   header meanwhile.
+ */
+static int chlg_ring_activate(struct chlg_reader_state *crs)
+{
+	/* pairs with smp_store_release() in chlg_mmap() */
+	struct changelog_ring_hdr *hdr = smp_load_acquire(&crs->crs_ring_new);
+	struct chlg_rec_entry *rec;
+	struct chlg_rec_entry *tmp;
+	int rc = 0;
+
+	if (hdr == NULL || crs->crs_ring != NULL)
+		return 0;
+
+	mutex_lock(&crs->crs_lock);
+	crs->crs_ring_data = (char *)hdr + PAGE_SIZE;
+	crs->crs_ring_head = 0;
+	/* the reader may have written the header since chlg_mmap() */
+	WRITE_ONCE(hdr->crh_tail, 0);
+	smp_store_release(&hdr->crh_head, 0);
+	crs->crs_ring = hdr;
+
+	list_for_each_entry_safe(rec, tmp, &crs->crs_rec_queue, enq_linkage) {
+		rc = chlg_ring_write(crs, rec->enq_record, rec->enq_length);
+		if (rc < 0) {
+			CDEBUG(D_INFO, "cannot move record to the ring: "
+			       "rc = %d\n", rc);
+			crs->crs_err = rc;
+			break;
+		}
+		crs->crs_rec_count--;
+		enq_record_delete(rec);
+	}
+	chlg_ring_set_state(crs);
+	mutex_unlock(&crs->crs_lock);
+
+	wake_up_all(&crs->crs_waitq_cons);
+
+	return rc;
+}
+
+/**
+ * Hand a record over to the consumer, either queued for chlg_read() or
+ * copied into the ring mapped by the reader.
+ *
+ * @param[in,out]  crs  Internal reader state.
+ * @param[in]      rec  Record read from the llog, if \a enq is NULL.
+ * @param[in]      enq  Record already copied, freed or queued here.
+ * @return 0 on success, negated error code on failure.
+ */
+static int chlg_rec_deliver(struct chlg_reader_state *crs,
+			    struct llog_changelog_rec *rec,
+			    struct chlg_rec_entry *enq)
+{
+	struct changelog_rec *cr = enq != NULL ? enq->enq_record : &rec->cr;
+	__u64 index = cr->cr_index;
+	int rc;
+
+	rc = chlg_ring_activate(crs);
+	if (rc < 0) {
+		if (enq != NULL)
+			enq_record_delete(enq);
+		return rc;
+	}
+
+	mutex_lock(&crs->crs_lock);
+	if (crs->crs_ring == NULL) {
+		if (enq == NULL)
+			enq = chlg_rec_entry_alloc(rec);
+		if (enq == NULL) {
+			mutex_unlock(&crs->crs_lock);
+			return -ENOMEM;
+		}
+		list_add_tail(&enq->enq_linkage, &crs->crs_rec_queue);
+		crs->crs_rec_count++;
+		mutex_unlock(&crs->crs_lock);
+
+		crs->crs_next_index = index + 1;
+		wake_up_all(&crs->crs_waitq_cons);
+		return 0;
+	}
+	mutex_unlock(&crs->crs_lock);
+
+	/* the loader is the only ring writer */
+	rc = chlg_ring_put(crs, cr, changelog_rec_size(cr) + cr->cr_namelen);
+	if (enq != NULL)
+		enq_record_delete(enq);
+	if (rc == 0)
+		crs->crs_next_index = index + 1;
+
+	return rc;
+}
+
 /**
  * ChangeLog catalog processing callback invoked on each record.
  * If the current record is eligible to userland delivery, push
@@ -206,8 +489,6 @@ static int chlg_read_cat_process_cb(const struct lu_env *env,
 {
 	struct llog_changelog_rec *rec;
 	struct chlg_reader_state *crs = data;
-	struct chlg_rec_entry *enq;
-	size_t len;
 	int rc;
 	ENTRY;
 
@@ -241,26 +522,76 @@ static int chlg_read_cat_process_cb(const struct lu_env *env,
 
 	wait_event_interruptible(crs->crs_waitq_prod,
 				 crs->crs_rec_count < CDEV_CHLG_MAX_PREFETCH ||
+				 READ_ONCE(crs->crs_ring_new) != NULL ||
 				 kthread_should_stop());
 
 	if (kthread_should_stop())
 		RETURN(LLOG_PROC_BREAK);
 
-	len = changelog_rec_size(&rec->cr) + rec->cr.cr_namelen;
-	OBD_ALLOC(enq, sizeof(*enq) + len);
-	if (enq == NULL)
-		RETURN(-ENOMEM);
+	/* copied straight from the llog chunk into the ring, if mapped */
+	rc = chlg_rec_deliver(crs, rec, NULL);
+	if (rc == -EINTR)
+		RETURN(LLOG_PROC_BREAK);
 
-	INIT_LIST_HEAD(&enq->enq_linkage);
-	enq->enq_length = len;
-	memcpy(enq->enq_record, &rec->cr, len);
+	RETURN(rc);
+}
 
-	mutex_lock(&crs->crs_lock);
-	list_add_tail(&enq->enq_linkage, &crs->crs_rec_queue);
-	crs->crs_rec_count++;
-	mutex_unlock(&crs->crs_lock);
+/**
+ * Callback of the shard catalogs processing, keeps records in the shard
+ * list until chlg_merge_shards() queues them in index order.
+ *
+ * @param[in]     env  (unused)
+ * @param[in]     llh  Client-side handle used to identify the llog
+ * @param[in]     hdr  Header of the current llog record
+ * @param[in,out] data chlg_shard passed from caller
+ *
+ * @return 0 or LLOG_PROC_* control code on success, negated error on failure.
+ */
+static int chlg_read_shard_cb(const struct lu_env *env,
+			      struct llog_handle *llh,
+			      struct llog_rec_hdr *hdr, void *data)
+{
+	struct llog_changelog_rec *rec;
+	struct chlg_shard *cs = data;
+	struct chlg_reader_state *crs = cs->cs_crs;
+	struct chlg_rec_entry *enq;
+	ENTRY;
 
-	wake_up_all(&crs->crs_waitq_cons);
+	rec = container_of(hdr, struct llog_changelog_rec, cr_hdr);
+
+	if (rec->cr_hdr.lrh_type != CHANGELOG_REC) {
+		CERROR("%s: not a changelog rec %x/%d in llog "DFID" rc = %d\n",
+		       crs->crs_obd->obd_name, rec->cr_hdr.lrh_type,
+		       rec->cr.cr_type,
+		       PFID(lu_object_fid(&llh->lgh_obj->do_lu)), -EINVAL);
+		RETURN(-EINVAL);
+	}
+
+	if (kthread_should_stop())
+		RETURN(LLOG_PROC_BREAK);
+
+	cs->cs_last_catidx = llh->lgh_hdr->llh_cat_idx;
+	cs->cs_last_idx = hdr->lrh_index;
+	cs->cs_last_index = rec->cr.cr_index;
+
+	/* Skip undesired records, and late ones a gap was accepted for */
+	if (rec->cr.cr_index < crs->crs_start_offset)
+		RETURN(0);
+	if (rec->cr.cr_index < crs->crs_next_index) {
+		CDEBUG(D_HSM, "%s: record %llu after gap skipped\n",
+		       crs->crs_obd->obd_name, rec->cr.cr_index);
+		RETURN(0);
+	}
+
+	enq = chlg_rec_entry_alloc(rec);
+	if (enq == NULL)
+		RETURN(-ENOMEM);
+
+	list_add_tail(&enq->enq_linkage, &cs->cs_recs);
+	if (++cs->cs_count >= CDEV_CHLG_MAX_PREFETCH) {
+		cs->cs_full = true;
+		RETURN(LLOG_PROC_BREAK);
+	}
 
 	RETURN(0);
 }
@@ -268,12 +599,252 @@ static int chlg_read_cat_process_cb(const struct lu_env *env,
 /**
  * Remove record from the list it is attached to and free it.
  */
-static void enq_record_delete(struct chlg_rec_entry *rec)
+static inline void enq_record_delete(struct chlg_rec_entry *rec)
 {
 	list_del(&rec->enq_linkage);
 	OBD_FREE(rec, sizeof(*rec) + rec->enq_length);
 }
 
+/**
+ * Open changelog catalog \a name of the MDT.
+ *
+ * @param[in]   crs   Internal reader state.
+ * @param[in]   ctx   Changelog replicator llog context.
+ * @param[in]   name  Catalog name.
+ * @param[out]  llh   Opened catalog handle.
+ * @return 0 on success, negated error code on failure.
+ */
+static int chlg_catalog_open(struct chlg_reader_state *crs,
+			     struct llog_ctxt *ctx, const char *name,
+			     struct llog_handle **llh)
+{
+	int rc;
+
+	rc = llog_open(NULL, ctx, llh, NULL, name, LLOG_OPEN_EXISTS);
+	if (rc) {
+		/* shard catalogs are probed until one does not exist */
+		if (rc != -ENOENT || strcmp(name, CHANGELOG_CATALOG) == 0)
+			CERROR("%s: fail to open changelog catalog %s: rc = %d\n",
+			       crs->crs_obd->obd_name, name, rc);
+		*llh = NULL;
+		return rc;
+	}
+
+	rc = llog_init_handle(NULL, *llh,
+			      LLOG_F_IS_CAT |
+			      LLOG_F_EXT_JOBID |
+			      LLOG_F_EXT_EXTRA_FLAGS |
+			      LLOG_F_EXT_X_UIDGID |
+			      LLOG_F_EXT_X_NID |
+			      LLOG_F_EXT_X_OMODE |
+			      LLOG_F_EXT_X_XATTR,
+			      NULL);
+	if (rc) {
+		CERROR("%s: fail to init llog handle: rc = %d\n",
+		       crs->crs_obd->obd_name, rc);
+		llog_cat_close(NULL, *llh);
+		*llh = NULL;
+	}
+
+	return rc;
+}
+
+static void chlg_shard_init(struct chlg_reader_state *crs, unsigned int i)
+{
+	struct chlg_shard *cs = &crs->crs_shards[i];
+
+	cs->cs_crs = crs;
+	cs->cs_last_catidx = -1;
+	cs->cs_last_idx = 0;
+	cs->cs_last_index = 0;
+	INIT_LIST_HEAD(&cs->cs_recs);
+	cs->cs_count = 0;
+}
+
+static void chlg_shards_free(struct chlg_reader_state *crs)
+{
+	struct chlg_rec_entry *rec;
+	struct chlg_rec_entry *tmp;
+	unsigned int i;
+
+	for (i = 0; i < crs->crs_shard_count; i++) {
+		list_for_each_entry_safe(rec, tmp, &crs->crs_shards[i].cs_recs,
+					 enq_linkage)
+			enq_record_delete(rec);
+		crs->crs_shards[i].cs_count = 0;
+	}
+}
+
+/**
+ * Check if a changelog shard may still receive a record with an index
+ * below \a index. Each shard gets increasing indices, so only shards with
+ * no record left to merge and not read up to \a index can.
+ */
+static bool chlg_gap_may_fill(struct chlg_reader_state *crs, __u64 index)
+{
+	struct chlg_shard *cs;
+	unsigned int i;
+
+	for (i = 0; i < crs->crs_shard_count; i++) {
+		cs = &crs->crs_shards[i];
+		if (list_empty(&cs->cs_recs) && cs->cs_last_index + 1 < index)
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Queue the records read from the changelog shards for the consumer in
+ * index order.
+ *
+ * The MDT takes the index of a record before appending it to its shard, so
+ * a record can show up in a shard after a larger index was read from
+ * another one. A missing index that a shard may still provide is waited
+ * for up to CDEV_CHLG_GAP_TIMEOUT_MS, after which it is assumed lost (its
+ * llog append failed) and records are returned past it.
+ *
+ * @param[in,out]  crs  Internal reader state.
+ */
+static void chlg_merge_shards(struct chlg_reader_state *crs)
+{
+	struct chlg_rec_entry *enq;
+	struct chlg_rec_entry *head;
+	struct chlg_shard *best;
+	struct chlg_shard *cs;
+	__u64 index;
+	__u64 next;
+	unsigned int i;
+
+	while (!kthread_should_stop()) {
+		best = NULL;
+		head = NULL;
+		for (i = 0; i < crs->crs_shard_count; i++) {
+			cs = &crs->crs_shards[i];
+			if (list_empty(&cs->cs_recs))
+				continue;
+			enq = list_first_entry(&cs->cs_recs,
+					       struct chlg_rec_entry,
+					       enq_linkage);
+			if (head == NULL ||
+			    enq->enq_record->cr_index <
+			    head->enq_record->cr_index) {
+				best = cs;
+				head = enq;
+			}
+		}
+		if (best == NULL)
+			break;
+
+		index = head->enq_record->cr_index;
+		if (index < crs->crs_start_offset) {
+			best->cs_count--;
+			enq_record_delete(head);
+			continue;
+		}
+
+		next = max(crs->crs_next_index, crs->crs_start_offset);
+		if (crs->crs_next_index != 0 && index > next &&
+		    chlg_gap_may_fill(crs, index)) {
+			if (crs->crs_gap_start == 0)
+				crs->crs_gap_start = ktime_get();
+			if (ktime_ms_delta(ktime_get(), crs->crs_gap_start) <
+			    CDEV_CHLG_GAP_TIMEOUT_MS) {
+				crs->crs_more = true;
+				break;
+			}
+			CDEBUG(D_HSM, "%s: changelog records %llu-%llu missing\n",
+			       crs->crs_obd->obd_name, next, index - 1);
+		}
+		crs->crs_gap_start = 0;
+
+		wait_event_interruptible(crs->crs_waitq_prod,
+				crs->crs_rec_count < CDEV_CHLG_MAX_PREFETCH ||
+				READ_ONCE(crs->crs_ring_new) != NULL ||
+				kthread_should_stop());
+		if (kthread_should_stop())
+			break;
+
+		list_del_init(&head->enq_linkage);
+		best->cs_count--;
+		if (chlg_rec_deliver(crs, NULL, head) < 0)
+			break;
+	}
+}
+
+/**
+ * Read the changelog shard catalogs and merge their records.
+ *
+ * Every shard is read from where the previous call stopped, up to
+ * CDEV_CHLG_MAX_PREFETCH records kept per shard, then records are queued in
+ * index order as far as it is safe. crs_more is set if another round
+ * should follow right away.
+ *
+ * @param[in,out]  crs   Internal reader state.
+ * @param[in]      ctx   Changelog replicator llog context.
+ * @param[in]      llh   Handle of the CHANGELOG_CATALOG, that is shard 0.
+ * @return 0 on success, negated error code on failure.
+ */
+static int chlg_read_shards(struct chlg_reader_state *crs,
+			    struct llog_ctxt *ctx, struct llog_handle *llh)
+{
+	struct chlg_shard *cs;
+	char name[32];
+	unsigned int count;
+	unsigned int i;
+	int rc = 0;
+	ENTRY;
+
+	crs->crs_shards[0].cs_llh = llh;
+	for (count = 1; count < CHANGELOG_MAX_SHARDS; count++) {
+		snprintf(name, sizeof(name), CHANGELOG_CATALOG_SHARD, count);
+		rc = chlg_catalog_open(crs, ctx, name,
+				       &crs->crs_shards[count].cs_llh);
+		if (rc == -ENOENT)
+			break;
+		if (rc)
+			GOTO(out_close, rc);
+		if (count >= crs->crs_shard_count)
+			chlg_shard_init(crs, count);
+	}
+	/* shards are never removed by the MDT */
+	crs->crs_shard_count = max(crs->crs_shard_count, count);
+
+	crs->crs_more = false;
+	for (i = 0; i < count && !kthread_should_stop(); i++) {
+		cs = &crs->crs_shards[i];
+		if (cs->cs_count >= CDEV_CHLG_MAX_PREFETCH) {
+			crs->crs_more = true;
+			continue;
+		}
+
+		cs->cs_full = false;
+		rc = llog_cat_process(NULL, cs->cs_llh, chlg_read_shard_cb, cs,
+				      cs->cs_last_catidx, cs->cs_last_idx);
+		if (rc < 0) {
+			CERROR("%s: fail to process llog: rc = %d\n",
+			       crs->crs_obd->obd_name, rc);
+			GOTO(out_close, rc);
+		}
+		rc = 0;
+		if (cs->cs_full)
+			crs->crs_more = true;
+	}
+
+	chlg_merge_shards(crs);
+
+	EXIT;
+out_close:
+	for (i = 1; i < count; i++) {
+		if (crs->crs_shards[i].cs_llh != NULL)
+			llog_cat_close(NULL, crs->crs_shards[i].cs_llh);
+		crs->crs_shards[i].cs_llh = NULL;
+	}
+	crs->crs_shards[0].cs_llh = NULL;
+
+	return rc;
+}
+
 /**
  * Record prefetch thread entry point. Opens the changelog catalog and starts
  * reading records.
@@ -305,41 +876,52 @@ again:
 	if (ctx == NULL)
 		GOTO(err_out, rc = -ENOENT);
 
-	rc = llog_open(NULL, ctx, &llh, NULL, CHANGELOG_CATALOG,
-		       LLOG_OPEN_EXISTS);
-	if (rc) {
-		CERROR("%s: fail to open changelog catalog: rc = %d\n",
-		       obd->obd_name, rc);
+	rc = chlg_catalog_open(crs, ctx, CHANGELOG_CATALOG, &llh);
+	if (rc)
 		GOTO(err_out, rc);
-	}
-
 
-	rc = llog_init_handle(NULL, llh,
-			      LLOG_F_IS_CAT |
-			      LLOG_F_EXT_JOBID |
-			      LLOG_F_EXT_EXTRA_FLAGS |
-			      LLOG_F_EXT_X_UIDGID |
-			      LLOG_F_EXT_X_NID |
-			      LLOG_F_EXT_X_OMODE |
-			      LLOG_F_EXT_X_XATTR,
-			      NULL);
-	if (rc) {
-		CERROR("%s: fail to init llog handle: rc = %d\n",
-		       obd->obd_name, rc);
-		GOTO(err_out, rc);
+	/* with more than one shard, records have to be merged by index */
+	if (!crs->crs_sharded) {
+		struct llog_handle *shard;
+		char name[32];
+
+		snprintf(name, sizeof(name), CHANGELOG_CATALOG_SHARD, 1);
+		rc = chlg_catalog_open(crs, ctx, name, &shard);
+		if (rc == 0) {
+			llog_cat_close(NULL, shard);
+			crs->crs_sharded = true;
+			chlg_shard_init(crs, 0);
+			crs->crs_shards[0].cs_last_catidx = crs->crs_last_catidx;
+			crs->crs_shards[0].cs_last_idx = crs->crs_last_idx;
+			crs->crs_shard_count = 1;
+		} else if (rc != -ENOENT) {
+			GOTO(err_out, rc);
+		}
 	}
 
-	rc = llog_cat_process(NULL, llh, chlg_read_cat_process_cb, crs,
-				crs->crs_last_catidx, crs->crs_last_idx);
-	if (rc < 0) {
-		CERROR("%s: fail to process llog: rc = %d\n", obd->obd_name, rc);
-		GOTO(err_out, rc);
+	if (crs->crs_sharded) {
+		rc = chlg_read_shards(crs, ctx, llh);
+		if (rc < 0)
+			GOTO(err_out, rc);
+	} else {
+		rc = llog_cat_process(NULL, llh, chlg_read_cat_process_cb, crs,
+				      crs->crs_last_catidx, crs->crs_last_idx);
+		if (rc < 0) {
+			CERROR("%s: fail to process llog: rc = %d\n",
+			       obd->obd_name, rc);
+			GOTO(err_out, rc);
+		}
 	}
-	if (!kthread_should_stop() && crs->crs_poll) {
+	if (!kthread_should_stop() && (crs->crs_poll || crs->crs_more)) {
 		llog_cat_close(NULL, llh);
+		llh = NULL;
 		llog_ctxt_put(ctx);
 		class_decref(obd, "changelog", crs);
-		schedule_timeout_interruptible(cfs_time_seconds(1));
+		/* shard records left to read or a missing index to wait for */
+		if (crs->crs_gap_start != 0)
+			schedule_timeout_interruptible(cfs_time_seconds(1) / 10);
+		else if (!crs->crs_more)
+			schedule_timeout_interruptible(cfs_time_seconds(1));
 		goto again;
 	}
 
@@ -349,6 +931,10 @@ err_out:
 	if (rc < 0)
 		crs->crs_err = rc;
 
+	if (crs->crs_ring != NULL)
+		chlg_ring_set_state(crs);
+
+	chlg_shards_free(crs);
 	wake_up_all(&crs->crs_waitq_cons);
 
 	if (llh != NULL)
@@ -359,7 +945,15 @@ err_out:
 
 	crs->crs_obd = NULL;
 	chlg_obd_put(ced, obd);
-	wait_event_interruptible(crs->crs_waitq_prod, kthread_should_stop());
+
+	/* the reader may still map a ring for the records left */
+	while (!kthread_should_stop()) {
+		wait_event_interruptible(crs->crs_waitq_prod,
+				kthread_should_stop() ||
+				(READ_ONCE(crs->crs_ring_new) != NULL &&
+				 crs->crs_ring == NULL));
+		chlg_ring_activate(crs);
+	}
 
 	RETURN(rc);
 }
@@ -387,6 +981,10 @@ static ssize_t chlg_read(struct file *file, char __user *buff, size_t count,
 	LIST_HEAD(consumed);
 	ENTRY;
 
+	/* records are delivered through the mapped ring */
+	if (READ_ONCE(crs->crs_ring_new) != NULL)
+		RETURN(-EBUSY);
+
 	if (file->f_flags & O_NONBLOCK && crs->crs_rec_count == 0) {
 		if (crs->crs_err < 0)
 			RETURN(crs->crs_err);
@@ -446,6 +1044,9 @@ static int chlg_set_start_offset(struct chlg_reader_state *crs, __u64 offset)
 	struct chlg_rec_entry *rec;
 	struct chlg_rec_entry *tmp;
 
+	if (READ_ONCE(crs->crs_ring_new) != NULL)
+		return -EBUSY;
+
 	mutex_lock(&crs->crs_lock);
 	if (offset < crs->crs_start_offset) {
 		mutex_unlock(&crs->crs_lock);
@@ -581,6 +1182,64 @@ out_kbuf:
 	return rc < 0 ? rc : count;
 }
 
+/**
+ * Mmap handler, sets up the record ring described by struct
+ * changelog_ring_hdr. The header takes the first page of the mapping, the
+ * rest is the record area. It has to hold the whole prefetch queue, which
+ * the loader moves into the ring before appending new records.
+ *
+ * crs_lock is not taken here, chlg_read() holds it while copying to user
+ * memory.
+ *
+ * @param[in]  file  File pointer to the changelog character device.
+ * @param[in]  vma   Mapping to set up.
+ * @return 0 on success, negated error code on failure.
+ */
+static int chlg_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct chlg_reader_state *crs = file->private_data;
+	struct changelog_ring_hdr *hdr;
+	unsigned long len = vma->vm_end - vma->vm_start;
+	int rc;
+	ENTRY;
+
+	if (!(file->f_mode & FMODE_READ) || vma->vm_pgoff != 0)
+		RETURN(-EINVAL);
+
+	if (len <= PAGE_SIZE || len > CDEV_CHLG_RING_MAX_SIZE ||
+	    len - PAGE_SIZE < CDEV_CHLG_MAX_PREFETCH *
+			      changelog_ring_rec_size(CR_MAXSIZE))
+		RETURN(-EINVAL);
+
+	mutex_lock(&crs->crs_ring_mutex);
+	if (crs->crs_ring_new != NULL)
+		GOTO(out_unlock, rc = -EBUSY);
+
+	hdr = vmalloc_user(len);
+	if (hdr == NULL)
+		GOTO(out_unlock, rc = -ENOMEM);
+
+	hdr->crh_magic = CHANGELOG_RING_MAGIC;
+	hdr->crh_data_offset = PAGE_SIZE;
+	hdr->crh_data_size = len - PAGE_SIZE;
+
+	rc = remap_vmalloc_range(vma, hdr, 0);
+	if (rc) {
+		vfree(hdr);
+		GOTO(out_unlock, rc);
+	}
+
+	/* the shared header is not trusted, the loader uses this copy */
+	crs->crs_ring_size = len - PAGE_SIZE;
+	smp_store_release(&crs->crs_ring_new, hdr);
+	wake_up_all(&crs->crs_waitq_prod);
+
+	EXIT;
+out_unlock:
+	mutex_unlock(&crs->crs_ring_mutex);
+	return rc;
+}
+
 /**
  * Open handler, initialize internal CRS state and spawn prefetch thread if
  * needed.
@@ -608,6 +1267,7 @@ static int chlg_open(struct inode *inode, struct file *file)
 	crs->crs_eof = false;
 
 	mutex_init(&crs->crs_lock);
+	mutex_init(&crs->crs_ring_mutex);
 	INIT_LIST_HEAD(&crs->crs_rec_queue);
 	init_waitqueue_head(&crs->crs_waitq_prod);
 	init_waitqueue_head(&crs->crs_waitq_cons);
@@ -652,6 +1312,10 @@ static int chlg_release(struct inode *inode, struct file *file)
 	list_for_each_entry_safe(rec, tmp, &crs->crs_rec_queue, enq_linkage)
 		enq_record_delete(rec);
 
+	/* the mapping holds a file reference, so it is gone already */
+	if (crs->crs_ring_new != NULL)
+		vfree(crs->crs_ring_new);
+
 	kref_put(&crs->crs_ced->ced_refs, chlg_dev_clear);
 	OBD_FREE_PTR(crs);
 
@@ -673,8 +1337,13 @@ static unsigned int chlg_poll(struct file *file, poll_table *wait)
 
 	mutex_lock(&crs->crs_lock);
 	poll_wait(file, &crs->crs_waitq_cons, wait);
-	if (crs->crs_rec_count > 0)
+	if (READ_ONCE(crs->crs_ring_new) != NULL) {
+		if (crs->crs_ring != NULL &&
+		    READ_ONCE(crs->crs_ring->crh_tail) != crs->crs_ring_head)
+			mask |= POLLIN | POLLRDNORM;
+	} else if (crs->crs_rec_count > 0) {
 		mask |= POLLIN | POLLRDNORM;
+	}
 	if (crs->crs_err)
 		mask |= POLLERR;
 	if (crs->crs_eof)
@@ -693,6 +1362,11 @@ static long chlg_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		crs->crs_poll = !!arg;
 		rc = 0;
 		break;
+	case OBD_IOC_CHLG_RING_WAKE:
+		/* the reader made room in the ring */
+		wake_up_all(&crs->crs_waitq_prod);
+		rc = 0;
+		break;
 	default:
 		rc = -EINVAL;
 		break;
@@ -709,6 +1383,7 @@ static const struct file_operations chlg_fops = {
 	.release	= chlg_release,
 	.poll		= chlg_poll,
 	.unlocked_ioctl	= chlg_ioctl,
+	.mmap		= chlg_mmap,
 };
 
 /**
@@ -142,6 +142,7 @@ static int mdd_init0(const struct lu_env *env, struct mdd_device *mdd,
 		RETURN(rc);
 
 	mdd->mdd_atime_diff = MAX_ATIME_DIFF;
+	mdd_deferred_destroy_init(mdd);
 	/* sync permission changes */
 	mdd->mdd_sync_permission = 1;
 	/* enable changelog garbage collection */
@@ -197,7 +198,9 @@ static int changelog_init_cb(const struct lu_env *env, struct llog_handle *llh,
 	       rec->cr.cr_index, rec->cr.cr_type, rec->cr.cr_namelen,
 	       changelog_rec_name(&rec->cr), PFID(&llh->lgh_id.lgl_oi.oi_fid));
 
-	mdd->mdd_cl.mc_index = rec->cr.cr_index;
+	/* with several shards the newest record is the largest index */
+	if (rec->cr.cr_index > atomic64_read(&mdd->mdd_cl.mc_index))
+		atomic64_set(&mdd->mdd_cl.mc_index, rec->cr.cr_index);
 	return LLOG_PROC_BREAK;
 }
 
@@ -219,8 +222,8 @@ static int changelog_user_init_cb(const struct lu_env *env,
 	spin_lock(&mdd->mdd_cl.mc_user_lock);
 	mdd->mdd_cl.mc_lastuser = rec->cur_id;
 	mdd->mdd_cl.mc_users++;
-	if (rec->cur_endrec > mdd->mdd_cl.mc_index)
-		mdd->mdd_cl.mc_index = rec->cur_endrec;
+	if (rec->cur_endrec > atomic64_read(&mdd->mdd_cl.mc_index))
+		atomic64_set(&mdd->mdd_cl.mc_index, rec->cur_endrec);
 	spin_unlock(&mdd->mdd_cl.mc_user_lock);
 
 	return LLOG_PROC_BREAK;
@@ -294,6 +297,12 @@ static int changelog_user_detect_orphan_cb(const struct lu_env *env,
 	    rec->cur_endrec < ((struct changelog_orphan_data *)data)->index)
 		((struct changelog_orphan_data *)data)->index = rec->cur_endrec;
 
+	if (!(rec->cur_hdr.lrh_id & CLU_F_SHARDS)) {
+		spin_lock(&mdd->mdd_cl.mc_user_lock);
+		mdd->mdd_cl.mc_users_unsharded++;
+		spin_unlock(&mdd->mdd_cl.mc_user_lock);
+	}
+
 	return 0;
 }
 
@@ -355,27 +364,159 @@ static int llog_changelog_cancel(const struct lu_env *env,
 				 struct llog_ctxt *ctxt,
 				 struct changelog_cancel_cookie *cookie)
 {
-	struct llog_handle	*cathandle = ctxt->loc_handle;
-	int			 rc;
+	struct mdd_device	*mdd = cookie->mdd;
+	struct llog_handle	*cathandle;
+	unsigned int		 i;
+	int			 rc = 0;
 
 	ENTRY;
 
-	/* This should only be called with the catalog handle */
-	LASSERT(cathandle->lgh_hdr->llh_flags & LLOG_F_IS_CAT);
+	/* records are ordered within each shard, purge them one by one */
+	for (i = 0; i < mdd_changelog_shard_count(mdd); i++) {
+		cathandle = mdd->mdd_cl.mc_shards[i];
+
+		/* This should only be called with the catalog handle */
+		LASSERT(cathandle->lgh_hdr->llh_flags & LLOG_F_IS_CAT);
+
+		rc = llog_cat_process(env, cathandle, llog_changelog_cancel_cb,
+				      cookie, 0, 0);
+		if (rc >= 0) {
+			/* 0 or 1 means we're done */
+			rc = 0;
+		} else {
+			CERROR("%s: cancel idx %u of catalog "DFID": rc = %d\n",
+			       ctxt->loc_obd->obd_name, cathandle->lgh_last_idx,
+			       PFID(&cathandle->lgh_id.lgl_oi.oi_fid), rc);
+			break;
+		}
+	}
 
-	rc = llog_cat_process(env, cathandle, llog_changelog_cancel_cb,
-			      cookie, 0, 0);
-	if (rc >= 0)
-		/* 0 or 1 means we're done */
-		rc = 0;
-	else
-		CERROR("%s: cancel idx %u of catalog "DFID": rc = %d\n",
-		       ctxt->loc_obd->obd_name, cathandle->lgh_last_idx,
-		       PFID(&cathandle->lgh_id.lgl_oi.oi_fid), rc);
+	RETURN(rc);
+}
+
+/**
+ * Open the changelog shard catalogs from mc_shard_count up to \a count.
+ *
+ * At setup the shards already on disk are opened, \a create is only set
+ * to add new ones. Shards are published one at a time so that concurrent
+ * writers only see fully initialized handles.
+ *
+ * \param[in] env	execution environment
+ * \param[in] mdd	mdd device
+ * \param[in] ctxt	changelog llog context
+ * \param[in] count	wanted number of shards
+ * \param[in] create	create missing shards instead of stopping at them
+ *
+ * \retval 0		on success
+ * \retval negative	negated errno on failure
+ */
+static int mdd_changelog_shards_open(const struct lu_env *env,
+				     struct mdd_device *mdd,
+				     struct llog_ctxt *ctxt,
+				     unsigned int count, bool create)
+{
+	struct llog_handle *llh;
+	char name[32];
+	unsigned int i;
+	int rc = 0;
+
+	ENTRY;
+
+	mutex_lock(&mdd->mdd_cl.mc_shard_mutex);
+	for (i = mdd->mdd_cl.mc_shard_count; i < count; i++) {
+		snprintf(name, sizeof(name), CHANGELOG_CATALOG_SHARD, i);
+		if (create)
+			rc = llog_open_create(env, ctxt, &llh, NULL, name);
+		else
+			rc = llog_open(env, ctxt, &llh, NULL, name,
+				       LLOG_OPEN_EXISTS);
+		if (rc == -ENOENT && !create) {
+			rc = 0;
+			break;
+		}
+		if (rc)
+			break;
+
+		rc = llog_init_handle(env, llh, LLOG_F_IS_CAT, NULL);
+		if (rc) {
+			llog_cat_close(env, llh);
+			break;
+		}
+
+		mdd->mdd_cl.mc_shards[i] = llh;
+		smp_store_release(&mdd->mdd_cl.mc_shard_count, i + 1);
+	}
+	mutex_unlock(&mdd->mdd_cl.mc_shard_mutex);
 
+	if (rc)
+		CERROR("%s: cannot open changelog shard %u: rc = %d\n",
+		       mdd2obd_dev(mdd)->obd_name, i, rc);
 	RETURN(rc);
 }
 
+/* close shards 1 and up, shard 0 is closed with the llog context */
+static void mdd_changelog_shards_close(const struct lu_env *env,
+				       struct mdd_device *mdd)
+{
+	unsigned int i;
+
+	mutex_lock(&mdd->mdd_cl.mc_shard_mutex);
+	for (i = 1; i < mdd->mdd_cl.mc_shard_count; i++) {
+		llog_cat_close(env, mdd->mdd_cl.mc_shards[i]);
+		mdd->mdd_cl.mc_shards[i] = NULL;
+	}
+	mdd->mdd_cl.mc_shards[0] = NULL;
+	smp_store_release(&mdd->mdd_cl.mc_shard_count, 0);
+	mutex_unlock(&mdd->mdd_cl.mc_shard_mutex);
+}
+
+/**
+ * Set the number of changelog shards.
+ *
+ * Shards are persistent catalogs that readers discover by name, so they
+ * can be added but not removed while the MDT is running. A reader that
+ * doesn't know about shards would silently miss the records of shards 1
+ * and up, so they are only added if all registered users declared they
+ * read every shard, see mdd_changelog_user_register().
+ */
+int mdd_changelog_shards_set(const struct lu_env *env, struct mdd_device *mdd,
+			     unsigned int count)
+{
+	struct llog_ctxt *ctxt;
+	int rc;
+
+	if (count == 0 || count > CHANGELOG_MAX_SHARDS)
+		return -ERANGE;
+
+	if (mdd->mdd_cl.mc_flags & CLM_ERR)
+		return -ESRCH;
+
+	if (count < mdd_changelog_shard_count(mdd))
+		return -EINVAL;
+
+	spin_lock(&mdd->mdd_cl.mc_user_lock);
+	if (count > 1 && mdd->mdd_cl.mc_users_unsharded > 0) {
+		spin_unlock(&mdd->mdd_cl.mc_user_lock);
+		CWARN("%s: %d changelog users do not read changelog shards\n",
+		      mdd2obd_dev(mdd)->obd_name,
+		      mdd->mdd_cl.mc_users_unsharded);
+		return -EOPNOTSUPP;
+	}
+	/* from now on, users must support shards to register */
+	if (count > mdd->mdd_cl.mc_shards_wanted)
+		mdd->mdd_cl.mc_shards_wanted = count;
+	spin_unlock(&mdd->mdd_cl.mc_user_lock);
+
+	ctxt = llog_get_context(mdd2obd_dev(mdd), LLOG_CHANGELOG_ORIG_CTXT);
+	if (ctxt == NULL)
+		return -ENXIO;
+
+	rc = mdd_changelog_shards_open(env, mdd, ctxt, count, true);
+	llog_ctxt_put(ctxt);
+
+	return rc;
+}
+
 static struct llog_operations changelog_orig_logops;
 
 static int
@@ -429,8 +570,11 @@ static int mdd_changelog_llog_init(const struct lu_env *env,
 	struct llog_ctxt	*ctxt = NULL, *uctxt = NULL;
 	struct changelog_orphan_data changelog_orphan = { .index = 0,
 							  .mdd = mdd },
+				     shard_orphan = { .index = 0,
+						      .mdd = mdd },
 				     user_orphan = { .index = 0,
 						     .mdd = mdd };
+	unsigned int		 i;
 	int			 rc;
 
 	ENTRY;
@@ -452,6 +596,10 @@ static int mdd_changelog_llog_init(const struct lu_env *env,
 	ctxt = llog_get_context(obd, LLOG_CHANGELOG_ORIG_CTXT);
 	LASSERT(ctxt);
 
+	/* mdd_changelog_write_rec() assigns cr_index, which readers and
+	 * purge expect to grow along each plain llog */
+	ctxt->loc_flags |= LLOG_CTXT_FLAG_ORDERED;
+
 	rc = llog_open_create(env, ctxt, &ctxt->loc_handle, NULL,
 			      CHANGELOG_CATALOG);
 	if (rc)
@@ -461,17 +609,26 @@ static int mdd_changelog_llog_init(const struct lu_env *env,
 	if (rc)
 		GOTO(out_close, rc);
 
-	rc = llog_cat_reverse_process(env, ctxt->loc_handle,
-				      changelog_init_cb, mdd);
-
-	if (rc < 0) {
-		CERROR("%s: changelog init failed: rc = %d\n", obd->obd_name,
-		       rc);
+	mdd->mdd_cl.mc_shards[0] = ctxt->loc_handle;
+	mdd->mdd_cl.mc_shard_count = 1;
+	rc = mdd_changelog_shards_open(env, mdd, ctxt, CHANGELOG_MAX_SHARDS,
+				       false);
+	if (rc)
 		GOTO(out_close, rc);
+
+	for (i = 0; i < mdd->mdd_cl.mc_shard_count; i++) {
+		rc = llog_cat_reverse_process(env, mdd->mdd_cl.mc_shards[i],
+					      changelog_init_cb, mdd);
+		if (rc < 0) {
+			CERROR("%s: changelog init failed: rc = %d\n",
+			       obd->obd_name, rc);
+			GOTO(out_close, rc);
+		}
 	}
 
-	CDEBUG(D_IOCTL, "changelog starting index=%llu\n",
-	       mdd->mdd_cl.mc_index);
+	CDEBUG(D_IOCTL, "changelog starting index=%llu shards=%u\n",
+	       (u64)atomic64_read(&mdd->mdd_cl.mc_index),
+	       mdd->mdd_cl.mc_shard_count);
 
 	/* setup user changelog */
 	rc = llog_setup(env, obd, &obd->obd_olg, LLOG_CHANGELOG_USER_ORIG_CTXT,
@@ -519,12 +676,21 @@ static int mdd_changelog_llog_init(const struct lu_env *env,
 	 * processed as a long time idle user record could have been deleted
 	 * XXX we may need to run end of purge as a separate thread
 	 */
-	rc = llog_cat_process(env, ctxt->loc_handle, changelog_detect_orphan_cb,
-			      &changelog_orphan, 0, 0);
-	if (rc < 0) {
-		CERROR("%s: changelog detect orphan failed: rc = %d\n",
-		       obd->obd_name, rc);
-		GOTO(out_uclose, rc);
+	for (i = 0; i < mdd->mdd_cl.mc_shard_count; i++) {
+		shard_orphan.index = 0;
+		rc = llog_cat_process(env, mdd->mdd_cl.mc_shards[i],
+				      changelog_detect_orphan_cb,
+				      &shard_orphan, 0, 0);
+		if (rc < 0) {
+			CERROR("%s: changelog detect orphan failed: rc = %d\n",
+			       obd->obd_name, rc);
+			GOTO(out_uclose, rc);
+		}
+		/* oldest record of all shards */
+		if (shard_orphan.index != 0 &&
+		    (changelog_orphan.index == 0 ||
+		     shard_orphan.index < changelog_orphan.index))
+			changelog_orphan.index = shard_orphan.index;
 	}
 	rc = llog_cat_process(env, uctxt->loc_handle,
 			      changelog_user_detect_orphan_cb,
@@ -561,6 +727,7 @@ out_uclose:
 out_ucleanup:
 	llog_cleanup(env, uctxt);
 out_close:
+	mdd_changelog_shards_close(env, mdd);
 	llog_cat_close(env, ctxt->loc_handle);
 out_cleanup:
 	llog_cleanup(env, ctxt);
@@ -572,11 +739,15 @@ static int mdd_changelog_init(const struct lu_env *env, struct mdd_device *mdd)
 	struct obd_device	*obd = mdd2obd_dev(mdd);
 	int			 rc;
 
-	mdd->mdd_cl.mc_index = 0;
+	atomic64_set(&mdd->mdd_cl.mc_index, 0);
 	spin_lock_init(&mdd->mdd_cl.mc_lock);
+	mutex_init(&mdd->mdd_cl.mc_shard_mutex);
+	mdd->mdd_cl.mc_shard_count = 0;
+	mdd->mdd_cl.mc_shards_wanted = 0;
 	mdd->mdd_cl.mc_starttime = ktime_get();
 	spin_lock_init(&mdd->mdd_cl.mc_user_lock);
 	mdd->mdd_cl.mc_lastuser = 0;
+	mdd->mdd_cl.mc_users_unsharded = 0;
 
 	/* ensure a GC check will, and a thread run may, occur upon start */
 	mdd->mdd_cl.mc_gc_time = 0;
@@ -635,6 +806,7 @@ again:
 
 	ctxt = llog_get_context(obd, LLOG_CHANGELOG_ORIG_CTXT);
 	if (ctxt) {
+		mdd_changelog_shards_close(env, mdd);
 		llog_cat_close(env, ctxt->loc_handle);
 		llog_cleanup(env, ctxt);
 	}
@@ -665,9 +837,7 @@ mdd_changelog_llog_cancel(const struct lu_env *env, struct mdd_device *mdd,
         if (ctxt == NULL)
                 return -ENXIO;
 
-	spin_lock(&mdd->mdd_cl.mc_lock);
-	cur = (long long)mdd->mdd_cl.mc_index;
-	spin_unlock(&mdd->mdd_cl.mc_lock);
+	cur = (long long)atomic64_read(&mdd->mdd_cl.mc_index);
         if (endrec > cur)
                 endrec = cur;
 
@@ -1067,6 +1237,7 @@ static int mdd_hsm_actions_llog_fini(const struct lu_env *env,
 static void mdd_device_shutdown(const struct lu_env *env, struct mdd_device *m,
 				struct lustre_cfg *cfg)
 {
+	mdd_deferred_destroy_stop(m);
 	barrier_deregister(m->mdd_bottom);
 	lfsck_degister(env, m->mdd_bottom);
 	mdd_hsm_actions_llog_fini(env, m);
@@ -1117,6 +1288,7 @@ static int mdd_process_config(const struct lu_env *env,
 	case LCFG_PRE_CLEANUP:
 		rc = next->ld_ops->ldo_process_config(env, next, cfg);
 		mdd_generic_thread_stop(&m->mdd_orphan_cleanup_thread);
+		mdd_deferred_destroy_stop(m);
 		break;
 	case LCFG_CLEANUP:
 		rc = next->ld_ops->ldo_process_config(env, next, cfg);
@@ -1284,6 +1456,10 @@ static int mdd_prepare(const struct lu_env *env,
 		GOTO(out_lfsck, rc);
 	}
 
+	/* not fatal, unlink destroys inline without destroy threads */
+	if (!mdd->mdd_bottom->dd_rdonly)
+		mdd_deferred_destroy_start(mdd);
+
 	RETURN(0);
 
 out_lfsck:
@@ -1514,8 +1690,16 @@ static const struct obd_ops mdd_obd_device_ops = {
 	.o_set_info_async = mdd_obd_set_info_async,
 };
 
+/**
+ * Register a changelog user.
+ *
+ * \param[in] flags	CLU_F_* flags of the user, CLU_F_SHARDS must be set
+ *			once the MDT has several changelog shards
+ * \param[out] id	id of the new user
+ */
 static int mdd_changelog_user_register(const struct lu_env *env,
-				       struct mdd_device *mdd, int *id)
+				       struct mdd_device *mdd, __u32 flags,
+				       int *id)
 {
         struct llog_ctxt *ctxt;
         struct llog_changelog_user_rec *rec;
@@ -1537,15 +1721,26 @@ static int mdd_changelog_user_register(const struct lu_env *env,
 
         rec->cur_hdr.lrh_len = sizeof(*rec);
         rec->cur_hdr.lrh_type = CHANGELOG_USER_REC;
+	rec->cur_hdr.lrh_id = flags & CLU_F_SHARDS;
 	spin_lock(&mdd->mdd_cl.mc_user_lock);
 	if (mdd->mdd_cl.mc_lastuser == (unsigned int)(-1)) {
 		spin_unlock(&mdd->mdd_cl.mc_user_lock);
 		CERROR("Maximum number of changelog users exceeded!\n");
 		GOTO(out, rc = -EOVERFLOW);
 	}
+	if (!(flags & CLU_F_SHARDS) &&
+	    max(mdd->mdd_cl.mc_shards_wanted,
+		mdd_changelog_shard_count(mdd)) > 1) {
+		spin_unlock(&mdd->mdd_cl.mc_user_lock);
+		CWARN("%s: changelog user must read all changelog shards\n",
+		      mdd2obd_dev(mdd)->obd_name);
+		GOTO(out, rc = -EOPNOTSUPP);
+	}
 	*id = rec->cur_id = ++mdd->mdd_cl.mc_lastuser;
 	mdd->mdd_cl.mc_users++;
-	rec->cur_endrec = mdd->mdd_cl.mc_index;
+	if (!(flags & CLU_F_SHARDS))
+		mdd->mdd_cl.mc_users_unsharded++;
+	rec->cur_endrec = atomic64_read(&mdd->mdd_cl.mc_index);
 
 	rec->cur_time = (__u32)ktime_get_real_seconds();
 	if (OBD_FAIL_CHECK(OBD_FAIL_TIME_IN_CHLOG_USER))
@@ -1559,6 +1754,8 @@ static int mdd_changelog_user_register(const struct lu_env *env,
 		      mdd2obd_dev(mdd)->obd_name, *id, rc);
 		spin_lock(&mdd->mdd_cl.mc_user_lock);
 		mdd->mdd_cl.mc_users--;
+		if (!(flags & CLU_F_SHARDS))
+			mdd->mdd_cl.mc_users_unsharded--;
 		spin_unlock(&mdd->mdd_cl.mc_user_lock);
 		GOTO(out, rc);
 	}
@@ -1629,6 +1826,8 @@ static int mdd_changelog_user_purge_cb(const struct lu_env *env,
 		mcup->mcup_usercount--;
 		spin_lock(&mcup->mcup_mdd->mdd_cl.mc_user_lock);
 		mcup->mcup_mdd->mdd_cl.mc_users--;
+		if (!(hdr->lrh_id & CLU_F_SHARDS))
+			mcup->mcup_mdd->mdd_cl.mc_users_unsharded--;
 		spin_unlock(&mcup->mcup_mdd->mdd_cl.mc_user_lock);
 	}
 
@@ -1788,9 +1987,7 @@ static int mdd_changelog_clear(const struct lu_env *env,
 	CDEBUG(D_IOCTL, "%s: Purge request: id=%u, endrec=%llu\n",
 	       mdd2obd_dev(mdd)->obd_name, id, endrec);
 	/* start_rec is the newest (largest value) entry in the changelogs*/
-	spin_lock(&mdd->mdd_cl.mc_lock);
-	start_rec = mdd->mdd_cl.mc_index;
-	spin_unlock(&mdd->mdd_cl.mc_lock);
+	start_rec = atomic64_read(&mdd->mdd_cl.mc_index);
 
 	if (start_rec < endrec) {
 		CDEBUG(D_IOCTL, "%s: Could not clear changelog, requested "\
@@ -1905,7 +2102,8 @@ static int mdd_iocontrol(const struct lu_env *env, struct md_device *m,
 		if (unlikely(!barrier_entry(mdd->mdd_bottom)))
 			RETURN(-EINPROGRESS);
 
-		rc = mdd_changelog_user_register(env, mdd, &data->ioc_u32_1);
+		rc = mdd_changelog_user_register(env, mdd, data->ioc_u32_2,
+						 &data->ioc_u32_1);
 		barrier_exit(mdd->mdd_bottom);
 		break;
 	case OBD_IOC_CHANGELOG_DEREG:
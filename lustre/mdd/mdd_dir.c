@@ -751,10 +751,13 @@ int mdd_declare_changelog_store(const struct lu_env *env,
 				struct thandle *handle)
 {
 	struct obd_device		*obd = mdd2obd_dev(mdd);
+	struct mdd_thread_info		*info = mdd_env_info(env);
 	struct llog_ctxt		*ctxt;
 	struct llog_changelog_rec	*rec;
+	struct llog_handle		*cathandle;
 	struct lu_buf			*buf;
 	struct thandle			*llog_th;
+	unsigned int			 shards;
 	int				 reclen;
 	int				 rc;
 
@@ -774,11 +777,29 @@ int mdd_declare_changelog_store(const struct lu_env *env,
 	if (ctxt == NULL)
 		return -ENXIO;
 
-	llog_th = thandle_get_sub(env, handle, ctxt->loc_handle->lgh_obj);
+	/*
+	 * The record goes to the shard of the CPT the transaction is
+	 * declared on. The choice is kept in the thread info, so that
+	 * mdd_changelog_store() appends to the declared llog even if the
+	 * thread has moved to another CPU meanwhile, and so that all the
+	 * records of a transaction share one shard. The shard count only
+	 * grows, so the declared shard is still valid at store time.
+	 */
+	shards = mdd_changelog_shard_count(mdd);
+	if (info->mti_chlg_th != handle) {
+		info->mti_chlg_th = handle;
+		info->mti_chlg_shard = shards > 1 ?
+			cfs_cpt_current(cfs_cpt_tab, 0) % shards : 0;
+	}
+	cathandle = info->mti_chlg_shard > 0 ?
+		    mdd->mdd_cl.mc_shards[info->mti_chlg_shard] :
+		    ctxt->loc_handle;
+
+	llog_th = thandle_get_sub(env, handle, cathandle->lgh_obj);
 	if (IS_ERR(llog_th))
 		GOTO(out_put, rc = PTR_ERR(llog_th));
 
-	rc = llog_declare_add(env, ctxt->loc_handle, &rec->cr_hdr, llog_th);
+	rc = llog_declare_add(env, cathandle, &rec->cr_hdr, llog_th);
 
 out_put:
 	llog_ctxt_put(ctxt);
@@ -797,28 +818,35 @@ int mdd_changelog_write_rec(const struct lu_env *env,
 	if (r->lrh_type == CHANGELOG_REC) {
 		struct mdd_device *mdd;
 		struct llog_changelog_rec *rec;
+		__u64 index;
 
 		mdd = lu2mdd_dev(loghandle->lgh_ctxt->loc_obd->obd_lu_dev);
 		rec = container_of(r, struct llog_changelog_rec, cr_hdr);
 
-		spin_lock(&mdd->mdd_cl.mc_lock);
-		rec->cr.cr_index = mdd->mdd_cl.mc_index + 1;
-		spin_unlock(&mdd->mdd_cl.mc_lock);
+		/*
+		 * Appends to different changelog shards run in parallel,
+		 * so the index comes from an atomic counter rather than
+		 * from the catalog lock. Records of one plain llog are
+		 * still written under its lock and thus stay ordered
+		 * within a shard, which is what readers merge on.
+		 */
+		index = atomic64_inc_return(&mdd->mdd_cl.mc_index);
+		rec->cr.cr_index = index;
 
 		rc = llog_osd_ops.lop_write_rec(env, loghandle, r,
 						cookie, idx, th);
 
 		/*
 		 * if current llog is full, we will generate a new
-		 * llog, and since it's actually not an error, let's
-		 * avoid increasing index so that userspace apps
-		 * should not see a gap in the changelog sequence
+		 * llog, and since it's actually not an error, give the
+		 * index back so that userspace apps should not see a
+		 * gap in the changelog sequence. This always succeeds
+		 * with a single catalog, with shards the index becomes
+		 * a gap if another shard took the next one meanwhile.
 		 */
-		if (!(rc == -ENOSPC && llog_is_full(loghandle))) {
-			spin_lock(&mdd->mdd_cl.mc_lock);
-			++mdd->mdd_cl.mc_index;
-			spin_unlock(&mdd->mdd_cl.mc_lock);
-		}
+		if (rc == -ENOSPC && llog_is_full(loghandle))
+			atomic64_cmpxchg(&mdd->mdd_cl.mc_index, index,
+					 index - 1);
 	} else {
 		rc = llog_osd_ops.lop_write_rec(env, loghandle, r,
 						cookie, idx, th);
@@ -839,7 +867,9 @@ int mdd_changelog_store(const struct lu_env *env, struct mdd_device *mdd,
 {
 	struct obd_device	*obd = mdd2obd_dev(mdd);
 	struct llog_ctxt	*ctxt;
+	struct llog_handle	*cathandle;
 	struct thandle		*llog_th;
+	unsigned int		 shard;
 	int			 rc;
 
 	rec->cr_hdr.lrh_len = llog_data_len(sizeof(*rec) +
@@ -853,13 +883,20 @@ int mdd_changelog_store(const struct lu_env *env, struct mdd_device *mdd,
 	if (ctxt == NULL)
 		return -ENXIO;
 
-	llog_th = thandle_get_sub(env, th, ctxt->loc_handle->lgh_obj);
+	/* append to the shard chosen by mdd_declare_changelog_store(), the
+	 * declare and the store of a transaction share the thread info */
+	shard = mdd_env_info(env)->mti_chlg_th == th ?
+		mdd_env_info(env)->mti_chlg_shard : 0;
+	cathandle = shard > 0 ? mdd->mdd_cl.mc_shards[shard] :
+				ctxt->loc_handle;
+
+	llog_th = thandle_get_sub(env, th, cathandle->lgh_obj);
 	if (IS_ERR(llog_th))
 		GOTO(out_put, rc = PTR_ERR(llog_th));
 
 	OBD_FAIL_TIMEOUT(OBD_FAIL_MDS_CHANGELOG_REORDER, cfs_fail_val);
 	/* nested journal transaction */
-	rc = llog_add(env, ctxt->loc_handle, &rec->cr_hdr, NULL, llog_th);
+	rc = llog_add(env, cathandle, &rec->cr_hdr, NULL, llog_th);
 
 	/* time to recover some space ?? */
 	if (likely(!mdd->mdd_changelog_gc ||
@@ -873,7 +910,7 @@ int mdd_changelog_store(const struct lu_env *env, struct mdd_device *mdd,
 		     mdd->mdd_cl.mc_gc_task == MDD_CHLG_GC_NONE &&
 		     ktime_get_real_seconds() - mdd->mdd_cl.mc_gc_time >
 			mdd->mdd_changelog_min_gc_interval)) {
-		if (unlikely(llog_cat_free_space(ctxt->loc_handle) <=
+		if (unlikely(llog_cat_free_space(cathandle) <=
 			     mdd->mdd_changelog_min_free_cat_entries ||
 			     OBD_FAIL_CHECK(OBD_FAIL_FORCE_GC_THREAD))) {
 			CWARN("%s:%s low on changelog_catalog free entries, "
@@ -1535,6 +1572,8 @@ int mdd_finish_unlink(const struct lu_env *env,
 		      const struct lu_name *lname,
 		      struct thandle *th)
 {
+	struct mdd_device *mdd = mdo2mdd(&obj->mod_obj);
+	struct mdd_destroy_item *mdi = NULL;
 	int rc = 0;
 	int is_dir = S_ISDIR(ma->ma_attr.la_mode);
 	ENTRY;
@@ -1565,7 +1604,22 @@ int mdd_finish_unlink(const struct lu_env *env,
 			 * causing the asserition */
 			rc = mdd_mark_orphan_object(env, obj, th, false);
 		} else {
-			rc = mdo_destroy(env, obj, th);
+			/* both orphan insert and destroy were declared, so
+			 * the file can go to PENDING to be destroyed by the
+			 * deferred destroy threads after the reply. A remote
+			 * object has no local PENDING entry to go to. */
+			if (S_ISREG(ma->ma_attr.la_mode) &&
+			    !mdd_object_remote(obj))
+				mdi = mdd_deferred_destroy_prep(mdd);
+			if (mdi && mdd_orphan_insert(env, obj, th) == 0) {
+				mdd_deferred_destroy_queue(mdd, mdi, obj);
+				rc = mdd_mark_orphan_object(env, obj, th,
+							    false);
+			} else {
+				if (mdi)
+					mdd_deferred_destroy_cancel(mdd, mdi);
+				rc = mdo_destroy(env, obj, th);
+			}
 		}
 	} else if (!is_dir) {
 		/* old files may not have link ea; ignore errors */
@@ -1817,6 +1871,8 @@ static int mdd_unlink(const struct lu_env *env, struct md_object *pobj,
 	if (rc == -ENOENT) {
 		cattr->la_nlink = 0;
 		rc = 0;
+	} else if (rc == 0 && mdd_object_destroy_deferred(mdd_cobj)) {
+		cattr->la_nlink = 0;
 	}
 
 	if (cattr->la_nlink == 0) {
@@ -3190,6 +3246,8 @@ static int mdd_rename(const struct lu_env *env,
 			 * return the latest known attributes */
 			tattr->la_nlink = 0;
 			rc = 0;
+		} else if (rc == 0 && mdd_object_destroy_deferred(mdd_tobj)) {
+			tattr->la_nlink = 0;
 		} else if (rc != 0) {
 			CERROR("%s: Failed to get nlink for tobj "
 				DFID": rc = %d\n",
@@ -93,14 +93,28 @@
 /** else the started task_struct address when running **/
 
 struct mdd_changelog {
-	spinlock_t		mc_lock;	/* for index */
+	spinlock_t		mc_lock;	/* for flags and gc */
 	int			mc_flags;
 	int			mc_mask;
-	__u64			mc_index;
+	/* last assigned record index */
+	atomic64_t		mc_index;
+	/* catalogs records are written to, mc_shards[0] is the
+	 * CHANGELOG_CATALOG handle of the changelog llog context. Entries
+	 * are only added, under mc_shard_mutex, and published by
+	 * mc_shard_count. */
+	struct llog_handle	*mc_shards[CHANGELOG_MAX_SHARDS];
+	unsigned int		mc_shard_count;
+	struct mutex		mc_shard_mutex;
 	ktime_t			mc_starttime;
 	spinlock_t		mc_user_lock;
 	int			mc_lastuser;
 	int			mc_users;      /* registered users number */
+	/* registered users reading CHANGELOG_CATALOG only, extra shards
+	 * can not be added while there is any */
+	int			mc_users_unsharded;
+	/* shard count set by the administrator, may be ahead of
+	 * mc_shard_count while the shards are being created */
+	unsigned int		mc_shards_wanted;
 	struct task_struct	*mc_gc_task;
 	time64_t		mc_gc_time;    /* last GC check or run time */
 	unsigned int		mc_deniednext; /* interval for recording denied
@@ -130,6 +144,35 @@ struct mdd_generic_thread {
 	bool			mgt_init;
 };
 
+#define MDD_DESTROY_THREADS_DEFAULT	2
+#define MDD_DESTROY_THREADS_MAX		16
+#define MDD_DESTROY_MAX_PENDING_DEFAULT	(64 * 1024)
+#define MDD_DESTROY_BATCH		32
+/* seconds before retrying a destroy blocked by a write barrier */
+#define MDD_DESTROY_RETRY_DELAY		1
+
+/* deferred destroy of unlinked files, see mdd_orphans.c */
+struct mdd_destroy_pool {
+	spinlock_t		mdp_lock;
+	struct list_head	mdp_list;	/* mdd_destroy_item queue */
+	/* items to retry once their mdi_retry time is reached */
+	struct list_head	mdp_retry_list;
+	wait_queue_head_t	mdp_waitq;
+	/* objects queued or being destroyed */
+	unsigned int		mdp_pending;
+	/* above this backlog unlink destroys inline */
+	unsigned int		mdp_max_pending;
+	unsigned int		mdp_threads;	/* wanted thread count */
+	unsigned int		mdp_running;	/* live threads */
+	unsigned long		mdp_slots;	/* thread indexes in use */
+	bool			mdp_started;
+	bool			mdp_stopping;
+	__u64			mdp_queued;
+	__u64			mdp_destroyed;
+	__u64			mdp_failed;
+	__u64			mdp_inline;	/* throttled to inline */
+};
+
 struct mdd_device {
         struct md_device                 mdd_md_dev;
 	struct obd_export               *mdd_child_exp;
@@ -154,6 +197,7 @@ struct mdd_device {
 	char				 mdd_append_pool[LOV_MAXPOOLNAME + 1];
 	struct local_oid_storage	*mdd_los;
 	struct mdd_generic_thread	 mdd_orphan_cleanup_thread;
+	struct mdd_destroy_pool		 mdd_destroy_pool;
 	struct kobject			 mdd_kobj;
 	struct kobj_type		 mdd_ktype;
 	struct completion		 mdd_kobj_unregister;
@@ -212,6 +256,9 @@ struct mdd_thread_info {
 	struct lu_seq_range	  mti_range;
 	union lmv_mds_md	  mti_lmv;
 	struct md_layout_change	  mti_mlc;
+	/* changelog shard declared for transaction mti_chlg_th */
+	struct thandle		 *mti_chlg_th;
+	unsigned int		  mti_chlg_shard;
 };
 
 int mdd_la_get(const struct lu_env *env, struct mdd_object *obj,
@@ -312,6 +359,17 @@ int mdd_orphan_declare_insert(const struct lu_env *env, struct mdd_object *obj,
 			      umode_t mode, struct thandle *thandle);
 int mdd_orphan_declare_delete(const struct lu_env *env, struct mdd_object *obj,
 			      struct thandle *thandle);
+void mdd_deferred_destroy_init(struct mdd_device *mdd);
+struct mdd_destroy_item *mdd_deferred_destroy_prep(struct mdd_device *mdd);
+void mdd_deferred_destroy_cancel(struct mdd_device *mdd,
+				 struct mdd_destroy_item *mdi);
+void mdd_deferred_destroy_queue(struct mdd_device *mdd,
+				struct mdd_destroy_item *mdi,
+				struct mdd_object *obj);
+int mdd_deferred_destroy_threads_set(struct mdd_device *mdd,
+				     unsigned int threads);
+int mdd_deferred_destroy_start(struct mdd_device *mdd);
+void mdd_deferred_destroy_stop(struct mdd_device *mdd);
 int mdd_dir_is_empty(const struct lu_env *env, struct mdd_object *dir);
 
 /* mdd_lproc.c */
@@ -429,6 +487,8 @@ int mdd_generic_thread_start(struct mdd_generic_thread *thread,
 void mdd_generic_thread_stop(struct mdd_generic_thread *thread);
 int mdd_changelog_user_purge(const struct lu_env *env, struct mdd_device *mdd,
 			     __u32 id);
+int mdd_changelog_shards_set(const struct lu_env *env, struct mdd_device *mdd,
+			     unsigned int count);
 
 /* mdd_prepare.c */
 int mdd_compat_fixes(const struct lu_env *env, struct mdd_device *mdd);
@@ -539,6 +599,12 @@ static inline const char *mdd_obj_dev_name(const struct mdd_object *mdd_obj)
 	return lu_dev_name(mdd_obj->mod_obj.mo_lu.lo_dev);
 }
 
+/* unlinked and queued for deferred destroy, only the PENDING link is left */
+static inline bool mdd_object_destroy_deferred(const struct mdd_object *obj)
+{
+	return obj->mod_count == 0 && obj->mod_flags & ORPHAN_OBJ;
+}
+
 #define MAX_ATIME_DIFF 60
 
 static inline int mdd_permission_internal(const struct lu_env *env,
@@ -815,4 +881,10 @@ static inline bool mdd_changelog_enabled(const struct lu_env *env,
 	}
 }
 
+static inline unsigned int mdd_changelog_shard_count(struct mdd_device *mdd)
+{
+	/* pairs with smp_store_release() in mdd_changelog_shards_open() */
+	return smp_load_acquire(&mdd->mdd_cl.mc_shard_count);
+}
+
 #endif
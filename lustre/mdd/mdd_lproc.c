@@ -164,9 +164,7 @@ static int mdd_changelog_users_seq_show(struct seq_file *m, void *data)
 		return rc;
 	}
 
-	spin_lock(&mdd->mdd_cl.mc_lock);
-	cur = mdd->mdd_cl.mc_index;
-	spin_unlock(&mdd->mdd_cl.mc_lock);
+	cur = atomic64_read(&mdd->mdd_cl.mc_index);
 
 	seq_printf(m, "current index: %llu\n", cur);
 	seq_printf(m, "%-5s %s %s\n", "ID", "index", "(idle seconds)");
@@ -212,6 +210,7 @@ static ssize_t changelog_size_show(struct kobject *kobj,
 	struct mdd_device *mdd = container_of(kobj, struct mdd_device,
 					      mdd_kobj);
 	struct lu_env env;
+	unsigned int i;
 	u64 tmp = 0;
 	int rc;
 
@@ -225,6 +224,10 @@ static ssize_t changelog_size_show(struct kobject *kobj,
 		return rc;
 	}
 
+	/* shard 0 is the context catalog accounted above */
+	for (i = 1; i < mdd_changelog_shard_count(mdd); i++)
+		tmp += llog_cat_size(&env, mdd->mdd_cl.mc_shards[i]);
+
 	rc = mdd_changelog_size_ctxt(&env, mdd, LLOG_CHANGELOG_USER_ORIG_CTXT,
 				     &tmp);
 
@@ -263,6 +266,41 @@ static ssize_t changelog_gc_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(changelog_gc);
 
+static ssize_t changelog_shards_show(struct kobject *kobj,
+				     struct attribute *attr,
+				     char *buf)
+{
+	struct mdd_device *mdd = container_of(kobj, struct mdd_device,
+					      mdd_kobj);
+
+	return sprintf(buf, "%u\n", mdd_changelog_shard_count(mdd));
+}
+
+static ssize_t changelog_shards_store(struct kobject *kobj,
+				      struct attribute *attr,
+				      const char *buffer, size_t count)
+{
+	struct mdd_device *mdd = container_of(kobj, struct mdd_device,
+					      mdd_kobj);
+	struct lu_env env;
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	rc = lu_env_init(&env, LCT_LOCAL);
+	if (rc)
+		return rc;
+
+	rc = mdd_changelog_shards_set(&env, mdd, val);
+	lu_env_fini(&env);
+
+	return rc ?: count;
+}
+LUSTRE_RW_ATTR(changelog_shards);
+
 static ssize_t changelog_max_idle_time_show(struct kobject *kobj,
 					    struct attribute *attr,
 					    char *buf)
@@ -644,6 +682,95 @@ static ssize_t append_pool_store(struct kobject *kobj, struct attribute *attr,
 }
 LUSTRE_RW_ATTR(append_pool);
 
+static ssize_t deferred_destroy_threads_show(struct kobject *kobj,
+					     struct attribute *attr, char *buf)
+{
+	struct mdd_device *mdd = container_of(kobj, struct mdd_device,
+					      mdd_kobj);
+
+	return sprintf(buf, "%u\n", mdd->mdd_destroy_pool.mdp_threads);
+}
+
+/**
+ * Set the number of threads destroying unlinked files in the background.
+ * 0 disables deferred destroy, unlink then destroys files inline.
+ */
+static ssize_t deferred_destroy_threads_store(struct kobject *kobj,
+					      struct attribute *attr,
+					      const char *buffer, size_t count)
+{
+	struct mdd_device *mdd = container_of(kobj, struct mdd_device,
+					      mdd_kobj);
+	unsigned int threads;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &threads);
+	if (rc)
+		return rc;
+
+	rc = mdd_deferred_destroy_threads_set(mdd, threads);
+
+	return rc ? rc : count;
+}
+LUSTRE_RW_ATTR(deferred_destroy_threads);
+
+static ssize_t deferred_destroy_max_pending_show(struct kobject *kobj,
+						 struct attribute *attr,
+						 char *buf)
+{
+	struct mdd_device *mdd = container_of(kobj, struct mdd_device,
+					      mdd_kobj);
+
+	return sprintf(buf, "%u\n", mdd->mdd_destroy_pool.mdp_max_pending);
+}
+
+/**
+ * Set the deferred destroy backlog above which unlink destroys inline again,
+ * throttling unlink to the speed of the destroy threads.
+ */
+static ssize_t deferred_destroy_max_pending_store(struct kobject *kobj,
+						  struct attribute *attr,
+						  const char *buffer,
+						  size_t count)
+{
+	struct mdd_device *mdd = container_of(kobj, struct mdd_device,
+					      mdd_kobj);
+	unsigned int max;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &max);
+	if (rc)
+		return rc;
+
+	mdd->mdd_destroy_pool.mdp_max_pending = max;
+
+	return count;
+}
+LUSTRE_RW_ATTR(deferred_destroy_max_pending);
+
+static int mdd_deferred_destroy_stats_seq_show(struct seq_file *m, void *data)
+{
+	struct mdd_device *mdd = m->private;
+	struct mdd_destroy_pool *mdp = &mdd->mdd_destroy_pool;
+
+	spin_lock(&mdp->mdp_lock);
+	seq_printf(m, "threads: %u\n"
+		   "running: %u\n"
+		   "pending: %u\n"
+		   "max_pending: %u\n"
+		   "queued: %llu\n"
+		   "destroyed: %llu\n"
+		   "failed: %llu\n"
+		   "inline: %llu\n",
+		   mdp->mdp_threads, mdp->mdp_running, mdp->mdp_pending,
+		   mdp->mdp_max_pending, mdp->mdp_queued, mdp->mdp_destroyed,
+		   mdp->mdp_failed, mdp->mdp_inline);
+	spin_unlock(&mdp->mdp_lock);
+
+	return 0;
+}
+LDEBUGFS_SEQ_FOPS_RO(mdd_deferred_destroy_stats);
+
 static struct ldebugfs_vars ldebugfs_mdd_obd_vars[] = {
 	{ .name =	"changelog_mask",
 	  .fops =	&mdd_changelog_mask_fops	},
@@ -653,6 +780,8 @@ static struct ldebugfs_vars ldebugfs_mdd_obd_vars[] = {
 	  .fops =	&mdd_lfsck_namespace_fops	},
 	{ .name	=	"lfsck_layout",
 	  .fops	=	&mdd_lfsck_layout_fops		},
+	{ .name	=	"deferred_destroy_stats",
+	  .fops	=	&mdd_deferred_destroy_stats_fops	},
 	{ NULL }
 };
 
@@ -661,6 +790,7 @@ static struct attribute *mdd_attrs[] = {
 	&lustre_attr_atime_diff.attr,
 	&lustre_attr_changelog_size.attr,
 	&lustre_attr_changelog_gc.attr,
+	&lustre_attr_changelog_shards.attr,
 	&lustre_attr_changelog_max_idle_time.attr,
 	&lustre_attr_changelog_max_idle_indexes.attr,
 	&lustre_attr_changelog_min_gc_interval.attr,
@@ -671,6 +801,8 @@ static struct attribute *mdd_attrs[] = {
 	&lustre_attr_sync_permission.attr,
 	&lustre_attr_append_stripe_count.attr,
 	&lustre_attr_append_pool.attr,
+	&lustre_attr_deferred_destroy_threads.attr,
+	&lustre_attr_deferred_destroy_max_pending.attr,
 	NULL,
 };
 
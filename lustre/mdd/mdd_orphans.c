@@ -39,6 +39,7 @@
 
 #define DEBUG_SUBSYSTEM S_MDS
 
+#include <linux/kthread.h>
 #include <obd.h>
 #include <obd_class.h>
 #include <obd_support.h>
@@ -586,3 +587,351 @@ out:
 
 	return rc;
 }
+
+/*
+ * Deferred destroy of unlinked files.
+ *
+ * When the last link of a regular file is removed and nobody has it open,
+ * mdd_finish_unlink() normally destroys the MDT inode and, through LOD/OSP,
+ * records a destroy llog record for every OST object in the unlink
+ * transaction.  With deferred destroy the file is instead moved to the
+ * PENDING directory like an open-unlinked file, and a pool of MDD threads
+ * destroys it shortly after the unlink has replied.  PENDING keeps the
+ * object persistent across a crash: anything still queued is destroyed by
+ * the orphan cleanup after recovery.
+ */
+struct mdd_destroy_item {
+	struct list_head	mdi_list;
+	struct lu_fid		mdi_fid;
+	/* when to retry a destroy that returned -EINPROGRESS */
+	time64_t		mdi_retry;
+};
+
+struct mdd_destroy_args {
+	struct mdd_device	*mda_mdd;
+	unsigned int		 mda_index;
+};
+
+void mdd_deferred_destroy_init(struct mdd_device *mdd)
+{
+	struct mdd_destroy_pool *mdp = &mdd->mdd_destroy_pool;
+
+	spin_lock_init(&mdp->mdp_lock);
+	INIT_LIST_HEAD(&mdp->mdp_list);
+	INIT_LIST_HEAD(&mdp->mdp_retry_list);
+	init_waitqueue_head(&mdp->mdp_waitq);
+	mdp->mdp_max_pending = MDD_DESTROY_MAX_PENDING_DEFAULT;
+	mdp->mdp_threads = MDD_DESTROY_THREADS_DEFAULT;
+}
+
+/**
+ * Reserve a deferred destroy slot for an object about to lose its last link.
+ *
+ * \param[in] mdd	MDD device
+ *
+ * \retval		item to pass to mdd_deferred_destroy_queue() or
+ *			mdd_deferred_destroy_cancel()
+ * \retval NULL		the object should be destroyed inline, because
+ *			deferral is disabled or the backlog is too large
+ */
+struct mdd_destroy_item *mdd_deferred_destroy_prep(struct mdd_device *mdd)
+{
+	struct mdd_destroy_pool *mdp = &mdd->mdd_destroy_pool;
+	struct mdd_destroy_item *mdi;
+
+	spin_lock(&mdp->mdp_lock);
+	if (!mdp->mdp_started || mdp->mdp_stopping || !mdp->mdp_threads ||
+	    !mdp->mdp_running) {
+		spin_unlock(&mdp->mdp_lock);
+		return NULL;
+	}
+	if (mdp->mdp_pending >= mdp->mdp_max_pending) {
+		mdp->mdp_inline++;
+		spin_unlock(&mdp->mdp_lock);
+		return NULL;
+	}
+	mdp->mdp_pending++;
+	spin_unlock(&mdp->mdp_lock);
+
+	OBD_ALLOC_PTR(mdi);
+	if (!mdi) {
+		spin_lock(&mdp->mdp_lock);
+		mdp->mdp_pending--;
+		mdp->mdp_inline++;
+		spin_unlock(&mdp->mdp_lock);
+	}
+
+	return mdi;
+}
+
+void mdd_deferred_destroy_cancel(struct mdd_device *mdd,
+				 struct mdd_destroy_item *mdi)
+{
+	struct mdd_destroy_pool *mdp = &mdd->mdd_destroy_pool;
+
+	OBD_FREE_PTR(mdi);
+	spin_lock(&mdp->mdp_lock);
+	mdp->mdp_pending--;
+	mdp->mdp_inline++;
+	spin_unlock(&mdp->mdp_lock);
+}
+
+/**
+ * Hand an orphan object inserted into PENDING over to the destroy threads.
+ *
+ * \param[in] mdd	MDD device
+ * \param[in] mdi	item from mdd_deferred_destroy_prep()
+ * \param[in] obj	object, already in the orphan index
+ */
+void mdd_deferred_destroy_queue(struct mdd_device *mdd,
+				struct mdd_destroy_item *mdi,
+				struct mdd_object *obj)
+{
+	struct mdd_destroy_pool *mdp = &mdd->mdd_destroy_pool;
+
+	mdi->mdi_fid = *mdd_object_fid(obj);
+	spin_lock(&mdp->mdp_lock);
+	list_add_tail(&mdi->mdi_list, &mdp->mdp_list);
+	mdp->mdp_queued++;
+	spin_unlock(&mdp->mdp_lock);
+	wake_up(&mdp->mdp_waitq);
+}
+
+static int mdd_deferred_destroy_one(const struct lu_env *env,
+				    struct mdd_device *mdd,
+				    const struct lu_fid *fid)
+{
+	struct mdd_object *obj;
+	int rc = 0;
+
+	obj = mdd_object_find(env, mdd, fid);
+	if (IS_ERR(obj))
+		return PTR_ERR(obj);
+
+	/* reopened (e.g. by FID) objects are destroyed by the last close */
+	if (mdd_object_exists(obj) && obj->mod_count == 0 &&
+	    obj->mod_flags & ORPHAN_OBJ) {
+		rc = mdd_orphan_destroy(env, obj,
+					mdd_orphan_key_fill(env, fid));
+		/* already removed by the orphan cleanup thread */
+		if (rc == -ENOENT)
+			rc = 0;
+	}
+	mdd_object_put(env, obj);
+
+	return rc;
+}
+
+static int mdd_deferred_destroy_thread(void *args)
+{
+	struct mdd_destroy_args *mda = args;
+	struct mdd_device *mdd = mda->mda_mdd;
+	struct mdd_destroy_pool *mdp = &mdd->mdd_destroy_pool;
+	unsigned int idx = mda->mda_index;
+	struct mdd_destroy_item *mdi, *tmp;
+	struct lu_env env;
+	int rc;
+
+	OBD_FREE_PTR(mda);
+
+	rc = lu_env_init(&env, LCT_MD_THREAD);
+	if (rc) {
+		CERROR("%s: cannot init destroy thread env: rc = %d\n",
+		       mdd2obd_dev(mdd)->obd_name, rc);
+		spin_lock(&mdp->mdp_lock);
+		clear_bit(idx, &mdp->mdp_slots);
+		goto out;
+	}
+
+	while (1) {
+		LIST_HEAD(batch);
+		int count = 0;
+
+		/* wake up in time for the retries */
+		wait_event_idle_timeout(mdp->mdp_waitq,
+				!list_empty(&mdp->mdp_list) ||
+				mdp->mdp_stopping || idx >= mdp->mdp_threads,
+				list_empty(&mdp->mdp_retry_list) ?
+				MAX_SCHEDULE_TIMEOUT :
+				cfs_time_seconds(MDD_DESTROY_RETRY_DELAY));
+
+		OBD_FAIL_TIMEOUT(OBD_FAIL_MDS_DESTROY_DELAY, cfs_fail_val);
+
+		spin_lock(&mdp->mdp_lock);
+		if (mdp->mdp_stopping || idx >= mdp->mdp_threads) {
+			/* the slot may be restarted while we exit */
+			clear_bit(idx, &mdp->mdp_slots);
+			spin_unlock(&mdp->mdp_lock);
+			break;
+		}
+		list_for_each_entry_safe(mdi, tmp, &mdp->mdp_retry_list,
+					 mdi_list) {
+			if (mdi->mdi_retry > ktime_get_seconds())
+				break;
+			list_move_tail(&mdi->mdi_list, &mdp->mdp_list);
+		}
+		list_for_each_entry_safe(mdi, tmp, &mdp->mdp_list, mdi_list) {
+			list_move_tail(&mdi->mdi_list, &batch);
+			if (++count >= MDD_DESTROY_BATCH)
+				break;
+		}
+		spin_unlock(&mdp->mdp_lock);
+
+		list_for_each_entry_safe(mdi, tmp, &batch, mdi_list) {
+			rc = mdd_deferred_destroy_one(&env, mdd,
+						      &mdi->mdi_fid);
+			if (rc == -EINPROGRESS) {
+				/* write barrier or snapshot, try later */
+				mdi->mdi_retry = ktime_get_seconds() +
+						 MDD_DESTROY_RETRY_DELAY;
+				spin_lock(&mdp->mdp_lock);
+				list_move_tail(&mdi->mdi_list,
+					       &mdp->mdp_retry_list);
+				spin_unlock(&mdp->mdp_lock);
+				continue;
+			}
+			if (rc)
+				/* left in PENDING for the orphan cleanup */
+				CERROR("%s: cannot destroy orphan "DFID": rc = %d\n",
+				       mdd2obd_dev(mdd)->obd_name,
+				       PFID(&mdi->mdi_fid), rc);
+
+			list_del(&mdi->mdi_list);
+			OBD_FREE_PTR(mdi);
+
+			spin_lock(&mdp->mdp_lock);
+			mdp->mdp_pending--;
+			if (rc)
+				mdp->mdp_failed++;
+			else
+				mdp->mdp_destroyed++;
+			spin_unlock(&mdp->mdp_lock);
+		}
+	}
+
+	lu_env_fini(&env);
+	spin_lock(&mdp->mdp_lock);
+out:
+	mdp->mdp_running--;
+	spin_unlock(&mdp->mdp_lock);
+	wake_up_all(&mdp->mdp_waitq);
+
+	return 0;
+}
+
+/**
+ * Change the number of deferred destroy threads.
+ *
+ * Threads beyond \a threads exit on their own, missing ones are started if
+ * the pool is running.  Setting 0 disables deferred destroy; objects that
+ * are already queued are still destroyed if some thread is left, otherwise
+ * by the orphan cleanup after the next restart.
+ *
+ * \param[in] mdd	MDD device
+ * \param[in] threads	new number of threads
+ *
+ * \retval 0		on success
+ * \retval negative	errno if a thread could not be started
+ */
+int mdd_deferred_destroy_threads_set(struct mdd_device *mdd,
+				     unsigned int threads)
+{
+	struct mdd_destroy_pool *mdp = &mdd->mdd_destroy_pool;
+	unsigned long start = 0;
+	unsigned int i;
+	int rc = 0;
+
+	if (threads > MDD_DESTROY_THREADS_MAX)
+		return -ERANGE;
+
+	spin_lock(&mdp->mdp_lock);
+	mdp->mdp_threads = threads;
+	if (mdp->mdp_started && !mdp->mdp_stopping) {
+		for (i = 0; i < threads; i++) {
+			if (!test_and_set_bit(i, &mdp->mdp_slots)) {
+				set_bit(i, &start);
+				mdp->mdp_running++;
+			}
+		}
+	}
+	spin_unlock(&mdp->mdp_lock);
+	wake_up_all(&mdp->mdp_waitq);
+
+	for_each_set_bit(i, &start, MDD_DESTROY_THREADS_MAX) {
+		struct mdd_destroy_args *mda;
+		struct task_struct *task;
+
+		OBD_ALLOC_PTR(mda);
+		if (mda) {
+			mda->mda_mdd = mdd;
+			mda->mda_index = i;
+			task = kthread_run(mdd_deferred_destroy_thread, mda,
+					   "mdd_dd_%02u", i);
+			if (!IS_ERR(task))
+				continue;
+			OBD_FREE_PTR(mda);
+			rc = PTR_ERR(task);
+		} else {
+			rc = -ENOMEM;
+		}
+
+		spin_lock(&mdp->mdp_lock);
+		clear_bit(i, &mdp->mdp_slots);
+		mdp->mdp_running--;
+		spin_unlock(&mdp->mdp_lock);
+	}
+
+	if (rc)
+		CERROR("%s: cannot start deferred destroy threads: rc = %d\n",
+		       mdd2obd_dev(mdd)->obd_name, rc);
+
+	return rc;
+}
+
+int mdd_deferred_destroy_start(struct mdd_device *mdd)
+{
+	struct mdd_destroy_pool *mdp = &mdd->mdd_destroy_pool;
+
+	spin_lock(&mdp->mdp_lock);
+	mdp->mdp_started = true;
+	mdp->mdp_stopping = false;
+	spin_unlock(&mdp->mdp_lock);
+
+	return mdd_deferred_destroy_threads_set(mdd, mdp->mdp_threads);
+}
+
+/**
+ * Stop the deferred destroy threads and drop the queue.
+ *
+ * The objects still queued stay in PENDING and are destroyed by the orphan
+ * cleanup once the target is mounted again.
+ */
+void mdd_deferred_destroy_stop(struct mdd_device *mdd)
+{
+	struct mdd_destroy_pool *mdp = &mdd->mdd_destroy_pool;
+	struct mdd_destroy_item *mdi, *tmp;
+	LIST_HEAD(list);
+
+	spin_lock(&mdp->mdp_lock);
+	if (!mdp->mdp_started) {
+		spin_unlock(&mdp->mdp_lock);
+		return;
+	}
+	mdp->mdp_stopping = true;
+	spin_unlock(&mdp->mdp_lock);
+	wake_up_all(&mdp->mdp_waitq);
+
+	wait_event_idle(mdp->mdp_waitq, mdp->mdp_running == 0);
+
+	spin_lock(&mdp->mdp_lock);
+	list_splice_init(&mdp->mdp_list, &list);
+	list_splice_init(&mdp->mdp_retry_list, &list);
+	mdp->mdp_started = false;
+	spin_unlock(&mdp->mdp_lock);
+
+	list_for_each_entry_safe(mdi, tmp, &list, mdi_list) {
+		list_del(&mdi->mdi_list);
+		OBD_FREE_PTR(mdi);
+		mdp->mdp_pending--;
+	}
+}
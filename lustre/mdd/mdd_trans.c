@@ -128,7 +128,8 @@ static int mdd_changelog_gc_cb(const struct lu_env *env,
 		 */
 		__u64 idle_indexes;
 
-		idle_indexes = mdd->mdd_cl.mc_index - rec->cur_endrec;
+		idle_indexes = atomic64_read(&mdd->mdd_cl.mc_index) -
+			       rec->cur_endrec;
 
 		/* treat user with the oldest/smallest current index first */
 		if (idle_indexes >= mdd->mdd_changelog_max_idle_indexes &&
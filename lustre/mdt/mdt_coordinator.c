@@ -141,6 +141,13 @@ struct hsm_scan_data {
 	 */
 	bool			 hsd_housekeeping;
 	bool			 hsd_one_restore;
+	/* location of the first waiting request, and of the last record
+	 * seen by the scan */
+	bool			 hsd_found_waiting;
+	u32			 hsd_waiting_cat_idx;
+	u32			 hsd_waiting_rec_idx;
+	u32			 hsd_last_cat_idx;
+	u32			 hsd_last_rec_idx;
 	int			 hsd_action_count;
 	int			 hsd_request_len; /* array alloc len */
 	int			 hsd_request_count; /* array used count */
@@ -377,6 +384,7 @@ static int mdt_cdt_started_cb(const struct lu_env *env,
 
 	larr->arr_status = ARS_CANCELED;
 	larr->arr_req_change = now;
+	cdt_fid_action_del(cdt, &hai->hai_fid, hai->hai_cookie);
 	rc = llog_write(hsd->hsd_mti->mti_env, llh, &larr->arr_hdr,
 			larr->arr_hdr.lrh_index);
 	if (rc < 0) {
@@ -415,15 +423,26 @@ static int mdt_coordinator_cb(const struct lu_env *env,
 	struct hsm_scan_data *hsd = data;
 	struct mdt_device *mdt = hsd->hsd_mti->mti_mdt;
 	struct coordinator *cdt = &mdt->mdt_coordinator;
+	int rc;
 	ENTRY;
 
 	larr = (struct llog_agent_req_rec *)hdr;
 	dump_llog_agent_req_rec("mdt_coordinator_cb(): ", larr);
+	hsd->hsd_last_cat_idx = llh->lgh_hdr->llh_cat_idx;
+	hsd->hsd_last_rec_idx = hdr->lrh_index;
+
 	switch (larr->arr_status) {
 	case ARS_WAITING:
-		RETURN(mdt_cdt_waiting_cb(env, mdt, llh, larr, hsd));
+		if (!hsd->hsd_found_waiting) {
+			hsd->hsd_found_waiting = true;
+			hsd->hsd_waiting_cat_idx = hsd->hsd_last_cat_idx;
+			hsd->hsd_waiting_rec_idx = hsd->hsd_last_rec_idx;
+		}
+		rc = mdt_cdt_waiting_cb(env, mdt, llh, larr, hsd);
+		break;
 	case ARS_STARTED:
-		RETURN(mdt_cdt_started_cb(env, mdt, llh, larr, hsd));
+		rc = mdt_cdt_started_cb(env, mdt, llh, larr, hsd);
+		break;
 	default:
 		if (!hsd->hsd_housekeeping)
 			RETURN(0);
@@ -437,6 +456,13 @@ static int mdt_coordinator_cb(const struct lu_env *env,
 
 		RETURN(0);
 	}
+
+	/* housekeeping visits every record, rebuild the FID index */
+	if (hsd->hsd_housekeeping && rc >= 0 && rc != LLOG_DEL_RECORD &&
+	    !agent_req_in_final_state(larr->arr_status))
+		cdt_fid_action_add(cdt, larr);
+
+	RETURN(rc);
 }
 
 /* Release the ressource used by the coordinator. Called when the
@@ -471,6 +497,9 @@ static void mdt_hsm_cdt_cleanup(struct mdt_device *mdt)
 	}
 	up_write(&cdt->cdt_agent_lock);
 
+	/* no housekeeping keeps the FID index in sync anymore */
+	cdt_fid_action_purge(cdt, true);
+
 	cdt_mti = lu_context_key_get(&cdt->cdt_env.le_ctx, &mdt_thread_key);
 	mutex_lock(&cdt->cdt_restore_lock);
 	list_for_each_entry_safe(crh, tmp3, &cdt->cdt_restore_handle_list,
@@ -562,6 +591,9 @@ static int mdt_coordinator(void *data)
 	obd_uuid2fsname(hsd.hsd_fsname, mdt_obd_name(mdt),
 			sizeof(hsd.hsd_fsname));
 
+	cdt->cdt_scan_cat_idx = 0;
+	cdt->cdt_scan_rec_idx = 0;
+
 	set_cdt_state(cdt, CDT_RUNNING);
 
 	/* Inform mdt_hsm_cdt_start(). */
@@ -573,6 +605,8 @@ static int mdt_coordinator(void *data)
 		int updates_sz;
 		int updates_cnt;
 		struct hsm_record_update *updates;
+		u32 start_cat_idx = 0;
+		u32 start_rec_idx = 0;
 
 		/* Limit execution of the expensive requests traversal
 		 * to at most one second. This prevents repeatedly
@@ -642,12 +676,48 @@ static int mdt_coordinator(void *data)
 		hsd.hsd_action_count = 0;
 		hsd.hsd_request_count = 0;
 		hsd.hsd_one_restore = false;
+		hsd.hsd_found_waiting = false;
+		hsd.hsd_last_cat_idx = 0;
+		hsd.hsd_last_rec_idx = 0;
+
+		/* Housekeeping walks the whole log. Otherwise, there is
+		 * no new work before the first waiting request seen by
+		 * the previous scan: new requests are appended and the
+		 * ones going back to waiting set cdt_scan_restart. */
+		if (hsd.hsd_housekeeping) {
+			cdt->cdt_fid_action_gen++;
+			cdt->cdt_fid_action_lost = false;
+			cdt->cdt_scan_restart = false;
+		} else if (cdt->cdt_scan_restart) {
+			cdt->cdt_scan_restart = false;
+		} else {
+			start_cat_idx = cdt->cdt_scan_cat_idx;
+			start_rec_idx = cdt->cdt_scan_rec_idx;
+			/* Fixup starting record index for llog_cat_process(). */
+			if (start_rec_idx != 0)
+				start_rec_idx -= 1;
+		}
 
 		rc = cdt_llog_process(mti->mti_env, mdt, mdt_coordinator_cb,
-				      &hsd, 0, 0, WRITE);
+				      &hsd, start_cat_idx, start_rec_idx, WRITE);
 		if (rc < 0)
 			goto clean_cb_alloc;
 
+		if (hsd.hsd_found_waiting) {
+			cdt->cdt_scan_cat_idx = hsd.hsd_waiting_cat_idx;
+			cdt->cdt_scan_rec_idx = hsd.hsd_waiting_rec_idx;
+		} else if (hsd.hsd_last_rec_idx != 0 ||
+			   (start_cat_idx == 0 && start_rec_idx == 0)) {
+			cdt->cdt_scan_cat_idx = hsd.hsd_last_cat_idx;
+			cdt->cdt_scan_rec_idx = hsd.hsd_last_rec_idx;
+		}
+
+		if (hsd.hsd_housekeeping) {
+			/* drop the requests the scan did not find active */
+			cdt_fid_action_purge(cdt, false);
+			cdt->cdt_fid_action_valid = !cdt->cdt_fid_action_lost;
+		}
+
 		CDEBUG(D_HSM, "found %d requests to send\n",
 		       hsd.hsd_request_count);
 
@@ -994,9 +1064,22 @@ int mdt_hsm_cdt_init(struct mdt_device *mdt)
 	if (cdt->cdt_agent_record_hash == NULL)
 		GOTO(out_request_cookie_hash, rc = -ENOMEM);
 
+	cdt->cdt_fid_action_hash = cfs_hash_create("FID_ACTION_HASH",
+						   CFS_HASH_BITS_MIN,
+						   CFS_HASH_BITS_MAX,
+						   CFS_HASH_BKT_BITS,
+						   0 /* extra bytes */,
+						   CFS_HASH_MIN_THETA,
+						   CFS_HASH_MAX_THETA,
+						   &cdt_fid_action_hash_ops,
+						   CFS_HASH_DEFAULT);
+	if (cdt->cdt_fid_action_hash == NULL)
+		GOTO(out_agent_record_hash, rc = -ENOMEM);
+	cdt->cdt_fid_action_valid = false;
+
 	rc = lu_env_init(&cdt->cdt_env, LCT_MD_THREAD);
 	if (rc < 0)
-		GOTO(out_agent_record_hash, rc);
+		GOTO(out_fid_action_hash, rc);
 
 	/* for mdt_ucred(), lu_ucred stored in lu_ucred_key */
 	rc = lu_context_init(&cdt->cdt_session, LCT_SERVER_SESSION);
@@ -1030,6 +1113,9 @@ int mdt_hsm_cdt_init(struct mdt_device *mdt)
 
 out_env:
 	lu_env_fini(&cdt->cdt_env);
+out_fid_action_hash:
+	cfs_hash_putref(cdt->cdt_fid_action_hash);
+	cdt->cdt_fid_action_hash = NULL;
 out_agent_record_hash:
 	cfs_hash_putref(cdt->cdt_agent_record_hash);
 	cdt->cdt_agent_record_hash = NULL;
@@ -1054,6 +1140,9 @@ int  mdt_hsm_cdt_fini(struct mdt_device *mdt)
 
 	lu_env_fini(&cdt->cdt_env);
 
+	cfs_hash_putref(cdt->cdt_fid_action_hash);
+	cdt->cdt_fid_action_hash = NULL;
+
 	cfs_hash_putref(cdt->cdt_agent_record_hash);
 	cdt->cdt_agent_record_hash = NULL;
 
@@ -1709,6 +1798,9 @@ static int mdt_cancel_all_cb(const struct lu_env *env,
 	    larr->arr_status == ARS_STARTED) {
 		larr->arr_status = ARS_CANCELED;
 		larr->arr_req_change = ktime_get_real_seconds();
+		cdt_fid_action_del(&hcad->mdt->mdt_coordinator,
+				   &larr->arr_hai.hai_fid,
+				   larr->arr_hai.hai_cookie);
 		rc = llog_write(env, llh, hdr, hdr->lrh_index);
 	}
 
@@ -863,6 +863,10 @@ void mdt_pack_attr2body(struct mdt_thread_info *info, struct mdt_body *b,
 			b->mbo_valid |= OBD_MD_FLSIZE | OBD_MD_FLBLOCKS;
 		} else if (ma->ma_valid & MA_SOM) { /* lsom is valid */
 			b->mbo_valid |= OBD_MD_FLLAZYSIZE | OBD_MD_FLLAZYBLOCKS;
+			/* no writers, client may use it instead of glimpse */
+			if (info->mti_lsom_trust &&
+			    exp_connect_flags2(exp) & OBD_CONNECT2_LSOM_TRUST)
+				b->mbo_valid |= OBD_MD_FLLAZYTRUST;
 			b->mbo_size = ma->ma_som.ms_size;
 			b->mbo_blocks = ma->ma_som.ms_blocks;
 		}
@@ -3101,6 +3105,21 @@ static int mdt_quota_dqacq(struct tgt_session_info *tsi)
 	RETURN(rc);
 }
 
+static int mdt_quota_dqacq_batch(struct tgt_session_info *tsi)
+{
+	struct mdt_device	*mdt = mdt_exp2dev(tsi->tsi_exp);
+	struct lu_device	*qmt = mdt->mdt_qmt_dev;
+	int			 rc;
+	ENTRY;
+
+	if (qmt == NULL)
+		RETURN(err_serious(-EOPNOTSUPP));
+
+	/* the reply is packed by the QMT once the batch size is known */
+	rc = qmt_hdls.qmth_dqacq_batch(tsi->tsi_env, qmt, tgt_ses_req(tsi));
+	RETURN(rc);
+}
+
 struct mdt_object *mdt_object_new(const struct lu_env *env,
 				  struct mdt_device *d,
 				  const struct lu_fid *f)
@@ -3959,6 +3978,7 @@ void mdt_thread_info_init(struct ptlrpc_request *req,
 	info->mti_big_lmm_used = 0;
 	info->mti_big_acl_used = 0;
 	info->mti_som_valid = 0;
+	info->mti_lsom_trust = 0;
 
         info->mti_spec.no_create = 0;
 	info->mti_spec.sp_rm_entry = 0;
@@ -5438,6 +5458,7 @@ TGT_SEC_HDL_VAR(0,			SEC_CTX_FINI,	  mdt_sec_ctx_handle)
 
 static struct tgt_handler mdt_quota_ops[] = {
 TGT_QUOTA_HDL(HAS_REPLY,		QUOTA_DQACQ,	  mdt_quota_dqacq),
+TGT_QUOTA_HDL(0,			QUOTA_DQACQ_BATCH, mdt_quota_dqacq_batch),
 };
 
 static struct tgt_handler mdt_llog_handlers[] = {
@@ -5673,6 +5694,8 @@ static int mdt_init0(const struct lu_env *env, struct mdt_device *m,
 	m->mdt_enable_chprojid_gid = 0;
 	m->mdt_enable_remote_rename = 1;
 	m->mdt_dir_restripe_nsonly = 1;
+	m->mdt_lsom_trust = 0;
+	m->mdt_lsom_flush_interval = MDT_LSOM_FLUSH_INTERVAL_DEFAULT;
 
 	atomic_set(&m->mdt_mds_mds_conns, 0);
 	atomic_set(&m->mdt_async_commit_count, 0);
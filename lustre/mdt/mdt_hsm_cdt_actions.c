@@ -166,6 +166,235 @@ void cdt_agent_record_hash_del(struct coordinator *cdt, u64 cookie)
 	cfs_hash_del_key(cdt->cdt_agent_record_hash, &cookie);
 }
 
+/* Index of the active (waiting or started) requests of the agent llog,
+ * keyed by FID. A FID may have several active requests, so entries are
+ * added with cfs_hash_add() and told apart by their cookie. Cancel
+ * requests are never indexed. Additions and removals are done under
+ * cdt_llog_lock held for write, lookups under cdt_llog_lock held for
+ * read, so the index matches the llog content as seen by the callers. */
+struct cdt_fid_action {
+	struct hlist_node	cfa_hnode;
+	atomic_t		cfa_refcount;
+	struct lu_fid		cfa_fid;
+	u64			cfa_cookie;
+	u64			cfa_gen;
+	u32			cfa_archive_id;
+};
+
+static inline void cdt_fid_action_put(struct cdt_fid_action *cfa)
+{
+	LASSERT(atomic_read(&cfa->cfa_refcount) > 0);
+	if (atomic_dec_and_test(&cfa->cfa_refcount))
+		OBD_FREE_PTR(cfa);
+}
+
+static unsigned int
+cdt_fid_action_hash(struct cfs_hash *hs, const void *key, unsigned int mask)
+{
+	return cfs_hash_djb2_hash(key, sizeof(struct lu_fid), mask);
+}
+
+static void *cdt_fid_action_object(struct hlist_node *hnode)
+{
+	return hlist_entry(hnode, struct cdt_fid_action, cfa_hnode);
+}
+
+static void *cdt_fid_action_key(struct hlist_node *hnode)
+{
+	struct cdt_fid_action *cfa = cdt_fid_action_object(hnode);
+
+	return &cfa->cfa_fid;
+}
+
+static int cdt_fid_action_keycmp(const void *key, struct hlist_node *hnode)
+{
+	return lu_fid_eq(key, cdt_fid_action_key(hnode));
+}
+
+static void cdt_fid_action_hop_get(struct cfs_hash *hs,
+				   struct hlist_node *hnode)
+{
+	struct cdt_fid_action *cfa = cdt_fid_action_object(hnode);
+
+	atomic_inc(&cfa->cfa_refcount);
+}
+
+static void cdt_fid_action_hop_put(struct cfs_hash *hs,
+				   struct hlist_node *hnode)
+{
+	cdt_fid_action_put(cdt_fid_action_object(hnode));
+}
+
+struct cfs_hash_ops cdt_fid_action_hash_ops = {
+	.hs_hash	= cdt_fid_action_hash,
+	.hs_key		= cdt_fid_action_key,
+	.hs_keycmp	= cdt_fid_action_keycmp,
+	.hs_object	= cdt_fid_action_object,
+	.hs_get		= cdt_fid_action_hop_get,
+	.hs_put_locked	= cdt_fid_action_hop_put,
+};
+
+struct cdt_fid_action_iter {
+	u64			 cfai_cookie;
+	struct cdt_fid_action	*cfai_found;
+};
+
+/* find the entry with the given cookie, or the most recent one when the
+ * cookie is 0, and take a reference on it */
+static int cdt_fid_action_find_cb(struct cfs_hash *hs, struct cfs_hash_bd *bd,
+				  struct hlist_node *hnode, void *data)
+{
+	struct cdt_fid_action_iter *cfai = data;
+	struct cdt_fid_action *cfa = cdt_fid_action_object(hnode);
+
+	if (cfai->cfai_cookie != 0 && cfa->cfa_cookie != cfai->cfai_cookie)
+		return 0;
+
+	if (cfai->cfai_found != NULL) {
+		if (cfai->cfai_found->cfa_cookie > cfa->cfa_cookie)
+			return 0;
+		cdt_fid_action_put(cfai->cfai_found);
+	}
+
+	atomic_inc(&cfa->cfa_refcount);
+	cfai->cfai_found = cfa;
+
+	return cfai->cfai_cookie != 0;
+}
+
+static struct cdt_fid_action *
+cdt_fid_action_lookup(struct coordinator *cdt, const struct lu_fid *fid,
+		      u64 cookie)
+{
+	struct cdt_fid_action_iter cfai = {
+		.cfai_cookie = cookie,
+		.cfai_found = NULL,
+	};
+
+	cfs_hash_for_each_key(cdt->cdt_fid_action_hash, fid,
+			      cdt_fid_action_find_cb, &cfai);
+
+	return cfai.cfai_found;
+}
+
+/**
+ * Index an active request of the agent llog, or mark it as seen by the
+ * current housekeeping scan if it is already indexed.
+ * Caller must hold cdt_llog_lock for write.
+ *
+ * \param cdt [IN] coordinator
+ * \param larr [IN] agent llog record
+ */
+void cdt_fid_action_add(struct coordinator *cdt,
+			const struct llog_agent_req_rec *larr)
+{
+	const struct hsm_action_item *hai = &larr->arr_hai;
+	struct cdt_fid_action *cfa;
+
+	if (hai->hai_action == HSMA_CANCEL)
+		return;
+
+	cfa = cdt_fid_action_lookup(cdt, &hai->hai_fid, hai->hai_cookie);
+	if (cfa != NULL) {
+		cfa->cfa_gen = cdt->cdt_fid_action_gen;
+		cdt_fid_action_put(cfa);
+		return;
+	}
+
+	OBD_ALLOC_PTR(cfa);
+	if (cfa == NULL) {
+		/* an incomplete index must not be trusted */
+		cdt->cdt_fid_action_valid = false;
+		cdt->cdt_fid_action_lost = true;
+		return;
+	}
+
+	INIT_HLIST_NODE(&cfa->cfa_hnode);
+	atomic_set(&cfa->cfa_refcount, 1);
+	cfa->cfa_fid = hai->hai_fid;
+	cfa->cfa_cookie = hai->hai_cookie;
+	cfa->cfa_gen = cdt->cdt_fid_action_gen;
+	cfa->cfa_archive_id = larr->arr_archive_id;
+
+	cfs_hash_add(cdt->cdt_fid_action_hash, &cfa->cfa_fid, &cfa->cfa_hnode);
+	cdt_fid_action_put(cfa);
+}
+
+/**
+ * Remove a request which reached a final state from the index.
+ * Caller must hold cdt_llog_lock for write.
+ *
+ * \param cdt [IN] coordinator
+ * \param fid [IN] FID of the request
+ * \param cookie [IN] cookie of the request
+ */
+void cdt_fid_action_del(struct coordinator *cdt, const struct lu_fid *fid,
+			u64 cookie)
+{
+	struct cdt_fid_action *cfa;
+
+	cfa = cdt_fid_action_lookup(cdt, fid, cookie);
+	if (cfa == NULL)
+		return;
+
+	cfs_hash_del(cdt->cdt_fid_action_hash, &cfa->cfa_fid, &cfa->cfa_hnode);
+	cdt_fid_action_put(cfa);
+}
+
+static int cdt_fid_action_stale(void *obj, void *data)
+{
+	struct cdt_fid_action *cfa = obj;
+	u64 *gen = data;
+
+	return gen == NULL || cfa->cfa_gen != *gen;
+}
+
+/**
+ * Drop the index entries which were not seen by the last complete
+ * housekeeping scan, or all of them.
+ *
+ * \param cdt [IN] coordinator
+ * \param all [IN] drop every entry and invalidate the index
+ */
+void cdt_fid_action_purge(struct coordinator *cdt, bool all)
+{
+	u64 gen = cdt->cdt_fid_action_gen;
+
+	if (all)
+		cdt->cdt_fid_action_valid = false;
+
+	cfs_hash_cond_del(cdt->cdt_fid_action_hash, cdt_fid_action_stale,
+			  all ? NULL : &gen);
+}
+
+/**
+ * Look up the most recent active request on a FID.
+ * Caller must hold cdt_llog_lock.
+ *
+ * \param cdt [IN] coordinator
+ * \param fid [IN] FID to look up
+ * \param cookie [OUT] cookie of the request found
+ * \param archive_id [OUT] archive id of the request found
+ *
+ * \retval 0 a request was found
+ * \retval -ENOENT no active request on \a fid
+ */
+int cdt_fid_action_find(struct coordinator *cdt, const struct lu_fid *fid,
+			u64 *cookie, u32 *archive_id)
+{
+	struct cdt_fid_action *cfa;
+
+	cfa = cdt_fid_action_lookup(cdt, fid, 0);
+	if (cfa == NULL)
+		return -ENOENT;
+
+	*cookie = cfa->cfa_cookie;
+	*archive_id = cfa->cfa_archive_id;
+	cdt_fid_action_put(cfa);
+
+	return 0;
+}
+
 void dump_llog_agent_req_rec(const char *prefix,
 			     const struct llog_agent_req_rec *larr)
 {
@@ -297,6 +526,8 @@ int mdt_agent_record_add(const struct lu_env *env, struct mdt_device *mdt,
 	rc = llog_cat_add(env, lctxt->loc_handle, &larr->arr_hdr, NULL);
 	if (rc > 0)
 		rc = 0;
+	if (rc == 0)
+		cdt_fid_action_add(cdt, larr);
 
 	up_write(&cdt->cdt_llog_lock);
 	llog_ctxt_put(lctxt);
@@ -335,11 +566,13 @@ static int mdt_agent_record_update_cb(const struct lu_env *env,
 {
 	struct llog_agent_req_rec	*larr;
 	struct data_update_cb		*ducb;
+	struct coordinator		*cdt;
 	int				 rc, i;
 	ENTRY;
 
 	larr = (struct llog_agent_req_rec *)hdr;
 	ducb = data;
+	cdt = &ducb->mdt->mdt_coordinator;
 
 	/* check if all done */
 	if (ducb->updates_count == ducb->updates_done)
@@ -374,6 +607,13 @@ static int mdt_agent_record_update_cb(const struct lu_env *env,
 			larr->arr_req_change = ducb->change_time;
 			rc = llog_write(env, llh, hdr, hdr->lrh_index);
 			ducb->updates_done++;
+			if (agent_req_in_final_state(update->status))
+				cdt_fid_action_del(cdt, &larr->arr_hai.hai_fid,
+						   update->cookie);
+			else if (update->status == ARS_WAITING)
+				/* the record may lie before the place the
+				 * coordinator resumes its scans from */
+				cdt->cdt_scan_restart = true;
 			break;
 		}
 	}
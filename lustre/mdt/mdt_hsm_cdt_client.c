@@ -97,6 +97,49 @@ static int hsm_find_compatible_cb(const struct lu_env *env,
 	RETURN(0);
 }
 
+/**
+ * find compatible requests using the coordinator FID index instead of
+ * scanning the whole actions llog, same semantic as
+ * hsm_find_compatible_cb()
+ * \param mdt [IN] MDT device
+ * \param hal [IN/OUT] new request
+ * \retval 0 success
+ * \retval -EAGAIN index is not usable, llog must be scanned
+ */
+static int hsm_find_compatible_index(struct mdt_device *mdt,
+				     struct hsm_action_list *hal)
+{
+	struct coordinator *cdt = &mdt->mdt_coordinator;
+	struct hsm_action_item *hai;
+	u64 cookie;
+	u32 archive_id;
+	int i;
+	ENTRY;
+
+	down_read(&cdt->cdt_llog_lock);
+	if (!cdt->cdt_fid_action_valid) {
+		up_read(&cdt->cdt_llog_lock);
+		RETURN(-EAGAIN);
+	}
+
+	hai = hai_first(hal);
+	for (i = 0; i < hal->hal_count; i++, hai = hai_next(hai)) {
+		if (hai->hai_action == HSMA_CANCEL && hai->hai_cookie != 0)
+			continue;
+
+		if (cdt_fid_action_find(cdt, &hai->hai_fid, &cookie,
+					&archive_id) != 0)
+			continue;
+
+		hai->hai_cookie = cookie;
+		if (hai->hai_action == HSMA_CANCEL && hal->hal_archive_id == 0)
+			hal->hal_archive_id = archive_id;
+	}
+	up_read(&cdt->cdt_llog_lock);
+
+	RETURN(0);
+}
+
 /**
  * find compatible requests already recorded
  * \param env [IN] environment
@@ -135,6 +178,10 @@ static int hsm_find_compatible(const struct lu_env *env, struct mdt_device *mdt,
 	if (ok_cnt == hal->hal_count)
 		RETURN(0);
 
+	rc = hsm_find_compatible_index(mdt, hal);
+	if (rc != -EAGAIN)
+		RETURN(rc);
+
 	rc = cdt_llog_process(env, mdt, hsm_find_compatible_cb, hal, 0, 0,
 			      READ);
 
@@ -178,6 +178,26 @@ struct coordinator {
 	 * request log. */
 	struct cfs_hash		*cdt_agent_record_hash;
 
+	/* Hash of FIDs to active requests in agent request log, see
+	 * cdt_fid_action_add(). Only trusted once a housekeeping scan
+	 * rebuilt it (cdt_fid_action_valid), entries not refreshed by
+	 * the scan of generation cdt_fid_action_gen are stale,
+	 * cdt_fid_action_lost is set when a request could not be indexed.
+	 */
+	struct cfs_hash		*cdt_fid_action_hash;
+	__u64			 cdt_fid_action_gen;
+	bool			 cdt_fid_action_valid;
+	bool			 cdt_fid_action_lost;
+
+	/* Location in agent request log of the first waiting request
+	 * found by the last scan, scans looking for new work start from
+	 * there. Only used by the coordinator thread. */
+	__u32			 cdt_scan_cat_idx;
+	__u32			 cdt_scan_rec_idx;
+	/* a request went back to waiting, next scan starts from the
+	 * beginning of the log */
+	bool			 cdt_scan_restart;
+
 	/* Bitmasks indexed by the HSMA_XXX constants. */
 	__u64			 cdt_user_request_mask;
 	__u64			 cdt_group_request_mask;
@@ -212,6 +232,28 @@ struct mdt_statfs_cache {
 /* directory auto-split allocate delta new stripes each time */
 #define DIR_SPLIT_DELTA_DEFAULT	4
 
+/* threads migrating sub files in directory restripe */
+#define DIR_RESTRIPE_THREADS_DEFAULT	4
+#define DIR_RESTRIPE_THREADS_MAX	32
+
+struct mdt_dir_restriper;
+
+/* thread migrating sub files in directory restripe */
+struct mdt_restripe_worker {
+	struct mdt_dir_restriper *mdw_restriper;
+	struct lu_env		 mdw_env;
+	struct lu_context	 mdw_session;
+	struct mdt_thread_info	*mdw_info;
+	struct task_struct	*mdw_task;
+	/* stripe whose sub files are being migrated, protected by mdr_lock */
+	struct mdt_object	*mdw_stripe;
+	/* lum used in migrate */
+	union lmv_mds_md	 mdw_lmv;
+	/* page used in readdir */
+	struct page		*mdw_page;
+	int			 mdw_index;
+};
+
 struct mdt_dir_restriper {
 	struct lu_env		mdr_env;
 	struct lu_context	mdr_session;
@@ -232,8 +274,24 @@ struct mdt_dir_restriper {
 	time64_t		mdr_update_time;
 	/* lum used in split/migrate/layout_change */
 	union lmv_mds_md	mdr_lmv;
-	/* page used in readdir */
-	struct page	       *mdr_page;
+	/* migrate threads wait for stripes in mdr_migrating */
+	wait_queue_head_t	mdr_waitq;
+	/* serialize stripe readdir, so threads migrate different pages */
+	struct mutex		mdr_readdir_mutex;
+	/* serialize migrate threads start/stop */
+	struct mutex		mdr_threads_mutex;
+	struct mdt_restripe_worker *mdr_workers[DIR_RESTRIPE_THREADS_MAX];
+	unsigned int		mdr_threads_started;
+	/* migrate threads allowed to run */
+	unsigned int		mdr_threads;
+	/* sub files migrated per second, 0 for unlimited */
+	unsigned int		mdr_rate;
+	unsigned int		mdr_rate_count;
+	time64_t		mdr_rate_second;
+	/* statistics, protected by mdr_lock */
+	u64			mdr_migrated;
+	u64			mdr_migrate_failed;
+	u64			mdr_stripes_done;
 };
 
 struct mdt_device {
@@ -292,7 +350,9 @@ struct mdt_device {
 				   mdt_skip_lfsck:1,
 				   mdt_readonly:1,
 				   /* dir restripe migrate dirent only */
-				   mdt_dir_restripe_nsonly:1;
+				   mdt_dir_restripe_nsonly:1,
+				   /* return LSOM as trusted when no writers */
+				   mdt_lsom_trust:1;
 
 				   /* user with gid can create remote/striped
 				    * dir, and set default dir stripe */
@@ -300,6 +360,9 @@ struct mdt_device {
 				   /* user with this gid can change projid */
 	gid_t			   mdt_enable_chprojid_gid;
 
+	/* max seconds an LSOM update is kept in memory, 0 to disable */
+	unsigned int		   mdt_lsom_flush_interval;
+
 	/* lock for osfs and md_root */
 	spinlock_t		   mdt_lock;
 
@@ -333,6 +396,7 @@ struct mdt_device {
 
 #define MDT_SERVICE_WATCHDOG_FACTOR	(2)
 #define MDT_COS_DEFAULT         (0)
+#define MDT_LSOM_FLUSH_INTERVAL_DEFAULT	(5)
 
 #define ENOENT_VERSION 1	/** 'virtual' version of non-existent object */
 
@@ -345,12 +409,24 @@ struct mdt_object {
 				mot_restriping:1,   /* dir restriping */
 				/* dir auto-split disabled */
 				mot_auto_split_disabled:1;
+	/* sub file migration state in dir restripe, protected by mdr_lock */
+	unsigned short		mot_restripe_busy;  /* migrating threads */
+	unsigned short		mot_restripe_hot:1, /* sub files created */
+				mot_restripe_failed:1;
+	unsigned int		mot_restripe_count; /* sub files migrated */
 	int			mot_write_count;
 	spinlock_t		mot_write_lock;
         /* Lock to protect create_data */
 	struct mutex		mot_lov_mutex;
 	/* Lock to protect object's SOM update. */
 	struct mutex		mot_som_mutex;
+	/* LSOM update coalesced in memory while other writers still have
+	 * the file open, protected by mot_write_lock. mot_som_pending is
+	 * the time the first update was deferred, 0 if none.
+	 */
+	__u64			mot_som_size;
+	__u64			mot_som_blocks;
+	time64_t		mot_som_pending;
 	/* lock to protect read/write stages for Data-on-MDT files */
 	struct rw_semaphore	mot_dom_sem;
 	/* Lock to protect lease open.
@@ -482,7 +558,9 @@ struct mdt_thread_info {
 	/* big_lmm buffer was used and must be used in reply */
 				   mti_big_lmm_used:1,
 				   mti_big_acl_used:1,
-				   mti_som_valid:1;
+				   mti_som_valid:1,
+	/* LSOM is up to date and file has no writers */
+				   mti_lsom_trust:1;
 
 	/* opdata for mdt_reint_open(), has the same as
 	 * ldlm_reply:lock_policy_res1.  mdt_update_last_rcvd() stores this
@@ -1041,6 +1119,13 @@ void cdt_agent_record_hash_add(struct coordinator *cdt, u64 cookie, u32 cat_idt,
 void cdt_agent_record_hash_lookup(struct coordinator *cdt, u64 cookie,
 				  u32 *cat_idt, u32 *rec_idx);
 void cdt_agent_record_hash_del(struct coordinator *cdt, u64 cookie);
+void cdt_fid_action_add(struct coordinator *cdt,
+			const struct llog_agent_req_rec *larr);
+void cdt_fid_action_del(struct coordinator *cdt, const struct lu_fid *fid,
+			u64 cookie);
+void cdt_fid_action_purge(struct coordinator *cdt, bool all);
+int cdt_fid_action_find(struct coordinator *cdt, const struct lu_fid *fid,
+			u64 *cookie, u32 *archive_id);
 
 /* mdt/mdt_hsm_cdt_agent.c */
 extern const struct file_operations mdt_hsm_agent_fops;
@@ -1072,6 +1157,7 @@ bool mdt_hsm_restore_is_running(struct mdt_thread_info *mti,
 /* mdt/mdt_hsm_cdt_requests.c */
 extern struct cfs_hash_ops cdt_request_cookie_hash_ops;
 extern struct cfs_hash_ops cdt_agent_record_hash_ops;
+extern struct cfs_hash_ops cdt_fid_action_hash_ops;
 extern const struct file_operations mdt_hsm_active_requests_fops;
 void dump_requests(char *prefix, struct coordinator *cdt);
 struct cdt_agent_req *mdt_cdt_alloc_request(__u32 archive_id, __u64 flags,
@@ -1264,6 +1350,7 @@ int mdt_set_som(struct mdt_thread_info *info, struct mdt_object *obj,
 		enum lustre_som_flags flag, __u64 size, __u64 blocks);
 int mdt_get_som(struct mdt_thread_info *info, struct mdt_object *obj,
 		struct md_attr *ma);
+bool mdt_lsom_pending(struct mdt_object *obj);
 int mdt_lsom_downgrade(struct mdt_thread_info *info, struct mdt_object *obj);
 int mdt_lsom_update(struct mdt_thread_info *info, struct mdt_object *obj,
 		    bool truncate);
@@ -1435,6 +1522,9 @@ void mdt_restriper_stop(struct mdt_device *mdt);
 void mdt_auto_split_add(struct mdt_thread_info *info, struct mdt_object *o);
 void mdt_restripe_migrate_add(struct mdt_thread_info *info,
 			      struct mdt_object *o);
+void mdt_restripe_migrate_hot(struct mdt_thread_info *info,
+			      struct mdt_object *o);
+int mdt_restripe_threads_set(struct mdt_device *mdt, unsigned int threads);
 void mdt_restripe_update_add(struct mdt_thread_info *info,
 			     struct mdt_object *o);
 int mdt_is_remote_object(struct mdt_thread_info *info,
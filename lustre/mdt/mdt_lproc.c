@@ -1227,6 +1227,191 @@ static ssize_t dir_restripe_nsonly_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(dir_restripe_nsonly);
 
+/**
+ * Whether lazy SOM of a file with no open writers is returned to clients
+ * as trusted, so that they may skip glimpsing OSTs for stat().
+ */
+static ssize_t lsom_trust_show(struct kobject *kobj, struct attribute *attr,
+			       char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", mdt->mdt_lsom_trust);
+}
+
+static ssize_t lsom_trust_store(struct kobject *kobj, struct attribute *attr,
+				const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+	mdt->mdt_lsom_trust = val;
+	return count;
+}
+LUSTRE_RW_ATTR(lsom_trust);
+
+/**
+ * Max seconds an LSOM update is coalesced in memory while a file is still
+ * open for write by other clients, 0 to write LSOM on every close.
+ */
+static ssize_t lsom_flush_interval_show(struct kobject *kobj,
+					struct attribute *attr, char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n",
+			 mdt->mdt_lsom_flush_interval);
+}
+
+static ssize_t lsom_flush_interval_store(struct kobject *kobj,
+					 struct attribute *attr,
+					 const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	mdt->mdt_lsom_flush_interval = val;
+	return count;
+}
+LUSTRE_RW_ATTR(lsom_flush_interval);
+
+static ssize_t dir_restripe_threads_show(struct kobject *kobj,
+					 struct attribute *attr, char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n",
+			 mdt->mdt_restriper.mdr_threads);
+}
+
+static ssize_t dir_restripe_threads_store(struct kobject *kobj,
+					  struct attribute *attr,
+					  const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	rc = mdt_restripe_threads_set(mdt, val);
+	if (rc)
+		return rc;
+
+	return count;
+}
+LUSTRE_RW_ATTR(dir_restripe_threads);
+
+static ssize_t dir_restripe_rate_show(struct kobject *kobj,
+				      struct attribute *attr, char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", mdt->mdt_restriper.mdr_rate);
+}
+
+static ssize_t dir_restripe_rate_store(struct kobject *kobj,
+				       struct attribute *attr,
+				       const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	WRITE_ONCE(mdt->mdt_restriper.mdr_rate, val);
+	/* throttled threads check new rate */
+	wake_up_all(&mdt->mdt_restriper.mdr_waitq);
+
+	return count;
+}
+LUSTRE_RW_ATTR(dir_restripe_rate);
+
+static void mdt_dir_restripe_stripe_print(struct seq_file *m,
+					  struct mdt_object *o)
+{
+	u64 offset = o->mot_restripe_offset;
+	unsigned int progress;
+
+	/* sub file hashes are evenly distributed */
+	if (offset == MDS_DIR_END_OFF)
+		progress = 100;
+	else
+		progress = min_t(u64, div64_u64(offset, MDS_DIR_END_OFF / 100),
+				 99);
+
+	seq_printf(m, "  - { fid: "DFID", offset: %#llx, progress: %u%%, migrated: %u, threads: %u, hot: %u }\n",
+		   PFID(mdt_object_fid(o)), offset, progress,
+		   o->mot_restripe_count, o->mot_restripe_busy,
+		   o->mot_restripe_hot);
+}
+
+static int mdt_dir_restripe_status_seq_show(struct seq_file *m, void *data)
+{
+	struct obd_device *obd = m->private;
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+	struct mdt_dir_restriper *restriper = &mdt->mdt_restriper;
+	struct mdt_object *o;
+	unsigned int splitting = 0;
+	unsigned int updating = 0;
+
+	spin_lock(&restriper->mdr_lock);
+	list_for_each_entry(o, &restriper->mdr_auto_splitting,
+			    mot_restripe_linkage)
+		splitting++;
+	list_for_each_entry(o, &restriper->mdr_updating, mot_restripe_linkage)
+		updating++;
+
+	seq_printf(m, "threads: %u\n"
+		   "rate: %u\n"
+		   "migrated: %llu\n"
+		   "failed: %llu\n"
+		   "stripes_done: %llu\n"
+		   "splitting: %u\n"
+		   "updating: %u\n"
+		   "migrating:\n",
+		   restriper->mdr_threads, restriper->mdr_rate,
+		   restriper->mdr_migrated, restriper->mdr_migrate_failed,
+		   restriper->mdr_stripes_done, splitting, updating);
+	list_for_each_entry(o, &restriper->mdr_migrating, mot_restripe_linkage)
+		mdt_dir_restripe_stripe_print(m, o);
+	spin_unlock(&restriper->mdr_lock);
+
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(mdt_dir_restripe_status);
+
 LPROC_SEQ_FOPS_RO_TYPE(mdt, hash);
 LPROC_SEQ_FOPS_WR_ONLY(mdt, mds_evict_client);
 LUSTRE_RW_ATTR(job_cleanup_interval);
@@ -1282,6 +1467,10 @@ static struct attribute *mdt_attrs[] = {
 	&lustre_attr_dir_split_count.attr,
 	&lustre_attr_dir_split_delta.attr,
 	&lustre_attr_dir_restripe_nsonly.attr,
+	&lustre_attr_lsom_trust.attr,
+	&lustre_attr_lsom_flush_interval.attr,
+	&lustre_attr_dir_restripe_threads.attr,
+	&lustre_attr_dir_restripe_rate.attr,
 	NULL,
 };
 
@@ -1300,6 +1489,8 @@ static struct lprocfs_vars lprocfs_mdt_obd_vars[] = {
 	  .fops =	&mdt_root_squash_fops			},
 	{ .name =	"nosquash_nids",
 	  .fops =	&mdt_nosquash_nids_fops			},
+	{ .name =	"dir_restripe_status",
+	  .fops =	&mdt_dir_restripe_status_fops		},
 	{ NULL }
 };
 
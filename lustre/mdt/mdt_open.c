@@ -1501,6 +1501,8 @@ int mdt_reint_open(struct mdt_thread_info *info, struct mdt_lock_handle *lhc)
                                 GOTO(out_child, result);
                 }
 		created = 1;
+		if (unlikely(parent->mot_restriping))
+			mdt_restripe_migrate_hot(info, parent);
 		mdt_counter_incr(req, LPROC_MDT_MKNOD,
 				 ktime_us_delta(ktime_get(), kstart));
         } else {
@@ -2366,8 +2368,12 @@ int mdt_mfd_close(struct mdt_thread_info *info, struct mdt_file_data *mfd)
 		break;
 	}
 
+	/* also flush a coalesced LSOM update if the close carries no size,
+	 * e.g. on client eviction, so it is not lost after the last writer
+	 */
 	if (S_ISREG(lu_object_attr(&o->mot_obj)) &&
-	    ma->ma_attr.la_valid & (LA_LSIZE | LA_LBLOCKS)) {
+	    (ma->ma_attr.la_valid & (LA_LSIZE | LA_LBLOCKS) ||
+	     (open_flags & MDS_FMODE_WRITE && mdt_lsom_pending(o)))) {
 		int rc2;
 
 		rc2 = mdt_lsom_update(info, o, false);
@@ -614,6 +614,9 @@ static int mdt_create(struct mdt_thread_info *info)
 	if (rc < 0)
 		GOTO(put_child, rc);
 
+	if (unlikely(parent->mot_restriping))
+		mdt_restripe_migrate_hot(info, parent);
+
 	/*
 	 * On DNE, we need to eliminate dependey between 'mkdir a' and
 	 * 'mkdir a/b' if b is a striped directory, to achieve this, two
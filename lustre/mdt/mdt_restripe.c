@@ -65,6 +65,10 @@ void mdt_restripe_migrate_add(struct mdt_thread_info *info,
 	if (!o->mot_restriping) {
 		o->mot_restriping = 1;
 		o->mot_restripe_offset = 0;
+		o->mot_restripe_busy = 0;
+		o->mot_restripe_count = 0;
+		o->mot_restripe_hot = 0;
+		o->mot_restripe_failed = 0;
 		mdt_object_get(NULL, o);
 		LASSERT(list_empty(&o->mot_restripe_linkage));
 		list_add_tail(&o->mot_restripe_linkage,
@@ -75,7 +79,7 @@ void mdt_restripe_migrate_add(struct mdt_thread_info *info,
 	}
 	spin_unlock(&restriper->mdr_lock);
 
-	wake_up_process(restriper->mdr_task);
+	wake_up(&restriper->mdr_waitq);
 }
 
 void mdt_restripe_update_add(struct mdt_thread_info *info,
@@ -448,18 +452,30 @@ out:
 
 /* sub-files under one stripe are migrated, clear MIGRATION flag in its LMV */
 static int mdt_restripe_migrate_finish(struct mdt_thread_info *info,
-				       struct mdt_object *stripe,
-				       struct lmv_mds_md_v1 *lmv)
+				       struct mdt_object *stripe)
 {
 	struct mdt_device *mdt = info->mti_mdt;
+	struct md_attr *ma = &info->mti_attr;
+	struct lmv_mds_md_v1 *lmv;
 	struct lu_buf buf;
 	struct mdt_lock_handle *lh;
 	int rc;
 
 	ENTRY;
 
-	LASSERT(le32_to_cpu(lmv->lmv_magic) == LMV_MAGIC_STRIPE);
-	LASSERT(lmv_is_restriping(lmv));
+	rc = mdt_stripe_get(info, stripe, ma, XATTR_NAME_LMV);
+	if (rc)
+		RETURN(rc);
+
+	if (!(ma->ma_valid & MA_LMV))
+		RETURN(-ENODATA);
+
+	lmv = &ma->ma_lmv->lmv_md_v1;
+	if (le32_to_cpu(lmv->lmv_magic) != LMV_MAGIC_STRIPE)
+		RETURN(-EBADF);
+
+	if (!lmv_is_restriping(lmv))
+		RETURN(0);
 
 	lmv->lmv_hash_type &= ~cpu_to_le32(LMV_HASH_FLAG_MIGRATION);
 	buf.lb_buf = lmv;
@@ -477,30 +493,36 @@ static int mdt_restripe_migrate_finish(struct mdt_thread_info *info,
 		CERROR("%s: update "DFID" LMV failed: rc = %d\n",
 		       mdt_obd_name(mdt), PFID(mdt_object_fid(stripe)), rc);
 
-	LASSERT(!list_empty(&stripe->mot_restripe_linkage));
-	LASSERT(stripe->mot_restriping);
-
-	spin_lock(&mdt->mdt_lock);
-	stripe->mot_restriping = 0;
-	list_del_init(&stripe->mot_restripe_linkage);
-	spin_unlock(&mdt->mdt_lock);
-
-	mdt_object_put(info->mti_env, stripe);
-
 	RETURN(rc);
 }
 
+/* lum of the directory layout sub files are migrated to */
+static void mdt_restripe_migrate_lum(struct lmv_user_md_v1 *lum,
+				     const struct lmv_mds_md_v1 *lmv)
+{
+	memset(lum, 0, sizeof(*lum));
+	lum->lum_magic = cpu_to_le32(LMV_USER_MAGIC);
+	lum->lum_stripe_offset = cpu_to_le32(LMV_OFFSET_DEFAULT);
+	if (lmv_is_splitting(lmv)) {
+		lum->lum_stripe_count = lmv->lmv_stripe_count;
+		lum->lum_hash_type =
+			lmv->lmv_hash_type & le32_to_cpu(LMV_HASH_TYPE_MASK);
+	} else if (lmv_is_merging(lmv)) {
+		lum->lum_stripe_count = lmv->lmv_merge_offset;
+		lum->lum_hash_type = lmv->lmv_merge_hash;
+	}
+}
+
 static void mdt_restripe_migrate_prep(struct mdt_thread_info *info,
 				      const struct lu_fid *fid1,
 				      const struct lu_fid *fid2,
 				      const struct lu_name *lname,
 				      __u16 type,
-				      const struct lmv_mds_md_v1 *lmv)
+				      struct lmv_user_md_v1 *lum)
 {
 	struct lu_attr *attr = &info->mti_attr.ma_attr;
 	struct mdt_reint_record *rr = &info->mti_rr;
 	struct md_op_spec *spec = &info->mti_spec;
-	struct lmv_user_md_v1 *lum;
 
 	attr->la_ctime = attr->la_mtime = ktime_get_real_seconds();
 	attr->la_valid = LA_CTIME | LA_MTIME;
@@ -509,18 +531,6 @@ static void mdt_restripe_migrate_prep(struct mdt_thread_info *info,
 	rr->rr_fid2 = fid2;
 	rr->rr_name = *lname;
 
-	lum = &info->mti_mdt->mdt_restriper.mdr_lmv.lmv_user_md;
-	lum->lum_magic = cpu_to_le32(LMV_USER_MAGIC);
-	lum->lum_stripe_offset = cpu_to_le32(LMV_OFFSET_DEFAULT);
-	if (lmv_is_splitting(lmv)) {
-		lum->lum_stripe_count = lmv->lmv_stripe_count;
-		lum->lum_hash_type =
-			lmv->lmv_hash_type & le32_to_cpu(LMV_HASH_TYPE_MASK);
-	} else if (lmv_is_merging(lmv)) {
-		lum->lum_stripe_count = lmv->lmv_merge_offset;
-		lum->lum_hash_type = lmv->lmv_merge_hash;
-	}
-
 	spec->u.sp_ea.eadatalen = sizeof(*lum);
 	spec->u.sp_ea.eadata = lum;
 	spec->sp_cr_flags = MDS_OPEN_HAS_EA;
@@ -534,13 +544,151 @@ static void mdt_restripe_migrate_prep(struct mdt_thread_info *info,
 			info->mti_mdt->mdt_dir_restripe_nsonly;
 }
 
-/* migrate sub-file from @mdr_restripe_offset */
-static int mdt_restripe_migrate(struct mdt_thread_info *info)
+/* mark stripe which has sub files created, it's migrated first */
+void mdt_restripe_migrate_hot(struct mdt_thread_info *info,
+			      struct mdt_object *o)
+{
+	struct mdt_dir_restriper *restriper = &info->mti_mdt->mdt_restriper;
+
+	if (o->mot_restripe_hot)
+		return;
+
+	spin_lock(&restriper->mdr_lock);
+	if (o->mot_restriping)
+		o->mot_restripe_hot = 1;
+	spin_unlock(&restriper->mdr_lock);
+}
+
+/* limit sub file migration to mdr_rate per second */
+static void mdt_restripe_throttle(struct mdt_dir_restriper *restriper)
+{
+	unsigned int rate;
+	time64_t now;
+
+	while ((rate = READ_ONCE(restriper->mdr_rate)) != 0) {
+		spin_lock(&restriper->mdr_lock);
+		now = ktime_get_seconds();
+		if (restriper->mdr_rate_second != now) {
+			restriper->mdr_rate_second = now;
+			restriper->mdr_rate_count = 0;
+		}
+		if (restriper->mdr_rate_count < rate) {
+			restriper->mdr_rate_count++;
+			spin_unlock(&restriper->mdr_lock);
+			break;
+		}
+		spin_unlock(&restriper->mdr_lock);
+
+		if (wait_event_idle_timeout(restriper->mdr_waitq,
+					    kthread_should_stop(),
+					    cfs_time_seconds(1) / 10))
+			break;
+	}
+}
+
+/*
+ * pick a stripe to migrate sub files from, stripes with sub files being
+ * created are picked first, others in turn.
+ */
+static struct mdt_object *
+mdt_restripe_migrate_get(struct mdt_restripe_worker *worker)
+{
+	struct mdt_dir_restriper *restriper = worker->mdw_restriper;
+	struct mdt_object *stripe = NULL;
+	struct mdt_object *o;
+
+	spin_lock(&restriper->mdr_lock);
+	list_for_each_entry(o, &restriper->mdr_migrating,
+			    mot_restripe_linkage) {
+		/* all pages are being migrated, or migration failed */
+		if (o->mot_restripe_offset == MDS_DIR_END_OFF ||
+		    o->mot_restripe_failed)
+			continue;
+
+		if (!stripe)
+			stripe = o;
+		if (o->mot_restripe_hot) {
+			stripe = o;
+			break;
+		}
+	}
+
+	if (stripe) {
+		stripe->mot_restripe_hot = 0;
+		stripe->mot_restripe_busy++;
+		list_move_tail(&stripe->mot_restripe_linkage,
+			       &restriper->mdr_migrating);
+		worker->mdw_stripe = stripe;
+	}
+	spin_unlock(&restriper->mdr_lock);
+
+	return stripe;
+}
+
+/*
+ * The last thread migrating sub files of a stripe removes it from migrating
+ * list after all its sub files are migrated, or migration failed.
+ */
+static void mdt_restripe_migrate_put(struct mdt_thread_info *info,
+				     struct mdt_restripe_worker *worker,
+				     struct mdt_object *stripe, int count,
+				     int rc)
+{
+	struct mdt_dir_restriper *restriper = worker->mdw_restriper;
+	bool done;
+
+	spin_lock(&restriper->mdr_lock);
+	worker->mdw_stripe = NULL;
+	stripe->mot_restripe_count += count;
+	restriper->mdr_migrated += count;
+	if (rc) {
+		stripe->mot_restripe_failed = 1;
+		if (rc != -EINTR)
+			restriper->mdr_migrate_failed++;
+	}
+	LASSERT(stripe->mot_restripe_busy > 0);
+	done = --stripe->mot_restripe_busy == 0 &&
+	       (stripe->mot_restripe_failed ||
+		stripe->mot_restripe_offset == MDS_DIR_END_OFF);
+	spin_unlock(&restriper->mdr_lock);
+
+	if (!done)
+		return;
+
+	/* other threads may pick up new stripes */
+	wake_up(&restriper->mdr_waitq);
+
+	if (!stripe->mot_restripe_failed)
+		rc = mdt_restripe_migrate_finish(info, stripe);
+
+	spin_lock(&restriper->mdr_lock);
+	LASSERT(!list_empty(&stripe->mot_restripe_linkage));
+	LASSERT(stripe->mot_restriping);
+	if (!stripe->mot_restripe_failed && !rc)
+		restriper->mdr_stripes_done++;
+	stripe->mot_restriping = 0;
+	list_del_init(&stripe->mot_restripe_linkage);
+	spin_unlock(&restriper->mdr_lock);
+
+	mdt_object_put(info->mti_env, stripe);
+}
+
+/*
+ * Migrate sub files in one directory page of stripe from
+ * @mot_restripe_offset. Pages are read in turn under mdr_readdir_mutex, and
+ * sub files of different pages are migrated by different threads in
+ * parallel.
+ *
+ * \retval	number of sub files migrated, or negated errno on failure
+ */
+static int mdt_restripe_migrate(struct mdt_thread_info *info,
+				struct mdt_restripe_worker *worker,
+				struct mdt_object *stripe)
 {
 	const struct lu_env *env = info->mti_env;
 	struct mdt_device *mdt = info->mti_mdt;
 	struct mdt_dir_restriper *restriper = &mdt->mdt_restriper;
-	struct mdt_object *stripe = NULL;
+	struct lmv_user_md_v1 *lum = &worker->mdw_lmv.lmv_user_md;
 	struct mdt_object *master = NULL;
 	struct md_attr *ma = &info->mti_attr;
 	struct lmv_mds_md_v1 *lmv;
@@ -550,8 +698,9 @@ static int mdt_restripe_migrate(struct mdt_thread_info *info)
 	struct lu_fid fid2;
 	struct lu_dirpage *dp;
 	struct lu_dirent *ent;
-	const char *name = NULL;
-	int namelen = 0;
+	__u64 hash;
+	int count = 0;
+	int namelen;
 	__u16 type;
 	int idx = 0;
 	int len;
@@ -559,12 +708,6 @@ static int mdt_restripe_migrate(struct mdt_thread_info *info)
 
 	ENTRY;
 
-	if (list_empty(&restriper->mdr_migrating))
-		RETURN(0);
-
-	stripe = list_entry(restriper->mdr_migrating.next, typeof(*stripe),
-			    mot_restripe_linkage);
-
 	/* get master object FID and stripe name */
 	rc = mdt_attr_get_pfid_name(info, stripe, &fid1, lname);
 	if (rc)
@@ -607,25 +750,44 @@ static int mdt_restripe_migrate(struct mdt_thread_info *info)
 		 * split, neither for target stripes in dir merge if hash type
 		 * is CRUSH.
 		 */
-		rc = mdt_restripe_migrate_finish(info, stripe, lmv);
-		RETURN(rc);
+		spin_lock(&restriper->mdr_lock);
+		stripe->mot_restripe_offset = MDS_DIR_END_OFF;
+		spin_unlock(&restriper->mdr_lock);
+		RETURN(0);
+	}
+
+	/* lmv is in thread buffer which is reused in migration */
+	mdt_restripe_migrate_lum(lum, lmv);
+
+	mutex_lock(&restriper->mdr_readdir_mutex);
+	/* the last page is taken by another thread */
+	if (stripe->mot_restripe_offset == MDS_DIR_END_OFF) {
+		mutex_unlock(&restriper->mdr_readdir_mutex);
+		RETURN(0);
 	}
 
-	/* get sub file name @mot_restripe_offset.
-	 * TODO: read one dirent instead of whole page.
-	 */
 	rdpg->rp_hash = stripe->mot_restripe_offset;
 	rdpg->rp_count = PAGE_SIZE;
 	rdpg->rp_npages = 1;
 	rdpg->rp_attrs = LUDA_64BITHASH | LUDA_FID | LUDA_TYPE;
-	rdpg->rp_pages = &restriper->mdr_page;
+	rdpg->rp_pages = &worker->mdw_page;
 	rc = mo_readpage(env, mdt_object_child(stripe), rdpg);
-	if (rc < 0)
+	if (rc < 0) {
+		mutex_unlock(&restriper->mdr_readdir_mutex);
 		GOTO(out, rc);
+	}
 
-	dp = page_address(restriper->mdr_page);
+	/* mti_u is reused in migration */
+	hash = rdpg->rp_hash;
+	dp = page_address(worker->mdw_page);
+	spin_lock(&restriper->mdr_lock);
+	stripe->mot_restripe_offset = le64_to_cpu(dp->ldp_hash_end);
+	spin_unlock(&restriper->mdr_lock);
+	mutex_unlock(&restriper->mdr_readdir_mutex);
+
+	rc = 0;
 	for (ent = lu_dirent_start(dp); ent; ent = lu_dirent_next(ent)) {
-		LASSERT(le64_to_cpu(ent->lde_hash) >= rdpg->rp_hash);
+		LASSERT(le64_to_cpu(ent->lde_hash) >= hash);
 
 		if (unlikely(!(le32_to_cpu(ent->lde_attrs) & LUDA_TYPE)))
 			GOTO(out, rc = -EINVAL);
@@ -637,81 +799,108 @@ static int mdt_restripe_migrate(struct mdt_thread_info *info)
 		if (name_is_dot_or_dotdot(ent->lde_name, namelen))
 			continue;
 
-		name = ent->lde_name;
-		type = lu_dirent_type_get(ent);
-		break;
-	}
-
-	if (!name) {
-		if (le64_to_cpu(dp->ldp_hash_end) == MDS_DIR_END_OFF) {
-			rc = mdt_restripe_migrate_finish(info, stripe, lmv);
-			RETURN(rc);
+		mdt_restripe_throttle(restriper);
+		/* stripe is dropped and migrated from start next time */
+		if (kthread_should_stop())
+			GOTO(out, rc = -EINTR);
+
+		if (!master) {
+			master = mdt_object_find(env, mdt, &fid1);
+			if (IS_ERR(master)) {
+				rc = PTR_ERR(master);
+				master = NULL;
+				GOTO(out, rc);
+			}
 		}
 
-		GOTO(out, rc = -EBADF);
-	}
-
-	/* copy name out because it should end with '\0' */
-	memcpy(info->mti_filename, name, namelen);
-	info->mti_filename[namelen] = '\0';
-	lname->ln_name = info->mti_filename;
-	lname->ln_namelen = namelen;
-
-	CDEBUG(D_INFO, "migrate "DFID"/"DNAME" type %ho\n",
-	       PFID(&fid1), PNAME(lname), type);
-
-	master = mdt_object_find(env, mdt, &fid1);
-	if (IS_ERR(master))
-		GOTO(out, rc = PTR_ERR(master));
-
-	rc = mdt_fid_alloc(env, mdt, &fid2, master, lname);
-	mdt_object_put(env, master);
-	if (rc < 0)
-		GOTO(out, rc);
+		type = lu_dirent_type_get(ent);
+		/* copy name out because it should end with '\0' */
+		memcpy(info->mti_filename, ent->lde_name, namelen);
+		info->mti_filename[namelen] = '\0';
+		lname->ln_name = info->mti_filename;
+		lname->ln_namelen = namelen;
 
-	mdt_restripe_migrate_prep(info, &fid1, &fid2, lname, type, lmv);
+		CDEBUG(D_INFO, "migrate "DFID"/"DNAME" type %ho\n",
+		       PFID(&fid1), PNAME(lname), type);
 
-	rc = mdt_reint_migrate(info, NULL);
-	/* mti_big_buf is allocated in XATTR migration */
-	if (unlikely(info->mti_big_buf.lb_buf))
-		lu_buf_free(&info->mti_big_buf);
-	if (rc == -EALREADY)
-		rc = 0;
-	if (rc)
-		GOTO(out, rc);
+		rc = mdt_fid_alloc(env, mdt, &fid2, master, lname);
+		if (rc < 0)
+			GOTO(out, rc);
 
-	LASSERT(ent);
-	do {
-		ent = lu_dirent_next(ent);
-		if (!ent)
-			break;
+		mdt_restripe_migrate_prep(info, &fid1, &fid2, lname, type, lum);
 
-		namelen = le16_to_cpu(ent->lde_namelen);
-	} while (namelen == 0); /* Skip dummy record */
+		rc = mdt_reint_migrate(info, NULL);
+		/* mti_big_buf is allocated in XATTR migration */
+		if (unlikely(info->mti_big_buf.lb_buf))
+			lu_buf_free(&info->mti_big_buf);
+		if (rc == -EALREADY)
+			rc = 0;
+		if (rc)
+			GOTO(out, rc);
 
-	if (ent)
-		stripe->mot_restripe_offset = le64_to_cpu(ent->lde_hash);
-	else
-		stripe->mot_restripe_offset = le64_to_cpu(dp->ldp_hash_end);
+		count++;
+	}
 
 	EXIT;
 out:
+	if (master)
+		mdt_object_put(env, master);
+
 	if (rc) {
 		/* -EBUSY: file is opened by others */
-		if (rc != -EBUSY)
+		if (rc != -EBUSY && rc != -EINTR)
 			CERROR("%s: migrate "DFID"/"DNAME" failed: rc = %d\n",
 			       mdt_obd_name(mdt), PFID(&fid1), PNAME(lname),
 			       rc);
+		return rc;
+	}
 
-		spin_lock(&mdt->mdt_lock);
-		stripe->mot_restriping = 0;
-		list_del_init(&stripe->mot_restripe_linkage);
-		spin_unlock(&mdt->mdt_lock);
+	return count;
+}
 
-		mdt_object_put(env, stripe);
+static inline bool
+mdt_restripe_worker_runnable(struct mdt_restripe_worker *worker)
+{
+	struct mdt_dir_restriper *restriper = worker->mdw_restriper;
+
+	return worker->mdw_index < READ_ONCE(restriper->mdr_threads) &&
+	       !list_empty(&restriper->mdr_migrating);
+}
+
+static int mdt_restripe_worker_main(void *arg)
+{
+	struct mdt_restripe_worker *worker = arg;
+	struct mdt_thread_info *info = worker->mdw_info;
+	struct mdt_object *stripe;
+	int rc;
+
+	ENTRY;
+
+	while (!kthread_should_stop()) {
+		wait_event_idle(worker->mdw_restriper->mdr_waitq,
+				kthread_should_stop() ||
+				mdt_restripe_worker_runnable(worker));
+		if (kthread_should_stop())
+			break;
+
+		stripe = mdt_restripe_migrate_get(worker);
+		if (!stripe) {
+			/* all stripes are taken, wait for one to finish */
+			wait_event_idle_timeout(worker->mdw_restriper->mdr_waitq,
+						kthread_should_stop(),
+						cfs_time_seconds(1));
+			continue;
+		}
+
+		rc = mdt_restripe_migrate(info, worker, stripe);
+		if (rc < 0)
+			mdt_restripe_migrate_put(info, worker, stripe, 0, rc);
+		else
+			mdt_restripe_migrate_put(info, worker, stripe, rc, 0);
+		cond_resched();
 	}
 
-	return rc;
+	RETURN(0);
 }
 
 static inline bool mdt_restripe_update_pending(struct mdt_thread_info *info)
@@ -861,10 +1050,6 @@ static int mdt_restriper_main(void *arg)
 			__set_current_state(TASK_RUNNING);
 			mdt_restripe_layout_update(info);
 			cond_resched();
-		} else if (!list_empty(&restriper->mdr_migrating)) {
-			__set_current_state(TASK_RUNNING);
-			mdt_restripe_migrate(info);
-			cond_resched();
 		} else {
 			schedule();
 		}
@@ -874,40 +1059,30 @@ static int mdt_restriper_main(void *arg)
 	RETURN(0);
 }
 
-int mdt_restriper_start(struct mdt_device *mdt)
+/* prepare root credentials for restripe thread */
+static struct mdt_thread_info *
+mdt_restripe_env_init(struct mdt_device *mdt, struct lu_env *env,
+		      struct lu_context *session)
 {
-	struct mdt_dir_restriper *restriper = &mdt->mdt_restriper;
-	struct task_struct *task;
 	struct mdt_thread_info *info;
 	struct lu_ucred *uc;
 	int rc;
 
-	ENTRY;
-
-	spin_lock_init(&restriper->mdr_lock);
-	INIT_LIST_HEAD(&restriper->mdr_auto_splitting);
-	INIT_LIST_HEAD(&restriper->mdr_migrating);
-	INIT_LIST_HEAD(&restriper->mdr_updating);
-	restriper->mdr_dir_split_count = DIR_SPLIT_COUNT_DEFAULT;
-	restriper->mdr_dir_split_delta = DIR_SPLIT_DELTA_DEFAULT;
-
-	restriper->mdr_page = alloc_page(GFP_KERNEL);
-	if (!restriper->mdr_page)
-		RETURN(-ENOMEM);
-
-	rc = lu_env_init(&restriper->mdr_env, LCT_MD_THREAD);
+	rc = lu_env_init(env, LCT_MD_THREAD);
 	if (rc)
-		GOTO(out_page, rc);
+		return ERR_PTR(rc);
 
-	rc = lu_context_init(&restriper->mdr_session, LCT_SERVER_SESSION);
-	if (rc)
-		GOTO(out_env, rc);
+	rc = lu_context_init(session, LCT_SERVER_SESSION);
+	if (rc) {
+		lu_env_fini(env);
+		return ERR_PTR(rc);
+	}
 
-	lu_context_enter(&restriper->mdr_session);
-	restriper->mdr_env.le_ses = &restriper->mdr_session;
+	lu_context_enter(session);
+	env->le_ses = session;
 
-	info = lu_context_key_get(&restriper->mdr_env.le_ctx, &mdt_thread_key);
-	info->mti_env = &restriper->mdr_env;
+	info = lu_context_key_get(&env->le_ctx, &mdt_thread_key);
+	info->mti_env = env;
 	info->mti_mdt = mdt;
 	info->mti_pill = NULL;
 	info->mti_dlm_req = NULL;
@@ -929,26 +1104,165 @@ int mdt_restriper_start(struct mdt_device *mdt)
 	uc->uc_ginfo = NULL;
 	uc->uc_identity = NULL;
 
+	return info;
+}
+
+static void mdt_restripe_env_fini(struct lu_env *env)
+{
+	lu_context_exit(env->le_ses);
+	lu_context_fini(env->le_ses);
+	lu_env_fini(env);
+}
+
+static int mdt_restripe_worker_start(struct mdt_device *mdt, int index)
+{
+	struct mdt_dir_restriper *restriper = &mdt->mdt_restriper;
+	struct mdt_restripe_worker *worker;
+	struct task_struct *task;
+	int rc;
+
+	ENTRY;
+
+	OBD_ALLOC_PTR(worker);
+	if (!worker)
+		RETURN(-ENOMEM);
+
+	worker->mdw_restriper = restriper;
+	worker->mdw_index = index;
+	worker->mdw_page = alloc_page(GFP_KERNEL);
+	if (!worker->mdw_page)
+		GOTO(out_free, rc = -ENOMEM);
+
+	worker->mdw_info = mdt_restripe_env_init(mdt, &worker->mdw_env,
+						 &worker->mdw_session);
+	if (IS_ERR(worker->mdw_info))
+		GOTO(out_page, rc = PTR_ERR(worker->mdw_info));
+
+	task = kthread_create(mdt_restripe_worker_main, worker,
+			      "mdt_rsm_%03d_%02d",
+			      mdt_seq_site(mdt)->ss_node_id, index);
+	if (IS_ERR(task)) {
+		rc = PTR_ERR(task);
+		CERROR("%s: Can't start restripe migrate thread: rc = %d\n",
+		       mdt_obd_name(mdt), rc);
+		GOTO(out_env, rc);
+	}
+	worker->mdw_task = task;
+	restriper->mdr_workers[index] = worker;
+	wake_up_process(task);
+
+	RETURN(0);
+
+out_env:
+	mdt_restripe_env_fini(&worker->mdw_env);
+out_page:
+	__free_page(worker->mdw_page);
+out_free:
+	OBD_FREE_PTR(worker);
+
+	return rc;
+}
+
+static void mdt_restripe_workers_stop(struct mdt_device *mdt)
+{
+	struct mdt_dir_restriper *restriper = &mdt->mdt_restriper;
+	struct mdt_restripe_worker *worker;
+	int i;
+
+	mutex_lock(&restriper->mdr_threads_mutex);
+	for (i = 0; i < restriper->mdr_threads_started; i++) {
+		worker = restriper->mdr_workers[i];
+		kthread_stop(worker->mdw_task);
+		mdt_restripe_env_fini(&worker->mdw_env);
+		__free_page(worker->mdw_page);
+		OBD_FREE_PTR(worker);
+		restriper->mdr_workers[i] = NULL;
+	}
+	restriper->mdr_threads_started = 0;
+	mutex_unlock(&restriper->mdr_threads_mutex);
+}
+
+/**
+ * Set the number of threads migrating sub files in directory restripe.
+ *
+ * Threads are started on demand and never stopped before umount, threads
+ * beyond \a threads stay idle.
+ *
+ * \param[in] mdt	MDT device
+ * \param[in] threads	number of threads, 0 to pause migration
+ *
+ * \retval		0 on success
+ * \retval		negative errno on failure
+ */
+int mdt_restripe_threads_set(struct mdt_device *mdt, unsigned int threads)
+{
+	struct mdt_dir_restriper *restriper = &mdt->mdt_restriper;
+	int rc = 0;
+
+	if (threads > DIR_RESTRIPE_THREADS_MAX)
+		return -ERANGE;
+
+	mutex_lock(&restriper->mdr_threads_mutex);
+	while (restriper->mdr_threads_started < threads) {
+		rc = mdt_restripe_worker_start(mdt,
+					       restriper->mdr_threads_started);
+		if (rc)
+			break;
+		restriper->mdr_threads_started++;
+	}
+	if (!rc)
+		WRITE_ONCE(restriper->mdr_threads, threads);
+	mutex_unlock(&restriper->mdr_threads_mutex);
+
+	wake_up_all(&restriper->mdr_waitq);
+
+	return rc;
+}
+
+int mdt_restriper_start(struct mdt_device *mdt)
+{
+	struct mdt_dir_restriper *restriper = &mdt->mdt_restriper;
+	struct task_struct *task;
+	struct mdt_thread_info *info;
+	int rc;
+
+	ENTRY;
+
+	spin_lock_init(&restriper->mdr_lock);
+	INIT_LIST_HEAD(&restriper->mdr_auto_splitting);
+	INIT_LIST_HEAD(&restriper->mdr_migrating);
+	INIT_LIST_HEAD(&restriper->mdr_updating);
+	init_waitqueue_head(&restriper->mdr_waitq);
+	mutex_init(&restriper->mdr_readdir_mutex);
+	mutex_init(&restriper->mdr_threads_mutex);
+	restriper->mdr_dir_split_count = DIR_SPLIT_COUNT_DEFAULT;
+	restriper->mdr_dir_split_delta = DIR_SPLIT_DELTA_DEFAULT;
+
+	info = mdt_restripe_env_init(mdt, &restriper->mdr_env,
+				     &restriper->mdr_session);
+	if (IS_ERR(info))
+		RETURN(PTR_ERR(info));
+
+	rc = mdt_restripe_threads_set(mdt, DIR_RESTRIPE_THREADS_DEFAULT);
+	if (rc)
+		GOTO(out_workers, rc);
+
 	task = kthread_create(mdt_restriper_main, info, "mdt_restriper_%03d",
 			      mdt_seq_site(mdt)->ss_node_id);
 	if (IS_ERR(task)) {
 		rc = PTR_ERR(task);
 		CERROR("%s: Can't start directory restripe thread: rc %d\n",
 		       mdt_obd_name(mdt), rc);
-		GOTO(out_ses, rc);
+		GOTO(out_workers, rc);
 	}
 	restriper->mdr_task = task;
 	wake_up_process(task);
 
 	RETURN(0);
 
-out_ses:
-	lu_context_exit(restriper->mdr_env.le_ses);
-	lu_context_fini(restriper->mdr_env.le_ses);
-out_env:
-	lu_env_fini(&restriper->mdr_env);
-out_page:
-	__free_page(restriper->mdr_page);
+out_workers:
+	mdt_restripe_workers_stop(mdt);
+	mdt_restripe_env_fini(&restriper->mdr_env);
 
 	return rc;
 }
@@ -962,6 +1276,7 @@ void mdt_restriper_stop(struct mdt_device *mdt)
 	if (!restriper->mdr_task)
 		return;
 
+	mdt_restripe_workers_stop(mdt);
 	kthread_stop(restriper->mdr_task);
 	restriper->mdr_task = NULL;
 
@@ -983,9 +1298,5 @@ void mdt_restriper_stop(struct mdt_device *mdt)
 		mdt_object_put(env, mo);
 	}
 
-	__free_page(restriper->mdr_page);
-
-	lu_context_exit(env->le_ses);
-	lu_context_fini(env->le_ses);
-	lu_env_fini(env);
+	mdt_restripe_env_fini(env);
 }
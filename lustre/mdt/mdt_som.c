@@ -73,6 +73,7 @@ int mdt_get_som(struct mdt_thread_info *info, struct mdt_object *obj,
 	struct lu_attr *attr = &ma->ma_attr;
 	int rc;
 
+	info->mti_lsom_trust = 0;
 	buf->lb_buf = info->mti_xattr_buf;
 	buf->lb_len = sizeof(info->mti_xattr_buf);
 	BUILD_BUG_ON(sizeof(struct lustre_som_attrs) >
@@ -82,9 +83,25 @@ int mdt_get_som(struct mdt_thread_info *info, struct mdt_object *obj,
 	rc = lustre_buf2som(info->mti_xattr_buf, rc, &ma->ma_som);
 	if (rc == 0) {
 		struct md_som *som = &ma->ma_som;
+		bool trust = false;
 
 		ma->ma_valid |= MA_SOM;
 
+		/* merge the LSOM update not yet written to disk */
+		spin_lock(&obj->mot_write_lock);
+		if (som->ms_valid & SOM_FL_LAZY) {
+			if (obj->mot_som_pending) {
+				som->ms_size = max(som->ms_size,
+						   obj->mot_som_size);
+				som->ms_blocks = max(som->ms_blocks,
+						     obj->mot_som_blocks);
+			} else if (obj->mot_write_count <= 0) {
+				trust = true;
+			}
+		}
+		spin_unlock(&obj->mot_write_lock);
+		info->mti_lsom_trust = trust && info->mti_mdt->mdt_lsom_trust;
+
 		CDEBUG(D_INODE, DFID": Reading som attrs: "
 		       "valid: %x, size: %lld, blocks: %lld\n",
 		       PFID(mdt_object_fid(obj)), som->ms_valid,
@@ -138,10 +155,66 @@ int mdt_set_som(struct mdt_thread_info *info, struct mdt_object *obj,
 	buf->lb_buf = som;
 	buf->lb_len = sizeof(*som);
 	rc = mo_xattr_set(info->mti_env, next, buf, XATTR_NAME_SOM, 0);
+	if (rc == 0) {
+		/* on-disk SOM supersedes the coalesced update */
+		spin_lock(&obj->mot_write_lock);
+		obj->mot_som_pending = 0;
+		spin_unlock(&obj->mot_write_lock);
+	}
 
 	RETURN(rc);
 }
 
+/**
+ * Check whether \a obj has an LSOM update not written to disk yet.
+ */
+bool mdt_lsom_pending(struct mdt_object *obj)
+{
+	bool pending;
+
+	spin_lock(&obj->mot_write_lock);
+	pending = obj->mot_som_pending != 0;
+	spin_unlock(&obj->mot_write_lock);
+
+	return pending;
+}
+
+/**
+ * Keep a lazy SOM update in memory instead of writing the xattr.
+ *
+ * While other clients still have the file open for write, every close
+ * would rewrite the LSOM xattr with a slightly larger size. Since LSOM
+ * only grows between truncates, keep the largest values in the object
+ * and write them once the last writer closes, or once the first
+ * deferred update is older than mdt_lsom_flush_interval seconds.
+ *
+ * \retval true if the update was deferred
+ */
+static bool mdt_lsom_defer(struct mdt_thread_info *info, struct mdt_object *o,
+			   __u64 size, __u64 blocks)
+{
+	unsigned int interval = info->mti_mdt->mdt_lsom_flush_interval;
+	time64_t now = ktime_get_seconds();
+	bool defer = false;
+
+	if (interval == 0)
+		return false;
+
+	spin_lock(&o->mot_write_lock);
+	/* this close still holds its own write reference */
+	if (o->mot_write_count > 1 &&
+	    (!o->mot_som_pending || now - o->mot_som_pending < interval)) {
+		if (!o->mot_som_pending)
+			o->mot_som_pending = now;
+		o->mot_som_size = size;
+		o->mot_som_blocks = blocks;
+		defer = true;
+	}
+	spin_unlock(&o->mot_write_lock);
+
+	return defer;
+}
+
 /**
  * SOM state transition from STRICT to STALE,
  */
@@ -223,6 +296,7 @@ int mdt_lsom_update(struct mdt_thread_info *info,
 		__u64 size;
 		__u64 blocks;
 		bool changed = false;
+		bool pending = mdt_lsom_pending(o);
 		struct md_som *som = &tmp_ma->ma_som;
 
 		if (truncate) {
@@ -280,7 +354,12 @@ int mdt_lsom_update(struct mdt_thread_info *info,
 				}
 			}
 		}
-		if (truncate || changed)
+		if (!truncate && (changed || pending) &&
+		    tmp_ma->ma_valid & MA_SOM && som->ms_valid & SOM_FL_LAZY &&
+		    mdt_lsom_defer(info, o, size, blocks))
+			GOTO(out_lock, rc = 0);
+
+		if (truncate || changed || pending)
 			rc = mdt_set_som(info, o, SOM_FL_LAZY, size, blocks);
 	}
 
@@ -601,9 +601,9 @@ repeat:
 				/* We need to be sure lgh_last_idx
 				 * record was saved to disk
 				 */
-				down_read(&loghandle->lgh_last_sem);
+				down_write(&loghandle->lgh_last_sem);
 				synced_idx = LLOG_HDR_TAIL(llh)->lrt_index;
-				up_read(&loghandle->lgh_last_sem);
+				up_write(&loghandle->lgh_last_sem);
 				CDEBUG(D_OTHER, "synced_idx: %d\n", synced_idx);
 				goto repeat;
 
@@ -478,6 +478,20 @@ int llog_cat_close(const struct lu_env *env, struct llog_handle *cathandle)
 }
 EXPORT_SYMBOL(llog_cat_close);
 
+/*
+ * Records can be appended to an existing local plain llog in parallel,
+ * llog_osd_write_rec() reserves the record slot under lgh_hdr_mutex and
+ * writes the record outside of it. Creation of the llog, the remote
+ * llogs and the llogs whose records must stay in call order still need
+ * the exclusive lock.
+ */
+static inline bool llog_cat_shared_append(struct llog_handle *loghandle)
+{
+	return loghandle->lgh_hdr != NULL && loghandle->lgh_obj != NULL &&
+	       !(loghandle->lgh_ctxt->loc_flags & LLOG_CTXT_FLAG_ORDERED) &&
+	       !dt_object_remote(loghandle->lgh_obj) && llog_exist(loghandle);
+}
+
 /** Return the currently active log handle.  If the current log handle doesn't
  * have enough space left for the current record, start a new one.
  *
@@ -486,14 +500,17 @@ EXPORT_SYMBOL(llog_cat_close);
  *
  * Assumes caller has already pushed us into the kernel context and is locking.
  *
- * NOTE: loghandle is write-locked upon successful return
+ * NOTE: loghandle is locked upon successful return, it is read-locked if
+ * \a shared is set and write-locked otherwise
  */
 static struct llog_handle *llog_cat_current_log(struct llog_handle *cathandle,
-						struct thandle *th)
+						struct thandle *th,
+						bool *shared)
 {
         struct llog_handle *loghandle = NULL;
         ENTRY;
 
+	*shared = false;
 
 	if (OBD_FAIL_CHECK(OBD_FAIL_MDS_LLOG_CREATE_FAILED2)) {
 		down_write_nested(&cathandle->lgh_lock, LLOGH_CAT);
@@ -505,6 +522,17 @@ static struct llog_handle *llog_cat_current_log(struct llog_handle *cathandle,
         if (loghandle) {
 		struct llog_log_hdr *llh;
 
+		if (llog_cat_shared_append(loghandle)) {
+			down_read_nested(&loghandle->lgh_lock, LLOGH_LOG);
+			if (llog_cat_shared_append(loghandle) &&
+			    !llog_is_full(loghandle)) {
+				up_read(&cathandle->lgh_lock);
+				*shared = true;
+				RETURN(loghandle);
+			}
+			up_read(&loghandle->lgh_lock);
+		}
+
 		down_write_nested(&loghandle->lgh_lock, LLOGH_LOG);
 		llh = loghandle->lgh_hdr;
 		if (llh == NULL || !llog_is_full(loghandle)) {
@@ -575,18 +603,19 @@ int llog_cat_add_rec(const struct lu_env *env, struct llog_handle *cathandle,
 		     struct thandle *th)
 {
         struct llog_handle *loghandle;
+	bool shared;
 	int rc, retried = 0;
 	ENTRY;
 
 	LASSERT(rec->lrh_len <= cathandle->lgh_ctxt->loc_chunk_size);
 
 retry:
-	loghandle = llog_cat_current_log(cathandle, th);
+	loghandle = llog_cat_current_log(cathandle, th, &shared);
 	if (IS_ERR(loghandle))
 		RETURN(PTR_ERR(loghandle));
 
 	/* loghandle is already locked by llog_cat_current_log() for us */
-	if (!llog_exist(loghandle)) {
+	if (!shared && !llog_exist(loghandle)) {
 		rc = llog_cat_new_log(env, cathandle, loghandle, th);
 		if (rc < 0) {
 			up_write(&loghandle->lgh_lock);
@@ -612,7 +641,10 @@ retry:
 		if (rc == -ENOSPC && llog_is_full(loghandle))
 			rc = -ENOBUFS;
 	}
-	up_write(&loghandle->lgh_lock);
+	if (shared)
+		up_read(&loghandle->lgh_lock);
+	else
+		up_write(&loghandle->lgh_lock);
 
 	if (rc == -ENOBUFS) {
 		if (retried++ == 0)
@@ -390,6 +390,11 @@ static int llog_osd_write_rec(const struct lu_env *env,
 	__u32			chunk_size;
 	size_t			 left;
 	__u32			orig_last_idx;
+	__u64			orig_off;
+	loff_t			rec_off;
+	loff_t			pad_off = 0;
+	int			pad_len = 0;
+	int			pad_idx = 0;
 	ENTRY;
 
 	llh = loghandle->lgh_hdr;
@@ -554,8 +559,24 @@ static int llog_osd_write_rec(const struct lu_env *env,
 		RETURN(-ENOSPC);
 
 	LASSERT(lgi->lgi_attr.la_valid & LA_SIZE);
+
+	/* Appenders of a local plain llog may run concurrently, see
+	 * llog_cat_current_log(). Each of them holds lgh_last_sem shared
+	 * until its record is written, so that llog_process_thread() can
+	 * wait for all in-flight records by taking it exclusively. */
+	down_read(&loghandle->lgh_last_sem);
+
+	/* the lgh_hdr_mutex protects llog header data from concurrent
+	 * update/cancel, the llh_count and llh_bitmap are protected.
+	 * It also serializes the reservation of the record index and
+	 * offset, all data is written outside of it */
+	mutex_lock(&loghandle->lgh_hdr_mutex);
 	orig_last_idx = loghandle->lgh_last_idx;
-	lgi->lgi_off = lgi->lgi_attr.la_size;
+	/* the object size doesn't cover records reserved by other
+	 * appenders but not written yet */
+	lgi->lgi_off = max_t(__u64, lgi->lgi_attr.la_size,
+			     loghandle->lgh_write_offset);
+	orig_off = lgi->lgi_off;
 
 	if (loghandle->lgh_max_size > 0 &&
 	    lgi->lgi_off >= loghandle->lgh_max_size) {
@@ -565,19 +586,24 @@ static int llog_osd_write_rec(const struct lu_env *env,
 		       PFID(&loghandle->lgh_id.lgl_oi.oi_fid));
 		/* this is to signal that this llog is full */
 		loghandle->lgh_last_idx = LLOG_HDR_BITMAP_SIZE(llh) - 1;
-		RETURN(-ENOSPC);
+		GOTO(out_reserve, rc = -ENOSPC);
 	}
 
 	left = chunk_size - (lgi->lgi_off & (chunk_size - 1));
 	/* NOTE: padding is a record, but no bit is set */
 	if (left != 0 && left != reclen &&
 	    left < (reclen + LLOG_MIN_REC_SIZE)) {
-		index = loghandle->lgh_last_idx + 1;
-		rc = llog_osd_pad(env, o, &lgi->lgi_off, left, index, th);
-		if (rc)
-			RETURN(rc);
-
-		loghandle->lgh_last_idx++; /* for pad rec */
+		/* the padding must not take the last free index */
+		if (!(llh->llh_flags & LLOG_F_IS_CAT) &&
+		    loghandle->lgh_last_idx + 1 >=
+		    LLOG_HDR_BITMAP_SIZE(llh) - 1) {
+			loghandle->lgh_last_idx = LLOG_HDR_BITMAP_SIZE(llh) - 1;
+			GOTO(out_reserve, rc = -ENOSPC);
+		}
+		pad_off = lgi->lgi_off;
+		pad_len = left;
+		pad_idx = ++loghandle->lgh_last_idx; /* for pad rec */
+		lgi->lgi_off += left;
 	}
 	/* if it's the last idx in log file, then return -ENOSPC
 	 * or wrap around if a catalog */
@@ -588,29 +614,20 @@ static int llog_osd_write_rec(const struct lu_env *env,
 		if (llh->llh_flags & LLOG_F_IS_CAT)
 			loghandle->lgh_last_idx = 0;
 		else
-			RETURN(-ENOSPC);
+			GOTO(out_reserve, rc = -ENOSPC);
 	}
 
-	down_write(&loghandle->lgh_last_sem);
 	/* increment the last_idx along with llh_tail index, they should
 	 * be equal for a llog lifetime */
 	loghandle->lgh_last_idx++;
 	index = loghandle->lgh_last_idx;
 	LLOG_HDR_TAIL(llh)->lrt_index = index;
-	/**
-	 * NB: the caller should make sure only 1 process access
-	 * the lgh_last_idx, e.g. append should be exclusive.
-	 * Otherwise it might hit the assert.
-	 */
 	LASSERT(index < LLOG_HDR_BITMAP_SIZE(llh));
 	rec->lrh_index = index;
 	lrt = rec_tail(rec);
 	lrt->lrt_len = rec->lrh_len;
 	lrt->lrt_index = rec->lrh_index;
 
-	/* the lgh_hdr_mutex protects llog header data from concurrent
-	 * update/cancel, the llh_count and llh_bitmap are protected */
-	mutex_lock(&loghandle->lgh_hdr_mutex);
 	if (__test_and_set_bit_le(index, LLOG_HDR_BITMAP(llh))) {
 		CERROR("%s: index %u already set in log bitmap\n",
 		       o->do_lu.lo_dev->ld_obd->obd_name, index);
@@ -627,8 +644,18 @@ static int llog_osd_write_rec(const struct lu_env *env,
 			llh->llh_size = reclen;
 	}
 
-	if (lgi->lgi_attr.la_size == 0) {
-		lgi->lgi_off = 0;
+	/* computed index can be used to determine offset for fixed-size
+	 * records. This also allows to handle Catalog wrap around case */
+	if (llh->llh_flags & LLOG_F_IS_FIXSIZE)
+		rec_off = llh->llh_hdr.lrh_len + (index - 1) * reclen;
+	else if (lgi->lgi_off == 0)
+		rec_off = llh->llh_hdr.lrh_len;
+	else
+		rec_off = lgi->lgi_off;
+	if (!(llh->llh_flags & LLOG_F_IS_FIXSIZE))
+		loghandle->lgh_write_offset = rec_off + reclen;
+
+	if (lgi->lgi_off == 0) {
 		lgi->lgi_buf.lb_len = llh->llh_hdr.lrh_len;
 		lgi->lgi_buf.lb_buf = &llh->llh_hdr;
 		rc = dt_record_write(env, o, &lgi->lgi_buf, &lgi->lgi_off, th);
@@ -670,7 +697,6 @@ static int llog_osd_write_rec(const struct lu_env *env,
 	}
 
 out_unlock:
-	/* unlock here for remote object */
 	mutex_unlock(&loghandle->lgh_hdr_mutex);
 	if (rc)
 		GOTO(out, rc);
@@ -681,27 +707,33 @@ out_unlock:
 		OBD_RACE(OBD_FAIL_LLOG_PROCESS_TIMEOUT);
 		msleep(1 * MSEC_PER_SEC);
 	}
-	/* computed index can be used to determine offset for fixed-size
-	 * records. This also allows to handle Catalog wrap around case */
-	if (llh->llh_flags & LLOG_F_IS_FIXSIZE) {
-		lgi->lgi_off = llh->llh_hdr.lrh_len + (index - 1) * reclen;
-	} else {
-		rc = dt_attr_get(env, o, &lgi->lgi_attr);
+
+	/* fail the reserved record with index cfs_fail_val of the llog test
+	 * context, the sleep lets other appenders reserve slots behind it */
+	if (OBD_FAIL_PRECHECK(OBD_FAIL_LLOG_WRITE_REC_FAIL) &&
+	    !(llh->llh_flags & LLOG_F_IS_CAT) && loghandle->lgh_ctxt != NULL &&
+	    loghandle->lgh_ctxt->loc_idx == LLOG_TEST_ORIG_CTXT &&
+	    OBD_FAIL_CHECK_VALUE(OBD_FAIL_LLOG_WRITE_REC_FAIL, index)) {
+		msleep(MSEC_PER_SEC / 10);
+		GOTO(out, rc = -EIO);
+	}
+
+	/* the slot is reserved, write the padding and the record itself
+	 * in parallel with other appenders */
+	if (pad_len > 0) {
+		rc = llog_osd_pad(env, o, &pad_off, pad_len, pad_idx, th);
 		if (rc)
 			GOTO(out, rc);
-
-		LASSERT(lgi->lgi_attr.la_valid & LA_SIZE);
-		lgi->lgi_off = max_t(__u64, lgi->lgi_attr.la_size,
-				     lgi->lgi_off);
 	}
 
+	lgi->lgi_off = rec_off;
 	lgi->lgi_buf.lb_len = reclen;
 	lgi->lgi_buf.lb_buf = rec;
 	rc = dt_record_write(env, o, &lgi->lgi_buf, &lgi->lgi_off, th);
 	if (rc < 0)
 		GOTO(out, rc);
 
-	up_write(&loghandle->lgh_last_sem);
+	up_read(&loghandle->lgh_last_sem);
 
 	CDEBUG(D_HA, "added record "DFID".%u, %u off%llu\n",
 	       PFID(lu_object_fid(&o->do_lu)), index, rec->lrh_len,
@@ -724,19 +756,64 @@ out:
 	mutex_lock(&loghandle->lgh_hdr_mutex);
 	clear_bit_le(index, LLOG_HDR_BITMAP(llh));
 	llh->llh_count--;
-	mutex_unlock(&loghandle->lgh_hdr_mutex);
+
+	if (loghandle->lgh_last_idx != index) {
+		__u32	*bitmap = LLOG_HDR_BITMAP(llh);
+		int	 rc2;
+
+		/* other records were reserved after this one and will be
+		 * written behind it, the bit of this index is already on
+		 * disk, clear it and fill the slot with padding to keep the
+		 * llog contiguous */
+		lgi->lgi_off = 0;
+		lgi->lgi_buf.lb_len = llh->llh_bitmap_offset;
+		lgi->lgi_buf.lb_buf = &llh->llh_hdr;
+		rc2 = dt_record_write(env, o, &lgi->lgi_buf, &lgi->lgi_off, th);
+		if (rc2 == 0) {
+			lgi->lgi_off = llh->llh_bitmap_offset +
+				(index / (sizeof(*bitmap) * 8)) *
+				sizeof(*bitmap);
+			lgi->lgi_buf.lb_len = sizeof(*bitmap);
+			lgi->lgi_buf.lb_buf =
+				&bitmap[index / (sizeof(*bitmap) * 8)];
+			rc2 = dt_record_write(env, o, &lgi->lgi_buf,
+					      &lgi->lgi_off, th);
+		}
+		mutex_unlock(&loghandle->lgh_hdr_mutex);
+		if (rc2 == 0 && !(llh->llh_flags & LLOG_F_IS_FIXSIZE))
+			rc2 = llog_osd_pad(env, o, &rec_off, reclen, index,
+					   th);
+		if (rc2 != 0)
+			CERROR("%s: cannot clear failed record "DFID".%u: "
+			       "rc = %d\n", o->do_lu.lo_dev->ld_obd->obd_name,
+			       PFID(lu_object_fid(&o->do_lu)), index, rc2);
+		up_read(&loghandle->lgh_last_sem);
+		RETURN(rc);
+	}
 
 	/* restore llog last_idx */
 	if (dt_object_remote(o)) {
 		loghandle->lgh_last_idx = orig_last_idx;
-	} else if (--loghandle->lgh_last_idx == 0 &&
-	    (llh->llh_flags & LLOG_F_IS_CAT) && llh->llh_cat_idx != 0) {
-		/* catalog had just wrap-around case */
-		loghandle->lgh_last_idx = LLOG_HDR_BITMAP_SIZE(llh) - 1;
+		loghandle->lgh_write_offset = orig_off;
+	} else {
+		if (--loghandle->lgh_last_idx == 0 &&
+		    (llh->llh_flags & LLOG_F_IS_CAT) && llh->llh_cat_idx != 0) {
+			/* catalog had just wrap-around case */
+			loghandle->lgh_last_idx = LLOG_HDR_BITMAP_SIZE(llh) - 1;
+		}
+		if (!(llh->llh_flags & LLOG_F_IS_FIXSIZE))
+			loghandle->lgh_write_offset = rec_off;
 	}
 
 	LLOG_HDR_TAIL(llh)->lrt_index = loghandle->lgh_last_idx;
-	up_write(&loghandle->lgh_last_sem);
+	mutex_unlock(&loghandle->lgh_hdr_mutex);
+	up_read(&loghandle->lgh_last_sem);
+
+	RETURN(rc);
+
+out_reserve:
+	mutex_unlock(&loghandle->lgh_hdr_mutex);
+	up_read(&loghandle->lgh_last_sem);
 
 	RETURN(rc);
 }
@@ -2097,6 +2097,334 @@ ctxt_release:
 	RETURN(rc);
 }
 
+#define LLOG_TEST_11_THREADS	4
+#define LLOG_TEST_11_RECS	256
+#define LLOG_TEST_11_FAIL_IDX	100
+
+struct llog_test_11_info {
+	struct llog_handle	*lti_cath;
+	struct completion	 lti_completion;
+	int			 lti_thread;
+	int			 lti_added;
+	int			 lti_failed_idx;
+	int			 lti_rc;
+	char			 lti_buf[LLOG_MIN_REC_SIZE + 8 * 24];
+};
+
+static int llog_test_11_thread(void *arg)
+{
+	struct llog_test_11_info *lti = arg;
+	struct llog_rec_hdr *rec = (struct llog_rec_hdr *)lti->lti_buf;
+	struct lu_context session;
+	struct lu_env env;
+	int rc, i;
+
+	rc = lu_env_init(&env, LCT_LOCAL | LCT_MG_THREAD);
+	if (rc)
+		GOTO(out, rc);
+
+	rc = lu_context_init(&session, LCT_SERVER_SESSION);
+	if (rc)
+		GOTO(out_env, rc);
+	session.lc_thread = (struct ptlrpc_thread *)current;
+	lu_context_enter(&session);
+	env.le_ses = &session;
+
+	for (i = 0; i < LLOG_TEST_11_RECS; i++) {
+		/* vary the length to get paddings at chunk ends */
+		rec->lrh_len = LLOG_MIN_REC_SIZE +
+			       ((i + lti->lti_thread) % 8) * 24;
+		rec->lrh_type = 0xf00f00;
+		rc = llog_cat_add(&env, lti->lti_cath, rec, NULL);
+		if (rc == -EIO && lti->lti_failed_idx == 0) {
+			/* injected failure, the record index is reserved */
+			lti->lti_failed_idx = rec->lrh_index;
+			continue;
+		}
+		if (rc) {
+			CERROR("11b: thread %d write #%d failed: %d\n",
+			       lti->lti_thread, i + 1, rc);
+			break;
+		}
+		lti->lti_added++;
+	}
+
+	lu_context_exit(&session);
+	lu_context_fini(&session);
+out_env:
+	lu_env_fini(&env);
+out:
+	lti->lti_rc = rc;
+	complete(&lti->lti_completion);
+	return rc;
+}
+
+struct llog_test_11_data {
+	struct llog_handle	*ltd_llh;
+	__u64			 ltd_off;
+	int			 ltd_idx;
+	int			 ltd_recs;
+	int			 ltd_failed_idx;
+	int			 ltd_failed_found;
+};
+
+/*
+ * Check the slots between the last processed record and \a off, they
+ * must be padding records with contiguous indices. The only padding not
+ * ending at a chunk boundary is the one of the failed record.
+ */
+static int llog_test_11_check_pad(const struct lu_env *env,
+				  struct llog_handle *llh,
+				  struct llog_test_11_data *ltd, __u64 off)
+{
+	size_t chunk_size = llh->lgh_hdr->llh_hdr.lrh_len;
+	struct llog_rec_hdr rec;
+	struct llog_rec_tail tail;
+	struct lu_buf buf;
+	loff_t pos;
+	int rc;
+
+	while (ltd->ltd_off < off) {
+		pos = ltd->ltd_off;
+		buf.lb_buf = &rec;
+		buf.lb_len = sizeof(rec);
+		rc = dt_record_read(env, llh->lgh_obj, &buf, &pos);
+		if (rc)
+			return rc;
+
+		if (rec.lrh_type != LLOG_PAD_MAGIC ||
+		    rec.lrh_index != ltd->ltd_idx ||
+		    rec.lrh_len < LLOG_MIN_REC_SIZE ||
+		    ltd->ltd_off + rec.lrh_len > off) {
+			CERROR("11c: bad record %x/%u/%u at %llu, expected padding %d\n",
+			       rec.lrh_type, rec.lrh_index, rec.lrh_len,
+			       ltd->ltd_off, ltd->ltd_idx);
+			return -EINVAL;
+		}
+
+		pos = ltd->ltd_off + rec.lrh_len - sizeof(tail);
+		buf.lb_buf = &tail;
+		buf.lb_len = sizeof(tail);
+		rc = dt_record_read(env, llh->lgh_obj, &buf, &pos);
+		if (rc)
+			return rc;
+
+		if (tail.lrt_len != rec.lrh_len ||
+		    tail.lrt_index != rec.lrh_index) {
+			CERROR("11c: bad padding tail %u/%u at %llu\n",
+			       tail.lrt_len, tail.lrt_index, ltd->ltd_off);
+			return -EINVAL;
+		}
+
+		if (rec.lrh_index == ltd->ltd_failed_idx) {
+			ltd->ltd_failed_found++;
+		} else if ((ltd->ltd_off + rec.lrh_len) % chunk_size != 0) {
+			CERROR("11c: padding %u at %llu ends inside a chunk\n",
+			       rec.lrh_index, ltd->ltd_off);
+			return -EINVAL;
+		}
+
+		ltd->ltd_off += rec.lrh_len;
+		ltd->ltd_idx++;
+	}
+
+	return 0;
+}
+
+static int llog_test_11_cb(const struct lu_env *env, struct llog_handle *llh,
+			   struct llog_rec_hdr *rec, void *data)
+{
+	struct llog_test_11_data *ltd = data;
+	int rc;
+
+	if (ltd->ltd_llh != llh) {
+		ltd->ltd_llh = llh;
+		ltd->ltd_off = llh->lgh_hdr->llh_hdr.lrh_len;
+		ltd->ltd_idx = 1;
+	}
+
+	if (rec->lrh_type != 0xf00f00) {
+		CERROR("11c: unexpected record %x with index %u\n",
+		       rec->lrh_type, rec->lrh_index);
+		RETURN(-EINVAL);
+	}
+
+	rc = llog_test_11_check_pad(env, llh, ltd, llh->lgh_cur_offset);
+	if (rc)
+		RETURN(rc);
+
+	if (llh->lgh_cur_offset != ltd->ltd_off ||
+	    rec->lrh_index != ltd->ltd_idx) {
+		CERROR("11c: record %u at %llu, expected %d at %llu\n",
+		       rec->lrh_index, llh->lgh_cur_offset, ltd->ltd_idx,
+		       ltd->ltd_off);
+		RETURN(-EINVAL);
+	}
+
+	ltd->ltd_off += rec->lrh_len;
+	ltd->ltd_idx++;
+	ltd->ltd_recs++;
+
+	RETURN(0);
+}
+
+/* test parallel appends to a plain llog and padding of a failed record */
+static int llog_test_11(const struct lu_env *env, struct obd_device *obd)
+{
+	struct llog_test_11_info *lti;
+	struct llog_test_11_data ltd;
+	struct llog_handle *cath;
+	struct llog_mini_rec lmr;
+	struct llog_ctxt *ctxt;
+	struct llog_logid logid;
+	char name[10];
+	int rc, rc2, i, added = 1, failed_idx = 0;
+
+	ENTRY;
+
+	ctxt = llog_get_context(obd, LLOG_TEST_ORIG_CTXT);
+	LASSERT(ctxt);
+
+	OBD_ALLOC(lti, sizeof(*lti) * LLOG_TEST_11_THREADS);
+	if (lti == NULL)
+		GOTO(ctxt_release, rc = -ENOMEM);
+
+	snprintf(name, sizeof(name), "%x", llog_test_rand + 3);
+	CWARN("11a: create a catalog log with name: %s\n", name);
+	rc = llog_open_create(env, ctxt, &cath, NULL, name);
+	if (rc) {
+		CERROR("11a: llog_create with name %s failed: %d\n", name, rc);
+		GOTO(out_free, rc);
+	}
+	rc = llog_init_handle(env, cath, LLOG_F_IS_CAT, &uuid);
+	if (rc) {
+		CERROR("11a: can't init llog handle: %d\n", rc);
+		GOTO(out, rc);
+	}
+	logid = cath->lgh_id;
+
+	/* create the plain llog, the parallel append path needs it */
+	lmr.lmr_hdr.lrh_len = lmr.lmr_tail.lrt_len = LLOG_MIN_REC_SIZE;
+	lmr.lmr_hdr.lrh_type = 0xf00f00;
+	rc = llog_cat_add(env, cath, &lmr.lmr_hdr, NULL);
+	if (rc) {
+		CERROR("11a: first write failed: %d\n", rc);
+		GOTO(out, rc);
+	}
+
+	cfs_fail_loc = OBD_FAIL_ONCE | OBD_FAIL_LLOG_WRITE_REC_FAIL;
+	cfs_fail_val = LLOG_TEST_11_FAIL_IDX;
+
+	CWARN("11b: write %d records from %d threads\n",
+	      LLOG_TEST_11_RECS * LLOG_TEST_11_THREADS, LLOG_TEST_11_THREADS);
+	for (i = 0; i < LLOG_TEST_11_THREADS; i++) {
+		struct task_struct *task;
+
+		lti[i].lti_cath = cath;
+		lti[i].lti_thread = i;
+		init_completion(&lti[i].lti_completion);
+		task = kthread_run(llog_test_11_thread, &lti[i],
+				   "llog_test_11_%d", i);
+		if (IS_ERR(task)) {
+			lti[i].lti_rc = PTR_ERR(task);
+			complete(&lti[i].lti_completion);
+		}
+	}
+
+	for (i = 0; i < LLOG_TEST_11_THREADS; i++) {
+		wait_for_completion(&lti[i].lti_completion);
+		if (lti[i].lti_rc && rc == 0)
+			rc = lti[i].lti_rc;
+		added += lti[i].lti_added;
+		if (lti[i].lti_failed_idx) {
+			if (failed_idx) {
+				CERROR("11b: more than one record failed\n");
+				rc = -EINVAL;
+			}
+			failed_idx = lti[i].lti_failed_idx;
+		}
+	}
+	cfs_fail_loc = 0;
+	cfs_fail_val = 0;
+	if (rc)
+		GOTO(out, rc);
+
+	if (failed_idx != LLOG_TEST_11_FAIL_IDX) {
+		CERROR("11b: failed record index %d, expected %d\n",
+		       failed_idx, LLOG_TEST_11_FAIL_IDX);
+		GOTO(out, rc = -EINVAL);
+	}
+
+	/* a single plain llog in the catalog (+1 with hdr) */
+	rc = verify_handle("11b", cath, 2);
+	if (rc)
+		GOTO(out, rc);
+
+	/* the header takes the first bit of the plain llog too */
+	rc = verify_handle("11b", cath->u.chd.chd_current_log, added + 1);
+	if (rc)
+		GOTO(out, rc);
+
+	CWARN("11c: check %d records are contiguous\n", added);
+	memset(&ltd, 0, sizeof(ltd));
+	ltd.ltd_failed_idx = failed_idx;
+	rc = llog_cat_process(env, cath, llog_test_11_cb, &ltd, 0, 0);
+	if (rc)
+		GOTO(out, rc);
+
+	if (ltd.ltd_recs != added || ltd.ltd_failed_found != 1) {
+		CERROR("11c: processed %d records of %d, failed record padded %d times\n",
+		       ltd.ltd_recs, added, ltd.ltd_failed_found);
+		GOTO(out, rc = -EINVAL);
+	}
+
+	CWARN("11d: reopen the catalog and check the llog on disk\n");
+	rc = llog_cat_close(env, cath);
+	if (rc) {
+		CERROR("11d: close log %s failed: %d\n", name, rc);
+		GOTO(out_free, rc);
+	}
+
+	rc = llog_open(env, ctxt, &cath, &logid, NULL, LLOG_OPEN_EXISTS);
+	if (rc) {
+		CERROR("11d: can't reopen catalog: %d\n", rc);
+		GOTO(out_free, rc);
+	}
+	rc = llog_init_handle(env, cath, LLOG_F_IS_CAT, &uuid);
+	if (rc) {
+		CERROR("11d: can't init llog handle: %d\n", rc);
+		GOTO(out, rc);
+	}
+
+	memset(&ltd, 0, sizeof(ltd));
+	ltd.ltd_failed_idx = failed_idx;
+	rc = llog_cat_process(env, cath, llog_test_11_cb, &ltd, 0, 0);
+	if (rc)
+		GOTO(out, rc);
+
+	if (ltd.ltd_recs != added || ltd.ltd_failed_found != 1) {
+		CERROR("11d: processed %d records of %d, failed record padded %d times\n",
+		       ltd.ltd_recs, added, ltd.ltd_failed_found);
+		GOTO(out, rc = -EINVAL);
+	}
+out:
+	cfs_fail_loc = 0;
+	cfs_fail_val = 0;
+
+	CWARN("11: put newly-created catalog\n");
+	rc2 = llog_cat_close(env, cath);
+	if (rc2) {
+		CERROR("11: close log %s failed: %d\n", name, rc2);
+		if (rc == 0)
+			rc = rc2;
+	}
+out_free:
+	OBD_FREE(lti, sizeof(*lti) * LLOG_TEST_11_THREADS);
+ctxt_release:
+	llog_ctxt_put(ctxt);
+	RETURN(rc);
+}
+
 /*
  * -------------------------------------------------------------------------
  * Tests above, boring obd functions below
@@ -2155,6 +2483,10 @@ static int llog_run_tests(const struct lu_env *env, struct obd_device *obd)
 	if (rc)
 		GOTO(cleanup, rc);
 
+	rc = llog_test_11(env, obd);
+	if (rc)
+		GOTO(cleanup, rc);
+
 cleanup:
 	err = llog_destroy(env, llh);
 	if (err)
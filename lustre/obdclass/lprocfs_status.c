@@ -635,6 +635,32 @@ static const char *obd_connect_names[] = {
 	"client_encryption",	/* 0x8000 */
 	"fidmap",		/* 0x10000 */
 	"getattr_pfid",		/* 0x20000 */
+	/* 0x40000 - 0x8000000000 are reserved for upstream flags */
+	"unknown",		/* 0x40000 */
+	"unknown",		/* 0x80000 */
+	"unknown",		/* 0x100000 */
+	"unknown",		/* 0x200000 */
+	"unknown",		/* 0x400000 */
+	"unknown",		/* 0x800000 */
+	"unknown",		/* 0x1000000 */
+	"unknown",		/* 0x2000000 */
+	"unknown",		/* 0x4000000 */
+	"unknown",		/* 0x8000000 */
+	"unknown",		/* 0x10000000 */
+	"unknown",		/* 0x20000000 */
+	"unknown",		/* 0x40000000 */
+	"unknown",		/* 0x80000000 */
+	"unknown",		/* 0x100000000 */
+	"unknown",		/* 0x200000000 */
+	"unknown",		/* 0x400000000 */
+	"unknown",		/* 0x800000000 */
+	"unknown",		/* 0x1000000000 */
+	"unknown",		/* 0x2000000000 */
+	"unknown",		/* 0x4000000000 */
+	"unknown",		/* 0x8000000000 */
+	"lsom_trust",		/* 0x10000000000 */
+	"dqacq_batch",		/* 0x20000000000 */
+	"setattr_batch",	/* 0x40000000000 */
 	NULL
 };
 
@@ -194,6 +194,8 @@ lprocfs_exp_print_export_seq(struct obd_export *exp, void *cb_data)
 	seq_printf(m, "    export_flags: [ ");
 	obd_export_flags2str(exp, m);
 	seq_printf(m, " ]\n");
+	seq_printf(m, "    granted_locks: %d\n",
+		   atomic_read(&exp->exp_granted_locks));
 
 out:
 	return 0;
@@ -220,6 +222,7 @@ out:
  *        instance: 0
  *        target_version: 2.10.51.0
  *        export_flags: [ ... ]
+ *        granted_locks: 12
  *
  */
 static int lprocfs_exp_export_seq_show(struct seq_file *m, void *data)
@@ -224,8 +224,9 @@ static inline __u64 tgt_statfs_iavail(struct lu_tgt_desc *tgt)
 /**
  * Calculate weight for a given tgt.
  *
- * The final tgt weight is bavail >> 16 * iavail >> 8 minus the tgt and server
- * penalties.  See ltd_qos_penalties_calc() for how penalties are calculated.
+ * The final tgt weight is bavail >> 16 * iavail >> 8, scaled down by the
+ * tgt I/O load, minus the tgt and server penalties.  See
+ * ltd_qos_penalties_calc() for how penalties and load are calculated.
  *
  * \param[in] tgt	target descriptor
  */
@@ -235,6 +236,11 @@ void lu_tgt_qos_weight_calc(struct lu_tgt_desc *tgt)
 	__u64 temp, temp2;
 
 	temp = (tgt_statfs_bavail(tgt) >> 16) * (tgt_statfs_iavail(tgt) >> 8);
+	if (ltq->ltq_load) {
+		/* weight * 256 / (256 + load), load is at most 4x256 */
+		do_div(temp, 256 + ltq->ltq_load);
+		temp <<= 8;
+	}
 	temp2 = ltq->ltq_penalty + ltq->ltq_svr->lsq_penalty;
 	if (temp < temp2)
 		ltq->ltq_weight = 0;
@@ -281,6 +287,8 @@ int lu_tgt_descs_init(struct lu_tgt_descs *ltd, bool is_mdt)
 	ltd->ltd_qos.lq_prio_free = 232;
 	/* Default threshold for rr (roughly 17%) */
 	ltd->ltd_qos.lq_threshold_rr = 43;
+	/* Default priority for I/O load (25%), only OSTs report load */
+	ltd->ltd_qos.lq_prio_load = 64;
 	ltd->ltd_is_mdt = is_mdt;
 	if (is_mdt)
 		ltd->ltd_lmv_desc.ld_pattern = LMV_HASH_TYPE_DEFAULT;
@@ -456,6 +464,8 @@ int ltd_qos_penalties_calc(struct lu_tgt_descs *ltd)
 	struct lu_svr_qos *svr;
 	__u64 ba_max, ba_min, ba;
 	__u64 ia_max, ia_min, ia = 1;
+	__u64 rate_sum = 0, inflight_sum = 0;
+	__u32 load, load_max = 0, load_cnt = 0;
 	__u32 num_active;
 	int prio_wide;
 	time64_t now, age;
@@ -496,6 +506,10 @@ int ltd_qos_penalties_calc(struct lu_tgt_descs *ltd)
 		if (!tgt->ltd_active)
 			continue;
 
+		rate_sum += tgt->ltd_statfs.os_io_rate;
+		inflight_sum += tgt->ltd_statfs.os_io_inflight;
+		load_cnt++;
+
 		/* when inode is counted, bavail >> 16 to avoid overflow */
 		ba = tgt_statfs_bavail(tgt);
 		if (ltd->ltd_is_mdt)
@@ -541,6 +555,39 @@ int ltd_qos_penalties_calc(struct lu_tgt_descs *ltd)
 			tgt->ltd_qos.ltq_penalty >>= age / desc->ld_qos_maxage;
 	}
 
+	/*
+	 * Per-tgt load is the tgt I/O rate and in-flight bulk count relative
+	 * to the average of all active tgts (256 == average), capped at 4x
+	 * the average and scaled by lq_prio_load.  Targets that don't report
+	 * load (MDTs, old OSTs) always get zero load.
+	 */
+	ltd_foreach_tgt(ltd, tgt) {
+		struct obd_statfs *osfs = &tgt->ltd_statfs;
+		__u32 parts = 0;
+
+		tgt->ltd_qos.ltq_load = 0;
+		if (!tgt->ltd_active || !qos->lq_prio_load)
+			continue;
+
+		load = 0;
+		if (rate_sum) {
+			load += div64_u64((__u64)osfs->os_io_rate * load_cnt
+					  << 8, rate_sum);
+			parts++;
+		}
+		if (inflight_sum) {
+			load += div64_u64((__u64)osfs->os_io_inflight *
+					  load_cnt << 8, inflight_sum);
+			parts++;
+		}
+		if (!parts)
+			continue;
+
+		load = min_t(__u32, load / parts, 4 * 256);
+		load_max = max(load, load_max);
+		tgt->ltd_qos.ltq_load = qos->lq_prio_load * load >> 8;
+	}
+
 	num_active = qos->lq_active_svr_count - 1;
 	if (num_active < 1) {
 		/*
@@ -581,11 +628,13 @@ int ltd_qos_penalties_calc(struct lu_tgt_descs *ltd)
 
 	/*
 	 * If each tgt has almost same free space, do rr allocation for better
-	 * creation performance
+	 * creation performance, unless some tgt is loaded more than twice the
+	 * average, in which case weighted allocation steers around it.
 	 */
 	qos->lq_same_space = 0;
 	if ((ba_max * (256 - qos->lq_threshold_rr)) >> 8 < ba_min &&
-	    (ia_max * (256 - qos->lq_threshold_rr)) >> 8 < ia_min) {
+	    (ia_max * (256 - qos->lq_threshold_rr)) >> 8 < ia_min &&
+	    load_max <= 2 * 256) {
 		qos->lq_same_space = 1;
 		/* Reset weights for the next time we enter qos mode */
 		qos->lq_reset = 1;
@@ -686,3 +735,67 @@ int ltd_qos_update(struct lu_tgt_descs *ltd, struct lu_tgt_desc *tgt,
 	RETURN(0);
 }
 EXPORT_SYMBOL(ltd_qos_update);
+
+/**
+ * Apply penalties of the objects allocated without lq_rw_sem.
+ *
+ * Allocations made lockless only count themselves in ltq_allocs, this
+ * applies the penalties ltd_qos_update() would have applied for them, with
+ * the decrease of all penalties done once for all allocations.
+ * Caller must hold lq_rw_sem for write.
+ *
+ * \param[in] ltd		lu_tgt_descs
+ *
+ * \retval		number of allocations applied
+ */
+unsigned int ltd_qos_allocs_fold(struct lu_tgt_descs *ltd)
+{
+	struct lu_qos *qos = &ltd->ltd_qos;
+	__u32 active = ltd->ltd_lov_desc.ld_active_tgt_count;
+	struct lu_tgt_desc *tgt;
+	struct lu_tgt_qos *ltq;
+	struct lu_svr_qos *svr;
+	unsigned int total = 0;
+	unsigned int count;
+	time64_t now;
+	__u64 dec;
+
+	now = ktime_get_real_seconds();
+	ltd_foreach_tgt(ltd, tgt) {
+		ltq = &tgt->ltd_qos;
+		count = atomic_xchg(&ltq->ltq_allocs, 0);
+		if (!count || !tgt->ltd_active)
+			continue;
+
+		total += count;
+		svr = ltq->ltq_svr;
+		/* penalties are halved each time, 64 times clears them */
+		for (count = min(count, 64U); count > 0; count--) {
+			ltq->ltq_penalty >>= 1;
+			svr->lsq_penalty >>= 1;
+			ltq->ltq_penalty += ltq->ltq_penalty_per_obj * active;
+			svr->lsq_penalty += svr->lsq_penalty_per_obj * active;
+		}
+		ltq->ltq_used = svr->lsq_used = now;
+	}
+
+	if (!total)
+		return 0;
+
+	list_for_each_entry(svr, &qos->lq_svr_list, lsq_svr_list) {
+		dec = svr->lsq_penalty_per_obj * total;
+		svr->lsq_penalty -= min(svr->lsq_penalty, dec);
+	}
+
+	ltd_foreach_tgt(ltd, tgt) {
+		if (!tgt->ltd_active)
+			continue;
+
+		ltq = &tgt->ltd_qos;
+		dec = ltq->ltq_penalty_per_obj * total;
+		ltq->ltq_penalty -= min(ltq->ltq_penalty, dec);
+	}
+
+	return total;
+}
+EXPORT_SYMBOL(ltd_qos_allocs_fold);
@@ -147,6 +147,61 @@ static ssize_t precreate_batch_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(precreate_batch);
 
+/**
+ * Show number of threads creating precreate batches in parallel.
+ *
+ * \param[in] kobj	kobject of the OFD device
+ * \param[in] attr	attribute to show
+ * \param[in] buf	output buffer
+ *
+ * \retval		number of bytes written to \a buf
+ */
+static ssize_t precreate_threads_show(struct kobject *kobj,
+				      struct attribute *attr, char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct ofd_device *ofd = ofd_dev(obd->obd_lu_dev);
+
+	return sprintf(buf, "%u\n", ofd->ofd_precreate_threads);
+}
+
+/**
+ * Change number of threads creating precreate batches in parallel.
+ *
+ * Setting 0 disables parallel precreation. The value cannot exceed the
+ * number of helper threads started at setup.
+ *
+ * \param[in] kobj	kobject of the OFD device
+ * \param[in] attr	attribute to change
+ * \param[in] buffer	string which represents the number of threads
+ * \param[in] count	\a buffer length
+ *
+ * \retval		\a count on success
+ * \retval		negative number on error
+ */
+static ssize_t precreate_threads_store(struct kobject *kobj,
+				       struct attribute *attr,
+				       const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct ofd_device *ofd = ofd_dev(obd->obd_lu_dev);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val > ofd->ofd_precreate_threads_started)
+		return -ERANGE;
+
+	WRITE_ONCE(ofd->ofd_precreate_threads, val);
+	return count;
+}
+LUSTRE_RW_ATTR(precreate_threads);
+
 /**
  * Show number of seconds to delay atime
  *
@@ -1077,6 +1132,7 @@ static struct attribute *ofd_attrs[] = {
 	&lustre_attr_seqs_allocated.attr,
 	&lustre_attr_grant_precreate.attr,
 	&lustre_attr_precreate_batch.attr,
+	&lustre_attr_precreate_threads.attr,
 	&lustre_attr_atime_diff.attr,
 	&lustre_attr_degraded.attr,
 	&lustre_attr_fstype.attr,
@@ -1374,6 +1374,135 @@ out:
 	return rc;
 }
 
+/**
+ * Apply one object of OST_SETATTR_BATCH.
+ *
+ * \param[in] tsi	target session environment for this request
+ * \param[in] nodemap	nodemap of the export to map the IDs with
+ * \param[in] osr	object and attributes to set
+ * \param[in] oa	obdo buffer to use
+ *
+ * \retval		0 if successful
+ * \retval		negative value on error
+ */
+static int ofd_setattr_batch_one(struct tgt_session_info *tsi,
+				 struct lu_nodemap *nodemap,
+				 const struct ost_setattr_rec *osr,
+				 struct obdo *oa)
+{
+	struct ofd_thread_info	*fti = tsi2ofd_info(tsi);
+	struct ofd_device	*ofd = ofd_exp(tsi->tsi_exp);
+	struct ofd_object	*fo;
+	ktime_t			 kstart = ktime_get();
+	int			 rc;
+
+	/* only the ownership can be changed this way */
+	if (osr->osr_valid & ~(OBD_MD_FLUID | OBD_MD_FLGID | OBD_MD_FLPROJID))
+		return -EINVAL;
+
+	memset(oa, 0, sizeof(*oa));
+	oa->o_oi = osr->osr_oi;
+	oa->o_valid = OBD_MD_FLID | OBD_MD_FLGROUP | osr->osr_valid;
+	oa->o_uid = nodemap_map_id(nodemap, NODEMAP_UID, NODEMAP_CLIENT_TO_FS,
+				   osr->osr_uid);
+	oa->o_gid = nodemap_map_id(nodemap, NODEMAP_GID, NODEMAP_CLIENT_TO_FS,
+				   osr->osr_gid);
+	oa->o_projid = osr->osr_projid;
+
+	rc = tgt_validate_obdo(tsi, oa);
+	if (rc)
+		return rc;
+
+	fti->fti_fid = oa->o_oi.oi_fid;
+	fo = ofd_object_find_exists(tsi->tsi_env, ofd, &fti->fti_fid);
+	if (IS_ERR(fo))
+		return PTR_ERR(fo);
+
+	la_from_obdo(&fti->fti_attr, oa, oa->o_valid);
+	fti->fti_attr.la_valid &= ~LA_TYPE;
+	/* no VBR for the batched objects */
+	fti->fti_pre_version = 0;
+
+	rc = ofd_attr_set(tsi->tsi_env, fo, &fti->fti_attr, oa);
+	ofd_object_put(tsi->tsi_env, fo);
+
+	/* unlike ofd_setattr_hdl() there is no need to update the LVB,
+	 * the ownership is not part of it */
+	if (rc == 0)
+		ofd_counter_incr(tsi->tsi_exp, LPROC_OFD_STATS_SETATTR,
+				 tsi->tsi_jobid,
+				 ktime_us_delta(ktime_get(), kstart));
+	return rc;
+}
+
+/**
+ * OFD request handler for OST_SETATTR_BATCH RPC.
+ *
+ * This is the batched OST_SETATTR used by OSP to propagate ownership changes
+ * of many OST objects with a single RPC, see osp_sync_new_setattr_job().
+ * Every object is changed in its own transaction and its result is returned
+ * in osr_rc, the request itself fails only if it can't be parsed.
+ *
+ * \param[in] tsi	target session environment for this request
+ *
+ * \retval		0 if successful
+ * \retval		negative value on error
+ */
+static int ofd_setattr_batch_hdl(struct tgt_session_info *tsi)
+{
+	struct req_capsule	*pill = tsi->tsi_pill;
+	struct ost_setattr_rec	*recs;
+	struct ost_setattr_rec	*reps;
+	struct lu_nodemap	*nodemap;
+	struct obdo		*oa;
+	int			 count, i, rc;
+
+	ENTRY;
+
+	recs = req_capsule_client_get(pill, &RMF_OST_SETATTR_BATCH);
+	if (recs == NULL)
+		RETURN(err_serious(-EPROTO));
+
+	count = req_capsule_get_size(pill, &RMF_OST_SETATTR_BATCH,
+				     RCL_CLIENT) / sizeof(*recs);
+	if (count == 0 || count > OST_SETATTR_BATCH_MAX)
+		RETURN(err_serious(-EPROTO));
+
+	req_capsule_set_size(pill, &RMF_OST_SETATTR_BATCH, RCL_SERVER,
+			     count * sizeof(*reps));
+	rc = req_capsule_server_pack(pill);
+	if (rc)
+		RETURN(err_serious(rc));
+
+	reps = req_capsule_server_get(pill, &RMF_OST_SETATTR_BATCH);
+	if (reps == NULL)
+		RETURN(err_serious(-EFAULT));
+
+	nodemap = nodemap_get_from_exp(tsi->tsi_exp);
+	if (IS_ERR(nodemap))
+		RETURN(PTR_ERR(nodemap));
+
+	OBD_ALLOC_PTR(oa);
+	if (oa == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	tgt_mult_trans_enable(tsi);
+	for (i = 0; i < count; i++) {
+		reps[i] = recs[i];
+		reps[i].osr_rc = ofd_setattr_batch_one(tsi, nodemap, &recs[i],
+						       oa);
+		CDEBUG(D_INODE, "%s: setattr "DOSTID" uid %u gid %u: rc = %d\n",
+		       tgt_name(tsi->tsi_tgt), POSTID(&recs[i].osr_oi),
+		       recs[i].osr_uid, recs[i].osr_gid, reps[i].osr_rc);
+	}
+
+	OBD_FREE_PTR(oa);
+	EXIT;
+out:
+	nodemap_putref(nodemap);
+	return rc;
+}
+
 /**
  * Destroy OST orphans.
  *
@@ -1695,8 +1824,14 @@ static int ofd_create_hdl(struct tgt_session_info *tsi)
 				break;
 			}
 
-			rc = ofd_precreate_objects(tsi->tsi_env, ofd, next_id,
-						   oseq, count, sync_trans);
+			if (count < diff)
+				rc = ofd_precreate_objects_parallel(
+						tsi->tsi_env, ofd, next_id,
+						oseq, (int)diff, sync_trans);
+			else
+				rc = ofd_precreate_objects(tsi->tsi_env, ofd,
+							   next_id, oseq,
+							   count, sync_trans);
 			if (rc > 0) {
 				created += rc;
 				diff -= rc;
@@ -2828,7 +2963,8 @@ TGT_OST_HDL_HP(HAS_BODY | HAS_REPLY | IS_MUTABLE,
 TGT_OST_HDL(HAS_BODY | HAS_REPLY,	OST_SYNC,	ofd_sync_hdl),
 TGT_OST_HDL(HAS_REPLY,	OST_QUOTACTL,	ofd_quotactl),
 TGT_OST_HDL(HAS_BODY | HAS_REPLY, OST_LADVISE,	ofd_ladvise_hdl),
-TGT_OST_HDL(HAS_BODY | HAS_REPLY | IS_MUTABLE, OST_FALLOCATE, ofd_fallocate_hdl)
+TGT_OST_HDL(HAS_BODY | HAS_REPLY | IS_MUTABLE, OST_FALLOCATE, ofd_fallocate_hdl),
+TGT_OST_HDL(IS_MUTABLE,			OST_SETATTR_BATCH, ofd_setattr_batch_hdl),
 };
 
 static struct tgt_opc_slice ofd_common_slice[] = {
@@ -2967,6 +3103,17 @@ static int ofd_init0(const struct lu_env *env, struct ofd_device *m,
 
 	spin_lock_init(&m->ofd_batch_lock);
 	init_rwsem(&m->ofd_lastid_rwsem);
+	atomic_set(&m->ofd_io_inflight, 0);
+	atomic64_set(&m->ofd_io_bytes, 0);
+	spin_lock_init(&m->ofd_io_stats_lock);
+	m->ofd_io_sample_time = ktime_get();
+	m->ofd_io_sample_bytes = 0;
+	m->ofd_io_rate = 0;
+	m->ofd_precreate_threads = OFD_PRECREATE_THREADS_DEFAULT;
+	atomic_set(&m->ofd_precreate_threads_running, 0);
+	INIT_LIST_HEAD(&m->ofd_precreate_list);
+	spin_lock_init(&m->ofd_precreate_lock);
+	init_waitqueue_head(&m->ofd_precreate_waitq);
 
 	m->ofd_dt_dev.dd_lu_dev.ld_ops = &ofd_lu_ops;
 	m->ofd_dt_dev.dd_lu_dev.ld_obd = obd;
@@ -3071,6 +3218,8 @@ static int ofd_init0(const struct lu_env *env, struct ofd_device *m,
 	if (rc != 0)
 		GOTO(err_fini_nm, rc);
 
+	ofd_start_precreate_threads(m);
+
 	tgt_adapt_sptlrpc_conf(&m->ofd_lut);
 
 	RETURN(0);
@@ -3125,6 +3274,7 @@ static void ofd_fini(const struct lu_env *env, struct ofd_device *m)
 	ofd_procfs_fini(m);
 	tgt_fini(env, &m->ofd_lut);
 	ofd_stop_inconsistency_verification_thread(m);
+	ofd_stop_precreate_threads(m);
 	lfsck_degister(env, m->ofd_osd);
 	ofd_fs_cleanup(env, m);
 	nm_config_file_deregister_tgt(env, obd->u.obt.obt_nodemap_config_file);
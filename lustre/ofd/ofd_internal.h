@@ -47,6 +47,9 @@
 #define OFD_PRECREATE_SMALL_FS		(1024ULL * 1024 * 1024)
 #define OFD_PRECREATE_BATCH_SMALL	8
 
+/* number of helper threads creating precreate batches in parallel */
+#define OFD_PRECREATE_THREADS_DEFAULT	2
+
 /* Limit the returned fields marked valid to those that we actually might set */
 #define OFD_VALID_FLAGS (LA_TYPE | LA_MODE | LA_SIZE | LA_BLOCKS | \
 			 LA_BLKSIZE | LA_ATIME | LA_MTIME | LA_CTIME)
@@ -103,6 +106,9 @@ struct ofd_seq {
 	struct mutex		os_create_lock;
 	atomic_t		os_refc;
 	atomic_t		os_precreate_in_progress;
+	/* highest LAST_ID written by the current parallel precreate,
+	 * protected by the LAST_ID object DT_LASTID lock */
+	u64			os_precreate_lastid;
 	struct dt_object	*os_lastid_obj;
 	unsigned long		os_destroys_in_progress:1,
 				os_last_id_synced:1;
@@ -132,6 +138,24 @@ struct ofd_device {
 	int			ofd_seq_count;
 	int			ofd_precreate_batch;
 	spinlock_t		ofd_batch_lock;
+	/* helper threads used for parallel precreate, see
+	 * ofd_precreate_objects_parallel() */
+	unsigned int		ofd_precreate_threads;
+	unsigned int		ofd_precreate_threads_started;
+	atomic_t		ofd_precreate_threads_running;
+	bool			ofd_precreate_stopping;
+	struct list_head	ofd_precreate_list;
+	spinlock_t		ofd_precreate_lock;
+	wait_queue_head_t	ofd_precreate_waitq;
+
+	/* bulk I/O load reported to the MDT QoS allocator via statfs,
+	 * see ofd_statfs_io_load() */
+	atomic_t		 ofd_io_inflight;
+	atomic64_t		 ofd_io_bytes;
+	spinlock_t		 ofd_io_stats_lock;
+	ktime_t			 ofd_io_sample_time;
+	__u64			 ofd_io_sample_bytes;
+	__u32			 ofd_io_rate;	/* MiB/s, decaying average */
 
 	/* preferred BRW size, decided by storage type and capability */
 	__u32			 ofd_brw_size;
@@ -385,6 +409,11 @@ int ofd_object_ff_update(const struct lu_env *env, struct ofd_object *fo,
 			 const struct obdo *oa, struct filter_fid *ff);
 int ofd_precreate_objects(const struct lu_env *env, struct ofd_device *ofd,
 			  u64 id, struct ofd_seq *oseq, int nr, int sync);
+int ofd_precreate_objects_parallel(const struct lu_env *env,
+				   struct ofd_device *ofd, u64 id,
+				   struct ofd_seq *oseq, int nr, int sync);
+int ofd_start_precreate_threads(struct ofd_device *ofd);
+void ofd_stop_precreate_threads(struct ofd_device *ofd);
 
 static inline void ofd_object_put(const struct lu_env *env,
 				  struct ofd_object *fo)
@@ -945,6 +945,9 @@ int ofd_preprw(const struct lu_env *env, int cmd, struct obd_export *exp,
 		       exp->exp_obd->obd_name, cmd);
 		rc = -EPROTO;
 	}
+	/* dropped in ofd_commitrw(), which is always called on success */
+	if (rc == 0)
+		atomic_inc(&ofd->ofd_io_inflight);
 	RETURN(rc);
 }
 
@@ -1502,5 +1505,15 @@ int ofd_commitrw(const struct lu_env *env, int cmd, struct obd_export *exp,
 		rc = -EPROTO;
 	}
 
+	atomic_dec(&ofd->ofd_io_inflight);
+	if (rc == 0) {
+		__u64 bytes = 0;
+		int i;
+
+		for (i = 0; i < obj->ioo_bufcnt; i++)
+			bytes += rnb[i].rnb_len;
+		atomic64_add(bytes, &ofd->ofd_io_bytes);
+	}
+
 	RETURN(rc);
 }
@@ -580,10 +580,10 @@ static int ofd_destroy_export(struct obd_export *exp)
 {
 	struct ofd_device *ofd = ofd_exp(exp);
 
-	if (exp->exp_target_data.ted_pending)
+	if (atomic_long_read(&exp->exp_target_data.ted_pending))
 		CERROR("%s: cli %s/%p has %lu pending on destroyed export\n",
 		       exp->exp_obd->obd_name, exp->exp_client_uuid.uuid,
-		       exp, exp->exp_target_data.ted_pending);
+		       exp, atomic_long_read(&exp->exp_target_data.ted_pending));
 
 	target_destroy_export(exp);
 
@@ -767,6 +767,41 @@ static int ofd_get_info(const struct lu_env *env, struct obd_export *exp,
 	RETURN(rc);
 }
 
+/**
+ * Fill the bulk I/O load fields of \a osfs.
+ *
+ * The read+write rate is sampled at most once a second and folded into a
+ * decaying average (3/4 old, 1/4 new), so that the MDT QoS allocator sees
+ * a stable value even when it polls statfs often.
+ *
+ * \param[in] ofd	OFD device
+ * \param[out] osfs	statistics to fill
+ */
+static void ofd_statfs_io_load(struct ofd_device *ofd,
+			       struct obd_statfs *osfs)
+{
+	ktime_t now = ktime_get();
+	s64 ms;
+
+	spin_lock(&ofd->ofd_io_stats_lock);
+	ms = ktime_ms_delta(now, ofd->ofd_io_sample_time);
+	if (ms >= MSEC_PER_SEC) {
+		__u64 bytes = atomic64_read(&ofd->ofd_io_bytes);
+		__u64 rate = bytes - ofd->ofd_io_sample_bytes;
+
+		/* MiB/s */
+		rate = div64_u64(rate * MSEC_PER_SEC, ms) >> 20;
+		ofd->ofd_io_rate = min_t(__u64, U32_MAX,
+					 (3ULL * ofd->ofd_io_rate + rate) >> 2);
+		ofd->ofd_io_sample_bytes = bytes;
+		ofd->ofd_io_sample_time = now;
+	}
+	osfs->os_io_rate = ofd->ofd_io_rate;
+	spin_unlock(&ofd->ofd_io_stats_lock);
+
+	osfs->os_io_inflight = max(atomic_read(&ofd->ofd_io_inflight), 0);
+}
+
 /**
  * Implementation of obd_ops::o_statfs.
  *
@@ -852,6 +887,8 @@ int ofd_statfs(const struct lu_env *env,  struct obd_export *exp,
 	if (ofd->ofd_no_precreate)
 		osfs->os_state |= OS_STATFS_NOPRECREATE;
 
+	ofd_statfs_io_load(ofd, osfs);
+
 	if (obd->obd_self_export != exp && !exp_grant_param_supp(exp) &&
 	    tgd->tgd_blockbits > COMPAT_BSIZE_SHIFT) {
 		/*
@@ -40,6 +40,7 @@
 
 #define DEBUG_SUBSYSTEM S_FILTER
 
+#include <linux/kthread.h>
 #include <dt_object.h>
 #include <lustre_lfsck.h>
 
@@ -245,12 +246,16 @@ static int ofd_precreate_cb_add(const struct lu_env *env, struct thandle *th,
  * \param[in] oseq	object sequence
  * \param[in] nr	number of objects to precreate
  * \param[in] sync	synchronous precreation flag
+ * \param[in] parallel	other batches of the same sequence may be created
+ *			concurrently, see ofd_precreate_objects_parallel()
  *
  * \retval		0 if successful
  * \retval		negative value on error
  */
-int ofd_precreate_objects(const struct lu_env *env, struct ofd_device *ofd,
-			  u64 id, struct ofd_seq *oseq, int nr, int sync)
+static int __ofd_precreate_objects(const struct lu_env *env,
+				   struct ofd_device *ofd, u64 id,
+				   struct ofd_seq *oseq, int nr, int sync,
+				   bool parallel)
 {
 	struct ofd_thread_info	*info = ofd_info(env);
 	struct ofd_object	*fo = NULL;
@@ -382,8 +387,14 @@ int ofd_precreate_objects(const struct lu_env *env, struct ofd_device *ofd,
 	if (!OBD_FAIL_CHECK(OBD_FAIL_LFSCK_SKIP_LASTID)) {
 		tmp = cpu_to_le64(id + nr - 1);
 		dt_write_lock(env, oseq->os_lastid_obj, DT_LASTID);
-		rc = dt_record_write(env, oseq->os_lastid_obj,
-				     &info->fti_buf, &info->fti_off, th);
+		/* concurrent batches must never move LAST_ID backward */
+		if (!parallel || id + nr - 1 > oseq->os_precreate_lastid) {
+			rc = dt_record_write(env, oseq->os_lastid_obj,
+					     &info->fti_buf, &info->fti_off,
+					     th);
+			if (parallel && rc == 0)
+				oseq->os_precreate_lastid = id + nr - 1;
+		}
 		dt_write_unlock(env, oseq->os_lastid_obj);
 		if (rc != 0)
 			GOTO(trans_stop, rc);
@@ -424,13 +435,18 @@ int ofd_precreate_objects(const struct lu_env *env, struct ofd_device *ofd,
 			ofd_write_unlock(env, fo);
 		}
 
-		ofd_seq_last_oid_set(oseq, id + i);
+		/* in parallel mode the caller sets the last OID once all
+		 * batches are done, see ofd_precreate_objects_parallel() */
+		if (!parallel)
+			ofd_seq_last_oid_set(oseq, id + i);
 	}
 
 	objects = i;
 	/* NOT all the wanted objects have been created,
-	 * set the LAST_ID as the real created. */
-	if (unlikely(objects < nr)) {
+	 * set the LAST_ID as the real created. In parallel mode later
+	 * batches may have succeeded, so LAST_ID is left as is and the
+	 * gap is handled as orphans by the MDT orphan cleanup. */
+	if (unlikely(objects < nr) && !parallel) {
 		int rc1;
 
 		info->fti_off = 0;
@@ -471,6 +487,282 @@ out:
 	RETURN(objects > 0 ? objects : rc);
 }
 
+/**
+ * Precreate the given number \a nr of objects in the given sequence \a oseq.
+ *
+ * See __ofd_precreate_objects() for details.
+ *
+ * \param[in] env	execution environment
+ * \param[in] ofd	OFD device
+ * \param[in] id	object ID to start precreation from
+ * \param[in] oseq	object sequence
+ * \param[in] nr	number of objects to precreate
+ * \param[in] sync	synchronous precreation flag
+ *
+ * \retval		number of objects created
+ * \retval		negative value on error
+ */
+int ofd_precreate_objects(const struct lu_env *env, struct ofd_device *ofd,
+			  u64 id, struct ofd_seq *oseq, int nr, int sync)
+{
+	return __ofd_precreate_objects(env, ofd, id, oseq, nr, sync, false);
+}
+
+struct ofd_precreate_job {
+	struct list_head	 opj_list;
+	struct ofd_device	*opj_ofd;
+	struct ofd_seq		*opj_oseq;
+	u64			 opj_id;
+	int			 opj_nr;
+	int			 opj_sync;
+	int			 opj_rc;
+	struct completion	 opj_done;
+};
+
+/**
+ * Main routine of the precreate helper thread.
+ *
+ * The thread takes precreate batches queued by
+ * ofd_precreate_objects_parallel() and creates each one in its own
+ * transaction, so that several batches of a big precreate request
+ * proceed concurrently instead of waiting on each other's journal start.
+ *
+ * \param[in] args	OFD device
+ *
+ * \retval		0 on successful thread termination
+ * \retval		negative value if the environment could not be set up
+ */
+static int ofd_precreate_main(void *args)
+{
+	struct ofd_device *ofd = args;
+	struct ofd_precreate_job *opj;
+	struct lu_env env;
+	int rc;
+
+	ENTRY;
+
+	rc = lu_env_init(&env, LCT_DT_THREAD);
+	if (rc != 0) {
+		CERROR("%s: cannot init precreate thread env: rc = %d\n",
+		       ofd_name(ofd), rc);
+		atomic_dec(&ofd->ofd_precreate_threads_running);
+		wake_up_all(&ofd->ofd_precreate_waitq);
+		RETURN(rc);
+	}
+
+	spin_lock(&ofd->ofd_precreate_lock);
+	while (1) {
+		while (!list_empty(&ofd->ofd_precreate_list)) {
+			opj = list_first_entry(&ofd->ofd_precreate_list,
+					       struct ofd_precreate_job,
+					       opj_list);
+			list_del_init(&opj->opj_list);
+			spin_unlock(&ofd->ofd_precreate_lock);
+
+			opj->opj_rc = __ofd_precreate_objects(&env, ofd,
+							      opj->opj_id,
+							      opj->opj_oseq,
+							      opj->opj_nr,
+							      opj->opj_sync,
+							      true);
+			complete(&opj->opj_done);
+			spin_lock(&ofd->ofd_precreate_lock);
+		}
+
+		if (ofd->ofd_precreate_stopping)
+			break;
+
+		spin_unlock(&ofd->ofd_precreate_lock);
+		wait_event_idle(ofd->ofd_precreate_waitq,
+				!list_empty(&ofd->ofd_precreate_list) ||
+				ofd->ofd_precreate_stopping);
+		spin_lock(&ofd->ofd_precreate_lock);
+	}
+	spin_unlock(&ofd->ofd_precreate_lock);
+
+	lu_env_fini(&env);
+	atomic_dec(&ofd->ofd_precreate_threads_running);
+	wake_up_all(&ofd->ofd_precreate_waitq);
+
+	RETURN(0);
+}
+
+/**
+ * Start the precreate helper threads.
+ *
+ * Failure to start a helper is not fatal, precreation falls back to the
+ * serial path when no helper is running.
+ *
+ * \param[in] ofd	OFD device
+ *
+ * \retval		0 always
+ */
+int ofd_start_precreate_threads(struct ofd_device *ofd)
+{
+	struct task_struct *task;
+	unsigned int i;
+
+	ofd->ofd_precreate_stopping = false;
+	for (i = 0; i < ofd->ofd_precreate_threads; i++) {
+		atomic_inc(&ofd->ofd_precreate_threads_running);
+		task = kthread_run(ofd_precreate_main, ofd, "ofd_precreate_%02u",
+				   i);
+		if (IS_ERR(task)) {
+			atomic_dec(&ofd->ofd_precreate_threads_running);
+			CWARN("%s: cannot start precreate thread: rc = %ld\n",
+			      ofd_name(ofd), PTR_ERR(task));
+			break;
+		}
+	}
+	ofd->ofd_precreate_threads_started = i;
+	ofd->ofd_precreate_threads = i;
+
+	return 0;
+}
+
+/**
+ * Stop the precreate helper threads.
+ *
+ * Queued batches are still processed before the threads exit, so no
+ * caller of ofd_precreate_objects_parallel() is left waiting.
+ *
+ * \param[in] ofd	OFD device
+ */
+void ofd_stop_precreate_threads(struct ofd_device *ofd)
+{
+	spin_lock(&ofd->ofd_precreate_lock);
+	ofd->ofd_precreate_stopping = true;
+	spin_unlock(&ofd->ofd_precreate_lock);
+	wake_up_all(&ofd->ofd_precreate_waitq);
+	wait_event_idle(ofd->ofd_precreate_waitq,
+			atomic_read(&ofd->ofd_precreate_threads_running) == 0);
+	ofd->ofd_precreate_threads_started = 0;
+}
+
+/**
+ * Precreate \a nr objects in \a oseq using several transactions in parallel.
+ *
+ * The range is split into batches of at most ofd_device::ofd_precreate_batch
+ * objects. Up to ofd_device::ofd_precreate_threads batches are handed to
+ * the precreate helper threads while the caller creates the first batch
+ * itself, so the journal handles of all batches are open concurrently.
+ *
+ * LAST_ID on disk only ever moves forward and always covers every object
+ * created so far. The in-memory last OID of the sequence is updated once
+ * all batches are done, to the end of the contiguous created prefix: if
+ * some batch fails, objects created by later batches become orphans that
+ * are reused or destroyed like after an interrupted precreate.
+ *
+ * The caller must hold ofd_seq::os_create_lock.
+ *
+ * \param[in] env	execution environment
+ * \param[in] ofd	OFD device
+ * \param[in] id	object ID to start precreation from
+ * \param[in] oseq	object sequence
+ * \param[in] nr	number of objects to precreate
+ * \param[in] sync	synchronous precreation flag
+ *
+ * \retval		number of objects created
+ * \retval		negative value on error
+ */
+int ofd_precreate_objects_parallel(const struct lu_env *env,
+				   struct ofd_device *ofd, u64 id,
+				   struct ofd_seq *oseq, int nr, int sync)
+{
+	struct ofd_precreate_job *jobs;
+	unsigned int threads = READ_ONCE(ofd->ofd_precreate_threads);
+	int njobs = 0;
+	int created = 0;
+	int count;
+	int rc;
+	int i;
+
+	ENTRY;
+
+	/* a helper whose environment setup failed has already exited */
+	threads = min_t(unsigned int, threads,
+			atomic_read(&ofd->ofd_precreate_threads_running));
+	count = ofd_precreate_batch(ofd, nr);
+	if (threads == 0 || count >= nr)
+		RETURN(ofd_precreate_objects(env, ofd, id, oseq, count, sync));
+
+	OBD_ALLOC_PTR_ARRAY(jobs, threads + 1);
+	if (jobs == NULL)
+		RETURN(ofd_precreate_objects(env, ofd, id, oseq, count, sync));
+
+	dt_write_lock(env, oseq->os_lastid_obj, DT_LASTID);
+	oseq->os_precreate_lastid = id - 1;
+	dt_write_unlock(env, oseq->os_lastid_obj);
+
+	for (i = 0; i <= threads && nr > 0; i++) {
+		count = ofd_precreate_batch(ofd, nr);
+		jobs[i].opj_ofd = ofd;
+		jobs[i].opj_oseq = oseq;
+		jobs[i].opj_id = id;
+		jobs[i].opj_nr = count;
+		jobs[i].opj_sync = sync;
+		INIT_LIST_HEAD(&jobs[i].opj_list);
+		init_completion(&jobs[i].opj_done);
+		id += count;
+		nr -= count;
+		njobs++;
+	}
+
+	/* batch 0 is created by the caller itself */
+	spin_lock(&ofd->ofd_precreate_lock);
+	for (i = 1; i < njobs; i++)
+		list_add_tail(&jobs[i].opj_list, &ofd->ofd_precreate_list);
+	spin_unlock(&ofd->ofd_precreate_lock);
+	wake_up_all(&ofd->ofd_precreate_waitq);
+
+	jobs[0].opj_rc = __ofd_precreate_objects(env, ofd, jobs[0].opj_id,
+						 oseq, jobs[0].opj_nr, sync,
+						 true);
+
+	/* create the batches no helper has taken yet, a helper may have
+	 * exited since the split was sized */
+	spin_lock(&ofd->ofd_precreate_lock);
+	for (i = 1; i < njobs; i++) {
+		if (list_empty(&jobs[i].opj_list))
+			continue;
+		list_del_init(&jobs[i].opj_list);
+		spin_unlock(&ofd->ofd_precreate_lock);
+
+		jobs[i].opj_rc = __ofd_precreate_objects(env, ofd,
+							 jobs[i].opj_id, oseq,
+							 jobs[i].opj_nr, sync,
+							 true);
+		complete(&jobs[i].opj_done);
+		spin_lock(&ofd->ofd_precreate_lock);
+	}
+	spin_unlock(&ofd->ofd_precreate_lock);
+
+	for (i = 1; i < njobs; i++)
+		wait_for_completion(&jobs[i].opj_done);
+
+	/* only the contiguous prefix of created objects can be exposed */
+	rc = 0;
+	for (i = 0; i < njobs; i++) {
+		if (jobs[i].opj_rc < 0) {
+			rc = jobs[i].opj_rc;
+			break;
+		}
+		created += jobs[i].opj_rc;
+		if (jobs[i].opj_rc < jobs[i].opj_nr)
+			break;
+	}
+
+	if (created > 0)
+		ofd_seq_last_oid_set(oseq, jobs[0].opj_id + created - 1);
+
+	CDEBUG(D_OTHER, "%s: created %d objects in %d parallel batches: %d\n",
+	       ofd_name(ofd), created, njobs, rc);
+
+	OBD_FREE_PTR_ARRAY(jobs, threads + 1);
+
+	RETURN(created > 0 ? created : rc);
+}
+
 /**
  * Fix the OFD object ownership.
  *
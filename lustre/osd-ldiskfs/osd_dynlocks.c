@@ -30,6 +30,7 @@
 #include <linux/module.h>
 #include <linux/slab.h>
 #include <linux/sched.h>
+#include <linux/hash.h>
 
 #include <libcfs/libcfs.h>
 
@@ -49,11 +50,29 @@
  */
 void dynlock_init(struct dynlock *dl)
 {
-	spin_lock_init(&dl->dl_list_lock);
-	INIT_LIST_HEAD(&dl->dl_list);
+	int i;
+
+	for (i = 0; i < DYNLOCK_HASH_SIZE; i++) {
+		spin_lock_init(&dl->dl_buckets[i].dlb_lock);
+		INIT_LIST_HEAD(&dl->dl_buckets[i].dlb_list);
+	}
 	dl->dl_magic = DYNLOCK_LIST_MAGIC;
 }
 
+/*
+ * dynlock_bucket
+ *
+ * returns the bucket of lockspace the value hashes to. all handles
+ * for the same value live in the same bucket, so only that bucket's
+ * spinlock has to be taken to find, create or release them
+ *
+ */
+static inline struct dynlock_bucket *dynlock_bucket(struct dynlock *dl,
+						    unsigned long value)
+{
+	return &dl->dl_buckets[hash_long(value, DYNLOCK_HASH_BITS)];
+}
+
 /*
  * dynlock_lock
  *
@@ -69,16 +88,18 @@ struct dynlock_handle *dynlock_lock(struct dynlock *dl, unsigned long value,
 {
 	struct dynlock_handle *nhl = NULL;
 	struct dynlock_handle *hl;
+	struct dynlock_bucket *db;
 
 	BUG_ON(dl == NULL);
 	BUG_ON(dl->dl_magic != DYNLOCK_LIST_MAGIC);
 
+	db = dynlock_bucket(dl, value);
 repeat:
 	/* find requested lock in lockspace */
-	spin_lock(&dl->dl_list_lock);
-	BUG_ON(dl->dl_list.next == NULL);
-	BUG_ON(dl->dl_list.prev == NULL);
-	list_for_each_entry(hl, &dl->dl_list, dh_list) {
+	spin_lock(&db->dlb_lock);
+	BUG_ON(db->dlb_list.next == NULL);
+	BUG_ON(db->dlb_list.prev == NULL);
+	list_for_each_entry(hl, &db->dlb_list, dh_list) {
 		BUG_ON(hl->dh_list.next == NULL);
 		BUG_ON(hl->dh_list.prev == NULL);
 		BUG_ON(hl->dh_magic != DYNLOCK_HANDLE_MAGIC);
@@ -100,10 +121,10 @@ repeat:
 		/* we already have allocated lock. use it */
 		hl = nhl;
 		nhl = NULL;
-		list_add(&hl->dh_list, &dl->dl_list);
+		list_add(&hl->dh_list, &db->dlb_list);
 		goto found;
 	}
-	spin_unlock(&dl->dl_list_lock);
+	spin_unlock(&db->dlb_lock);
 
 	/* lock not found and we haven't allocated lock yet. allocate it */
 	OBD_SLAB_ALLOC_GFP(nhl, dynlock_cachep, sizeof(*nhl), gfp);
@@ -128,23 +149,23 @@ found:
 		 * this functionaly is useful for rename operations */
 		while ((hl->dh_writers && hl->dh_pid != current->pid) ||
 				hl->dh_readers) {
-			spin_unlock(&dl->dl_list_lock);
+			spin_unlock(&db->dlb_lock);
 			wait_event(hl->dh_wait,
 				hl->dh_writers == 0 && hl->dh_readers == 0);
-			spin_lock(&dl->dl_list_lock);
+			spin_lock(&db->dlb_lock);
 		}
 		hl->dh_writers++;
 	} else {
 		/* shared lock: user do not want to share lock with writer */
 		while (hl->dh_writers) {
-			spin_unlock(&dl->dl_list_lock);
+			spin_unlock(&db->dlb_lock);
 			wait_event(hl->dh_wait, hl->dh_writers == 0);
-			spin_lock(&dl->dl_list_lock);
+			spin_lock(&db->dlb_lock);
 		}
 		hl->dh_readers++;
 	}
 	hl->dh_pid = current->pid;
-	spin_unlock(&dl->dl_list_lock);
+	spin_unlock(&db->dlb_lock);
 
 	return hl;
 }
@@ -158,6 +179,7 @@ found:
  */
 void dynlock_unlock(struct dynlock *dl, struct dynlock_handle *hl)
 {
+	struct dynlock_bucket *db;
 	int wakeup = 0;
 
 	BUG_ON(dl == NULL);
@@ -170,7 +192,8 @@ void dynlock_unlock(struct dynlock *dl, struct dynlock_handle *hl)
 	BUG_ON(hl->dh_magic != DYNLOCK_HANDLE_MAGIC);
 	BUG_ON(hl->dh_writers != 0 && current->pid != hl->dh_pid);
 
-	spin_lock(&dl->dl_list_lock);
+	db = dynlock_bucket(dl, hl->dh_value);
+	spin_lock(&db->dlb_lock);
 	if (hl->dh_writers) {
 		BUG_ON(hl->dh_readers != 0);
 		hl->dh_writers--;
@@ -192,19 +215,21 @@ void dynlock_unlock(struct dynlock *dl, struct dynlock_handle *hl)
 		list_del(&hl->dh_list);
 		OBD_SLAB_FREE(hl, dynlock_cachep, sizeof(*hl));
 	}
-	spin_unlock(&dl->dl_list_lock);
+	spin_unlock(&db->dlb_lock);
 }
 
 int dynlock_is_locked(struct dynlock *dl, unsigned long value)
 {
 	struct dynlock_handle *hl;
+	struct dynlock_bucket *db;
 	int result = 0;
 
 	/* find requested lock in lockspace */
-	spin_lock(&dl->dl_list_lock);
-	BUG_ON(dl->dl_list.next == NULL);
-	BUG_ON(dl->dl_list.prev == NULL);
-	list_for_each_entry(hl, &dl->dl_list, dh_list) {
+	db = dynlock_bucket(dl, value);
+	spin_lock(&db->dlb_lock);
+	BUG_ON(db->dlb_list.next == NULL);
+	BUG_ON(db->dlb_list.prev == NULL);
+	list_for_each_entry(hl, &db->dlb_list, dh_list) {
 		BUG_ON(hl->dh_list.next == NULL);
 		BUG_ON(hl->dh_list.prev == NULL);
 		BUG_ON(hl->dh_magic != DYNLOCK_HANDLE_MAGIC);
@@ -214,6 +239,6 @@ int dynlock_is_locked(struct dynlock *dl, unsigned long value)
 			break;
 		}
 	}
-	spin_unlock(&dl->dl_list_lock);
+	spin_unlock(&db->dlb_lock);
 	return result;
 }
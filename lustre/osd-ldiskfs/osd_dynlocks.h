@@ -5,14 +5,29 @@
 #include <linux/wait.h>
 
 /*
- * lock's namespace:
- *   - list of locks
+ * Number of hash buckets in each lockspace. Locks on values hashing to
+ * different buckets never contend on the same spinlock.
+ */
+#define DYNLOCK_HASH_BITS	4
+#define DYNLOCK_HASH_SIZE	(1 << DYNLOCK_HASH_BITS)
+
+/*
+ * one bucket of lock's namespace:
+ *   - list of locks hashed to this bucket
  *   - lock to protect this list
  */
+struct dynlock_bucket {
+	spinlock_t		dlb_lock;
+	struct list_head	dlb_list;
+} ____cacheline_aligned_in_smp;
+
+/*
+ * lock's namespace:
+ *   - hash table of lock buckets
+ */
 struct dynlock {
 	unsigned		dl_magic;
-	struct list_head	dl_list;
-	spinlock_t		dl_list_lock;
+	struct dynlock_bucket	dl_buckets[DYNLOCK_HASH_SIZE];
 };
 
 enum dynlock_type {
@@ -777,6 +777,327 @@ put:
 	return rc;
 }
 
+static inline ldiskfs_fsblk_t osd_scrub_desc_blk(struct super_block *sb,
+						 __le32 lo, __le32 hi)
+{
+	return le32_to_cpu(lo) |
+	       (LDISKFS_DESC_SIZE(sb) >= LDISKFS_MIN_DESC_SIZE_64BIT ?
+		(ldiskfs_fsblk_t)le32_to_cpu(hi) << 32 : 0);
+}
+
+/**
+ * Start to read the inode bitmap and the used part of the inode table of
+ * the given group, so that they are cached when the iteration reaches it.
+ */
+static void osd_scrub_group_readahead(struct super_block *sb,
+				      ldiskfs_group_t bg)
+{
+	struct ldiskfs_group_desc *desc;
+	struct blk_plug plug;
+	ldiskfs_fsblk_t blk;
+	unsigned long count;
+	unsigned long i;
+	__u32 used;
+
+	if (bg >= LDISKFS_SB(sb)->s_groups_count)
+		return;
+
+	desc = ldiskfs_get_group_desc(sb, bg, NULL);
+	if (!desc || desc->bg_flags & cpu_to_le16(LDISKFS_BG_INODE_UNINIT))
+		return;
+
+	used = LDISKFS_INODES_PER_GROUP(sb) -
+	       ldiskfs_itable_unused_count(sb, desc);
+	count = DIV_ROUND_UP(used, LDISKFS_SB(sb)->s_inodes_per_block);
+
+	blk_start_plug(&plug);
+	sb_breadahead(sb, osd_scrub_desc_blk(sb, desc->bg_inode_bitmap_lo,
+					     desc->bg_inode_bitmap_hi));
+	blk = osd_scrub_desc_blk(sb, desc->bg_inode_table_lo,
+				 desc->bg_inode_table_hi);
+	for (i = 0; i < count; i++)
+		sb_breadahead(sb, blk + i);
+	blk_finish_plug(&plug);
+}
+
+static void osd_scrub_pf_scan(struct osd_thread_info *info,
+			      struct osd_device *dev,
+			      struct osd_scrub_prefetch *pf,
+			      struct osd_scrub_pf_group *grp)
+{
+	struct super_block *sb = osd_sb(dev);
+	__u32 ipg = LDISKFS_INODES_PER_GROUP(sb);
+	struct ldiskfs_group_desc *desc;
+	struct buffer_head *bitmap;
+	__u32 offset = 0;
+	__u32 unused;
+
+	if (grp->opg_bg == pf->osp_first_bg)
+		offset = pf->osp_first_offset;
+
+	desc = ldiskfs_get_group_desc(sb, grp->opg_bg, NULL);
+	if (!desc) {
+		grp->opg_rc = -EIO;
+		return;
+	}
+
+	if (desc->bg_flags & cpu_to_le16(LDISKFS_BG_INODE_UNINIT))
+		return;
+
+	osd_scrub_group_readahead(sb, grp->opg_bg);
+	bitmap = ldiskfs_read_inode_bitmap(sb, grp->opg_bg);
+	if (!bitmap) {
+		grp->opg_rc = -EIO;
+		return;
+	}
+
+	unused = ldiskfs_itable_unused_count(sb, desc);
+	while (offset + unused < ipg && !kthread_should_stop()) {
+		struct osd_scrub_pf_item *item;
+		__u32 pos;
+
+		offset = ldiskfs_find_next_bit(bitmap->b_data, ipg, offset);
+		if (offset >= ipg)
+			break;
+
+		pos = 1 + grp->opg_bg * ipg + offset++;
+		item = &grp->opg_items[grp->opg_count++];
+		osd_id_gen(&item->opi_lid, pos, OSD_OII_NOGEN);
+		item->opi_rc = osd_iit_iget(info, dev, &item->opi_fid,
+					    &item->opi_lid, pos, sb, true);
+	}
+	brelse(bitmap);
+}
+
+static inline bool osd_scrub_pf_can_take(struct osd_scrub_prefetch *pf)
+{
+	bool rc;
+
+	spin_lock(&pf->osp_lock);
+	rc = pf->osp_next_bg < pf->osp_groups_count &&
+	     pf->osp_next_bg < pf->osp_cur_bg + pf->osp_nslots;
+	spin_unlock(&pf->osp_lock);
+
+	return rc;
+}
+
+static int osd_scrub_pf_main(void *args)
+{
+	struct osd_device *dev = args;
+	struct osd_scrub_prefetch *pf = dev->od_scrub.os_prefetch;
+	struct lu_env env;
+	int rc;
+
+	rc = lu_env_init(&env, LCT_LOCAL | LCT_DT_THREAD);
+	if (rc != 0) {
+		CDEBUG(D_LFSCK, "%s: OI scrub prefetch fail to init env: "
+		       "rc = %d\n", osd_name(dev), rc);
+		/* the scrub thread reads the groups by itself then */
+		spin_lock(&pf->osp_lock);
+		pf->osp_active--;
+		spin_unlock(&pf->osp_lock);
+		wake_up_var(pf);
+		wait_var_event(pf, kthread_should_stop());
+		return rc;
+	}
+
+	while (1) {
+		struct osd_scrub_pf_group *grp;
+
+		wait_var_event(pf, kthread_should_stop() ||
+				   osd_scrub_pf_can_take(pf));
+		if (kthread_should_stop())
+			break;
+
+		spin_lock(&pf->osp_lock);
+		if (!(pf->osp_next_bg < pf->osp_groups_count &&
+		      pf->osp_next_bg < pf->osp_cur_bg + pf->osp_nslots)) {
+			spin_unlock(&pf->osp_lock);
+			continue;
+		}
+		grp = &pf->osp_slots[pf->osp_next_bg % pf->osp_nslots];
+		LASSERT(!grp->opg_ready);
+		grp->opg_bg = pf->osp_next_bg++;
+		grp->opg_count = 0;
+		grp->opg_idx = 0;
+		grp->opg_rc = 0;
+		spin_unlock(&pf->osp_lock);
+
+		osd_scrub_pf_scan(osd_oti_get(&env), dev, pf, grp);
+
+		spin_lock(&pf->osp_lock);
+		grp->opg_ready = true;
+		spin_unlock(&pf->osp_lock);
+		wake_up_var(pf);
+	}
+
+	lu_env_fini(&env);
+	return 0;
+}
+
+static void osd_scrub_pf_fini(struct osd_device *dev)
+{
+	struct osd_scrub_prefetch *pf = dev->od_scrub.os_prefetch;
+	int i;
+
+	if (!pf)
+		return;
+
+	for (i = 0; pf->osp_tasks && i < pf->osp_nthreads; i++) {
+		if (pf->osp_tasks[i])
+			kthread_stop(pf->osp_tasks[i]);
+	}
+
+	for (i = 0; pf->osp_slots && i < pf->osp_nslots; i++) {
+		if (pf->osp_slots[i].opg_items)
+			OBD_FREE_PTR_ARRAY_LARGE(pf->osp_slots[i].opg_items,
+				LDISKFS_INODES_PER_GROUP(osd_sb(dev)));
+	}
+	if (pf->osp_slots)
+		OBD_FREE_PTR_ARRAY(pf->osp_slots, pf->osp_nslots);
+	if (pf->osp_tasks)
+		OBD_FREE_PTR_ARRAY(pf->osp_tasks, pf->osp_nthreads);
+	OBD_FREE_PTR(pf);
+	dev->od_scrub.os_prefetch = NULL;
+}
+
+/**
+ * Start OI scrub prefetch threads from the current iteration position.
+ *
+ * Only used for the full speed scanning without LFSCK consuming the
+ * objects, otherwise the scanning is paced by the otable iterator and
+ * there is nothing to gain. Failure is not fatal, the OI scrub thread
+ * reads the groups by itself then.
+ */
+static void osd_scrub_pf_init(struct osd_device *dev,
+			      struct osd_iit_param *param)
+{
+	struct lustre_scrub *scrub = &dev->od_scrub.os_scrub;
+	struct super_block *sb = osd_sb(dev);
+	struct osd_scrub_prefetch *pf;
+	int nthreads = dev->od_scrub.os_pf_threads;
+	int i;
+
+	if (nthreads <= 0 || !scrub->os_full_speed || dev->od_otable_it ||
+	    param->bg >= LDISKFS_SB(sb)->s_groups_count)
+		return;
+
+	OBD_ALLOC_PTR(pf);
+	if (!pf)
+		return;
+
+	spin_lock_init(&pf->osp_lock);
+	pf->osp_cur_bg = param->bg;
+	pf->osp_next_bg = param->bg;
+	pf->osp_first_bg = param->bg;
+	pf->osp_first_offset = param->offset;
+	pf->osp_groups_count = LDISKFS_SB(sb)->s_groups_count;
+	pf->osp_nthreads = nthreads;
+	pf->osp_active = nthreads;
+	/* let every thread work on one group while other ones are checked */
+	pf->osp_nslots = nthreads * 2;
+	dev->od_scrub.os_prefetch = pf;
+
+	OBD_ALLOC_PTR_ARRAY(pf->osp_slots, pf->osp_nslots);
+	OBD_ALLOC_PTR_ARRAY(pf->osp_tasks, nthreads);
+	if (!pf->osp_slots || !pf->osp_tasks)
+		goto fail;
+
+	for (i = 0; i < pf->osp_nslots; i++) {
+		OBD_ALLOC_PTR_ARRAY_LARGE(pf->osp_slots[i].opg_items,
+					  LDISKFS_INODES_PER_GROUP(sb));
+		if (!pf->osp_slots[i].opg_items)
+			goto fail;
+	}
+
+	for (i = 0; i < nthreads; i++) {
+		struct task_struct *task;
+
+		task = kthread_run(osd_scrub_pf_main, dev, "OI_scrub_pf%02d",
+				   i);
+		if (IS_ERR(task)) {
+			CDEBUG(D_LFSCK, "%s: cannot start OI scrub prefetch "
+			       "thread: rc = %ld\n", osd_name(dev),
+			       PTR_ERR(task));
+			goto fail;
+		}
+		pf->osp_tasks[i] = task;
+	}
+
+	CDEBUG(D_LFSCK, "%s: OI scrub with %d prefetch threads from group %u\n",
+	       osd_name(dev), nthreads, param->bg);
+	return;
+
+fail:
+	osd_scrub_pf_fini(dev);
+}
+
+/**
+ * Wait for the prefetch threads to scan the given group.
+ *
+ * \retval 0		the group is ready
+ * \retval 1		no prefetch thread left, scan the group directly
+ * \retval negative	error of the group scanning
+ */
+static int osd_scrub_pf_wait(struct osd_device *dev,
+			     struct osd_scrub_prefetch *pf, ldiskfs_group_t bg)
+{
+	struct osd_scrub_pf_group *grp = &pf->osp_slots[bg % pf->osp_nslots];
+
+	LASSERT(bg == pf->osp_cur_bg);
+
+	wait_var_event(pf, kthread_should_stop() || pf->osp_active == 0 ||
+			   (grp->opg_ready && grp->opg_bg == bg));
+	if (kthread_should_stop())
+		return SCRUB_NEXT_EXIT;
+
+	if (!grp->opg_ready)
+		return 1;
+
+	return grp->opg_rc;
+}
+
+/* The group is checked completely, the slot can be used for another one. */
+static void osd_scrub_pf_release(struct osd_scrub_prefetch *pf,
+				 ldiskfs_group_t bg)
+{
+	struct osd_scrub_pf_group *grp = &pf->osp_slots[bg % pf->osp_nslots];
+
+	spin_lock(&pf->osp_lock);
+	if (grp->opg_bg == bg)
+		grp->opg_ready = false;
+	pf->osp_cur_bg = bg + 1;
+	spin_unlock(&pf->osp_lock);
+	wake_up_var(pf);
+}
+
+static int osd_scrub_pf_next(struct osd_device *dev,
+			     struct osd_iit_param *param,
+			     struct osd_idmap_cache **oic)
+{
+	struct osd_scrub_prefetch *pf = dev->od_scrub.os_prefetch;
+	struct lustre_scrub *scrub = &dev->od_scrub.os_scrub;
+	struct osd_scrub_pf_group *grp;
+	struct osd_scrub_pf_item *item;
+
+	grp = &pf->osp_slots[param->bg % pf->osp_nslots];
+	LASSERT(grp->opg_ready && grp->opg_bg == param->bg);
+
+	if (grp->opg_idx >= grp->opg_count) {
+		scrub->os_pos_current = 1 + (param->bg + 1) *
+					LDISKFS_INODES_PER_GROUP(param->sb);
+		return SCRUB_NEXT_BREAK;
+	}
+
+	item = &grp->opg_items[grp->opg_idx++];
+	scrub->os_pos_current = item->opi_lid.oii_ino;
+	*oic = &dev->od_scrub.os_oic;
+	(*oic)->oic_fid = item->opi_fid;
+	(*oic)->oic_lid = item->opi_lid;
+
+	return item->opi_rc;
+}
+
 static int osd_scrub_next(struct osd_thread_info *info, struct osd_device *dev,
 			  struct osd_iit_param *param,
 			  struct osd_idmap_cache **oic, const bool noslot)
@@ -826,6 +1147,9 @@ static int osd_scrub_next(struct osd_thread_info *info, struct osd_device *dev,
 	if (noslot)
 		return SCRUB_NEXT_WAIT;
 
+	if (param->bitmap == NULL && dev->od_scrub.os_prefetch)
+		return osd_scrub_pf_next(dev, param, oic);
+
 	rc = osd_iit_next(param, &scrub->os_pos_current);
 	if (rc != 0)
 		return rc;
@@ -1041,6 +1365,7 @@ static int osd_inode_iteration(struct osd_thread_info *info,
 	__u64 *pos;
 	__u64 *count;
 	struct osd_iit_param *param;
+	struct osd_scrub_prefetch *pf = NULL;
 	__u32 limit;
 	int rc;
 	bool noslot = true;
@@ -1150,6 +1475,8 @@ full:
 			(*pos - 1) % LDISKFS_INODES_PER_GROUP(param->sb);
 		param->gbase =
 			1 + param->bg * LDISKFS_INODES_PER_GROUP(param->sb);
+		osd_scrub_pf_init(dev, param);
+		pf = dev->od_scrub.os_prefetch;
 	} else {
 		struct osd_otable_cache *ooc = &dev->od_otable_it->ooi_cache;
 
@@ -1170,11 +1497,38 @@ full:
 		if (!desc)
 			RETURN(-EIO);
 
+		if (pf) {
+			/* the group is read by the prefetch threads,
+			 * even uninitialized one to release its slot */
+			rc = osd_scrub_pf_wait(dev, pf, param->bg);
+			if (rc == SCRUB_NEXT_EXIT)
+				RETURN(0);
+			if (rc < 0) {
+				CERROR("%s: fail to read bitmap for %u, "
+				       "scrub will stop, urgent mode\n",
+				       osd_scrub2name(scrub), (__u32)param->bg);
+				RETURN(rc);
+			}
+			if (rc == 0)
+				goto scan;
+			/* no prefetch thread, read the group directly */
+			rc = 0;
+		}
+
 		if (desc->bg_flags & cpu_to_le16(LDISKFS_BG_INODE_UNINIT)) {
 			next_group = true;
 			goto next_group;
 		}
 
+		if (param->ra_bg <= param->bg + OSD_SCRUB_RA_GROUPS) {
+			/* keep the inode tables of the next groups in flight */
+			if (param->ra_bg < param->bg)
+				param->ra_bg = param->bg;
+			while (param->ra_bg <= param->bg + OSD_SCRUB_RA_GROUPS)
+				osd_scrub_group_readahead(param->sb,
+							  param->ra_bg++);
+		}
+
 		param->bitmap = ldiskfs_read_inode_bitmap(param->sb, param->bg);
 		if (!param->bitmap) {
 			CERROR("%s: fail to read bitmap for %u, "
@@ -1183,10 +1537,11 @@ full:
 			RETURN(-EIO);
 		}
 
+scan:
 		do {
 			struct osd_idmap_cache *oic = NULL;
 
-			if (param->offset +
+			if (param->bitmap && param->offset +
 				ldiskfs_itable_unused_count(param->sb, desc) >=
 			    LDISKFS_INODES_PER_GROUP(param->sb)) {
 				next_group = true;
@@ -1222,6 +1577,8 @@ next_group:
 			GOTO(out, rc);
 
 		if (next_group) {
+			if (pf)
+				osd_scrub_pf_release(pf, param->bg);
 			param->bg++;
 			param->offset = 0;
 			param->gbase = 1 +
@@ -1301,6 +1658,7 @@ static int osd_scrub_main(void *args)
 	       scrub->os_pos_current);
 
 	rc = osd_inode_iteration(osd_oti_get(&env), dev, ~0U, false);
+	osd_scrub_pf_fini(dev);
 	if (unlikely(rc == SCRUB_IT_CRASH)) {
 		spin_lock(&scrub->os_lock);
 		scrub->os_running = 0;
@@ -2600,6 +2958,8 @@ int osd_scrub_setup(const struct lu_env *env, struct osd_device *dev)
 	spin_lock_init(&scrub->os_lock);
 	INIT_LIST_HEAD(&scrub->os_inconsistent_items);
 	scrub->os_name = osd_name(dev);
+	dev->od_scrub.os_pf_threads = min_t(int, OSD_SCRUB_PF_THREADS_DEF,
+					    num_online_cpus());
 
 	push_ctxt(&saved, ctxt);
 	filp = filp_open(osd_scrub_name, O_RDWR |
@@ -46,16 +46,69 @@ struct osd_iit_param {
 	struct super_block *sb;
 	struct buffer_head *bitmap;
 	ldiskfs_group_t bg;
+	/* next group to issue inode table readahead for */
+	ldiskfs_group_t ra_bg;
 	__u32 gbase;
 	__u32 offset;
 	__u32 start;
 };
 
+/* How many groups ahead of the iteration have their inode table read. */
+#define OSD_SCRUB_RA_GROUPS		4
+/* Default and max count of OI scrub prefetch threads. */
+#define OSD_SCRUB_PF_THREADS_DEF	4
+#define OSD_SCRUB_PF_THREADS_MAX	32
+
+/* The in-use inode found by OI scrub prefetch thread. */
+struct osd_scrub_pf_item {
+	struct lu_fid		opi_fid;
+	struct osd_inode_id	opi_lid;
+	int			opi_rc;
+};
+
+/* The block group scanned by OI scrub prefetch thread. */
+struct osd_scrub_pf_group {
+	struct osd_scrub_pf_item	*opg_items;
+	ldiskfs_group_t			 opg_bg;
+	__u32				 opg_count;
+	/* the next item to be checked by the OI scrub thread */
+	__u32				 opg_idx;
+	int				 opg_rc;
+	bool				 opg_ready;
+};
+
+/*
+ * Prefetch threads read the inode tables of the block groups ahead of the
+ * OI scrub thread and get the FIDs of the in-use inodes. The OI scrub thread
+ * still checks the OI mappings in the inode number order, so the position
+ * and the checkpoint are the same as for single threaded scanning.
+ */
+struct osd_scrub_prefetch {
+	spinlock_t			 osp_lock;
+	/* the group being checked by the OI scrub thread */
+	ldiskfs_group_t			 osp_cur_bg;
+	/* the next group to be taken by a prefetch thread */
+	ldiskfs_group_t			 osp_next_bg;
+	ldiskfs_group_t			 osp_first_bg;
+	ldiskfs_group_t			 osp_groups_count;
+	/* the offset to start with in the first group */
+	__u32				 osp_first_offset;
+	int				 osp_nslots;
+	int				 osp_nthreads;
+	/* the prefetch threads able to scan groups */
+	int				 osp_active;
+	struct osd_scrub_pf_group	*osp_slots;
+	struct task_struct		**osp_tasks;
+};
+
 struct osd_scrub {
 	struct lustre_scrub	os_scrub;
 	struct lvfs_run_ctxt    os_ctxt;
 	struct osd_idmap_cache  os_oic;
 	struct osd_iit_param	os_iit_param;
+	struct osd_scrub_prefetch *os_prefetch;
+	/* count of the prefetch threads for full speed OI scrub */
+	int			os_pf_threads;
 
 	/* statistics for /lost+found are in ram only, it will be reset
 	 * when each time the device remount. */
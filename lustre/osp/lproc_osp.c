@@ -296,6 +296,96 @@ static ssize_t max_rpcs_in_progress_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(max_rpcs_in_progress);
 
+/**
+ * Show maximum number of setattr changes sent with one OST_SETATTR_BATCH
+ */
+static ssize_t sync_batch_max_show(struct kobject *kobj,
+				   struct attribute *attr,
+				   char *buf)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct osp_device *osp = dt2osp_dev(dt);
+
+	return sprintf(buf, "%d\n", osp->opd_sync_batch_max);
+}
+
+/**
+ * Change maximum number of setattr changes sent with one OST_SETATTR_BATCH,
+ * 0 or 1 disables batching
+ */
+static ssize_t sync_batch_max_store(struct kobject *kobj,
+				    struct attribute *attr,
+				    const char *buffer,
+				    size_t count)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct osp_device *osp = dt2osp_dev(dt);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val > OST_SETATTR_BATCH_MAX)
+		return -ERANGE;
+
+	osp->opd_sync_batch_max = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(sync_batch_max);
+
+/**
+ * Show number of OST_SETATTR_BATCH RPCs sent
+ */
+static ssize_t sync_batch_rpcs_show(struct kobject *kobj,
+				    struct attribute *attr,
+				    char *buf)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct osp_device *osp = dt2osp_dev(dt);
+
+	return sprintf(buf, "%lld\n",
+		       (s64)atomic64_read(&osp->opd_sync_batch_rpcs));
+}
+LUSTRE_RO_ATTR(sync_batch_rpcs);
+
+/**
+ * Show number of setattr changes sent with OST_SETATTR_BATCH
+ */
+static ssize_t sync_batch_recs_show(struct kobject *kobj,
+				    struct attribute *attr,
+				    char *buf)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct osp_device *osp = dt2osp_dev(dt);
+
+	return sprintf(buf, "%lld\n",
+		       (s64)atomic64_read(&osp->opd_sync_batch_recs));
+}
+LUSTRE_RO_ATTR(sync_batch_recs);
+
+/**
+ * Show number of llog records processed by the sync thread
+ */
+static ssize_t sync_processed_show(struct kobject *kobj,
+				   struct attribute *attr,
+				   char *buf)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct osp_device *osp = dt2osp_dev(dt);
+
+	return sprintf(buf, "%lld\n",
+		       (s64)atomic64_read(&osp->opd_sync_processed_recs));
+}
+LUSTRE_RO_ATTR(sync_processed);
+
 /**
  * Show number of objects to precreate next time
  *
@@ -1006,6 +1096,10 @@ static struct attribute *osp_obd_attrs[] = {
 	&lustre_attr_sync_in_flight.attr,
 	&lustre_attr_sync_in_progress.attr,
 	&lustre_attr_sync_changes.attr,
+	&lustre_attr_sync_processed.attr,
+	&lustre_attr_sync_batch_max.attr,
+	&lustre_attr_sync_batch_rpcs.attr,
+	&lustre_attr_sync_batch_recs.attr,
 	&lustre_attr_force_sync.attr,
 	&lustre_attr_old_sync_processed.attr,
 	&lustre_attr_create_count.attr,
@@ -86,6 +86,13 @@ struct osp_precreate {
 	int				 osp_pre_create_slow;
 	/* cleaning up orphans or recreating missing objects */
 	int				 osp_pre_recovering;
+	/* objects consumed since osp_pre_rate_start */
+	__u64				 osp_pre_used_count;
+	ktime_t				 osp_pre_rate_start;
+	/* smoothed object consumption rate, objects per second */
+	__u64				 osp_pre_rate;
+	/* smoothed duration of OST_CREATE RPCs, in microseconds */
+	__u64				 osp_pre_rpc_time;
 };
 
 struct osp_update_request_sub {
@@ -240,6 +247,13 @@ struct osp_device {
 	int                              opd_sync_last_catalog_idx;
 	/* number of processed records */
 	atomic64_t			 opd_sync_processed_recs;
+	/* OST_SETATTR_BATCH being filled by the sync thread */
+	struct ptlrpc_request		*opd_sync_batch_req;
+	/* max records per OST_SETATTR_BATCH, 0 or 1 disables batching */
+	int				 opd_sync_batch_max;
+	/* number of OST_SETATTR_BATCH RPCs and records sent */
+	atomic64_t			 opd_sync_batch_rpcs;
+	atomic64_t			 opd_sync_batch_recs;
 	/* stop processing new requests until barrier=0 */
 	atomic_t			 opd_sync_barrier;
 	wait_queue_head_t		 opd_sync_barrier_waitq;
@@ -288,6 +302,10 @@ struct osp_device {
 #define opd_pre_max_create_count	opd_pre->osp_pre_max_create_count
 #define opd_pre_create_slow		opd_pre->osp_pre_create_slow
 #define opd_pre_recovering		opd_pre->osp_pre_recovering
+#define opd_pre_used_count		opd_pre->osp_pre_used_count
+#define opd_pre_rate_start		opd_pre->osp_pre_rate_start
+#define opd_pre_rate			opd_pre->osp_pre_rate
+#define opd_pre_rpc_time		opd_pre->osp_pre_rpc_time
 
 extern struct kmem_cache *osp_object_kmem;
 
@@ -589,6 +589,53 @@ static int osp_precreate_fids(const struct lu_env *env, struct osp_device *osp,
 	return *grow > 0 ? 0 : 1;
 }
 
+/* minimal interval to sample the object consumption rate over */
+#define OSP_PRE_RATE_INTERVAL	(USEC_PER_SEC / 10)
+
+/**
+ * Adapt the precreate window to the observed object consumption rate.
+ *
+ * Sample the number of objects handed out by osp_precreate_get_fid() since
+ * the previous sample and fold it into a smoothed rate. The next
+ * OST_CREATE must cover what is consumed during two RPC round trips (the
+ * one in flight and the next one), so that the pool does not run dry
+ * during bursts. The window only grows here; it is shrunk by
+ * osp_precreate_send() when the OST cannot keep up.
+ *
+ * The caller must hold osp_device::opd_pre_lock.
+ *
+ * \param[in] d		OSP device
+ */
+static void osp_precreate_adapt_count(struct osp_device *d)
+{
+	ktime_t now = ktime_get();
+	s64 elapsed = ktime_us_delta(now, d->opd_pre_rate_start);
+	__u64 rate;
+	__u64 want;
+
+	if (elapsed >= OSP_PRE_RATE_INTERVAL) {
+		rate = div64_u64(d->opd_pre_used_count * USEC_PER_SEC,
+				 elapsed);
+		d->opd_pre_rate = (d->opd_pre_rate * 3 + rate) / 4;
+		d->opd_pre_used_count = 0;
+		d->opd_pre_rate_start = now;
+	}
+
+	if (d->opd_pre_create_slow || d->opd_pre_rpc_time == 0)
+		return;
+
+	want = div64_u64(d->opd_pre_rate * d->opd_pre_rpc_time * 2,
+			 USEC_PER_SEC);
+	want = min_t(__u64, want, d->opd_pre_max_create_count / 2);
+	if (want > d->opd_pre_create_count) {
+		CDEBUG(D_HA, "%s: grow precreate window %d -> %llu, rate %llu/s"
+		       " rpc %lluus\n", d->opd_obd->obd_name,
+		       d->opd_pre_create_count, want, d->opd_pre_rate,
+		       d->opd_pre_rpc_time);
+		d->opd_pre_create_count = want;
+	}
+}
+
 /**
  * Prepare and send precreate RPC
  *
@@ -612,6 +659,8 @@ static int osp_precreate_send(const struct lu_env *env, struct osp_device *d)
 	struct ost_body		*body;
 	int			 rc, grow, diff;
 	struct lu_fid		*fid = &oti->osi_fid;
+	ktime_t			 start;
+	s64			 rpc_time = 0;
 	ENTRY;
 
 	/* don't precreate new objects till OST healthy and has free space */
@@ -642,6 +691,7 @@ static int osp_precreate_send(const struct lu_env *env, struct osp_device *d)
 	}
 
 	spin_lock(&d->opd_pre_lock);
+	osp_precreate_adapt_count(d);
 	if (d->opd_pre_create_count > d->opd_pre_max_create_count / 2)
 		d->opd_pre_create_count = d->opd_pre_max_create_count / 2;
 	grow = d->opd_pre_create_count;
@@ -671,12 +721,14 @@ static int osp_precreate_send(const struct lu_env *env, struct osp_device *d)
 	if (OBD_FAIL_CHECK(OBD_FAIL_OSP_FAKE_PRECREATE))
 		GOTO(ready, rc = 0);
 
+	start = ktime_get();
 	rc = ptlrpc_queue_wait(req);
 	if (rc) {
 		CERROR("%s: can't precreate: rc = %d\n", d->opd_obd->obd_name,
 		       rc);
 		GOTO(out_req, rc);
 	}
+	rpc_time = ktime_us_delta(ktime_get(), start);
 	LASSERT(req->rq_transno == 0);
 
 	body = req_capsule_server_get(&req->rq_pill, &RMF_OST_BODY);
@@ -696,6 +748,9 @@ ready:
 	diff = osp_fid_diff(fid, &d->opd_pre_last_created_fid);
 
 	spin_lock(&d->opd_pre_lock);
+	if (rpc_time > 0)
+		d->opd_pre_rpc_time = d->opd_pre_rpc_time ?
+			(d->opd_pre_rpc_time * 3 + rpc_time) / 4 : rpc_time;
 	if (diff < grow) {
 		/* the OST has not managed to create all the
 		 * objects we asked for */
@@ -1564,6 +1619,7 @@ int osp_precreate_get_fid(const struct lu_env *env, struct osp_device *d,
 	d->opd_pre_used_fid.f_oid++;
 	memcpy(fid, &d->opd_pre_used_fid, sizeof(*fid));
 	d->opd_pre_reserved--;
+	d->opd_pre_used_count++;
 	/*
 	 * last_used_id must be changed along with getting new id otherwise
 	 * we might miscalculate gap causing object loss or leak
@@ -1718,6 +1774,7 @@ int osp_init_precreate(struct osp_device *d)
 	d->opd_pre_create_count = OST_MIN_PRECREATE;
 	d->opd_pre_min_create_count = OST_MIN_PRECREATE;
 	d->opd_pre_max_create_count = OST_MAX_PRECREATE;
+	d->opd_pre_rate_start = ktime_get();
 	d->opd_reserved_mb_high = 0;
 	d->opd_reserved_mb_low = 0;
 
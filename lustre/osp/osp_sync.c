@@ -94,8 +94,44 @@ struct osp_job_req_args {
 	struct list_head		jra_in_flight_link;
 	struct llog_cookie		jra_lcookie;
 	__u32				jra_magic;
+	/** cookies of the records carried by OST_SETATTR_BATCH */
+	struct llog_cookie		*jra_batch_cookies;
+	int				jra_batch_count;
+	int				jra_batch_max;
 };
 
+static inline bool osp_sync_req_is_batch(struct ptlrpc_request *req)
+{
+	return lustre_msg_get_opc(req->rq_reqmsg) == OST_SETATTR_BATCH;
+}
+
+static inline bool osp_sync_batch_enabled(struct osp_device *d)
+{
+	return d->opd_sync_batch_max > 1 && d->opd_exp != NULL &&
+	       exp_connect_flags2(d->opd_exp) & OBD_CONNECT2_SETATTR_BATCH;
+}
+
+/**
+ * Check whether a llog record can be added to the OST_SETATTR_BATCH RPC
+ * being filled. Changes of the layout version are sent individually, they
+ * are urgent for FLR and can't wait for the batch to fill.
+ */
+static inline bool osp_sync_batch_joinable(struct osp_device *d,
+					   struct llog_rec_hdr *h)
+{
+	return h->lrh_type == MDS_SETATTR64_REC &&
+	       !(((struct llog_setattr64_rec *)h)->lsr_valid &
+		 OBD_MD_LAYOUT_VERSION);
+}
+
+static void osp_sync_batch_fini(struct osp_job_req_args *jra)
+{
+	if (jra->jra_batch_cookies != NULL) {
+		OBD_FREE_PTR_ARRAY(jra->jra_batch_cookies, jra->jra_batch_max);
+		jra->jra_batch_cookies = NULL;
+	}
+}
+
 static int osp_sync_add_commit_cb(const struct lu_env *env,
 				  struct osp_device *d, struct thandle *th);
 
@@ -158,6 +194,25 @@ static inline int osp_sync_in_flight_conflict(struct osp_device *d,
 
 		req = container_of((void *)jra, struct ptlrpc_request,
 				   rq_async_args);
+		if (osp_sync_req_is_batch(req)) {
+			struct ost_setattr_rec *recs;
+			int i;
+
+			recs = req_capsule_client_get(&req->rq_pill,
+						      &RMF_OST_SETATTR_BATCH);
+			LASSERT(recs);
+			for (i = 0; i < jra->jra_batch_count; i++) {
+				if (memcmp(&ostid, &recs[i].osr_oi,
+					   sizeof(ostid)) == 0) {
+					conflict = 1;
+					break;
+				}
+			}
+			if (conflict)
+				break;
+			continue;
+		}
+
 		body = req_capsule_client_get(&req->rq_pill,
 					      &RMF_OST_BODY);
 		LASSERT(body);
@@ -554,10 +609,12 @@ static int osp_sync_interpret(const struct lu_env *env,
 	       atomic_read(&req->rq_refcount),
 	       rc, (unsigned) req->rq_transno);
 
-	if (rc == -ENOENT) {
+	if (rc == -ENOENT ||
+	    (rc == 0 && req->rq_transno == 0 && osp_sync_req_is_batch(req))) {
 		/*
 		 * we tried to destroy object or update attributes,
-		 * but object doesn't exist anymore - cancell llog record
+		 * but object doesn't exist anymore - cancell llog record.
+		 * the same for a batch which changed no object at all
 		 */
 		LASSERT(req->rq_transno == 0);
 		LASSERT(list_empty(&jra->jra_committed_link));
@@ -586,6 +643,7 @@ static int osp_sync_interpret(const struct lu_env *env,
 			 * will be called at some point */
 			LASSERT(atomic_read(&d->opd_sync_rpcs_in_progress) > 0);
 			atomic_dec(&d->opd_sync_rpcs_in_progress);
+			osp_sync_batch_fini(jra);
 		}
 
 		wake_up(&d->opd_sync_waitq);
@@ -615,20 +673,21 @@ static int osp_sync_interpret(const struct lu_env *env,
 	return 0;
 }
 
-/*
- ** Add request to ptlrpc queue.
+/**
+ * Put request on the in-flight list.
  *
- * This is just a tiny helper function to put the request on the sending list
+ * The request is accounted in flight since this point, even if it is sent
+ * later as OST_SETATTR_BATCH, so that conflicting changes wait for it.
  *
  * \param[in] d		OSP device
  * \param[in] llh	llog handle where the record is stored
  * \param[in] h		llog record
  * \param[in] req	request
  */
-static void osp_sync_send_new_rpc(struct osp_device *d,
-				  struct llog_handle *llh,
-				  struct llog_rec_hdr *h,
-				  struct ptlrpc_request *req)
+static void osp_sync_track_new_rpc(struct osp_device *d,
+				   struct llog_handle *llh,
+				   struct llog_rec_hdr *h,
+				   struct ptlrpc_request *req)
 {
 	struct osp_job_req_args *jra;
 
@@ -640,11 +699,31 @@ static void osp_sync_send_new_rpc(struct osp_device *d,
 	jra->jra_lcookie.lgc_lgl = llh->lgh_id;
 	jra->jra_lcookie.lgc_subsys = LLOG_MDS_OST_ORIG_CTXT;
 	jra->jra_lcookie.lgc_index = h->lrh_index;
+	jra->jra_batch_cookies = NULL;
+	jra->jra_batch_count = 0;
+	jra->jra_batch_max = 0;
 	INIT_LIST_HEAD(&jra->jra_committed_link);
 	spin_lock(&d->opd_sync_lock);
 	list_add_tail(&jra->jra_in_flight_link, &d->opd_sync_in_flight_list);
 	spin_unlock(&d->opd_sync_lock);
+}
 
+/*
+ ** Add request to ptlrpc queue.
+ *
+ * This is just a tiny helper function to put the request on the sending list
+ *
+ * \param[in] d		OSP device
+ * \param[in] llh	llog handle where the record is stored
+ * \param[in] h		llog record
+ * \param[in] req	request
+ */
+static void osp_sync_send_new_rpc(struct osp_device *d,
+				  struct llog_handle *llh,
+				  struct llog_rec_hdr *h,
+				  struct ptlrpc_request *req)
+{
+	osp_sync_track_new_rpc(d, llh, h, req);
 	ptlrpcd_add_req(req);
 }
 
@@ -683,6 +762,14 @@ static struct ptlrpc_request *osp_sync_new_job(struct osp_device *d,
 	if (req == NULL)
 		RETURN(ERR_PTR(-ENOMEM));
 
+	/* room for the whole batch, shrunk to the actual size on send */
+	if (format == &RQF_OST_SETATTR_BATCH)
+		req_capsule_set_size(&req->rq_pill, &RMF_OST_SETATTR_BATCH,
+				     RCL_CLIENT,
+				     clamp(d->opd_sync_batch_max, 1,
+					   OST_SETATTR_BATCH_MAX) *
+				     sizeof(struct ost_setattr_rec));
+
 	rc = ptlrpc_request_pack(req, LUSTRE_OST_VERSION, op);
 	if (rc) {
 		ptlrpc_req_finished(req);
@@ -698,11 +785,126 @@ static struct ptlrpc_request *osp_sync_new_job(struct osp_device *d,
 	return req;
 }
 
+/**
+ * Send the OST_SETATTR_BATCH RPC being filled.
+ *
+ * The request buffer is shrunk to the records actually added and the
+ * reply is sized to return a result for each of them.
+ *
+ * \param[in] d		OSP device
+ */
+static void osp_sync_batch_flush(struct osp_device *d)
+{
+	struct ptlrpc_request	*req = d->opd_sync_batch_req;
+	struct osp_job_req_args	*jra;
+	__u32			 size;
+
+	if (req == NULL)
+		return;
+
+	d->opd_sync_batch_req = NULL;
+	jra = ptlrpc_req_async_args(jra, req);
+	LASSERT(jra->jra_batch_count > 0);
+
+	size = jra->jra_batch_count * sizeof(struct ost_setattr_rec);
+	req_capsule_shrink(&req->rq_pill, &RMF_OST_SETATTR_BATCH, size,
+			   RCL_CLIENT);
+	req_capsule_set_size(&req->rq_pill, &RMF_OST_SETATTR_BATCH,
+			     RCL_SERVER, size);
+	ptlrpc_request_set_replen(req);
+
+	atomic64_inc(&d->opd_sync_batch_rpcs);
+	atomic64_add(jra->jra_batch_count, &d->opd_sync_batch_recs);
+	CDEBUG(D_OTHER, "%s: send setattr batch of %d\n",
+	       d->opd_obd->obd_name, jra->jra_batch_count);
+
+	ptlrpcd_add_req(req);
+}
+
+/**
+ * Add setattr change to OST_SETATTR_BATCH.
+ *
+ * The change is added to the batch RPC being filled, a new one is started
+ * if there is none. The batch is accounted as a single RPC in flight and it
+ * is sent once full or once the sync thread is going to wait for new
+ * changes, see osp_sync_process_queues().
+ *
+ * \param[in] d		OSP device
+ * \param[in] llh	llog handle where the record is stored
+ * \param[in] h		llog record
+ *
+ * \retval 0		on success
+ * \retval negative	negated errno on error
+ */
+static int osp_sync_add_setattr_batch(struct osp_device *d,
+				      struct llog_handle *llh,
+				      struct llog_rec_hdr *h)
+{
+	struct llog_setattr64_rec	*rec = (struct llog_setattr64_rec *)h;
+	struct ptlrpc_request		*req = d->opd_sync_batch_req;
+	struct osp_job_req_args		*jra;
+	struct ost_setattr_rec		*osr;
+	struct llog_cookie		*cookie;
+
+	ENTRY;
+
+	if (req == NULL) {
+		req = osp_sync_new_job(d, OST_SETATTR_BATCH,
+				       &RQF_OST_SETATTR_BATCH);
+		if (IS_ERR(req))
+			RETURN(PTR_ERR(req));
+
+		osp_sync_track_new_rpc(d, llh, h, req);
+		jra = ptlrpc_req_async_args(jra, req);
+		jra->jra_batch_max = req_capsule_get_size(&req->rq_pill,
+							  &RMF_OST_SETATTR_BATCH,
+							  RCL_CLIENT) /
+				     sizeof(struct ost_setattr_rec);
+		OBD_ALLOC_PTR_ARRAY(jra->jra_batch_cookies,
+				    jra->jra_batch_max);
+		if (jra->jra_batch_cookies == NULL) {
+			spin_lock(&d->opd_sync_lock);
+			list_del_init(&jra->jra_in_flight_link);
+			spin_unlock(&d->opd_sync_lock);
+			ptlrpc_req_finished(req);
+			RETURN(-ENOMEM);
+		}
+		d->opd_sync_batch_req = req;
+	}
+
+	jra = ptlrpc_req_async_args(jra, req);
+	LASSERT(jra->jra_batch_count < jra->jra_batch_max);
+
+	osr = req_capsule_client_get(&req->rq_pill, &RMF_OST_SETATTR_BATCH);
+	LASSERT(osr);
+	osr += jra->jra_batch_count;
+	memset(osr, 0, sizeof(*osr));
+	osr->osr_oi = rec->lsr_oi;
+	osr->osr_uid = rec->lsr_uid;
+	osr->osr_gid = rec->lsr_gid;
+	if (h->lrh_len > sizeof(struct llog_setattr64_rec))
+		osr->osr_projid =
+			((struct llog_setattr64_rec_v2 *)rec)->lsr_projid;
+	/* see osp_sync_new_setattr_job() for records without 'valid' */
+	osr->osr_valid = rec->lsr_valid ?: (OBD_MD_FLUID | OBD_MD_FLGID);
+
+	cookie = &jra->jra_batch_cookies[jra->jra_batch_count];
+	cookie->lgc_lgl = llh->lgh_id;
+	cookie->lgc_subsys = LLOG_MDS_OST_ORIG_CTXT;
+	cookie->lgc_index = h->lrh_index;
+
+	if (++jra->jra_batch_count == jra->jra_batch_max)
+		osp_sync_batch_flush(d);
+
+	RETURN(0);
+}
+
 /**
  * Generate a request for setattr change.
  *
  * The function prepares a new RPC, initializes it with setattr specific
- * bits and send the RPC.
+ * bits and send the RPC. Ownership changes are batched into
+ * OST_SETATTR_BATCH if the OST supports it.
  *
  * \param[in] d		OSP device
  * \param[in] llh	llog handle where the record is stored
@@ -736,6 +938,10 @@ static int osp_sync_new_setattr_job(struct osp_device *d,
 		RETURN(1);
 	}
 
+	if (osp_sync_batch_joinable(d, h) &&
+	    (d->opd_sync_batch_req != NULL || osp_sync_batch_enabled(d)))
+		RETURN(osp_sync_add_setattr_batch(d, llh, h));
+
 	req = osp_sync_new_job(d, OST_SETATTR, &RQF_OST_SETATTR);
 	if (IS_ERR(req))
 		RETURN(PTR_ERR(req));
@@ -884,6 +1090,7 @@ static void osp_sync_process_record(const struct lu_env *env,
 {
 	struct llog_handle	*cathandle = llh->u.phd.phd_cat_handle;
 	struct llog_cookie	 cookie;
+	bool			 batched;
 	int			 rc = 0;
 
 	ENTRY;
@@ -920,9 +1127,14 @@ static void osp_sync_process_record(const struct lu_env *env,
 	 */
 
 	/* notice we increment counters before sending RPC, to be consistent
-	 * in RPC interpret callback which may happen very quickly */
-	atomic_inc(&d->opd_sync_rpcs_in_flight);
-	atomic_inc(&d->opd_sync_rpcs_in_progress);
+	 * in RPC interpret callback which may happen very quickly.
+	 * a change joining the batch being filled is accounted with it */
+	batched = osp_sync_batch_joinable(d, rec) &&
+		  d->opd_sync_batch_req != NULL;
+	if (!batched) {
+		atomic_inc(&d->opd_sync_rpcs_in_flight);
+		atomic_inc(&d->opd_sync_rpcs_in_progress);
+	}
 
 	switch (rec->lrh_type) {
 	/* case MDS_UNLINK_REC is kept for compatibility */
@@ -952,7 +1164,7 @@ static void osp_sync_process_record(const struct lu_env *env,
 		wake_up(&d->opd_sync_barrier_waitq);
 	}
 	atomic64_inc(&d->opd_sync_processed_recs);
-	if (rc != 0) {
+	if (rc != 0 && !batched) {
 		atomic_dec(&d->opd_sync_rpcs_in_flight);
 		atomic_dec(&d->opd_sync_rpcs_in_progress);
 	}
@@ -978,6 +1190,34 @@ static void osp_sync_process_record(const struct lu_env *env,
 	RETURN_EXIT;
 }
 
+/**
+ * Cancel llog record, possibly postponing it to massive cancel.
+ *
+ * Records of the same plain llog as the first one are collected in \a arr
+ * to be cancelled at once, the others are cancelled right away.
+ */
+static void osp_sync_cancel_cookie(const struct lu_env *env,
+				   struct osp_device *d,
+				   struct llog_handle *llh,
+				   struct llog_cookie *cookie,
+				   int *arr, int *i, struct llog_logid *lgid)
+{
+	int rc;
+
+	if (arr && (!*i ||
+		    !memcmp(&cookie->lgc_lgl, lgid, sizeof(*lgid)))) {
+		if (unlikely(!*i))
+			*lgid = cookie->lgc_lgl;
+
+		arr[(*i)++] = cookie->lgc_index;
+	} else {
+		rc = llog_cat_cancel_records(env, llh, 1, cookie);
+		if (rc)
+			CERROR("%s: can't cancel record: %d\n",
+			       d->opd_obd->obd_name, rc);
+	}
+}
+
 /**
  * Cancel llog records for the committed changes.
  *
@@ -1001,6 +1241,7 @@ static void osp_sync_process_committed(const struct lu_env *env,
 	LIST_HEAD(list);
 	struct list_head	 *le;
 	struct llog_logid	 lgid;
+	struct osp_job_req_args	*jra;
 	int			 rc, i, count = 0, done = 0;
 
 	ENTRY;
@@ -1035,16 +1276,17 @@ static void osp_sync_process_committed(const struct lu_env *env,
 	INIT_LIST_HEAD(&d->opd_sync_committed_there);
 	spin_unlock(&d->opd_sync_lock);
 
-	list_for_each(le, &list)
-		count++;
+	list_for_each(le, &list) {
+		jra = list_entry(le, struct osp_job_req_args,
+				 jra_committed_link);
+		count += jra->jra_batch_cookies ? jra->jra_batch_count : 1;
+	}
 	if (count > 2)
 		OBD_ALLOC_PTR_ARRAY_LARGE(arr, count);
 	else
 		arr = NULL;
 	i = 0;
 	while (!list_empty(&list)) {
-		struct osp_job_req_args	*jra;
-
 		jra = list_entry(list.next, struct osp_job_req_args,
 				 jra_committed_link);
 		LASSERT(jra->jra_magic == OSP_JOB_MAGIC);
@@ -1052,26 +1294,42 @@ static void osp_sync_process_committed(const struct lu_env *env,
 
 		req = container_of((void *)jra, struct ptlrpc_request,
 				   rq_async_args);
+		if (osp_sync_req_is_batch(req)) {
+			struct ost_setattr_rec	*reps = NULL;
+			int			 j;
+
+			/* the records of objects failed to change are kept
+			 * to be tried again after reboot, as usual */
+			if (req->rq_import_generation == imp->imp_generation &&
+			    req_capsule_get_size(&req->rq_pill,
+						 &RMF_OST_SETATTR_BATCH,
+						 RCL_SERVER) ==
+			    jra->jra_batch_count * sizeof(*reps))
+				reps = req_capsule_server_get(&req->rq_pill,
+							&RMF_OST_SETATTR_BATCH);
+			for (j = 0; reps != NULL &&
+				    j < jra->jra_batch_count; j++) {
+				if (reps[j].osr_rc != 0 &&
+				    reps[j].osr_rc != -ENOENT)
+					continue;
+				osp_sync_cancel_cookie(env, d, llh,
+						&jra->jra_batch_cookies[j],
+						arr, &i, &lgid);
+			}
+			osp_sync_batch_fini(jra);
+			ptlrpc_req_finished(req);
+			done++;
+			continue;
+		}
+
 		body = req_capsule_client_get(&req->rq_pill,
 					      &RMF_OST_BODY);
 		LASSERT(body);
 		/* import can be closing, thus all commit cb's are
 		 * called we can check committness directly */
 		if (req->rq_import_generation == imp->imp_generation) {
-			if (arr && (!i ||
-				    !memcmp(&jra->jra_lcookie.lgc_lgl, &lgid,
-					   sizeof(lgid)))) {
-				if (unlikely(!i))
-					lgid = jra->jra_lcookie.lgc_lgl;
-
-				arr[i++] = jra->jra_lcookie.lgc_index;
-			} else {
-				rc = llog_cat_cancel_records(env, llh, 1,
-							     &jra->jra_lcookie);
-				if (rc)
-					CERROR("%s: can't cancel record: %d\n",
-					       obd->obd_name, rc);
-			}
+			osp_sync_cancel_cookie(env, d, llh, &jra->jra_lcookie,
+					       arr, &i, &lgid);
 		} else {
 			DEBUG_REQ(D_OTHER, req, "imp_committed = %llu",
 				  imp->imp_peer_committed_transno);
@@ -1163,6 +1421,11 @@ static int osp_sync_process_queues(const struct lu_env *env,
 			    cfs_fail_val != 1)
 			msleep(1 * MSEC_PER_SEC);
 
+		/* nothing more can be added to the batch before waiting */
+		if (d->opd_sync_batch_req != NULL &&
+		    !osp_sync_can_process_new(d, rec))
+			osp_sync_batch_flush(d);
+
 		wait_event_idle(d->opd_sync_waitq,
 				!d->opd_sync_task ||
 				osp_sync_can_process_new(d, rec) ||
@@ -1258,6 +1521,9 @@ next:
 	} while (rc == 0 && (wrapped ||
 			     d->opd_sync_last_catalog_idx == LLOG_CAT_FIRST));
 
+	/* send the changes batched so far, they are in progress already */
+	osp_sync_batch_flush(d);
+
 	if (rc < 0) {
 		if (rc == -EINPROGRESS) {
 			/* can't access the llog now - OI scrub is trying to fix
@@ -1508,6 +1774,7 @@ int osp_sync_init(const struct lu_env *env, struct osp_device *d)
 	ENTRY;
 
 	d->opd_sync_max_rpcs_in_flight = OSP_MAX_RPCS_IN_FLIGHT;
+	d->opd_sync_batch_max = OST_SETATTR_BATCH_MAX;
 	d->opd_sync_max_rpcs_in_progress = OSP_MAX_RPCS_IN_PROGRESS;
 	spin_lock_init(&d->opd_sync_lock);
 	init_waitqueue_head(&d->opd_sync_waitq);
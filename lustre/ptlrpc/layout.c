@@ -109,6 +109,11 @@ static const struct req_msg_field *quota_body_only[] = {
 	&RMF_QUOTA_BODY
 };
 
+static const struct req_msg_field *quota_batch_only[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_QUOTA_BATCH
+};
+
 static const struct req_msg_field *ldlm_intent_quota_client[] = {
 	&RMF_PTLRPC_BODY,
 	&RMF_DLM_REQ,
@@ -639,6 +644,11 @@ static const struct req_msg_field *ost_body_capa[] = {
         &RMF_CAPA1
 };
 
+static const struct req_msg_field *ost_setattr_batch_only[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_OST_SETATTR_BATCH
+};
+
 static const struct req_msg_field *ost_destroy_client[] = {
         &RMF_PTLRPC_BODY,
         &RMF_OST_BODY,
@@ -825,6 +835,7 @@ static struct req_format *req_formats[] = {
 	&RQF_OST_CREATE,
 	&RQF_OST_PUNCH,
 	&RQF_OST_FALLOCATE,
+	&RQF_OST_SETATTR_BATCH,
 	&RQF_OST_SYNC,
 	&RQF_OST_DESTROY,
 	&RQF_OST_BRW_READ,
@@ -855,6 +866,7 @@ static struct req_format *req_formats[] = {
 	&RQF_LDLM_INTENT_GETXATTR,
 	&RQF_LDLM_INTENT_QUOTA,
 	&RQF_QUOTA_DQACQ,
+	&RQF_QUOTA_DQACQ_BATCH,
 	&RQF_LLOG_ORIGIN_HANDLE_CREATE,
 	&RQF_LLOG_ORIGIN_HANDLE_NEXT_BLOCK,
 	&RQF_LLOG_ORIGIN_HANDLE_PREV_BLOCK,
@@ -1014,6 +1026,11 @@ struct req_msg_field RMF_QUOTA_BODY =
 		    sizeof(struct quota_body), lustre_swab_quota_body, NULL);
 EXPORT_SYMBOL(RMF_QUOTA_BODY);
 
+struct req_msg_field RMF_QUOTA_BATCH =
+	DEFINE_MSGF("quota_batch", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct quota_body), lustre_swab_quota_body, NULL);
+EXPORT_SYMBOL(RMF_QUOTA_BATCH);
+
 struct req_msg_field RMF_MDT_EPOCH =
         DEFINE_MSGF("mdt_ioepoch", 0,
                     sizeof(struct mdt_ioepoch), lustre_swab_mdt_ioepoch, NULL);
@@ -1191,6 +1208,12 @@ struct req_msg_field RMF_OST_BODY =
 		    dump_ost_body);
 EXPORT_SYMBOL(RMF_OST_BODY);
 
+struct req_msg_field RMF_OST_SETATTR_BATCH =
+	DEFINE_MSGF("ost_setattr_batch", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct ost_setattr_rec),
+		    lustre_swab_ost_setattr_rec, NULL);
+EXPORT_SYMBOL(RMF_OST_SETATTR_BATCH);
+
 struct req_msg_field RMF_OBD_IOOBJ =
         DEFINE_MSGF("obd_ioobj", RMF_F_STRUCT_ARRAY,
                     sizeof(struct obd_ioobj), lustre_swab_obd_ioobj, dump_ioo);
@@ -1438,6 +1461,11 @@ struct req_format RQF_QUOTA_DQACQ =
 	DEFINE_REQ_FMT0("QUOTA_DQACQ", quota_body_only, quota_body_only);
 EXPORT_SYMBOL(RQF_QUOTA_DQACQ);
 
+struct req_format RQF_QUOTA_DQACQ_BATCH =
+	DEFINE_REQ_FMT0("QUOTA_DQACQ_BATCH", quota_batch_only,
+			quota_batch_only);
+EXPORT_SYMBOL(RQF_QUOTA_DQACQ_BATCH);
+
 struct req_format RQF_LDLM_INTENT_QUOTA =
 	DEFINE_REQ_FMT0("LDLM_INTENT_QUOTA",
 			ldlm_intent_quota_client,
@@ -1740,6 +1768,11 @@ struct req_format RQF_OST_FALLOCATE =
 	DEFINE_REQ_FMT0("OST_FALLOCATE", ost_body_capa, ost_body_only);
 EXPORT_SYMBOL(RQF_OST_FALLOCATE);
 
+struct req_format RQF_OST_SETATTR_BATCH =
+	DEFINE_REQ_FMT0("OST_SETATTR_BATCH", ost_setattr_batch_only,
+			ost_setattr_batch_only);
+EXPORT_SYMBOL(RQF_OST_SETATTR_BATCH);
+
 struct req_format RQF_OST_SYNC =
         DEFINE_REQ_FMT0("OST_SYNC", ost_body_capa, ost_body_only);
 EXPORT_SYMBOL(RQF_OST_SYNC);
@@ -67,6 +67,8 @@ static struct ll_rpc_opcode {
 	{ OST_QUOTA_ADJUST_QUNIT, "ost_quota_adjust_qunit" },
 	{ OST_LADVISE,      "ost_ladvise" },
 	{ OST_FALLOCATE,    "ost_fallocate"},
+	{ 23,                NULL },    /* OST_SEEK upstream */
+	{ OST_SETATTR_BATCH, "ost_setattr_batch" },
 	{ MDS_GETATTR,      "mds_getattr" },
 	{ MDS_GETATTR_NAME, "mds_getattr_lock" },
 	{ MDS_CLOSE,        "mds_close" },
@@ -126,6 +128,7 @@ static struct ll_rpc_opcode {
 	{ LLOG_ORIGIN_HANDLE_DESTROY,    "llog_origin_handle_destroy" },
 	{ QUOTA_DQACQ,      "quota_acquire" },
 	{ QUOTA_DQREL,      "quota_release" },
+	{ QUOTA_DQACQ_BATCH, "quota_acquire_batch" },
 	{ SEQ_QUERY,        "seq_query" },
 	{ SEC_CTX_INIT,     "sec_ctx_init" },
 	{ SEC_CTX_INIT_CONT, "sec_ctx_init_cont" },
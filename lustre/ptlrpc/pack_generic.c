@@ -1862,8 +1862,8 @@ void lustre_swab_obd_statfs(struct obd_statfs *os)
 	__swab32s(&os->os_state);
 	__swab32s(&os->os_fprecreated);
 	__swab32s(&os->os_granted);
-	BUILD_BUG_ON(offsetof(typeof(*os), os_spare3) == 0);
-	BUILD_BUG_ON(offsetof(typeof(*os), os_spare4) == 0);
+	__swab32s(&os->os_io_rate);
+	__swab32s(&os->os_io_inflight);
 	BUILD_BUG_ON(offsetof(typeof(*os), os_spare5) == 0);
 	BUILD_BUG_ON(offsetof(typeof(*os), os_spare6) == 0);
 	BUILD_BUG_ON(offsetof(typeof(*os), os_spare7) == 0);
@@ -1890,6 +1890,16 @@ void lustre_swab_ost_body(struct ost_body *b)
 	lustre_swab_obdo(&b->oa);
 }
 
+void lustre_swab_ost_setattr_rec(struct ost_setattr_rec *osr)
+{
+	lustre_swab_ost_id(&osr->osr_oi);
+	__swab64s(&osr->osr_valid);
+	__swab32s(&osr->osr_uid);
+	__swab32s(&osr->osr_gid);
+	__swab32s(&osr->osr_projid);
+	__swab32s(&osr->osr_rc);
+}
+
 void lustre_swab_ost_last_id(u64 *id)
 {
 	__swab64s(id);
@@ -2654,6 +2664,7 @@ void lustre_swab_quota_body(struct quota_body *b)
 	lustre_swab_lu_fid(&b->qb_fid);
 	lustre_swab_lu_fid((struct lu_fid *)&b->qb_id);
 	__swab32s(&b->qb_flags);
+	__swab32s(&b->qb_rc);
 	__swab64s(&b->qb_count);
 	__swab64s(&b->qb_usage);
 	__swab64s(&b->qb_slv_ver);
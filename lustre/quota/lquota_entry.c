@@ -31,6 +31,7 @@
 
 #include <linux/module.h>
 #include <linux/slab.h>
+#include <linux/hash.h>
 #include <obd_class.h>
 #include "lquota_internal.h"
 
@@ -94,6 +95,18 @@ static struct cfs_hash_ops lqe64_hash_ops = {
 	.hs_exit       = lqe_hash_exit
 };
 
+/*
+ * Return the hash table of \a site in charge of quota ID \a uid. The shard is
+ * the 32-bit hash_64() of the ID modulo the number of shards. The shard finds
+ * the bucket with cfs_hash_u64_hash(), a different multiplicative hash, so
+ * the IDs of one shard still spread over all its buckets.
+ */
+static inline struct cfs_hash *lqs_hash_shard(struct lquota_site *site,
+					      __u64 uid)
+{
+	return site->lqs_hash[hash_64(uid, 32) % site->lqs_hash_nr];
+}
+
 /* Logging helper function */
 void lquota_lqe_debug0(struct lquota_entry *lqe,
 		       struct libcfs_debug_msg_data *msgdata,
@@ -203,6 +216,7 @@ struct lquota_site *lquota_site_alloc(const struct lu_env *env, void *parent,
 {
 	struct lquota_site	*site;
 	char			 hashname[15];
+	int			 i;
 	ENTRY;
 
 	if (qtype >= LL_MAXQUOTAS)
@@ -212,27 +226,42 @@ struct lquota_site *lquota_site_alloc(const struct lu_env *env, void *parent,
 	if (site == NULL)
 		RETURN(ERR_PTR(-ENOMEM));
 
+	site->lqs_hash_nr = cfs_cpt_number(cfs_cpt_tab);
+	OBD_ALLOC_PTR_ARRAY(site->lqs_hash, site->lqs_hash_nr);
+	if (site->lqs_hash == NULL) {
+		OBD_FREE_PTR(site);
+		RETURN(ERR_PTR(-ENOMEM));
+	}
+
 	/* assign parameters */
 	site->lqs_qtype  = qtype;
 	site->lqs_parent = parent;
 	site->lqs_is_mst = is_master;
 	site->lqs_ops    = ops;
 
-	/* allocate hash table */
+	/* allocate one hash table per CPU partition */
 	memset(hashname, 0, sizeof(hashname));
 	snprintf(hashname, sizeof(hashname), "LQUOTA_HASH%hu", qtype);
-	site->lqs_hash= cfs_hash_create(hashname, hash_lqs_cur_bits,
-					HASH_LQE_MAX_BITS,
-					min(hash_lqs_cur_bits,
-					    HASH_LQE_BKT_BITS),
-					0, CFS_HASH_MIN_THETA,
-					CFS_HASH_MAX_THETA, &lqe64_hash_ops,
-					CFS_HASH_RW_SEM_BKTLOCK |
-					CFS_HASH_COUNTER |
-					CFS_HASH_REHASH |
-					CFS_HASH_BIGNAME);
+	for (i = 0; i < site->lqs_hash_nr; i++) {
+		site->lqs_hash[i] = cfs_hash_create(hashname, hash_lqs_cur_bits,
+						    HASH_LQE_MAX_BITS,
+						    min(hash_lqs_cur_bits,
+							HASH_LQE_BKT_BITS),
+						    0, CFS_HASH_MIN_THETA,
+						    CFS_HASH_MAX_THETA,
+						    &lqe64_hash_ops,
+						    CFS_HASH_RW_SEM_BKTLOCK |
+						    CFS_HASH_COUNTER |
+						    CFS_HASH_REHASH |
+						    CFS_HASH_BIGNAME);
+		if (site->lqs_hash[i] == NULL)
+			break;
+	}
 
-	if (site->lqs_hash == NULL) {
+	if (i < site->lqs_hash_nr) {
+		while (--i >= 0)
+			cfs_hash_putref(site->lqs_hash[i]);
+		OBD_FREE_PTR_ARRAY(site->lqs_hash, site->lqs_hash_nr);
 		OBD_FREE_PTR(site);
 		RETURN(ERR_PTR(-ENOMEM));
 	}
@@ -251,14 +280,62 @@ struct lquota_site *lquota_site_alloc(const struct lu_env *env, void *parent,
  */
 void lquota_site_free(const struct lu_env *env, struct lquota_site *site)
 {
-	/* cleanup hash table */
-	lqe_cleanup(site->lqs_hash, true);
-	cfs_hash_putref(site->lqs_hash);
+	int i;
+
+	/* cleanup hash tables */
+	for (i = 0; i < site->lqs_hash_nr; i++) {
+		lqe_cleanup(site->lqs_hash[i], true);
+		cfs_hash_putref(site->lqs_hash[i]);
+	}
+	OBD_FREE_PTR_ARRAY(site->lqs_hash, site->lqs_hash_nr);
 
 	site->lqs_parent = NULL;
 	OBD_FREE_PTR(site);
 }
 
+/*
+ * Call \a cb for each quota entry of a lquota site, see cfs_hash_for_each().
+ *
+ * \param site - lquota site to iterate over
+ * \param cb   - callback called for each entry
+ * \param data - opaque data passed to \a cb
+ */
+void lquota_site_for_each(struct lquota_site *site, cfs_hash_for_each_cb_t cb,
+			  void *data)
+{
+	int i;
+
+	for (i = 0; i < site->lqs_hash_nr; i++)
+		cfs_hash_for_each(site->lqs_hash[i], cb, data);
+}
+
+/*
+ * Same as lquota_site_for_each(), but \a cb is called without the hash
+ * bucket lock held, see cfs_hash_for_each_safe().
+ */
+void lquota_site_for_each_safe(struct lquota_site *site,
+			       cfs_hash_for_each_cb_t cb, void *data)
+{
+	int i;
+
+	for (i = 0; i < site->lqs_hash_nr; i++)
+		cfs_hash_for_each_safe(site->lqs_hash[i], cb, data);
+}
+
+/*
+ * Return the number of quota entries cached in a lquota site.
+ */
+__u64 lquota_site_count(struct lquota_site *site)
+{
+	__u64 count = 0;
+	int i;
+
+	for (i = 0; i < site->lqs_hash_nr; i++)
+		count += cfs_hash_size_get(site->lqs_hash[i]);
+
+	return count;
+}
+
 /*
  * Initialize qsd/qmt-specific fields of quota entry.
  *
@@ -326,10 +403,11 @@ struct lquota_entry *lqe_locate_find(const struct lu_env *env,
 				     bool find)
 {
 	struct lquota_entry	*lqe, *new = NULL;
+	struct cfs_hash		*hash = lqs_hash_shard(site, qid->qid_uid);
 	int			 rc = 0;
 	ENTRY;
 
-	lqe = cfs_hash_lookup(site->lqs_hash, (void *)&qid->qid_uid);
+	lqe = cfs_hash_lookup(hash, (void *)&qid->qid_uid);
 	if (lqe != NULL) {
 		LASSERT(lqe->lqe_uptodate);
 		RETURN(lqe);
@@ -338,7 +416,7 @@ struct lquota_entry *lqe_locate_find(const struct lu_env *env,
 	OBD_SLAB_ALLOC_PTR_GFP(new, lqe_kmem, GFP_NOFS);
 	if (new == NULL) {
 		CERROR("Fail to allocate lqe for id:%llu, "
-			"hash:%s\n", qid->qid_uid, site->lqs_hash->hs_name);
+			"hash:%s\n", qid->qid_uid, hash->hs_name);
 		RETURN(ERR_PTR(-ENOMEM));
 	}
 
@@ -360,7 +438,7 @@ struct lquota_entry *lqe_locate_find(const struct lu_env *env,
 		GOTO(out, lqe = ERR_PTR(rc));
 
 	/* add new entry to hash */
-	lqe = cfs_hash_findadd_unique(site->lqs_hash, &new->lqe_id.qid_uid,
+	lqe = cfs_hash_findadd_unique(hash, &new->lqe_id.qid_uid,
 				      &new->lqe_hash);
 	if (lqe == new)
 		new = NULL;
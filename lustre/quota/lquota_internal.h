@@ -147,6 +147,14 @@ struct lquota_slv_entry {
 
 	/* when latest edquot set */
 	time64_t		lse_edquot_time;
+
+	/* moving average of quota space consumed per second */
+	__u64			lse_rate;
+
+	/* space consumed since lse_rate_time, folded into lse_rate once
+	 * per second */
+	__u64			lse_rate_space;
+	time64_t		lse_rate_time;
 };
 
 /* In-memory entry for each enforced quota id
@@ -217,8 +225,13 @@ struct lqe_glbl_data {
  * lquota_entry structures are kept in a hash table and read from disk if not
  * present.  */
 struct lquota_site {
-	/* Hash table storing lquota_entry structures */
-	struct cfs_hash	*lqs_hash;
+	/* Hash tables storing lquota_entry structures. The site is sharded by
+	 * quota ID into one hash table per CPU partition, so that lookups of
+	 * different IDs do not contend on the same table lock and rehash. */
+	struct cfs_hash	**lqs_hash;
+
+	/* Number of hash tables in lqs_hash */
+	int		 lqs_hash_nr;
 
 	/* Quota type, either user or group. */
 	int		 lqs_qtype;
@@ -255,6 +268,9 @@ struct lquota_site {
 #define lqe_acq_rc		u.se.lse_acq_rc
 #define lqe_acq_time		u.se.lse_acq_time
 #define lqe_edquot_time		u.se.lse_edquot_time
+#define lqe_rate		u.se.lse_rate
+#define lqe_rate_space		u.se.lse_rate_space
+#define lqe_rate_time		u.se.lse_rate_time
 
 #define LQUOTA_BUMP_VER 0x1
 #define LQUOTA_SET_VER  0x2
@@ -448,6 +464,11 @@ const struct dt_index_features *glb_idx_feature(struct lu_fid *);
 struct lquota_site *lquota_site_alloc(const struct lu_env *, void *, bool,
 				      short, struct lquota_entry_operations *);
 void lquota_site_free(const struct lu_env *, struct lquota_site *);
+void lquota_site_for_each(struct lquota_site *, cfs_hash_for_each_cb_t,
+			  void *);
+void lquota_site_for_each_safe(struct lquota_site *, cfs_hash_for_each_cb_t,
+			       void *);
+__u64 lquota_site_count(struct lquota_site *);
 /* quota entry operations */
 #define lqe_locate(env, site, id) lqe_locate_find(env, site, id, false)
 #define lqe_find(env, site, id) lqe_locate_find(env, site, id, true)
@@ -272,8 +272,9 @@ out_nolock:
 			LQUOTA_DEBUG(lqe, "notify all lqe with default quota");
 			iter_data.qeid_env = env;
 			iter_data.qeid_qmt = qmt;
-			cfs_hash_for_each_safe(lqe->lqe_site->lqs_hash,
-					       qmt_entry_iter_cb, &iter_data);
+			lquota_site_for_each_safe(lqe->lqe_site,
+						  qmt_entry_iter_cb,
+						  &iter_data);
 			/* Always notify slaves with default values. Don't
 			 * care about overhead as will be sent only not changed
 			 * values(see qmt_id_lock_cb for details).*/
@@ -888,31 +889,26 @@ int qmt_uuid2idx(struct obd_uuid *uuid, int *idx)
 }
 
 /*
- * Handle quota request from slave.
+ * Handle the quota request of a single ID from a slave.
  *
- * \param env  - is the environment passed by the caller
- * \param ld   - is the lu device associated with the qmt
- * \param req  - is the quota acquire request
+ * \param env     - is the environment passed by the caller
+ * \param qmt     - is the quota master target
+ * \param req     - is the request carrying \a qbody
+ * \param stype   - is the slave type, QMT_STYPE_MDT or QMT_STYPE_OST
+ * \param idx     - is the slave index
+ * \param qbody   - is the quota body of the ID to be handled
+ * \param repbody - is the quota body to be packed in the reply
  */
-static int qmt_dqacq(const struct lu_env *env, struct lu_device *ld,
-		     struct ptlrpc_request *req)
+static int qmt_dqacq_one(const struct lu_env *env, struct qmt_device *qmt,
+			 struct ptlrpc_request *req, int stype, int idx,
+			 struct quota_body *qbody, struct quota_body *repbody)
 {
-	struct qmt_device *qmt = lu2qmt_dev(ld);
-	struct quota_body *qbody, *repbody;
-	struct obd_uuid	*uuid;
+	struct obd_uuid	*uuid = &req->rq_export->exp_client_uuid;
 	struct ldlm_lock *lock;
 	int rtype, qtype;
-	int rc, idx, stype;
+	int rc;
 	ENTRY;
 
-	qbody = req_capsule_client_get(&req->rq_pill, &RMF_QUOTA_BODY);
-	if (qbody == NULL)
-		RETURN(err_serious(-EPROTO));
-
-	repbody = req_capsule_server_get(&req->rq_pill, &RMF_QUOTA_BODY);
-	if (repbody == NULL)
-		RETURN(err_serious(-EFAULT));
-
 	/* verify if global lock is stale */
 	if (!lustre_handle_is_used(&qbody->qb_glb_lockh))
 		RETURN(-ENOLCK);
@@ -922,11 +918,6 @@ static int qmt_dqacq(const struct lu_env *env, struct lu_device *ld,
 		RETURN(-ENOLCK);
 	LDLM_LOCK_PUT(lock);
 
-	uuid = &req->rq_export->exp_client_uuid;
-	stype = qmt_uuid2idx(uuid, &idx);
-	if (stype < 0)
-		RETURN(stype);
-
 	if (req_is_rel(qbody->qb_flags) + req_is_acq(qbody->qb_flags) +
 	    req_is_preacq(qbody->qb_flags) > 1) {
 		CERROR("%s: malformed quota request with conflicting flags set "
@@ -995,12 +986,100 @@ static int qmt_dqacq(const struct lu_env *env, struct lu_device *ld,
 	RETURN(rc);
 }
 
+/*
+ * Handle quota request from slave.
+ *
+ * \param env  - is the environment passed by the caller
+ * \param ld   - is the lu device associated with the qmt
+ * \param req  - is the quota acquire request
+ */
+static int qmt_dqacq(const struct lu_env *env, struct lu_device *ld,
+		     struct ptlrpc_request *req)
+{
+	struct qmt_device *qmt = lu2qmt_dev(ld);
+	struct quota_body *qbody, *repbody;
+	int idx, stype;
+	ENTRY;
+
+	qbody = req_capsule_client_get(&req->rq_pill, &RMF_QUOTA_BODY);
+	if (qbody == NULL)
+		RETURN(err_serious(-EPROTO));
+
+	repbody = req_capsule_server_get(&req->rq_pill, &RMF_QUOTA_BODY);
+	if (repbody == NULL)
+		RETURN(err_serious(-EFAULT));
+
+	stype = qmt_uuid2idx(&req->rq_export->exp_client_uuid, &idx);
+	if (stype < 0)
+		RETURN(stype);
+
+	RETURN(qmt_dqacq_one(env, qmt, req, stype, idx, qbody, repbody));
+}
+
+/*
+ * Handle batched quota request from slave.
+ *
+ * The request carries an array of up to QUOTA_DQACQ_BATCH_MAX quota bodies,
+ * possibly for different quota types, which are handled one after another
+ * exactly as if they had been sent in separate QUOTA_DQACQ requests. The
+ * reply has one quota body per ID, the status of each ID being returned in
+ * qb_rc. A failure of one ID does not prevent the following IDs from being
+ * handled.
+ *
+ * \param env  - is the environment passed by the caller
+ * \param ld   - is the lu device associated with the qmt
+ * \param req  - is the batched quota acquire request
+ */
+static int qmt_dqacq_batch(const struct lu_env *env, struct lu_device *ld,
+			   struct ptlrpc_request *req)
+{
+	struct qmt_device *qmt = lu2qmt_dev(ld);
+	struct quota_body *qbodies, *repbodies;
+	int idx, stype;
+	int rc, i, nr;
+	ENTRY;
+
+	nr = req_capsule_get_size(&req->rq_pill, &RMF_QUOTA_BATCH,
+				  RCL_CLIENT) / sizeof(*qbodies);
+	if (nr == 0 || nr > QUOTA_DQACQ_BATCH_MAX)
+		RETURN(err_serious(-EPROTO));
+
+	qbodies = req_capsule_client_get(&req->rq_pill, &RMF_QUOTA_BATCH);
+	if (qbodies == NULL)
+		RETURN(err_serious(-EPROTO));
+
+	req_capsule_set_size(&req->rq_pill, &RMF_QUOTA_BATCH, RCL_SERVER,
+			     nr * sizeof(*repbodies));
+	rc = req_capsule_server_pack(&req->rq_pill);
+	if (rc)
+		RETURN(err_serious(rc));
+
+	repbodies = req_capsule_server_get(&req->rq_pill, &RMF_QUOTA_BATCH);
+	LASSERT(repbodies != NULL);
+
+	stype = qmt_uuid2idx(&req->rq_export->exp_client_uuid, &idx);
+	if (stype < 0)
+		RETURN(stype);
+
+	for (i = 0; i < nr; i++) {
+		memset(&repbodies[i], 0, sizeof(repbodies[i]));
+		rc = qmt_dqacq_one(env, qmt, req, stype, idx, &qbodies[i],
+				   &repbodies[i]);
+		repbodies[i].qb_rc = rc;
+	}
+
+	CDEBUG(D_QUOTA, "%s: handled batch of %d quota requests\n",
+	       qmt->qmt_svname, nr);
+	RETURN(0);
+}
+
 /* Vector of quota request handlers. This vector is used by the MDT to forward
  * requests to the quota master. */
 struct qmt_handlers qmt_hdls = {
 	/* quota request handlers */
 	.qmth_quotactl		= qmt_quotactl,
 	.qmth_dqacq		= qmt_dqacq,
+	.qmth_dqacq_batch	= qmt_dqacq_batch,
 
 	/* ldlm handlers */
 	.qmth_intent_policy	= qmt_intent_policy,
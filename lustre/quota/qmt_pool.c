@@ -93,10 +93,10 @@ static int qpi_state_seq_show(struct seq_file *m, void *data)
 	for (type = 0; type < LL_MAXQUOTAS; type++)
 		seq_printf(m, "    %s:\n"
 			   "        #slv: %d\n"
-			   "        #lqe: %d\n",
+			   "        #lqe: %llu\n",
 			   qtype_name(type),
 			   qpi_slv_nr(pool, type),
-		    atomic_read(&pool->qpi_site[type]->lqs_hash->hs_count));
+			   lquota_site_count(pool->qpi_site[type]));
 
 	return 0;
 }
@@ -1235,8 +1235,8 @@ static int qmt_pool_recalc(void *args)
 		/* Now go trough the site hash and compare lqe_granted
 		 * with lqe_calc_granted. Write new value if disagree */
 
-		cfs_hash_for_each(pool->qpi_site[qtype]->lqs_hash,
-				  qmt_site_recalc_cb, &env);
+		lquota_site_for_each(pool->qpi_site[qtype],
+				     qmt_site_recalc_cb, &env);
 	}
 	GOTO(out_stop, rc);
 out_stop:
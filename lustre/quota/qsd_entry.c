@@ -50,6 +50,9 @@ static void qsd_lqe_init(struct lquota_entry *lqe, void *arg)
 	init_waitqueue_head(&lqe->lqe_waiters);
 	lqe->lqe_usage    = 0;
 	lqe->lqe_nopreacq = false;
+	lqe->lqe_rate       = 0;
+	lqe->lqe_rate_space = 0;
+	lqe->lqe_rate_time  = 0;
 }
 
 /*
@@ -326,6 +329,69 @@ out:
 	return rc;
 }
 
+/*
+ * Update the records of several IDs in the global or slave index copy in a
+ * single local transaction. The version of the index is set to the highest
+ * version of the update records, if any.
+ *
+ * \param env    - the environment passed by the caller
+ * \param qqi    - is the qsd_type_info structure associated with the index
+ * \param global - is set to true when updating the global index copy
+ * \param list   - is the list of qsd_upd_rec to be written, at most
+ *                 QSD_UPD_BATCH records with one record per ID
+ */
+int qsd_update_index_batch(const struct lu_env *env,
+			   struct qsd_qtype_info *qqi, bool global,
+			   struct list_head *list)
+{
+	struct qsd_instance	*qsd = qqi->qqi_qsd;
+	struct qsd_upd_rec	*upd;
+	struct thandle		*th;
+	struct dt_object	*obj;
+	__u64			 ver = 0;
+	int			 flags = 0;
+	int			 rc = 0;
+	ENTRY;
+
+	obj = global ? qqi->qqi_glb_obj : qqi->qqi_slv_obj;
+
+	th = dt_trans_create(env, qsd->qsd_dev);
+	if (IS_ERR(th))
+		RETURN(PTR_ERR(th));
+
+	list_for_each_entry(upd, list, qur_link) {
+		rc = lquota_disk_declare_write(env, th, obj, &upd->qur_qid);
+		if (rc)
+			GOTO(out, rc);
+		ver = max(ver, upd->qur_ver);
+	}
+
+	rc = dt_trans_start_local(env, qsd->qsd_dev, th);
+	if (rc)
+		GOTO(out, rc);
+
+	if (ver != 0)
+		flags = LQUOTA_SET_VER;
+
+	list_for_each_entry(upd, list, qur_link) {
+		rc = lquota_disk_write(env, th, obj, &upd->qur_qid,
+				       (struct dt_rec *)&upd->qur_rec, flags,
+				       ver != 0 ? &ver : NULL);
+		if (rc)
+			break;
+	}
+	EXIT;
+out:
+	dt_trans_stop(env, qsd->qsd_dev, th);
+	if (rc)
+		CDEBUG(D_QUOTA, "%s: failed to update %s index copy in batch: "
+		       "rc = %d\n", qsd->qsd_svname,
+		       global ? "global" : "slave", rc);
+	else if (ver != 0)
+		qsd_bump_version(qqi, ver, global);
+	return rc;
+}
+
 /*
  * Update in-memory lquota entry with new quota setting from record \rec.
  * The record can either be a global record (i.e. lquota_glb_rec) or a slave
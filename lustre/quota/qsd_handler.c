@@ -142,6 +142,47 @@ static int qsd_ready(struct lquota_entry *lqe, struct lustre_handle *lockh)
 	RETURN(0);
 }
 
+/**
+ * Quota space expected to be consumed for \a lqe in the next
+ * qsd_prefetch_sec seconds at the current write rate. It is capped to one
+ * qunit, so that a busy ID can't hoard space that the master could grant to
+ * other slaves, and it naturally shrinks as the master reduces qunit when
+ * the ID gets close to its limit.
+ */
+static __u64 qsd_prefetch_space(struct lquota_entry *lqe)
+{
+	struct qsd_instance *qsd = lqe2qqi(lqe)->qqi_qsd;
+
+	return min_t(__u64, lqe->lqe_rate * qsd->qsd_prefetch_sec,
+		     lqe->lqe_qunit);
+}
+
+/**
+ * Account \a space consumed by a completed operation in the per-ID rate,
+ * a moving average sampled at most once per second. Called with the lqe
+ * write lock held.
+ */
+static void qsd_rate_update(struct lquota_entry *lqe, __u64 space)
+{
+	time64_t now = ktime_get_seconds();
+	time64_t elapsed = now - lqe->lqe_rate_time;
+
+	if (elapsed > 0) {
+		if (elapsed >= QSD_RATE_IDLE) {
+			lqe->lqe_rate = 0;
+		} else {
+			__u64 rate = lqe->lqe_rate_space;
+
+			do_div(rate, (__u32)elapsed);
+			/* new sample weighs 1/4 */
+			lqe->lqe_rate = (lqe->lqe_rate * 3 + rate) >> 2;
+		}
+		lqe->lqe_rate_time = now;
+		lqe->lqe_rate_space = 0;
+	}
+	lqe->lqe_rate_space += space;
+}
+
 /**
  * Check whether any quota space adjustment (pre-acquire/release/report) is
  * needed for a given quota ID. If a non-null \a qbody is passed, then the
@@ -265,11 +306,14 @@ static bool qsd_calc_adjust(struct lquota_entry *lqe, struct quota_body *qbody)
 
 	/* 3. Time to pre-acquire? */
 	if (!lqe->lqe_edquot && !lqe->lqe_nopreacq && usage > 0 &&
-	    lqe->lqe_qunit != 0 && granted < usage + lqe->lqe_qtune) {
+	    lqe->lqe_qunit != 0 &&
+	    granted < usage + max(lqe->lqe_qtune, qsd_prefetch_space(lqe))) {
 		/* To pre-acquire quota space, we report how much spare quota
 		 * space the slave currently owns, then the master will grant us
 		 * back how much we can pretend given the current state of
-		 * affairs */
+		 * affairs. Busy IDs pre-acquire as soon as the spare space
+		 * won't last qsd_prefetch_sec seconds, so that writes don't
+		 * have to wait for a DQACQ RPC once it is exhausted */
 		if (qbody == NULL)
 			RETURN(true);
 		if (granted <= usage)
@@ -902,6 +946,59 @@ int qsd_op_begin(const struct lu_env *env, struct qsd_instance *qsd,
 }
 EXPORT_SYMBOL(qsd_op_begin);
 
+/**
+ * Send the non-intent quota requests collected in \a batchp to the master,
+ * if any.
+ *
+ * \param env    - the environment passed by the caller
+ * \param qsd    - is the qsd instance the requests belong to
+ * \param batchp - is the batch to be sent, reset to NULL once sent
+ */
+void qsd_adjust_flush(const struct lu_env *env, struct qsd_instance *qsd,
+		      struct qsd_dqacq_batch **batchp)
+{
+	if (*batchp == NULL)
+		return;
+
+	/* the completion function is called for each ID on failure */
+	qsd_send_dqacq_batch(env, qsd->qsd_exp, *batchp, qsd_req_completion);
+	*batchp = NULL;
+}
+
+/*
+ * Add a non-intent quota request to \a batchp, the batch is sent once full.
+ * The request is sent on its own if the batch can't be allocated.
+ */
+static int qsd_adjust_batch_add(const struct lu_env *env,
+				struct qsd_instance *qsd,
+				struct lquota_entry *lqe,
+				struct quota_body *qbody,
+				struct lustre_handle *lockh,
+				struct qsd_dqacq_batch **batchp)
+{
+	struct qsd_dqacq_batch *batch = *batchp;
+
+	if (batch == NULL) {
+		OBD_ALLOC_PTR(batch);
+		if (batch == NULL)
+			return qsd_send_dqacq(env, qsd->qsd_exp, qbody, false,
+					      qsd_req_completion, lqe2qqi(lqe),
+					      lockh, lqe);
+		*batchp = batch;
+	}
+
+	batch->qdb_bodies[batch->qdb_count] = *qbody;
+	lustre_handle_copy(&batch->qdb_lockh[batch->qdb_count], lockh);
+	batch->qdb_lqes[batch->qdb_count] = lqe;
+	batch->qdb_count++;
+	LQUOTA_DEBUG(lqe, "added to DQACQ batch, flags:0x%x count:%d",
+		     qbody->qb_flags, batch->qdb_count);
+
+	if (batch->qdb_count == QUOTA_DQACQ_BATCH_MAX)
+		qsd_adjust_flush(env, qsd, batchp);
+	return 0;
+}
+
 /**
  * Adjust quota space (by acquiring or releasing) hold by the quota slave.
  * This function is called after each quota request completion and during
@@ -909,12 +1006,18 @@ EXPORT_SYMBOL(qsd_op_begin);
  * Space adjustment is aborted if there is already a quota request in flight
  * for this ID.
  *
+ * If \a batchp isn't NULL and the master supports it, non-intent requests
+ * are collected in \a batchp instead of being sent right away, the caller
+ * then has to send them with qsd_adjust_flush().
+ *
  * \param env    - the environment passed by the caller
  * \param lqe    - is the qid entry to be processed
+ * \param batchp - is the batch to add non-intent requests to, or NULL
  *
  * \retval 0 on success, appropriate errors on failure
  */
-int qsd_adjust(const struct lu_env *env, struct lquota_entry *lqe)
+int __qsd_adjust(const struct lu_env *env, struct lquota_entry *lqe,
+		 struct qsd_dqacq_batch **batchp)
 {
 	struct qsd_thread_info	*qti = qsd_info(env);
 	struct quota_body	*qbody = &qti->qti_body;
@@ -996,7 +1099,11 @@ int qsd_adjust(const struct lu_env *env, struct lquota_entry *lqe)
 		memset(&qti->qti_lockh, 0, sizeof(qti->qti_lockh));
 	}
 
-	if (!intent) {
+	if (!intent && batchp != NULL &&
+	    exp_connect_flags2(qsd->qsd_exp) & OBD_CONNECT2_DQACQ_BATCH) {
+		rc = qsd_adjust_batch_add(env, qsd, lqe, qbody,
+					  &qti->qti_lockh, batchp);
+	} else if (!intent) {
 		rc = qsd_send_dqacq(env, qsd->qsd_exp, qbody, false,
 				    qsd_req_completion, qqi, &qti->qti_lockh,
 				    lqe);
@@ -1020,6 +1127,11 @@ out:
 	return rc;
 }
 
+int qsd_adjust(const struct lu_env *env, struct lquota_entry *lqe)
+{
+	return __qsd_adjust(env, lqe, NULL);
+}
+
 /**
  * Post quota operation, pre-acquire/release quota from master.
  *
@@ -1051,8 +1163,10 @@ static void qsd_op_end0(const struct lu_env *env, struct qsd_qtype_info *qqi,
 		qsd_refresh_usage(env, lqe);
 
 	lqe_write_lock(lqe);
-	if (qid->lqi_space > 0)
+	if (qid->lqi_space > 0) {
 		lqe->lqe_pending_write -= qid->lqi_space;
+		qsd_rate_update(lqe, qid->lqi_space);
+	}
 	if (env != NULL)
 		adjust = qsd_adjust_needed(lqe);
 	else
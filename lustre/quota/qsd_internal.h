@@ -32,6 +32,24 @@
 
 struct qsd_type_info;
 struct qsd_fsinfo;
+struct qsd_instance;
+
+/* maximum number of writeback workers of a qsd instance */
+#define QSD_UPD_WORKERS_MAX	8
+
+/*
+ * Writeback worker of a qsd instance. Each worker is bound to a CPU partition
+ * and applies the updates of the IDs hashed to it. Worker 0 also applies the
+ * versioned updates of the global index copies, which must be written in
+ * order, and handles quota space adjustment and reintegration.
+ */
+struct qsd_upd_worker {
+	struct qsd_instance	*quw_qsd;
+	struct task_struct	*quw_task;
+	/* list of update records, protected by qsd_lock */
+	struct list_head	 quw_list;
+	int			 quw_idx;
+};
 
 extern struct kmem_cache *upd_kmem;
 
@@ -83,15 +101,13 @@ struct qsd_instance {
 	/* lock protecting adjust list */
 	spinlock_t		 qsd_adjust_lock;
 
-	/* dedicated thread for updating slave index files. */
-	struct task_struct	*qsd_upd_task;
-
-	/* list of update tasks */
-	struct list_head	 qsd_upd_list;
+	/* writeback workers updating the index files */
+	struct qsd_upd_worker	 qsd_upd_workers[QSD_UPD_WORKERS_MAX];
+	int			 qsd_upd_worker_nr;
 
 	/* r/w spinlock protecting:
 	 * - the state flags
-	 * - the qsd update list
+	 * - the qsd update lists
 	 * - the deferred list
 	 * - flags of the qsd_qtype_info */
 	rwlock_t		 qsd_lock;
@@ -106,6 +122,11 @@ struct qsd_instance {
 	 * enforced here (via procfs) */
 	int			 qsd_timeout;
 
+	/* pre-acquire quota space expected to be consumed in the next
+	 * qsd_prefetch_sec seconds at the current per-ID rate, 0 to only
+	 * pre-acquire when spare space drops below qtune */
+	unsigned int		 qsd_prefetch_sec;
+
 	unsigned long		qsd_is_md:1,    /* managing quota for mdt */
 				qsd_started:1,  /* instance is now started */
 				qsd_prepared:1, /* qsd_prepare() successfully
@@ -232,7 +253,7 @@ static inline void qqi_putref(struct qsd_qtype_info *qqi)
 
 /* udpate record for slave & global index copy */
 struct qsd_upd_rec {
-	struct list_head	qur_link; /* link into qsd_upd_list */
+	struct list_head	qur_link; /* link into quw_list */
 	union lquota_id		qur_qid;
 	union lquota_rec	qur_rec;
 	struct qsd_qtype_info  *qur_qqi;
@@ -241,6 +262,16 @@ struct qsd_upd_rec {
 	bool			qur_global;
 };
 
+/* Non-intent quota requests collected by a qsd thread to be sent to the
+ * master in a single QUOTA_DQACQ_BATCH request. The batch is handed over to
+ * the request once sent and freed by the request interpret callback. */
+struct qsd_dqacq_batch {
+	int			 qdb_count;
+	struct quota_body	 qdb_bodies[QUOTA_DQACQ_BATCH_MAX];
+	struct lustre_handle	 qdb_lockh[QUOTA_DQACQ_BATCH_MAX];
+	struct lquota_entry	*qdb_lqes[QUOTA_DQACQ_BATCH_MAX];
+};
+
 /* Common data shared by qsd-level handlers. This is allocated per-thread to
  * reduce stack consumption.  */
 struct qsd_thread_info {
@@ -322,6 +353,11 @@ static inline void qsd_set_edquot(struct lquota_entry *lqe, bool edquot)
 }
 
 #define QSD_WB_INTERVAL	60 /* 60 seconds */
+/* maximum number of IDs updated in one index transaction by writeback */
+#define QSD_UPD_BATCH	16
+#define QSD_PREFETCH_SEC_DEFAULT	2
+/* per-ID rate is reset after this many seconds without consumption */
+#define QSD_RATE_IDLE	16
 
 /* helper function calculating how long a service thread should be waiting for
  * quota space */
@@ -337,6 +373,8 @@ extern struct lquota_entry_operations qsd_lqe_ops;
 int qsd_refresh_usage(const struct lu_env *, struct lquota_entry *);
 int qsd_update_index(const struct lu_env *, struct qsd_qtype_info *,
 		     union lquota_id *, bool, __u64, void *);
+int qsd_update_index_batch(const struct lu_env *, struct qsd_qtype_info *,
+			   bool, struct list_head *);
 int qsd_update_lqe(const struct lu_env *, struct lquota_entry *, bool,
 		   void *);
 int qsd_write_version(const struct lu_env *, struct qsd_qtype_info *,
@@ -364,6 +402,8 @@ int qsd_send_dqacq(const struct lu_env *, struct obd_export *,
 		   struct quota_body *, bool, qsd_req_completion_t,
 		   struct qsd_qtype_info *, struct lustre_handle *,
 		   struct lquota_entry *);
+int qsd_send_dqacq_batch(const struct lu_env *, struct obd_export *,
+			 struct qsd_dqacq_batch *, qsd_req_completion_t);
 int qsd_intent_lock(const struct lu_env *, struct obd_export *,
 		    struct quota_body *, bool, int, qsd_req_completion_t,
 		    struct qsd_qtype_info *, struct lquota_lvb *, void *);
@@ -381,7 +421,11 @@ int qsd_config(char *valstr, char *fsname, int pool);
 int qsd_process_config(struct lustre_cfg *);
 
 /* qsd_handler.c */
+int __qsd_adjust(const struct lu_env *, struct lquota_entry *,
+		 struct qsd_dqacq_batch **);
 int qsd_adjust(const struct lu_env *, struct lquota_entry *);
+void qsd_adjust_flush(const struct lu_env *, struct qsd_instance *,
+		      struct qsd_dqacq_batch **);
 
 /* qsd_writeback.c */
 void qsd_upd_schedule(struct qsd_qtype_info *, struct lquota_entry *,
@@ -267,6 +267,34 @@ qsd_timeout_seq_write(struct file *file, const char __user *buffer,
 }
 LPROC_SEQ_FOPS(qsd_timeout);
 
+static int qsd_prefetch_seconds_seq_show(struct seq_file *m, void *data)
+{
+	struct qsd_instance *qsd = m->private;
+	LASSERT(qsd != NULL);
+
+	seq_printf(m, "%u\n", qsd->qsd_prefetch_sec);
+	return 0;
+}
+
+static ssize_t
+qsd_prefetch_seconds_seq_write(struct file *file, const char __user *buffer,
+			       size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct qsd_instance *qsd = m->private;
+	unsigned int sec;
+	int rc;
+
+	LASSERT(qsd != NULL);
+	rc = kstrtouint_from_user(buffer, count, 0, &sec);
+	if (rc)
+		return rc;
+
+	qsd->qsd_prefetch_sec = sec;
+	return count;
+}
+LPROC_SEQ_FOPS(qsd_prefetch_seconds);
+
 static struct lprocfs_vars lprocfs_quota_qsd_vars[] = {
 	{ .name	=	"info",
 	  .fops	=	&qsd_state_fops		},
@@ -276,6 +304,8 @@ static struct lprocfs_vars lprocfs_quota_qsd_vars[] = {
 	  .fops	=	&qsd_force_reint_fops	},
 	{ .name	=	"timeout",
 	  .fops	=	&qsd_timeout_fops	},
+	{ .name	=	"prefetch_seconds",
+	  .fops	=	&qsd_prefetch_seconds_fops	},
 	{ NULL }
 };
 
@@ -655,7 +685,7 @@ struct qsd_instance *qsd_init(const struct lu_env *env, char *svname,
 {
 	struct qsd_thread_info	*qti = qsd_info(env);
 	struct qsd_instance	*qsd;
-	int			 rc, type, idx;
+	int			 rc, type, idx, i;
 	ENTRY;
 
 	/* only configure qsd for MDT & OST */
@@ -671,12 +701,19 @@ struct qsd_instance *qsd_init(const struct lu_env *env, char *svname,
 	/* generic initializations */
 	rwlock_init(&qsd->qsd_lock);
 	INIT_LIST_HEAD(&qsd->qsd_link);
-	INIT_LIST_HEAD(&qsd->qsd_upd_list);
+	qsd->qsd_upd_worker_nr = min(cfs_cpt_number(cfs_cpt_tab),
+				     QSD_UPD_WORKERS_MAX);
+	for (i = 0; i < qsd->qsd_upd_worker_nr; i++) {
+		qsd->qsd_upd_workers[i].quw_qsd = qsd;
+		qsd->qsd_upd_workers[i].quw_idx = i;
+		INIT_LIST_HEAD(&qsd->qsd_upd_workers[i].quw_list);
+	}
 	spin_lock_init(&qsd->qsd_adjust_lock);
 	INIT_LIST_HEAD(&qsd->qsd_adjust_list);
 	qsd->qsd_prepared = false;
 	qsd->qsd_started = false;
 	qsd->qsd_is_md = is_md;
+	qsd->qsd_prefetch_sec = QSD_PREFETCH_SEC_DEFAULT;
 
 	/* copy service name */
 	if (strlcpy(qsd->qsd_svname, svname, sizeof(qsd->qsd_svname))
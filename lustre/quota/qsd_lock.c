@@ -280,8 +280,7 @@ void qsd_update_default_quota(struct qsd_qtype_info *qqi, __u64 hardlimit,
 	qqi->qqi_default_softlimit = softlimit;
 	qqi->qqi_default_gracetime = gracetime;
 
-	cfs_hash_for_each_safe(qqi->qqi_site->lqs_hash,
-			       qsd_entry_def_iter_cb, qqi);
+	lquota_site_for_each_safe(qqi->qqi_site, qsd_entry_def_iter_cb, qqi);
 }
 
 /*
@@ -304,6 +304,7 @@ static int qsd_reconciliation(const struct lu_env *env,
 {
 	struct qsd_thread_info	*qti = qsd_info(env);
 	struct qsd_instance	*qsd = qqi->qqi_qsd;
+	struct qsd_dqacq_batch	*batch = NULL;
 	const struct dt_it_ops	*iops;
 	struct dt_it		*it;
 	struct dt_key		*key;
@@ -364,7 +365,7 @@ static int qsd_reconciliation(const struct lu_env *env,
 			GOTO(out, rc);
 		}
 
-		rc = qsd_adjust(env, lqe);
+		rc = __qsd_adjust(env, lqe, &batch);
 		lqe_putref(lqe);
 		if (rc) {
 			CWARN("%s: failed to report quota. "DFID", %d\n",
@@ -382,6 +383,7 @@ next:
 	if (rc > 0)
 		rc = 0;
 out:
+	qsd_adjust_flush(env, qsd, &batch);
 	iops->put(env, it);
 	iops->fini(env, it);
 	RETURN(rc);
@@ -582,6 +584,7 @@ static bool qsd_pending_updates(struct qsd_qtype_info *qqi)
 	struct lquota_entry	*lqe, *n;
 	int			 dqacq = 0;
 	bool			 updates = false;
+	int			 i;
 	ENTRY;
 
 	/* any pending quota adjust? */
@@ -596,8 +599,11 @@ static bool qsd_pending_updates(struct qsd_qtype_info *qqi)
 
 	/* any pending updates? */
 	read_lock(&qsd->qsd_lock);
-	list_for_each_entry(upd, &qsd->qsd_upd_list, qur_link) {
-		if (upd->qur_qqi == qqi) {
+	for (i = 0; i < qsd->qsd_upd_worker_nr; i++) {
+		list_for_each_entry(upd, &qsd->qsd_upd_workers[i].quw_list,
+				    qur_link) {
+			if (upd->qur_qqi != qqi)
+				continue;
 			read_unlock(&qsd->qsd_lock);
 			CDEBUG(D_QUOTA, "%s: pending %s updates for type:%d.\n",
 			       qsd->qsd_svname,
@@ -609,8 +615,7 @@ static bool qsd_pending_updates(struct qsd_qtype_info *qqi)
 	read_unlock(&qsd->qsd_lock);
 
 	/* any pending quota request? */
-	cfs_hash_for_each_safe(qqi->qqi_site->lqs_hash, qsd_entry_iter_cb,
-			       &dqacq);
+	lquota_site_for_each_safe(qqi->qqi_site, qsd_entry_iter_cb, &dqacq);
 	if (dqacq) {
 		CDEBUG(D_QUOTA, "%s: pending dqacq for type:%d.\n",
 		       qsd->qsd_svname, qqi->qqi_qtype);
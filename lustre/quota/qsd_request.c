@@ -141,6 +141,125 @@ out:
 	return rc;
 }
 
+/*
+ * Batched quota request interpret callback. The completion callback is
+ * called for each ID of the batch with the status returned by the master
+ * for this ID.
+ *
+ * \param env    - the environment passed by the caller
+ * \param req    - the batched quota request
+ * \param arg    - qsd_async_args
+ * \param rc     - request status
+ *
+ * \retval 0     - success
+ * \retval -ve   - appropriate errors
+ */
+static int qsd_dqacq_batch_interpret(const struct lu_env *env,
+				     struct ptlrpc_request *req, void *arg,
+				     int rc)
+{
+	struct qsd_async_args	*aa = (struct qsd_async_args *)arg;
+	struct qsd_dqacq_batch	*batch = aa->aa_arg;
+	struct quota_body	*req_qbodies, *rep_qbodies = NULL;
+	struct quota_body	*rep_qbody;
+	int			 i, ret;
+	ENTRY;
+
+	req_qbodies = req_capsule_client_get(&req->rq_pill, &RMF_QUOTA_BATCH);
+	if (rc == 0) {
+		rep_qbodies = req_capsule_server_sized_get(&req->rq_pill,
+						&RMF_QUOTA_BATCH,
+						batch->qdb_count *
+						sizeof(*rep_qbodies));
+		if (rep_qbodies == NULL)
+			rc = -EPROTO;
+	}
+
+	for (i = 0; i < batch->qdb_count; i++) {
+		struct lquota_entry *lqe = batch->qdb_lqes[i];
+
+		ret = rep_qbodies != NULL ? rep_qbodies[i].qb_rc : rc;
+		rep_qbody = NULL;
+		if (rep_qbodies != NULL &&
+		    (ret == 0 || ret == -EDQUOT || ret == -EINPROGRESS))
+			rep_qbody = &rep_qbodies[i];
+		aa->aa_completion(env, lqe2qqi(lqe), &req_qbodies[i],
+				  rep_qbody, &batch->qdb_lockh[i], NULL, lqe,
+				  ret);
+	}
+	OBD_FREE_PTR(batch);
+	RETURN(rc);
+}
+
+/*
+ * Send a batch of non-intent quota requests to master. Ownership of the batch
+ * is transferred to the request, the completion callback is called for each
+ * ID once the request is completed.
+ *
+ * \param env    - the environment passed by the caller
+ * \param exp    - is the export to use to send the acquire RPC
+ * \param batch  - quota requests to be packed in the RPC
+ * \param completion - completion callback
+ *
+ * \retval 0     - success
+ * \retval -ve   - appropriate errors
+ */
+int qsd_send_dqacq_batch(const struct lu_env *env, struct obd_export *exp,
+			 struct qsd_dqacq_batch *batch,
+			 qsd_req_completion_t completion)
+{
+	struct ptlrpc_request	*req;
+	struct quota_body	*req_qbodies;
+	struct qsd_async_args	*aa;
+	int			 size = batch->qdb_count * sizeof(*req_qbodies);
+	int			 rc, i;
+	ENTRY;
+
+	LASSERT(exp);
+	LASSERT(batch->qdb_count > 0 &&
+		batch->qdb_count <= QUOTA_DQACQ_BATCH_MAX);
+
+	req = ptlrpc_request_alloc(class_exp2cliimp(exp),
+				   &RQF_QUOTA_DQACQ_BATCH);
+	if (req == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	req_capsule_set_size(&req->rq_pill, &RMF_QUOTA_BATCH, RCL_CLIENT,
+			     size);
+	req->rq_no_resend = req->rq_no_delay = 1;
+	req->rq_no_retry_einprogress = 1;
+	rc = ptlrpc_request_pack(req, LUSTRE_MDS_VERSION, QUOTA_DQACQ_BATCH);
+	if (rc) {
+		ptlrpc_request_free(req);
+		GOTO(out, rc);
+	}
+
+	req->rq_request_portal = MDS_READPAGE_PORTAL;
+	req_qbodies = req_capsule_client_get(&req->rq_pill, &RMF_QUOTA_BATCH);
+	memcpy(req_qbodies, batch->qdb_bodies, size);
+
+	req_capsule_set_size(&req->rq_pill, &RMF_QUOTA_BATCH, RCL_SERVER,
+			     size);
+	ptlrpc_request_set_replen(req);
+
+	aa = ptlrpc_req_async_args(aa, req);
+	aa->aa_exp = exp;
+	aa->aa_arg = batch;
+	aa->aa_completion = completion;
+
+	req->rq_interpret_reply = qsd_dqacq_batch_interpret;
+	ptlrpcd_add_req(req);
+
+	RETURN(0);
+out:
+	for (i = 0; i < batch->qdb_count; i++)
+		completion(env, lqe2qqi(batch->qdb_lqes[i]),
+			   &batch->qdb_bodies[i], NULL, &batch->qdb_lockh[i],
+			   NULL, batch->qdb_lqes[i], rc);
+	OBD_FREE_PTR(batch);
+	return rc;
+}
+
 /*
  * intent quota request interpret callback.
  *
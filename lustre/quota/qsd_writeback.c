@@ -31,6 +31,7 @@
 #define DEBUG_SUBSYSTEM S_LQUOTA
 
 #include <linux/kthread.h>
+#include <linux/hash.h>
 #include "qsd_internal.h"
 
 /*
@@ -79,14 +80,33 @@ static void qsd_upd_free(struct qsd_upd_rec *upd)
 	OBD_SLAB_FREE_PTR(upd, upd_kmem);
 }
 
+/*
+ * Return the writeback worker in charge of an update record. Versioned
+ * updates have to be written in version order and are all handled by worker
+ * 0, other updates are spread over the workers by ID so that the updates of
+ * a given ID are still applied in order.
+ */
+static struct qsd_upd_worker *qsd_upd_worker(struct qsd_instance *qsd,
+					     struct qsd_upd_rec *upd)
+{
+	int idx = 0;
+
+	if (upd->qur_ver == 0)
+		idx = hash_64(upd->qur_qid.qid_uid, 32) %
+		      qsd->qsd_upd_worker_nr;
+	return &qsd->qsd_upd_workers[idx];
+}
+
 /* must hold the qsd_lock */
 static void qsd_upd_add(struct qsd_instance *qsd, struct qsd_upd_rec *upd)
 {
 	if (!qsd->qsd_stopping) {
-		list_add_tail(&upd->qur_link, &qsd->qsd_upd_list);
+		struct qsd_upd_worker *quw = qsd_upd_worker(qsd, upd);
+
+		list_add_tail(&upd->qur_link, &quw->quw_list);
 		/* wake up the upd thread */
-		if (qsd->qsd_upd_task)
-			wake_up_process(qsd->qsd_upd_task);
+		if (quw->quw_task)
+			wake_up_process(quw->quw_task);
 	} else {
 		CWARN("%s: discard update.\n", qsd->qsd_svname);
 		if (upd->qur_lqe)
@@ -176,10 +196,14 @@ static void qsd_kickoff_deferred(struct qsd_qtype_info *qqi,
 	LASSERTF(upd->qur_ver > ver, "lur_ver:%llu, cur_ver:%llu\n",
 		 upd->qur_ver, ver);
 
-	/* Kick off the deferred udpate */
-	if (upd->qur_ver == ver + 1) {
+	/* Kick off the deferred udpates with consecutive versions, the
+	 * writeback worker applies them in a single transaction */
+	list_for_each_entry_safe_from(upd, tmp, list, qur_link) {
+		if (upd->qur_ver != ver + 1)
+			break;
 		list_del_init(&upd->qur_link);
 		qsd_upd_add(qqi->qqi_qsd, upd);
+		ver++;
 	}
 	EXIT;
 }
@@ -276,25 +300,31 @@ void qsd_upd_schedule(struct qsd_qtype_info *qqi, struct lquota_entry *lqe,
 	EXIT;
 }
 
-static int qsd_process_upd(const struct lu_env *env, struct qsd_upd_rec *upd)
+/*
+ * Prepare an update record to be written to disk. The in-memory lqe is
+ * updated right away for global index updates, the in-memory lqe update for
+ * slave index copy isn't deferred and we shouldn't touch it here.
+ */
+static int qsd_upd_prep(const struct lu_env *env, struct qsd_upd_rec *upd)
 {
-	struct lquota_entry	*lqe = upd->qur_lqe;
 	struct qsd_qtype_info	*qqi = upd->qur_qqi;
+	struct lquota_entry	*lqe;
 	int			 rc;
 	ENTRY;
 
-	if (lqe == NULL) {
+	if (upd->qur_lqe == NULL) {
 		lqe = lqe_locate(env, qqi->qqi_site, &upd->qur_qid);
 		if (IS_ERR(lqe))
-			GOTO(out, rc = PTR_ERR(lqe));
+			RETURN(PTR_ERR(lqe));
+		/* reference released by qsd_upd_free() */
+		upd->qur_lqe = lqe;
 	}
+	lqe = upd->qur_lqe;
 
-	/* The in-memory lqe update for slave index copy isn't deferred,
-	 * we shouldn't touch it here. */
 	if (upd->qur_global) {
 		rc = qsd_update_lqe(env, lqe, upd->qur_global, &upd->qur_rec);
 		if (rc)
-			GOTO(out, rc);
+			RETURN(rc);
 		/* refresh usage */
 		qsd_refresh_usage(env, lqe);
 
@@ -307,10 +337,15 @@ static int qsd_process_upd(const struct lu_env *env, struct qsd_upd_rec *upd)
 		if (rc)
 			LQUOTA_ERROR(lqe, "failed to report usage, rc:%d", rc);
 	}
+	RETURN(0);
+}
+
+/* Complete an update record once written to disk with status \a rc */
+static void qsd_upd_done(struct qsd_upd_rec *upd, int rc)
+{
+	struct qsd_qtype_info	*qqi = upd->qur_qqi;
+	struct lquota_entry	*lqe = upd->qur_lqe;
 
-	rc = qsd_update_index(env, qqi, &upd->qur_qid, upd->qur_global,
-			      upd->qur_ver, &upd->qur_rec);
-out:
 	if (upd->qur_global && rc == 0 &&
 	    upd->qur_rec.lqr_glb_rec.qbr_softlimit == 0 &&
 	    upd->qur_rec.lqr_glb_rec.qbr_hardlimit == 0 &&
@@ -325,12 +360,113 @@ out:
 
 		LQUOTA_DEBUG(lqe, "update to use default quota");
 	}
+}
 
-	if (lqe && !IS_ERR(lqe)) {
-		lqe_putref(lqe);
-		upd->qur_lqe = NULL;
+/*
+ * Write a batch of update records of the same index file. The records are
+ * written in a single transaction, or one transaction per record if there
+ * is a single record or if the batched transaction failed, in which case
+ * only the last record sets the index version.
+ */
+static void qsd_process_upd_batch(const struct lu_env *env,
+				  struct list_head *batch)
+{
+	struct qsd_upd_rec	*upd, *n;
+	__u64			 ver = 0;
+	int			 rc, rc2;
+	ENTRY;
+
+	list_for_each_entry_safe(upd, n, batch, qur_link) {
+		rc = qsd_upd_prep(env, upd);
+		if (rc) {
+			list_del_init(&upd->qur_link);
+			qsd_upd_free(upd);
+			continue;
+		}
+		ver = max(ver, upd->qur_ver);
+	}
+
+	if (list_empty(batch))
+		RETURN_EXIT;
+
+	upd = list_first_entry(batch, struct qsd_upd_rec, qur_link);
+	if (list_is_singular(batch))
+		rc = -EAGAIN;
+	else
+		rc = qsd_update_index_batch(env, upd->qur_qqi,
+					    upd->qur_global, batch);
+
+	list_for_each_entry_safe(upd, n, batch, qur_link) {
+		rc2 = 0;
+		if (rc)
+			rc2 = qsd_update_index(env, upd->qur_qqi,
+					       &upd->qur_qid, upd->qur_global,
+					       list_is_last(&upd->qur_link,
+							    batch) ? ver : 0,
+					       &upd->qur_rec);
+		list_del_init(&upd->qur_link);
+		qsd_upd_done(upd, rc2);
+		qsd_upd_free(upd);
+	}
+	EXIT;
+}
+
+/* Find the update record of ID \a qid in \a list */
+static struct qsd_upd_rec *qsd_upd_find(struct list_head *list,
+					union lquota_id *qid)
+{
+	struct qsd_upd_rec *upd;
+
+	list_for_each_entry(upd, list, qur_link)
+		if (upd->qur_qid.qid_uid == qid->qid_uid)
+			return upd;
+	return NULL;
+}
+
+/*
+ * Apply the update records of \a queue. The records of a given index file
+ * are written QSD_UPD_BATCH IDs at a time, and several records of the same
+ * ID are coalesced into the most recent one since each record holds the
+ * full quota settings of the ID.
+ */
+static void qsd_process_upd_list(const struct lu_env *env,
+				 struct list_head *queue)
+{
+	LIST_HEAD(batch);
+	struct qsd_upd_rec	*first, *upd, *n, *dup;
+	int			 count;
+
+	while (!list_empty(queue)) {
+		first = list_first_entry(queue, struct qsd_upd_rec, qur_link);
+		list_move_tail(&first->qur_link, &batch);
+		count = 1;
+
+		list_for_each_entry_safe(upd, n, queue, qur_link) {
+			if (upd->qur_qqi != first->qur_qqi ||
+			    upd->qur_global != first->qur_global)
+				continue;
+
+			dup = qsd_upd_find(&batch, &upd->qur_qid);
+			if (dup != NULL) {
+				dup->qur_rec = upd->qur_rec;
+				dup->qur_ver = max(dup->qur_ver, upd->qur_ver);
+				if (dup->qur_lqe == NULL) {
+					dup->qur_lqe = upd->qur_lqe;
+					upd->qur_lqe = NULL;
+				}
+				list_del_init(&upd->qur_link);
+				qsd_upd_free(upd);
+				continue;
+			}
+
+			if (count == QSD_UPD_BATCH)
+				break;
+			list_move_tail(&upd->qur_link, &batch);
+			count++;
+		}
+
+		qsd_process_upd_batch(env, &batch);
 	}
-	RETURN(rc);
 }
 
 void qsd_adjust_schedule(struct lquota_entry *lqe, bool defer, bool cancel)
@@ -379,40 +515,44 @@ void qsd_adjust_schedule(struct lquota_entry *lqe, bool defer, bool cancel)
 		lqe_putref(lqe);
 	else {
 		read_lock(&qsd->qsd_lock);
-		if (qsd->qsd_upd_task)
-			wake_up_process(qsd->qsd_upd_task);
+		if (qsd->qsd_upd_workers[0].quw_task)
+			wake_up_process(qsd->qsd_upd_workers[0].quw_task);
 		read_unlock(&qsd->qsd_lock);
 	}
 }
 
 /* return true if there is pending writeback records or the pending
- * adjust requests */
-static bool qsd_job_pending(struct qsd_instance *qsd, struct list_head *upd,
+ * adjust requests, the latter being only handled by worker 0 */
+static bool qsd_job_pending(struct qsd_upd_worker *quw, struct list_head *upd,
 			    bool *uptodate)
 {
+	struct qsd_instance *qsd = quw->quw_qsd;
 	bool	job_pending = false;
 	int	qtype;
 
 	LASSERT(list_empty(upd));
 	*uptodate = true;
 
-	spin_lock(&qsd->qsd_adjust_lock);
-	if (!list_empty(&qsd->qsd_adjust_list)) {
-		struct lquota_entry *lqe;
-		lqe = list_entry(qsd->qsd_adjust_list.next,
-				     struct lquota_entry, lqe_link);
-		if (ktime_get_seconds() >= lqe->lqe_adjust_time)
-			job_pending = true;
+	if (quw->quw_idx == 0) {
+		spin_lock(&qsd->qsd_adjust_lock);
+		if (!list_empty(&qsd->qsd_adjust_list)) {
+			struct lquota_entry *lqe;
+			lqe = list_entry(qsd->qsd_adjust_list.next,
+					 struct lquota_entry, lqe_link);
+			if (ktime_get_seconds() >= lqe->lqe_adjust_time)
+				job_pending = true;
+		}
+		spin_unlock(&qsd->qsd_adjust_lock);
 	}
-	spin_unlock(&qsd->qsd_adjust_lock);
 
 	write_lock(&qsd->qsd_lock);
-	if (!list_empty(&qsd->qsd_upd_list)) {
-		list_splice_init(&qsd->qsd_upd_list, upd);
+	if (!list_empty(&quw->quw_list)) {
+		list_splice_init(&quw->quw_list, upd);
 		job_pending = true;
 	}
 
-	for (qtype = USRQUOTA; qtype < LL_MAXQUOTAS; qtype++) {
+	for (qtype = USRQUOTA; quw->quw_idx == 0 && qtype < LL_MAXQUOTAS;
+	     qtype++) {
 		struct qsd_qtype_info *qqi = qsd->qsd_type_array[qtype];
 
 		/* don't bother kicking off reintegration if space accounting
@@ -435,7 +575,7 @@ static bool qsd_job_pending(struct qsd_instance *qsd, struct list_head *upd,
 }
 
 struct qsd_upd_args {
-	struct qsd_instance	*qua_inst;
+	struct qsd_upd_worker	*qua_worker;
 	struct lu_env		 qua_env;
 	struct completion	*qua_started;
 };
@@ -453,9 +593,10 @@ struct qsd_upd_args {
 static int qsd_upd_thread(void *_args)
 {
 	struct qsd_upd_args	*args = _args;
-	struct qsd_instance	*qsd = args->qua_inst;
+	struct qsd_upd_worker	*quw = args->qua_worker;
+	struct qsd_instance	*qsd = quw->quw_qsd;
 	LIST_HEAD(queue);
-	struct qsd_upd_rec	*upd, *n;
+	struct qsd_dqacq_batch	*batch = NULL;
 	struct lu_env		*env = &args->qua_env;
 	int			 qtype, rc = 0;
 	bool			 uptodate;
@@ -463,19 +604,23 @@ static int qsd_upd_thread(void *_args)
 	time64_t cur_time;
 	ENTRY;
 
+	if (cfs_cpt_bind(cfs_cpt_tab, quw->quw_idx) != 0)
+		CWARN("%s: failed to bind writeback worker %d to CPT\n",
+		      qsd->qsd_svname, quw->quw_idx);
+
 	complete(args->qua_started);
 	while (({set_current_state(TASK_IDLE);
 		 !kthread_should_stop(); })) {
 
-		if (!qsd_job_pending(qsd, &queue, &uptodate))
+		if (!qsd_job_pending(quw, &queue, &uptodate))
 			schedule_timeout(cfs_time_seconds(QSD_WB_INTERVAL));
 		__set_current_state(TASK_RUNNING);
 
-		list_for_each_entry_safe(upd, n, &queue, qur_link) {
-			list_del_init(&upd->qur_link);
-			qsd_process_upd(env, upd);
-			qsd_upd_free(upd);
-		}
+		qsd_process_upd_list(env, &queue);
+
+		/* only worker 0 handles quota adjustment and reintegration */
+		if (quw->quw_idx != 0)
+			continue;
 
 		spin_lock(&qsd->qsd_adjust_lock);
 		cur_time = ktime_get_seconds();
@@ -494,13 +639,14 @@ static int qsd_upd_thread(void *_args)
 				if (lqe->lqe_adjust_time == 0)
 					qsd_id_lock_cancel(env, lqe);
 				else
-					qsd_adjust(env, lqe);
+					__qsd_adjust(env, lqe, &batch);
 			}
 
 			lqe_putref(lqe);
 			spin_lock(&qsd->qsd_adjust_lock);
 		}
 		spin_unlock(&qsd->qsd_adjust_lock);
+		qsd_adjust_flush(env, qsd, &batch);
 
 		if (uptodate || kthread_should_stop())
 			continue;
@@ -516,8 +662,9 @@ static int qsd_upd_thread(void *_args)
 	RETURN(rc);
 }
 
-int qsd_start_upd_thread(struct qsd_instance *qsd)
+static int qsd_start_upd_worker(struct qsd_upd_worker *quw)
 {
+	struct qsd_instance *qsd = quw->quw_qsd;
 	struct qsd_upd_args *args;
 	struct task_struct *task;
 	DECLARE_COMPLETION_ONSTACK(started);
@@ -533,17 +680,24 @@ int qsd_start_upd_thread(struct qsd_instance *qsd)
 		CERROR("%s: cannot init env: rc = %d\n", qsd->qsd_svname, rc);
 		goto out_free;
 	}
-	args->qua_inst = qsd;
+	args->qua_worker = quw;
 	args->qua_started = &started;
 
-	task = kthread_create(qsd_upd_thread, args,
-			      "lquota_wb_%s", qsd->qsd_svname);
+	if (quw->quw_idx == 0)
+		task = kthread_create(qsd_upd_thread, args,
+				      "lquota_wb_%s", qsd->qsd_svname);
+	else
+		task = kthread_create(qsd_upd_thread, args,
+				      "lquota_wb%d_%s", quw->quw_idx,
+				      qsd->qsd_svname);
 	if (IS_ERR(task)) {
 		rc = PTR_ERR(task);
 		CERROR("fail to start quota update thread: rc = %d\n", rc);
 		goto out_fini;
 	}
-	qsd->qsd_upd_task = task;
+	write_lock(&qsd->qsd_lock);
+	quw->quw_task = task;
+	write_unlock(&qsd->qsd_lock);
 	wake_up_process(task);
 	wait_for_completion(&started);
 
@@ -556,6 +710,25 @@ out_free:
 	RETURN(rc);
 }
 
+/*
+ * Start the writeback workers of a qsd instance, one per CPU partition up to
+ * QSD_UPD_WORKERS_MAX.
+ */
+int qsd_start_upd_thread(struct qsd_instance *qsd)
+{
+	int i, rc;
+	ENTRY;
+
+	for (i = 0; i < qsd->qsd_upd_worker_nr; i++) {
+		rc = qsd_start_upd_worker(&qsd->qsd_upd_workers[i]);
+		if (rc) {
+			qsd_stop_upd_thread(qsd);
+			RETURN(rc);
+		}
+	}
+	RETURN(0);
+}
+
 static void qsd_cleanup_deferred(struct qsd_instance *qsd)
 {
 	int	qtype;
@@ -606,14 +779,29 @@ static void qsd_cleanup_adjust(struct qsd_instance *qsd)
 
 void qsd_stop_upd_thread(struct qsd_instance *qsd)
 {
+	struct qsd_upd_worker *quw;
+	struct qsd_upd_rec *upd, *tmp;
 	struct task_struct *task;
+	int i;
 
-	write_lock(&qsd->qsd_lock);
-	task = qsd->qsd_upd_task;
-	qsd->qsd_upd_task = NULL;
-	write_unlock(&qsd->qsd_lock);
-	if (task)
-		kthread_stop(task);
+	for (i = 0; i < qsd->qsd_upd_worker_nr; i++) {
+		quw = &qsd->qsd_upd_workers[i];
+
+		write_lock(&qsd->qsd_lock);
+		task = quw->quw_task;
+		quw->quw_task = NULL;
+		write_unlock(&qsd->qsd_lock);
+		if (task)
+			kthread_stop(task);
+
+		/* drop updates queued after the worker last ran */
+		write_lock(&qsd->qsd_lock);
+		list_for_each_entry_safe(upd, tmp, &quw->quw_list, qur_link) {
+			list_del_init(&upd->qur_link);
+			qsd_upd_free(upd);
+		}
+		write_unlock(&qsd->qsd_lock);
+	}
 
 	qsd_cleanup_deferred(qsd);
 	qsd_cleanup_adjust(qsd);
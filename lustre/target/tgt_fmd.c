@@ -39,10 +39,13 @@
  *
  * FMD is organized as per-client list and identified by FID of object. Each
  * FMD stores FID of object and the highest received XID of modification
- * request for this object.
+ * request for this object. FMDs are also hashed by FID so that a client
+ * modifying many objects concurrently doesn't have to scan the whole list.
  *
  * FMD can expire if there are no updates for a long time to keep the list
- * reasonably small.
+ * reasonably small. The list is kept in LRU order and each access pushes the
+ * expiry time of the FMD by the same amount, so it is sorted by expiry time
+ * too and expired FMDs are always found at its head.
  *
  * Author: Andreas Dilger <adilger@whamcloud.com>
  * Author: Mike Pershin <mpershin@whamcloud.com>
@@ -55,6 +58,36 @@
 
 #include "tgt_internal.h"
 
+static const struct rhashtable_params tgt_fmd_hash_params = {
+	.key_len	= sizeof(struct lu_fid),
+	.key_offset	= offsetof(struct tgt_fmd_data, fmd_fid),
+	.head_offset	= offsetof(struct tgt_fmd_data, fmd_hash),
+	.automatic_shrinking = true,
+};
+
+/**
+ * Initialize FMD list and hash of the export.
+ *
+ * \param[in] exp	OBD export
+ *
+ * \retval		0 on success
+ * \retval		negative value on error
+ */
+int tgt_fmd_init(struct obd_export *exp)
+{
+	struct tg_export_data *ted = &exp->exp_target_data;
+	int rc;
+
+	spin_lock_init(&ted->ted_fmd_lock);
+	INIT_LIST_HEAD(&ted->ted_fmd_list);
+	ted->ted_fmd_count = 0;
+
+	rc = rhashtable_init(&ted->ted_fmd_hash, &tgt_fmd_hash_params);
+	ted->ted_fmd_hash_inited = rc == 0;
+
+	return rc;
+}
+
 /**
  * Drop FMD reference and free it if reference drops to zero.
  *
@@ -76,6 +109,26 @@ static inline void tgt_fmd_put_nolock(struct obd_export *exp,
 	}
 }
 
+/**
+ * Remove FMD from the export list and hash, and drop the list reference.
+ *
+ * Must be called with ted_fmd_lock held.
+ *
+ * \param[in] exp	OBD export
+ * \param[in] fmd	FMD to unlink
+ */
+static void tgt_fmd_unlink_nolock(struct obd_export *exp,
+				  struct tgt_fmd_data *fmd)
+{
+	struct tg_export_data *ted = &exp->exp_target_data;
+
+	assert_spin_locked(&ted->ted_fmd_lock);
+	list_del_init(&fmd->fmd_list);
+	rhashtable_remove_fast(&ted->ted_fmd_hash, &fmd->fmd_hash,
+			       tgt_fmd_hash_params);
+	tgt_fmd_put_nolock(exp, fmd); /* list reference */
+}
+
 /**
  * Wrapper to drop FMD reference with ted_fmd_lock held.
  *
@@ -122,8 +175,7 @@ static void tgt_fmd_expire_nolock(struct obd_export *exp,
 		    ted->ted_fmd_count < lut->lut_fmd_max_num)
 			break;
 
-		list_del_init(&fmd->fmd_list);
-		tgt_fmd_put_nolock(exp, fmd); /* list reference */
+		tgt_fmd_unlink_nolock(exp, fmd);
 	}
 }
 
@@ -146,7 +198,7 @@ void tgt_fmd_expire(struct obd_export *exp)
 /**
  * Find FMD by specified FID.
  *
- * Function finds FMD entry by FID in the tg_export_data::ted_fmd_list.
+ * Function finds FMD entry by FID in the tg_export_data::ted_fmd_hash.
  *
  * Caller must hold tg_export_data::ted_fmd_lock and take FMD reference.
  *
@@ -160,19 +212,21 @@ static struct tgt_fmd_data *tgt_fmd_find_nolock(struct obd_export *exp,
 						const struct lu_fid *fid)
 {
 	struct tg_export_data *ted = &exp->exp_target_data;
-	struct tgt_fmd_data *found = NULL, *fmd;
+	struct tgt_fmd_data *found;
 	struct lu_target *lut = exp->exp_obd->u.obt.obt_lut;
 	time64_t now = ktime_get_seconds();
 
 	assert_spin_locked(&ted->ted_fmd_lock);
 
-	list_for_each_entry_reverse(fmd, &ted->ted_fmd_list, fmd_list) {
-		if (lu_fid_eq(&fmd->fmd_fid, fid)) {
-			found = fmd;
-			list_move_tail(&fmd->fmd_list, &ted->ted_fmd_list);
-			fmd->fmd_expire = now + lut->lut_fmd_max_age;
-			break;
-		}
+	/* the export setup failed, it tracks no FMD */
+	if (!ted->ted_fmd_hash_inited)
+		return NULL;
+
+	found = rhashtable_lookup_fast(&ted->ted_fmd_hash, fid,
+				       tgt_fmd_hash_params);
+	if (found) {
+		list_move_tail(&found->fmd_list, &ted->ted_fmd_list);
+		found->fmd_expire = now + lut->lut_fmd_max_age;
 	}
 
 	tgt_fmd_expire_nolock(exp, found);
@@ -226,14 +280,21 @@ struct tgt_fmd_data *tgt_fmd_get(struct obd_export *exp,
 	struct tg_export_data *ted = &exp->exp_target_data;
 	struct tgt_fmd_data *found = NULL, *fmd_new = NULL;
 
+	/* the export setup failed, it tracks no FMD */
+	if (!ted->ted_fmd_hash_inited)
+		return NULL;
+
 	OBD_SLAB_ALLOC_PTR(fmd_new, tgt_fmd_kmem);
 
 	spin_lock(&ted->ted_fmd_lock);
 	found = tgt_fmd_find_nolock(exp, fid);
 	if (fmd_new) {
-		if (!found) {
+		fmd_new->fmd_fid = *fid;
+		if (!found &&
+		    rhashtable_insert_fast(&ted->ted_fmd_hash,
+					   &fmd_new->fmd_hash,
+					   tgt_fmd_hash_params) == 0) {
 			list_add_tail(&fmd_new->fmd_list, &ted->ted_fmd_list);
-			fmd_new->fmd_fid = *fid;
 			fmd_new->fmd_refcount++;   /* list reference */
 			found = fmd_new;
 			ted->ted_fmd_count++;
@@ -278,10 +339,8 @@ void tgt_fmd_drop(struct obd_export *exp, const struct lu_fid *fid)
 
 	spin_lock(&ted->ted_fmd_lock);
 	fmd = tgt_fmd_find_nolock(exp, fid);
-	if (fmd) {
-		list_del_init(&fmd->fmd_list);
-		tgt_fmd_put_nolock(exp, fmd);
-	}
+	if (fmd)
+		tgt_fmd_unlink_nolock(exp, fmd);
 	spin_unlock(&ted->ted_fmd_lock);
 }
 EXPORT_SYMBOL(tgt_fmd_drop);
@@ -290,7 +349,9 @@ EXPORT_SYMBOL(tgt_fmd_drop);
 /**
  * Remove all entries from FMD list.
  *
- * Cleanup function to free all FMD enries on the given export.
+ * Cleanup function to free all FMD enries on the given export and the FMD
+ * hash itself. It may be called several times, or for an export whose FMD
+ * hash could not be set up.
  *
  * \param[in] exp	OBD export
  */
@@ -299,18 +360,22 @@ void tgt_fmd_cleanup(struct obd_export *exp)
 	struct tg_export_data *ted = &exp->exp_target_data;
 	struct tgt_fmd_data *fmd = NULL, *tmp;
 
+	if (!ted->ted_fmd_hash_inited)
+		return;
+
 	spin_lock(&ted->ted_fmd_lock);
 	list_for_each_entry_safe(fmd, tmp, &ted->ted_fmd_list, fmd_list) {
-		list_del_init(&fmd->fmd_list);
 		if (fmd->fmd_refcount > 1) {
 			CDEBUG(D_INFO,
 			       "fmd %p still referenced (refcount = %d)\n",
 			       fmd, fmd->fmd_refcount);
 		}
-		tgt_fmd_put_nolock(exp, fmd);
+		tgt_fmd_unlink_nolock(exp, fmd);
 	}
 	spin_unlock(&ted->ted_fmd_lock);
 	LASSERT(list_empty(&exp->exp_target_data.ted_fmd_list));
+	rhashtable_destroy(&ted->ted_fmd_hash);
+	ted->ted_fmd_hash_inited = false;
 }
 
 /**
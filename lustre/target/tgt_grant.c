@@ -67,6 +67,15 @@
  * - allocating server-side grant space for synchronous write RPCs which did not
  *   consume grant on the client side (OBD_BRW_FROM_GRANT flag not set). If not
  *   enough space is available, such RPCs fail with ENOSPC
+ * - releasing pending grant space at commit time. This is done for each bulk
+ *   write, so released space is first accumulated in per-CPT caches and only
+ *   folded into the global counters in batches, when statfs data are
+ *   refreshed or when running low on space (see tgt_grant_cache_flush())
+ *
+ * Only the release of grant at commit time goes through the per-CPT caches.
+ * Grant allocation (tgt_grant_prepare_write(), tgt_grant_alloc(),
+ * tgt_grant_connect()) still runs under tgd_grant_lock since it needs exact
+ * free space to decide how much grant an export can get.
  *
  * Author: Johann Lombardi <johann.lombardi@intel.com>
  */
@@ -81,6 +90,15 @@
 /* Clients typically hold 2x their max_rpcs_in_flight of grant space */
 #define TGT_GRANT_SHRINK_LIMIT(exp)	(2ULL * 8 * exp_max_brw_size(exp))
 
+/* Maximum amount of released grant space kept in one per-CPT cache before
+ * it is folded into the global counters */
+#define TGT_GRANT_CACHE_MAX		(32ULL << 20)
+
+/* Space possibly hidden in the per-CPT caches, tgd_tot_granted is exact
+ * enough as long as there is more than this left on the target */
+#define TGT_GRANT_CACHE_MARGIN		(cfs_cpt_number(cfs_cpt_tab) * \
+					 TGT_GRANT_CACHE_MAX)
+
 /* Helpers to inflate/deflate grants for clients that do not support the grant
  * parameters */
 static inline u64 tgt_grant_inflate(struct tg_grants_data *tgd, u64 val)
@@ -132,23 +150,119 @@ static inline u64 tgt_grant_chunk(struct obd_export *exp,
 	return chunk;
 }
 
+/**
+ * Fold grant space released in one per-CPT cache into the global counters.
+ *
+ * Caller must hold tgd_grant_lock spinlock and the per-CPT lock protecting
+ * \a tgc.
+ *
+ * \param[in] tgd	grant data of the target
+ * \param[in] tgc	per-CPT cache to fold
+ */
+static void tgt_grant_cache_fold(struct tg_grants_data *tgd,
+				 struct tg_grant_cache *tgc)
+{
+	assert_spin_locked(&tgd->tgd_grant_lock);
+
+	if (tgc->tgc_released == 0)
+		return;
+
+	if (tgc->tgc_written != 0) {
+		spin_lock(&tgd->tgd_osfs_lock);
+		/* Take written space out of cached statfs data */
+		tgd->tgd_osfs.os_bavail -= min_t(u64, tgd->tgd_osfs.os_bavail,
+					tgc->tgc_written >> tgd->tgd_blockbits);
+		if (tgd->tgd_statfs_inflight)
+			/* someone is running statfs and want to be notified of
+			 * writes happening meanwhile */
+			tgd->tgd_osfs_inflight += tgc->tgc_written;
+		spin_unlock(&tgd->tgd_osfs_lock);
+	}
+
+	LASSERTF(tgd->tgd_tot_granted >= tgc->tgc_released,
+		 "tot_granted(%llu) < released(%llu)\n",
+		 tgd->tgd_tot_granted, tgc->tgc_released);
+	LASSERTF(tgd->tgd_tot_pending >= tgc->tgc_released,
+		 "tot_pending(%llu) < released(%llu)\n",
+		 tgd->tgd_tot_pending, tgc->tgc_released);
+	tgd->tgd_tot_granted -= tgc->tgc_released;
+	tgd->tgd_tot_pending -= tgc->tgc_released;
+	tgc->tgc_released = 0;
+	tgc->tgc_written = 0;
+}
+
+/**
+ * Fold all per-CPT caches of released grant space into the global counters.
+ *
+ * Once done, tgd_tot_granted and tgd_tot_pending are exact and match the sum
+ * of per-export counters, until the grant lock is released.
+ * Caller must hold tgd_grant_lock spinlock.
+ *
+ * \param[in] tgd	grant data of the target
+ */
+static void tgt_grant_cache_flush_locked(struct tg_grants_data *tgd)
+{
+	struct tg_grant_cache *tgc;
+	int i;
+
+	assert_spin_locked(&tgd->tgd_grant_lock);
+
+	if (tgd->tgd_grant_caches == NULL)
+		return;
+
+	cfs_percpt_lock(tgd->tgd_grant_pcl, CFS_PERCPT_LOCK_EX);
+	cfs_percpt_for_each(tgc, i, tgd->tgd_grant_caches)
+		tgt_grant_cache_fold(tgd, tgc);
+	cfs_percpt_unlock(tgd->tgd_grant_pcl, CFS_PERCPT_LOCK_EX);
+}
+
+/**
+ * Reconcile global grant counters with per-CPT caches.
+ *
+ * \param[in] tgd	grant data of the target
+ */
+static void tgt_grant_cache_flush(struct tg_grants_data *tgd)
+{
+	spin_lock(&tgd->tgd_grant_lock);
+	tgt_grant_cache_flush_locked(tgd);
+	spin_unlock(&tgd->tgd_grant_lock);
+}
+
+/**
+ * Release per-CPT grant caches of a target.
+ *
+ * \param[in] tgd	grant data of the target
+ */
+void tgt_grant_cache_fini(struct tg_grants_data *tgd)
+{
+	if (tgd->tgd_grant_caches != NULL) {
+		cfs_percpt_free(tgd->tgd_grant_caches);
+		tgd->tgd_grant_caches = NULL;
+	}
+	if (tgd->tgd_grant_pcl != NULL) {
+		cfs_percpt_lock_free(tgd->tgd_grant_pcl);
+		tgd->tgd_grant_pcl = NULL;
+	}
+}
+
 static int tgt_check_export_grants(struct obd_export *exp, u64 *dirty,
 				   u64 *pending, u64 *granted, u64 maxsize)
 {
 	struct tg_export_data *ted = &exp->exp_target_data;
+	long ted_pending = atomic_long_read(&ted->ted_pending);
 	int level = D_CACHE;
 
-	if (ted->ted_grant < 0 || ted->ted_pending < 0 || ted->ted_dirty < 0)
+	if (ted->ted_grant < 0 || ted_pending < 0 || ted->ted_dirty < 0)
 		level = D_ERROR;
 	CDEBUG_LIMIT(level, "%s: cli %s/%p dirty %ld pend %ld grant %ld\n",
 		     exp->exp_obd->obd_name, exp->exp_client_uuid.uuid, exp,
-		     ted->ted_dirty, ted->ted_pending, ted->ted_grant);
+		     ted->ted_dirty, ted_pending, ted->ted_grant);
 
-	if (ted->ted_grant + ted->ted_pending > maxsize) {
+	if (ted->ted_grant + ted_pending > maxsize) {
 		CERROR("%s: cli %s/%p ted_grant(%ld) + ted_pending(%ld)"
 			" > maxsize(%llu)\n", exp->exp_obd->obd_name,
 			exp->exp_client_uuid.uuid, exp, ted->ted_grant,
-			ted->ted_pending, maxsize);
+			ted_pending, maxsize);
 		return -EFAULT;
 	}
 	if (ted->ted_dirty > maxsize) {
@@ -157,8 +271,8 @@ static int tgt_check_export_grants(struct obd_export *exp, u64 *dirty,
 			exp, ted->ted_dirty, maxsize);
 		return -EFAULT;
 	}
-	*granted += ted->ted_grant + ted->ted_pending;
-	*pending += ted->ted_pending;
+	*granted += ted->ted_grant + ted_pending;
+	*pending += ted_pending;
 	*dirty += ted->ted_dirty;
 	return 0;
 }
@@ -205,19 +319,27 @@ void tgt_grant_sanity_check(struct obd_device *obd, const char *func)
 
 	spin_lock(&obd->obd_dev_lock);
 	spin_lock(&tgd->tgd_grant_lock);
+	/* get exact global counters and keep tgt_grant_commit() away while
+	 * per-export counters are scanned */
+	tgt_grant_cache_flush_locked(tgd);
+	if (tgd->tgd_grant_pcl != NULL)
+		cfs_percpt_lock(tgd->tgd_grant_pcl, CFS_PERCPT_LOCK_EX);
 	exp = obd->obd_self_export;
 	ted = &exp->exp_target_data;
 	CDEBUG(D_CACHE, "%s: processing self export: %ld %ld "
 	       "%ld\n", obd->obd_name, ted->ted_grant,
-	       ted->ted_pending, ted->ted_dirty);
-	tot_granted += ted->ted_grant + ted->ted_pending;
-	tot_pending += ted->ted_pending;
+	       atomic_long_read(&ted->ted_pending), ted->ted_dirty);
+	tot_granted += ted->ted_grant + atomic_long_read(&ted->ted_pending);
+	tot_pending += atomic_long_read(&ted->ted_pending);
 	tot_dirty += ted->ted_dirty;
 
 	list_for_each_entry(exp, &obd->obd_exports, exp_obd_chain) {
 		error = tgt_check_export_grants(exp, &tot_dirty, &tot_pending,
 						&tot_granted, maxsize);
 		if (error < 0) {
+			if (tgd->tgd_grant_pcl != NULL)
+				cfs_percpt_unlock(tgd->tgd_grant_pcl,
+						  CFS_PERCPT_LOCK_EX);
 			spin_unlock(&obd->obd_dev_lock);
 			spin_unlock(&tgd->tgd_grant_lock);
 			LBUG();
@@ -231,6 +353,9 @@ void tgt_grant_sanity_check(struct obd_device *obd, const char *func)
 		error = tgt_check_export_grants(exp, &tot_dirty, &tot_pending,
 						&tot_granted, maxsize);
 		if (error < 0) {
+			if (tgd->tgd_grant_pcl != NULL)
+				cfs_percpt_unlock(tgd->tgd_grant_pcl,
+						  CFS_PERCPT_LOCK_EX);
 			spin_unlock(&obd->obd_dev_lock);
 			spin_unlock(&tgd->tgd_grant_lock);
 			LBUG();
@@ -240,6 +365,8 @@ void tgt_grant_sanity_check(struct obd_device *obd, const char *func)
 	fo_tot_granted = tgd->tgd_tot_granted;
 	fo_tot_pending = tgd->tgd_tot_pending;
 	fo_tot_dirty = tgd->tgd_tot_dirty;
+	if (tgd->tgd_grant_pcl != NULL)
+		cfs_percpt_unlock(tgd->tgd_grant_pcl, CFS_PERCPT_LOCK_EX);
 	spin_unlock(&obd->obd_dev_lock);
 	spin_unlock(&tgd->tgd_grant_lock);
 
@@ -286,6 +413,12 @@ int tgt_statfs_internal(const struct lu_env *env, struct lu_target *lut,
 	int rc = 0;
 	ENTRY;
 
+	/* statfs data are about to be refreshed, fold space written by
+	 * already committed I/Os into cached data first so that it isn't
+	 * accounted as unstable below */
+	if (tgd->tgd_osfs_age < max_age || max_age == 0)
+		tgt_grant_cache_flush(tgd);
+
 	spin_lock(&tgd->tgd_osfs_lock);
 	if (tgd->tgd_osfs_age < max_age || max_age == 0) {
 		u64 unstable;
@@ -316,6 +449,8 @@ int tgt_statfs_internal(const struct lu_env *env, struct lu_target *lut,
 		osfs->os_namelen = min_t(__u32, osfs->os_namelen, NAME_MAX);
 
 		spin_lock(&tgd->tgd_grant_lock);
+		/* get exact tgd_tot_pending */
+		tgt_grant_cache_flush_locked(tgd);
 		spin_lock(&tgd->tgd_osfs_lock);
 		/* calculate how much space was written while we released the
 		 * tgd_osfs_lock */
@@ -446,6 +581,18 @@ static u64 tgt_grant_space_left(struct obd_export *exp)
 	unstable = tgd->tgd_osfs_unstable; /* those might be accounted twice */
 	spin_unlock(&tgd->tgd_osfs_lock);
 
+	/* Space released by committed writes might still be accounted in
+	 * tgd_tot_granted. This is harmless as long as there is plenty of
+	 * space left, but get exact counters when running low on space */
+	if (left < tgd->tgd_tot_granted + TGT_GRANT_CACHE_MARGIN) {
+		tgt_grant_cache_flush_locked(tgd);
+
+		spin_lock(&tgd->tgd_osfs_lock);
+		left = tgd->tgd_osfs.os_bavail << tgd->tgd_blockbits;
+		unstable = tgd->tgd_osfs_unstable;
+		spin_unlock(&tgd->tgd_osfs_lock);
+	}
+
 	reserved = left * tgd->tgd_reserved_pcnt / 100;
 	tot_granted = tgd->tgd_tot_granted + reserved;
 
@@ -565,10 +712,12 @@ static void tgt_grant_incoming(const struct lu_env *env, struct obd_export *exp,
 	ted->ted_grant -= dropped;
 	ted->ted_dirty = dirty;
 
-	if (ted->ted_dirty < 0 || ted->ted_grant < 0 || ted->ted_pending < 0) {
+	if (ted->ted_dirty < 0 || ted->ted_grant < 0 ||
+	    atomic_long_read(&ted->ted_pending) < 0) {
 		CERROR("%s: cli %s/%p dirty %ld pend %ld grant %ld\n",
 		       obd->obd_name, exp->exp_client_uuid.uuid, exp,
-		       ted->ted_dirty, ted->ted_pending, ted->ted_grant);
+		       ted->ted_dirty, atomic_long_read(&ted->ted_pending),
+		       ted->ted_grant);
 		spin_unlock(&tgd->tgd_grant_lock);
 		LBUG();
 	}
@@ -838,7 +987,7 @@ static void tgt_grant_check(const struct lu_env *env, struct obd_export *exp,
 	 * that space before we have actually allocated our blocks. That
 	 * happens in tgt_grant_commit() after the writes are done. */
 	ted->ted_grant -= granted;
-	ted->ted_pending += oa->o_grant_used;
+	atomic_long_add(oa->o_grant_used, &ted->ted_pending);
 	tgd->tgd_tot_granted += ungranted;
 	tgd->tgd_tot_pending += oa->o_grant_used;
 
@@ -861,10 +1010,12 @@ static void tgt_grant_check(const struct lu_env *env, struct obd_export *exp,
 	tgd->tgd_tot_dirty -= granted;
 	ted->ted_dirty -= granted;
 
-	if (ted->ted_dirty < 0 || ted->ted_grant < 0 || ted->ted_pending < 0) {
+	if (ted->ted_dirty < 0 || ted->ted_grant < 0 ||
+	    atomic_long_read(&ted->ted_pending) < 0) {
 		CERROR("%s: cli %s/%p dirty %ld pend %ld grant %ld\n",
 		       obd->obd_name, exp->exp_client_uuid.uuid, exp,
-		       ted->ted_dirty, ted->ted_pending, ted->ted_grant);
+		       ted->ted_dirty, atomic_long_read(&ted->ted_pending),
+		       ted->ted_grant);
 		spin_unlock(&tgd->tgd_grant_lock);
 		LBUG();
 	}
@@ -1099,10 +1250,11 @@ void tgt_grant_discard(struct obd_export *exp)
 	}
 	tgd->tgd_tot_granted -= ted->ted_grant;
 	ted->ted_grant = 0;
-	if (tgd->tgd_tot_pending < ted->ted_pending) {
+	if (tgd->tgd_tot_pending < atomic_long_read(&ted->ted_pending)) {
 		CERROR("%s: tot_pending %llu < cli %s/%p ted_pending %ld\n",
 		       obd->obd_name, tgd->tgd_tot_pending,
-		       exp->exp_client_uuid.uuid, exp, ted->ted_pending);
+		       exp->exp_client_uuid.uuid, exp,
+		       atomic_long_read(&ted->ted_pending));
 	}
 	/* tgd_tot_pending is handled in tgt_grant_commit as bulk
 	 * commmits */
@@ -1206,6 +1358,7 @@ EXPORT_SYMBOL(tgt_grant_prepare_read);
  * the backend storage. This function works in pair with tgt_grant_commit()
  * which must be invoked once all buffers have been written to disk in order
  * to release space from the pending grant counter.
+ * Unlike tgt_grant_commit(), it is serialized by tgd_grant_lock.
  *
  * \param[in] env	LU environment provided by the caller
  * \param[in] exp	export of the client which sent the request
@@ -1383,7 +1536,7 @@ long tgt_grant_create(const struct lu_env *env, struct obd_export *exp, s64 *nr)
 		ted->ted_grant = 0;
 	}
 	granted = wanted;
-	ted->ted_pending += granted;
+	atomic_long_add(granted, &ted->ted_pending);
 	tgd->tgd_tot_pending += granted;
 
 	/* grant more space for precreate purpose if possible. */
@@ -1407,6 +1560,11 @@ EXPORT_SYMBOL(tgt_grant_create);
  * Release grant space added to the pending counter by tgt_grant_prepare_write()
  *
  * Update pending grant counter once buffers have been written to the disk.
+ * This is called for each bulk write, mostly from the commit callbacks, so
+ * the global grant lock isn't taken here. Released space is accumulated in
+ * the per-CPT cache of the current CPU partition instead, and folded into
+ * tgd_tot_granted/tgd_tot_pending once the cache is large enough or when
+ * exact global counters are needed (see tgt_grant_cache_flush()).
  *
  * \param[in] exp	export of the client which sent the request
  * \param[in] pending	amount of reserved space to be released
@@ -1416,6 +1574,10 @@ void tgt_grant_commit(struct obd_export *exp, unsigned long pending,
 		      int rc)
 {
 	struct tg_grants_data *tgd = &exp->exp_obd->u.obt.obt_lut->lut_tgd;
+	struct tg_export_data *ted = &exp->exp_target_data;
+	struct tg_grant_cache *tgc;
+	bool flush;
+	int cpt;
 
 	ENTRY;
 
@@ -1424,53 +1586,37 @@ void tgt_grant_commit(struct obd_export *exp, unsigned long pending,
 	if (pending == 0)
 		RETURN_EXIT;
 
-	spin_lock(&tgd->tgd_grant_lock);
+	cpt = cfs_cpt_current(cfs_cpt_tab, 0);
+	cfs_percpt_lock(tgd->tgd_grant_pcl, cpt);
+	if (atomic_long_read(&ted->ted_pending) < pending) {
+		CERROR("%s: cli %s/%p ted_pending(%lu) < grant_used(%lu)\n",
+		       exp->exp_obd->obd_name, exp->exp_client_uuid.uuid, exp,
+		       atomic_long_read(&ted->ted_pending), pending);
+		cfs_percpt_unlock(tgd->tgd_grant_pcl, cpt);
+		LBUG();
+	}
+	atomic_long_sub(pending, &ted->ted_pending);
+
+	tgc = tgd->tgd_grant_caches[cpt];
+	tgc->tgc_released += pending;
 	/* Don't update statfs data for errors raised before commit (e.g.
 	 * bulk transfer failed, ...) since we know those writes have not been
 	 * processed. For other errors hit during commit, we cannot really tell
 	 * whether or not something was written, so we update statfs data.
 	 * In any case, this should not be fatal since we always get fresh
 	 * statfs data before failing a request with ENOSPC */
-	if (rc == 0) {
-		spin_lock(&tgd->tgd_osfs_lock);
-		/* Take pending out of cached statfs data */
-		tgd->tgd_osfs.os_bavail -= min_t(u64,
-						 tgd->tgd_osfs.os_bavail,
-						 pending >> tgd->tgd_blockbits);
-		if (tgd->tgd_statfs_inflight)
-			/* someone is running statfs and want to be notified of
-			 * writes happening meanwhile */
-			tgd->tgd_osfs_inflight += pending;
-		spin_unlock(&tgd->tgd_osfs_lock);
-	}
+	if (rc == 0)
+		tgc->tgc_written += pending;
+	flush = tgc->tgc_released >= TGT_GRANT_CACHE_MAX;
+	cfs_percpt_unlock(tgd->tgd_grant_pcl, cpt);
 
-	if (exp->exp_target_data.ted_pending < pending) {
-		CERROR("%s: cli %s/%p ted_pending(%lu) < grant_used(%lu)\n",
-		       exp->exp_obd->obd_name, exp->exp_client_uuid.uuid, exp,
-		       exp->exp_target_data.ted_pending, pending);
-		spin_unlock(&tgd->tgd_grant_lock);
-		LBUG();
-	}
-	exp->exp_target_data.ted_pending -= pending;
-
-	if (tgd->tgd_tot_granted < pending) {
-		CERROR("%s: cli %s/%p tot_granted(%llu) < grant_used(%lu)\n",
-		       exp->exp_obd->obd_name, exp->exp_client_uuid.uuid, exp,
-		       tgd->tgd_tot_granted, pending);
-		spin_unlock(&tgd->tgd_grant_lock);
-		LBUG();
-	}
-	tgd->tgd_tot_granted -= pending;
-
-	if (tgd->tgd_tot_pending < pending) {
-		CERROR("%s: cli %s/%p tot_pending(%llu) < grant_used(%lu)\n",
-		       exp->exp_obd->obd_name, exp->exp_client_uuid.uuid, exp,
-		       tgd->tgd_tot_pending, pending);
+	if (flush) {
+		spin_lock(&tgd->tgd_grant_lock);
+		cfs_percpt_lock(tgd->tgd_grant_pcl, cpt);
+		tgt_grant_cache_fold(tgd, tgc);
+		cfs_percpt_unlock(tgd->tgd_grant_pcl, cpt);
 		spin_unlock(&tgd->tgd_grant_lock);
-		LBUG();
 	}
-	tgd->tgd_tot_pending -= pending;
-	spin_unlock(&tgd->tgd_grant_lock);
 	EXIT;
 }
 EXPORT_SYMBOL(tgt_grant_commit);
@@ -1588,6 +1734,7 @@ ssize_t tot_granted_show(struct kobject *kobj, struct attribute *attr,
 	struct tg_grants_data *tgd;
 
 	tgd = &obd->u.obt.obt_lut->lut_tgd;
+	tgt_grant_cache_flush(tgd);
 	return scnprintf(buf, PAGE_SIZE, "%llu\n", tgd->tgd_tot_granted);
 }
 EXPORT_SYMBOL(tot_granted_show);
@@ -1610,6 +1757,7 @@ ssize_t tot_pending_show(struct kobject *kobj, struct attribute *attr,
 	struct tg_grants_data *tgd;
 
 	tgd = &obd->u.obt.obt_lut->lut_tgd;
+	tgt_grant_cache_flush(tgd);
 	return scnprintf(buf, PAGE_SIZE, "%llu\n", tgd->tgd_tot_pending);
 }
 EXPORT_SYMBOL(tot_pending_show);
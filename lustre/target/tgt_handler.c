@@ -185,6 +185,24 @@ out:
 }
 EXPORT_SYMBOL(tgt_validate_obdo);
 
+/**
+ * Allow the request being handled to run several transactions.
+ *
+ * Every transaction gets its own transno and last_rcvd update, the reply
+ * carries the last one, so the client sees the request as committed only
+ * once all of them are. A replayed request keeps the single transno it was
+ * assigned, see tgt_txn_stop_cb().
+ *
+ * \param[in] tsi	target session environment for this request
+ */
+void tgt_mult_trans_enable(struct tgt_session_info *tsi)
+{
+	struct tgt_thread_info *tti = tgt_th_info(tsi->tsi_env);
+
+	tti->tti_mult_trans = !req_is_replay(tgt_ses_req(tsi));
+}
+EXPORT_SYMBOL(tgt_mult_trans_enable);
+
 static int tgt_io_data_unpack(struct tgt_session_info *tsi, struct ost_id *oi)
 {
 	unsigned		 max_brw;
@@ -1261,19 +1279,114 @@ TGT_OBD_HDL    (0,	OBD_IDX_READ,		tgt_obd_idx_read)
 };
 EXPORT_SYMBOL(tgt_obd_handlers);
 
+/* how long a sync request waits for a group commit before falling back
+ * to syncing the object itself */
+#define TGT_SYNC_COMMIT_WAIT	5
+
+/**
+ * Wait for \a transno to be committed to disk.
+ *
+ * The first request finding \a transno uncommitted starts an async commit
+ * covering every transaction done so far, other requests arriving before
+ * that commit completes just wait for it. All of them are released at once
+ * by tgt_cb_last_committed(), so concurrent sync requests from many clients
+ * share a single journal commit and their replies are sent together.
+ *
+ * \param[in] env	execution environment
+ * \param[in] tgt	target
+ * \param[in] transno	transaction number to wait for
+ *
+ * \retval		0 if \a transno is committed
+ * \retval		-ETIMEDOUT if the commit did not complete in time
+ * \retval		negative value if the commit could not be started
+ */
+static int tgt_sync_commit_wait(const struct lu_env *env,
+				struct lu_target *tgt, __u64 transno)
+{
+	struct obd_device *obd = tgt->lut_obd;
+	bool kick = false;
+	int rc;
+
+	spin_lock(&tgt->lut_translock);
+	if (transno > tgt->lut_sync_kicked) {
+		tgt->lut_sync_kicked = tgt->lut_last_transno;
+		kick = true;
+	}
+	spin_unlock(&tgt->lut_translock);
+
+	if (kick) {
+		rc = dt_commit_async(env, tgt->lut_bottom);
+		if (rc < 0) {
+			spin_lock(&tgt->lut_translock);
+			tgt->lut_sync_kicked = obd->obd_last_committed;
+			spin_unlock(&tgt->lut_translock);
+			return rc;
+		}
+		atomic_inc(&tgt->lut_sync_group_commits);
+	}
+
+	rc = wait_event_idle_timeout(tgt->lut_commit_waitq,
+				     transno <= obd->obd_last_committed,
+				     cfs_time_seconds(TGT_SYNC_COMMIT_WAIT));
+
+	return rc > 0 ? 0 : -ETIMEDOUT;
+}
+
+/**
+ * Sync the whole target device.
+ *
+ * Requests arriving while a device sync is in progress do not start
+ * another one each: once the current sync is done, the first of them
+ * syncs on behalf of all the others, which then return its result.
+ *
+ * \param[in] env	execution environment
+ * \param[in] tgt	target
+ *
+ * \retval		0 if successful
+ * \retval		negative value on error
+ */
+static int tgt_sync_device(const struct lu_env *env, struct lu_target *tgt)
+{
+	__u64 started = READ_ONCE(tgt->lut_sync_started);
+	int rc;
+
+	mutex_lock(&tgt->lut_sync_mutex);
+	/* a sync started after our arrival has covered us */
+	if (tgt->lut_sync_done > started) {
+		rc = tgt->lut_sync_rc;
+	} else {
+		tgt->lut_sync_started++;
+		rc = dt_sync(env, tgt->lut_bottom);
+		tgt->lut_sync_rc = rc;
+		tgt->lut_sync_done = tgt->lut_sync_started;
+	}
+	mutex_unlock(&tgt->lut_sync_mutex);
+
+	return rc;
+}
+
 int tgt_sync(const struct lu_env *env, struct lu_target *tgt,
 	     struct dt_object *obj, __u64 start, __u64 end)
 {
+	__u64 version;
 	int rc = 0;
 
 	ENTRY;
 
 	/* if no objid is specified, it means "sync whole filesystem" */
 	if (obj == NULL) {
-		rc = dt_sync(env, tgt->lut_bottom);
-	} else if (dt_version_get(env, obj) >
-		   tgt->lut_obd->obd_last_committed) {
-		rc = dt_object_sync(env, obj, start, end);
+		rc = tgt_sync_device(env, tgt);
+	} else {
+		version = dt_version_get(env, obj);
+		if (version > tgt->lut_obd->obd_last_committed) {
+			/* only the journal commit is missing, join the group
+			 * commit, sync the object itself if that fails */
+			rc = tgt_sync_commit_wait(env, tgt, version);
+			if (rc < 0)
+				rc = dt_object_sync(env, obj, start, end);
+			else
+				atomic_inc(&tgt->lut_sync_group_reqs);
+		}
 	}
 	atomic_inc(&tgt->lut_sync_count);
 
@@ -288,6 +288,7 @@ void barrier_fini(void);
 /* FMD tracking data */
 struct tgt_fmd_data {
 	struct list_head fmd_list;	  /* linked to tgt_fmd_list */
+	struct rhash_head fmd_hash;	  /* linked to ted_fmd_hash */
 	struct lu_fid	 fmd_fid;	  /* FID being written to */
 	__u64		 fmd_mactime_xid; /* xid highest {m,a,c}time setattr */
 	time64_t	 fmd_expire;	  /* time when the fmd should expire */
@@ -296,7 +297,11 @@ struct tgt_fmd_data {
 
 /* tgt_fmd.c */
 extern struct kmem_cache *tgt_fmd_kmem;
+int tgt_fmd_init(struct obd_export *exp);
 void tgt_fmd_expire(struct obd_export *exp);
 void tgt_fmd_cleanup(struct obd_export *exp);
 
+/* tgt_grant.c */
+void tgt_grant_cache_fini(struct tg_grants_data *tgd);
+
 #endif /* _TG_INTERNAL_H */
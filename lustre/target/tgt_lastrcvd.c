@@ -390,17 +390,22 @@ static inline struct lu_buf *tti_buf_lcd(struct tgt_thread_info *tti)
  */
 int tgt_client_alloc(struct obd_export *exp)
 {
+	int rc;
+
 	ENTRY;
 	LASSERT(exp != exp->exp_obd->obd_self_export);
 
 	spin_lock_init(&exp->exp_target_data.ted_nodemap_lock);
 	INIT_LIST_HEAD(&exp->exp_target_data.ted_nodemap_member);
-	spin_lock_init(&exp->exp_target_data.ted_fmd_lock);
-	INIT_LIST_HEAD(&exp->exp_target_data.ted_fmd_list);
+	rc = tgt_fmd_init(exp);
+	if (rc)
+		RETURN(rc);
 
 	OBD_ALLOC_PTR(exp->exp_target_data.ted_lcd);
-	if (exp->exp_target_data.ted_lcd == NULL)
+	if (exp->exp_target_data.ted_lcd == NULL) {
+		tgt_fmd_cleanup(exp);
 		RETURN(-ENOMEM);
+	}
 	/* Mark that slot is not yet valid, 0 doesn't work here */
 	exp->exp_target_data.ted_lr_idx = -1;
 	INIT_LIST_HEAD(&exp->exp_target_data.ted_reply_list);
@@ -884,8 +889,11 @@ static void tgt_cb_last_committed(struct lu_env *env, struct thandle *th,
 	if (ccb->llcc_transno <= ccb->llcc_exp->exp_last_committed)
 		goto out;
 	spin_lock(&ccb->llcc_tgt->lut_translock);
-	if (ccb->llcc_transno > ccb->llcc_tgt->lut_obd->obd_last_committed)
+	if (ccb->llcc_transno > ccb->llcc_tgt->lut_obd->obd_last_committed) {
 		ccb->llcc_tgt->lut_obd->obd_last_committed = ccb->llcc_transno;
+		/* release sync requests waiting for this commit */
+		wake_up_all(&ccb->llcc_tgt->lut_commit_waitq);
+	}
 
 	if (ccb->llcc_transno > ccb->llcc_exp->exp_last_committed) {
 		ccb->llcc_exp->exp_last_committed = ccb->llcc_transno;
@@ -125,6 +125,110 @@ ssize_t sync_lock_cancel_store(struct kobject *kobj, struct attribute *attr,
 EXPORT_SYMBOL(sync_lock_cancel_store);
 LUSTRE_RW_ATTR(sync_lock_cancel);
 
+/**
+ * Show number of object sync requests released by a group commit.
+ *
+ * Together with sync_group_commits, this tells how many sync requests
+ * shared each journal commit, see tgt_sync().
+ *
+ * \param[in] kobj	kobject
+ * \param[in] attr	attribute to show
+ * \param[in] buf	buffer for data
+ *
+ * \retval		0 and buffer filled with data on success
+ * \retval		negative value on error
+ */
+static ssize_t sync_group_requests_show(struct kobject *kobj,
+					struct attribute *attr, char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct lu_target *lut = obd->u.obt.obt_lut;
+
+	return sprintf(buf, "%d\n", atomic_read(&lut->lut_sync_group_reqs));
+}
+
+/**
+ * Reset the number of sync requests released by a group commit.
+ *
+ * \param[in] kobj	kobject
+ * \param[in] attr	attribute to show
+ * \param[in] buf	buffer for data
+ * \param[in] count	buffer size
+ *
+ * \retval		\a count on success
+ * \retval		negative value on error
+ */
+static ssize_t sync_group_requests_store(struct kobject *kobj,
+					 struct attribute *attr,
+					 const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct lu_target *lut = obd->u.obt.obt_lut;
+	int val, rc;
+
+	rc = kstrtoint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	atomic_set(&lut->lut_sync_group_reqs, val);
+
+	return count;
+}
+LUSTRE_RW_ATTR(sync_group_requests);
+
+/**
+ * Show number of async journal commits started for sync requests.
+ *
+ * \param[in] kobj	kobject
+ * \param[in] attr	attribute to show
+ * \param[in] buf	buffer for data
+ *
+ * \retval		0 and buffer filled with data on success
+ * \retval		negative value on error
+ */
+static ssize_t sync_group_commits_show(struct kobject *kobj,
+				       struct attribute *attr, char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct lu_target *lut = obd->u.obt.obt_lut;
+
+	return sprintf(buf, "%d\n",
+		       atomic_read(&lut->lut_sync_group_commits));
+}
+
+/**
+ * Reset the number of async journal commits started for sync requests.
+ *
+ * \param[in] kobj	kobject
+ * \param[in] attr	attribute to show
+ * \param[in] buf	buffer for data
+ * \param[in] count	buffer size
+ *
+ * \retval		\a count on success
+ * \retval		negative value on error
+ */
+static ssize_t sync_group_commits_store(struct kobject *kobj,
+					struct attribute *attr,
+					const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct lu_target *lut = obd->u.obt.obt_lut;
+	int val, rc;
+
+	rc = kstrtoint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	atomic_set(&lut->lut_sync_group_commits, val);
+
+	return count;
+}
+LUSTRE_RW_ATTR(sync_group_commits);
+
 /**
  * Show maximum number of Filter Modification Data (FMD) maintained.
  *
@@ -246,6 +350,8 @@ static struct lustre_attr tgt_fmd_seconds_compat = __ATTR(client_cache_seconds,
 
 static const struct attribute *tgt_attrs[] = {
 	&lustre_attr_sync_lock_cancel.attr,
+	&lustre_attr_sync_group_requests.attr,
+	&lustre_attr_sync_group_commits.attr,
 	&lustre_attr_tgt_fmd_count.attr,
 	&lustre_attr_tgt_fmd_seconds.attr,
 	&tgt_fmd_count_compat.attr,
@@ -444,6 +550,14 @@ int tgt_init(const struct lu_env *env, struct lu_target *lut,
 	tgd->tgd_tot_pending = 0;
 	tgd->tgd_grant_compat_disable = 0;
 
+	tgd->tgd_grant_pcl = cfs_percpt_lock_alloc(cfs_cpt_tab);
+	if (tgd->tgd_grant_pcl == NULL)
+		GOTO(out_grant, rc = -ENOMEM);
+	tgd->tgd_grant_caches = cfs_percpt_alloc(cfs_cpt_tab,
+						 sizeof(struct tg_grant_cache));
+	if (tgd->tgd_grant_caches == NULL)
+		GOTO(out_grant, rc = -ENOMEM);
+
 	/* populate cached statfs data */
 	osfs = &tgt_th_info(env)->tti_u.osfs;
 	rc = tgt_statfs_internal(env, lut, osfs, 0, NULL);
@@ -464,7 +578,7 @@ int tgt_init(const struct lu_env *env, struct lu_target *lut,
 
 	OBD_ALLOC(lut->lut_client_bitmap, LR_MAX_CLIENTS >> 3);
 	if (lut->lut_client_bitmap == NULL)
-		RETURN(-ENOMEM);
+		GOTO(out_grant, rc = -ENOMEM);
 
 	memset(&attr, 0, sizeof(attr));
 	attr.la_valid = LA_MODE;
@@ -500,6 +614,13 @@ int tgt_init(const struct lu_env *env, struct lu_target *lut,
 	lut->lut_fmd_max_age = LUT_FMD_MAX_AGE_DEFAULT;
 
 	atomic_set(&lut->lut_sync_count, 0);
+	atomic_set(&lut->lut_sync_group_reqs, 0);
+	atomic_set(&lut->lut_sync_group_commits, 0);
+	init_waitqueue_head(&lut->lut_commit_waitq);
+	mutex_init(&lut->lut_sync_mutex);
+	lut->lut_sync_kicked = 0;
+	lut->lut_sync_started = 0;
+	lut->lut_sync_done = 0;
 
 	/* reply_data is supported by MDT targets only for now */
 	if (strncmp(obd->obd_type->typ_name, LUSTRE_MDT_NAME, 3) != 0)
@@ -559,6 +680,8 @@ out_put:
 			 LUT_REPLY_SLOTS_MAX_CHUNKS * sizeof(unsigned long *));
 	}
 	lut->lut_reply_bitmap = NULL;
+out_grant:
+	tgt_grant_cache_fini(tgd);
 	return rc;
 }
 EXPORT_SYMBOL(tgt_init);
@@ -607,6 +730,7 @@ void tgt_fini(const struct lu_env *env, struct lu_target *lut)
 		dt_object_put(env, lut->lut_last_rcvd);
 		lut->lut_last_rcvd = NULL;
 	}
+	tgt_grant_cache_fini(&lut->lut_tgd);
 	EXIT;
 }
 EXPORT_SYMBOL(tgt_fini);
@@ -0,0 +1,201 @@
+/* GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+
+/*
+ * Changelog record ring test.
+ *
+ * Without -t, read the changelog of MDTNAME through the ring mapped by
+ * llapi_changelog_start(CHANGELOG_FLAG_RING) and print the index of each
+ * record, which must be increasing.
+ *
+ * With -t, map the smallest ring allowed and write a bogus crh_tail, first
+ * right after mmap(), then once the kernel waits for room. The kernel must
+ * ignore the first one and stop with CHANGELOG_RING_ERROR and -EINVAL on
+ * the second one. The changelog must hold more records than the ring.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include <lustre/lustreapi.h>
+#include <linux/lustre/lustre_ioctl.h>
+
+#define ERROR(fmt, ...)							\
+	fprintf(stderr, "%s: %s:%d: %s: " fmt "\n",			\
+		program_invocation_short_name, __FILE__, __LINE__,	\
+		__func__, ## __VA_ARGS__)
+
+#define DIE(fmt, ...)							\
+	do {								\
+		ERROR(fmt, ## __VA_ARGS__);				\
+		exit(EXIT_FAILURE);					\
+	} while (0)
+
+/* CDEV_CHLG_MAX_PREFETCH in mdc_changelog.c */
+#define CHLG_MAX_PREFETCH	1024
+#define RING_BATCH		64
+/* seconds to wait for the kernel to fill the ring */
+#define RING_TIMEOUT		60
+
+static void usage(char *prog)
+{
+	fprintf(stderr, "usage: %s [-t] MDTNAME\n", prog);
+	exit(EXIT_FAILURE);
+}
+
+static int ring_read(const char *mdtname)
+{
+	struct changelog_rec *recs[RING_BATCH];
+	__u64 last = 0;
+	void *priv;
+	int rc;
+	int i;
+
+	rc = llapi_changelog_start(&priv, CHANGELOG_FLAG_RING |
+				   CHANGELOG_FLAG_JOBID |
+				   CHANGELOG_FLAG_EXTRA_FLAGS, mdtname, 0);
+	if (rc < 0)
+		DIE("cannot start changelog of %s: %s", mdtname,
+		    strerror(-rc));
+
+	while ((rc = llapi_changelog_recv_batch(priv, recs, RING_BATCH)) > 0) {
+		for (i = 0; i < rc; i++) {
+			if (recs[i]->cr_index <= last)
+				DIE("record %llu after %llu",
+				    (unsigned long long)recs[i]->cr_index,
+				    (unsigned long long)last);
+			last = recs[i]->cr_index;
+			printf("%llu\n", (unsigned long long)last);
+		}
+		llapi_changelog_release_batch(priv);
+	}
+	if (rc < 0)
+		DIE("cannot read changelog of %s: %s", mdtname, strerror(-rc));
+
+	llapi_changelog_fini(&priv);
+
+	return 0;
+}
+
+/* wait until one of \a flags is set in the ring header */
+static __u32 ring_wait(struct changelog_ring_hdr *hdr, __u32 flags)
+{
+	__u32 cur;
+	int i;
+
+	for (i = 0; i < RING_TIMEOUT * 10; i++) {
+		cur = __atomic_load_n(&hdr->crh_flags, __ATOMIC_ACQUIRE);
+		if (cur & flags)
+			return cur;
+		usleep(100000);
+	}
+
+	return 0;
+}
+
+static int ring_corrupt(const char *mdtname)
+{
+	struct changelog_ring_hdr *hdr;
+	char path[PATH_MAX];
+	long page = sysconf(_SC_PAGESIZE);
+	size_t len;
+	__u32 flags;
+	int fd;
+
+	snprintf(path, sizeof(path), "/dev/changelog-%s", mdtname);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		DIE("cannot open %s: %s", path, strerror(errno));
+
+	len = CHLG_MAX_PREFETCH * changelog_ring_rec_size(CR_MAXSIZE);
+	len = (len + page - 1) / page * page + page;
+	hdr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (hdr == MAP_FAILED)
+		DIE("cannot map %s: %s", path, strerror(errno));
+
+	/* before the kernel uses the ring, it must reset the header */
+	hdr->crh_tail = ~0ULL;
+
+	flags = ring_wait(hdr, CHANGELOG_RING_WAKEUP | CHANGELOG_RING_EOF |
+			  CHANGELOG_RING_ERROR);
+	if (flags & CHANGELOG_RING_ERROR) {
+		/* the ring was activated before the first write */
+		if (hdr->crh_error != -EINVAL)
+			DIE("ring error %d", hdr->crh_error);
+		printf("ring error %d\n", hdr->crh_error);
+		goto out;
+	}
+	if (flags & CHANGELOG_RING_EOF)
+		DIE("changelog fits in %zu bytes", len - page);
+	if (flags == 0)
+		DIE("ring not filled after %d seconds", RING_TIMEOUT);
+
+	/* free room the kernel must not trust */
+	hdr->crh_tail = hdr->crh_head + 4096;
+	ioctl(fd, OBD_IOC_CHLG_RING_WAKE);
+
+	flags = ring_wait(hdr, CHANGELOG_RING_ERROR | CHANGELOG_RING_EOF);
+	if (!(flags & CHANGELOG_RING_ERROR))
+		DIE("bogus ring tail accepted, flags %#x", flags);
+	if (hdr->crh_error != -EINVAL)
+		DIE("ring error %d", hdr->crh_error);
+	printf("ring error %d\n", hdr->crh_error);
+out:
+	munmap(hdr, len);
+	close(fd);
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	bool corrupt = false;
+	int c;
+
+	while ((c = getopt(argc, argv, "th")) != -1) {
+		switch (c) {
+		case 't':
+			corrupt = true;
+			break;
+		case 'h':
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1)
+		usage(argv[0]);
+
+	/* Play nice with Lustre test scripts. Non-line buffered output
+	 * stream under I/O redirection may appear incorrectly. */
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	if (corrupt)
+		return ring_corrupt(argv[optind]);
+
+	return ring_read(argv[optind]);
+}
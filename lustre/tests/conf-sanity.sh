@@ -9082,6 +9082,78 @@ test_127() {
 }
 run_test 127 "direct io overwrite on full ost"
 
+test_128() {
+	local mdt=$(facet_svc mds1)
+	local cl_user
+	local nr=1000
+	local pids
+	local i
+
+	# changelog shards can not be removed once added
+	reformat_and_config
+	setup
+	stack_trap "cleanup; reformat_and_config" EXIT
+
+	do_facet mds1 $LCTL get_param -n mdd.$mdt.changelog_shards ||
+		skip "MDS does not support changelog shards"
+
+	# a user only reading the first catalog prevents shards
+	cl_user=$(do_facet mds1 $LCTL --device $mdt changelog_register -n) ||
+		error "register changelog user failed"
+	do_facet mds1 $LCTL set_param mdd.$mdt.changelog_shards=4 &&
+		error "shards added with a user not reading them"
+	do_facet mds1 $LCTL --device $mdt changelog_deregister $cl_user ||
+		error "deregister changelog user failed"
+
+	cl_user=$(do_facet mds1 $LCTL --device $mdt \
+		  changelog_register -n -s) ||
+		error "register changelog user with shards failed"
+	do_facet mds1 $LCTL set_param mdd.$mdt.changelog_shards=4 ||
+		error "cannot add changelog shards"
+	do_facet mds1 $LCTL set_param mdd.$mdt.changelog_shards=2 &&
+		error "changelog shards removed"
+	do_facet mds1 $LCTL --device $mdt changelog_register -n &&
+		error "user not reading shards registered"
+
+	# records of parallel writers are merged by index by the reader
+	mkdir $DIR/$tdir || error "mkdir $DIR/$tdir failed"
+	for i in {1..8}; do
+		createmany -o $DIR/$tdir/f$i- $nr &
+		pids+=" $!"
+	done
+	for i in $pids; do
+		wait $i || error "createmany failed"
+	done
+
+	stack_trap "rm -f $TMP/$tfile.*" EXIT
+	$LFS changelog $mdt | awk '{ print $1 }' > $TMP/$tfile.idx ||
+		error "read changelog failed"
+	(( $(wc -l < $TMP/$tfile.idx) >= 8 * nr )) ||
+		error "only $(wc -l < $TMP/$tfile.idx) changelog records"
+	sort -n -u -c $TMP/$tfile.idx ||
+		error "changelog records out of order"
+
+	# shards are opened again at mount
+	fail mds1
+	[[ $(do_facet mds1 $LCTL get_param -n \
+	     mdd.$mdt.changelog_shards) == 4 ]] ||
+		error "changelog shards lost at remount"
+	$LFS changelog $mdt | awk '{ print $1 }' > $TMP/$tfile.idx2 ||
+		error "read changelog after remount failed"
+	[[ -z "$(comm -23 <(sort $TMP/$tfile.idx) \
+			  <(sort $TMP/$tfile.idx2))" ]] ||
+		error "changelog records lost at remount"
+
+	# purge goes through all the shards
+	$LFS changelog_clear $mdt $cl_user 0 ||
+		error "clear changelog failed"
+	(( $($LFS changelog $mdt | wc -l) == 0 )) ||
+		error "changelog records left after clear"
+
+	rm -rf $DIR/$tdir
+}
+run_test 128 "changelog shards"
+
 if ! combined_mgs_mds ; then
 	stop mgs
 fi
@@ -1585,6 +1585,90 @@ test_28() {
 }
 run_test 28 "lfs_migrate with pool name"
 
+test_29() {
+	[[ $OSTCOUNT -le 2 ]] && skip_env "needs >= 3 OSTs"
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+
+	local POOL_ROOT=${POOL_ROOT:-$DIR/$tdir}
+	local lod="lo[vd].$FSNAME-MDT0000-mdtlov"
+	local old_rr=$(do_facet $SINGLEMDS $LCTL get_param -n \
+		       $lod.qos_threshold_rr | head -n1)
+	local old_prio=$(do_facet $SINGLEMDS $LCTL get_param -n \
+			 $lod.qos_prio_free | head -n1)
+	local old_maxage=$(do_facet $SINGLEMDS $LCTL get_param -n \
+			   $lod.qos_maxage | head -n1)
+	local numfiles=500
+	local nthreads=4
+	local pids=""
+	local pid
+	local nr
+	local i
+
+	[ -z "$old_rr" ] && skip "no QOS"
+	old_rr=${old_rr%%%}
+	old_prio=${old_prio%%%}
+	old_maxage=${old_maxage%% *}
+	stack_trap "do_facet $SINGLEMDS $LCTL set_param \
+		    $lod.qos_threshold_rr=$old_rr $lod.qos_prio_free=$old_prio \
+		    $lod.qos_maxage=$old_maxage"
+
+	# force QoS allocation and rebuild the weight snapshots often
+	do_facet $SINGLEMDS $LCTL set_param $lod.qos_threshold_rr=0 \
+		$lod.qos_maxage=1
+
+	create_pool_nofail $POOL
+	add_pool $POOL "$FSNAME-OST[0000-0001]" \
+		"$FSNAME-OST0000_UUID $FSNAME-OST0001_UUID "
+	create_dir $POOL_ROOT $POOL 1
+	mkdir -p $DIR/$tdir.all || error "mkdir $tdir.all failed"
+	$LFS setstripe -c 1 $DIR/$tdir.all || error "setstripe $tdir.all failed"
+
+	# make the OST weights differ
+	$LFS setstripe -i 1 -c 1 $DIR/$tfile || error "setstripe $tfile failed"
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=64 conv=fsync ||
+		error "dd $tfile failed"
+
+	for ((i = 0; i < nthreads; i++)); do
+		createmany -o $POOL_ROOT/f$i- $numfiles &
+		pids+=" $!"
+		createmany -o $DIR/$tdir.all/f$i- $numfiles &
+		pids+=" $!"
+	done
+
+	# change the OST weights and the pool membership during the creates
+	for i in $(seq 1 10); do
+		do_facet $SINGLEMDS $LCTL set_param \
+			$lod.qos_prio_free=$((i * 9))
+		do_facet mgs $LCTL pool_remove $FSNAME.$POOL OST0001
+		sleep 1
+		do_facet mgs $LCTL pool_add $FSNAME.$POOL OST0001
+		sleep 1
+	done
+
+	for pid in $pids; do
+		wait $pid || error "createmany failed"
+	done
+
+	nr=$(ls $POOL_ROOT | wc -l)
+	[ $nr -eq $((numfiles * nthreads)) ] ||
+		error "$nr files in $POOL_ROOT, expected $((numfiles * nthreads))"
+	nr=$(ls $DIR/$tdir.all | wc -l)
+	[ $nr -eq $((numfiles * nthreads)) ] ||
+		error "$nr files in $tdir.all, expected $((numfiles * nthreads))"
+
+	# pool files must only use the OSTs that were ever in the pool
+	nr=$($LFS getstripe -i $POOL_ROOT/* | grep -vcw "[01]")
+	[ $nr -eq 0 ] || error "$nr files in $POOL_ROOT allocated off $POOL"
+
+	nr=$($LFS getstripe -i $DIR/$tdir.all/* | sort -u | wc -l)
+	echo "$tdir.all files allocated on $nr OSTs"
+	[ $nr -gt 1 ] || error "$tdir.all files allocated on one OST only"
+
+	rm -rf $POOL_ROOT $DIR/$tdir.all $DIR/$tfile
+	destroy_pool $POOL
+}
+run_test 29 "Change OST weights and pools during concurrent creates"
+
 cd $ORIG_PWD
 
 complete $SECONDS
@@ -0,0 +1,471 @@
+/* GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+
+/*
+ * Offline simulator for the LOD QoS object allocator.
+ *
+ * Replays a create trace against a set of synthetic OSTs and reports how
+ * well the resulting bandwidth load and free space are balanced, once with
+ * space-only weights (qos_prio_load=0) and once with the load-aware weights
+ * computed by ltd_qos_penalties_calc()/lu_tgt_qos_weight_calc().
+ *
+ * Trace lines are "<start_sec> <stripe_count> <size_MiB> <rate_MiB/s>",
+ * '#' starts a comment.  Without a trace file a random trace is generated.
+ * OSTs 0..hot-1 carry additional background load that is not visible to
+ * the allocator except through the statfs load fields.
+ *
+ * The weight formula and load normalization here must be kept in sync with
+ * lustre/obdclass/lu_tgt_descs.c.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_OSTS	1024
+#define MAX_STRIPES	64
+
+struct sim_ost {
+	double		so_free;	/* MiB */
+	double		so_bw;		/* MiB/s the OST can sustain */
+	double		so_bg;		/* background MiB/s demand */
+	double		so_demand;	/* current total MiB/s demand */
+	unsigned int	so_streams;	/* current stripes being written */
+	/* values last reported through statfs */
+	uint32_t	so_io_rate;
+	uint32_t	so_io_inflight;
+	double		so_free_rep;
+	/* statistics */
+	double		so_util_sum;
+	unsigned int	so_over;
+};
+
+struct sim_file {
+	double		sf_start;
+	double		sf_end;
+	double		sf_rate;	/* MiB/s per stripe */
+	double		sf_size;	/* MiB per stripe */
+	int		sf_count;
+	int		sf_osts[MAX_STRIPES];
+};
+
+struct sim_result {
+	double		sr_util_mean;
+	double		sr_util_stddev;
+	double		sr_util_maxmean;
+	double		sr_over_pct;
+	double		sr_free_spread;
+	double		sr_slowdown;
+};
+
+static struct sim_ost osts[MAX_OSTS];
+static struct sim_file *files;
+static int nr_files;
+static int nr_osts = 16;
+static int nr_hot = 2;
+static double ost_size = 1 << 20;	/* MiB */
+static double ost_bw = 1000;		/* MiB/s */
+static double hot_bg = 700;		/* MiB/s */
+static int maxage = 5;			/* statfs refresh interval, seconds */
+static unsigned int prio_load = 64;	/* 0-256 */
+static int verbose;
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-n osts] [-H hot_osts] [-b ost_MiB/s] [-B hot_MiB/s]\n"
+		"          [-s ost_size_GiB] [-a maxage] [-p prio_load%%]\n"
+		"          [-f files] [-S seed] [-v] [trace_file]\n", prog);
+	exit(1);
+}
+
+static void trace_generate(int count, unsigned int seed)
+{
+	double t = 0;
+	int i;
+
+	srandom(seed);
+	files = calloc(count, sizeof(*files));
+	if (!files) {
+		perror("calloc");
+		exit(ENOMEM);
+	}
+
+	for (i = 0; i < count; i++) {
+		struct sim_file *f = &files[i];
+
+		/* ~1 create per second, mostly narrow files */
+		t += (random() % 2000) / 1000.0;
+		f->sf_start = t;
+		f->sf_count = random() % 8 ? 1 + random() % 2 :
+					     1 + random() % 8;
+		f->sf_rate = 50 + random() % 250;
+		f->sf_size = f->sf_rate * (5 + random() % 60) / f->sf_count;
+	}
+	nr_files = count;
+}
+
+static void trace_load(const char *name)
+{
+	char line[256];
+	FILE *fp;
+	int size = 0;
+
+	fp = fopen(name, "r");
+	if (!fp) {
+		fprintf(stderr, "cannot open '%s': %s\n", name,
+			strerror(errno));
+		exit(errno);
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		struct sim_file *f;
+		double total;
+
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (nr_files == size) {
+			size = size ? size * 2 : 1024;
+			files = realloc(files, size * sizeof(*files));
+			if (!files) {
+				perror("realloc");
+				exit(ENOMEM);
+			}
+		}
+		f = &files[nr_files];
+		memset(f, 0, sizeof(*f));
+		if (sscanf(line, "%lf %d %lf %lf", &f->sf_start, &f->sf_count,
+			   &total, &f->sf_rate) != 4 || f->sf_count < 1 ||
+		    f->sf_count > MAX_STRIPES || f->sf_rate <= 0) {
+			fprintf(stderr, "%s: bad trace line '%s'\n", name,
+				line);
+			exit(EINVAL);
+		}
+		f->sf_size = total / f->sf_count;
+		f->sf_rate /= f->sf_count;
+		nr_files++;
+	}
+	fclose(fp);
+}
+
+/* mirror of ofd_statfs_io_load() and the lod statfs refresh */
+static void statfs_refresh(void)
+{
+	int i;
+
+	for (i = 0; i < nr_osts; i++) {
+		struct sim_ost *o = &osts[i];
+		double rate = o->so_demand < o->so_bw ? o->so_demand : o->so_bw;
+
+		o->so_io_rate = (3 * o->so_io_rate + (uint32_t)rate) >> 2;
+		o->so_io_inflight = o->so_streams + (o->so_bg > 0 ? 8 : 0);
+		o->so_free_rep = o->so_free;
+	}
+}
+
+/* mirror of the load part of ltd_qos_penalties_calc() */
+static void load_calc(unsigned int prio, uint32_t *load)
+{
+	uint64_t rate_sum = 0, inflight_sum = 0;
+	int i;
+
+	for (i = 0; i < nr_osts; i++) {
+		rate_sum += osts[i].so_io_rate;
+		inflight_sum += osts[i].so_io_inflight;
+	}
+
+	for (i = 0; i < nr_osts; i++) {
+		uint32_t l = 0, parts = 0;
+
+		load[i] = 0;
+		if (!prio)
+			continue;
+		if (rate_sum) {
+			l += ((uint64_t)osts[i].so_io_rate * nr_osts << 8) /
+			     rate_sum;
+			parts++;
+		}
+		if (inflight_sum) {
+			l += ((uint64_t)osts[i].so_io_inflight * nr_osts << 8) /
+			     inflight_sum;
+			parts++;
+		}
+		if (!parts)
+			continue;
+		l /= parts;
+		if (l > 4 * 256)
+			l = 4 * 256;
+		load[i] = prio * l >> 8;
+	}
+}
+
+/* weighted random pick without replacement, as lod_ost_alloc_qos() does */
+static void alloc_stripes(struct sim_file *f, const uint32_t *load)
+{
+	uint64_t weight[MAX_OSTS], total = 0;
+	int i, s;
+
+	for (i = 0; i < nr_osts; i++) {
+		/* bavail >> 16 with 1MiB units, iavail assumed equal */
+		weight[i] = ((uint64_t)(osts[i].so_free_rep * 1048576) >> 16);
+		if (load[i])
+			weight[i] = weight[i] / (256 + load[i]) << 8;
+		total += weight[i];
+	}
+
+	for (s = 0; s < f->sf_count && s < nr_osts; s++) {
+		uint64_t r, cur = 0;
+
+		if (!total)
+			break;
+		r = (((uint64_t)random() << 31) | random()) % total;
+		for (i = 0; i < nr_osts; i++) {
+			cur += weight[i];
+			if (cur > r)
+				break;
+		}
+		f->sf_osts[s] = i;
+		total -= weight[i];
+		weight[i] = 0;
+	}
+	f->sf_count = s;
+}
+
+static void simulate(unsigned int prio, struct sim_result *res)
+{
+	uint32_t load[MAX_OSTS];
+	double util_sum = 0, util_sq = 0;
+	double max_sum = 0, fmin, fmax;
+	unsigned int samples = 0, over = 0;
+	int done = 0;
+	int next = 0, i, j;
+	double t;
+
+	for (i = 0; i < nr_osts; i++) {
+		memset(&osts[i], 0, sizeof(osts[i]));
+		osts[i].so_free = ost_size;
+		osts[i].so_free_rep = ost_size;
+		osts[i].so_bw = ost_bw;
+		osts[i].so_bg = i < nr_hot ? hot_bg : 0;
+	}
+	for (i = 0; i < nr_files; i++)
+		files[i].sf_end = 0;
+	srandom(1);
+	load_calc(prio, load);
+
+	for (t = 0; done < nr_files; t += 1) {
+		double umax = 0;
+
+		if ((long)t % maxage == 0) {
+			statfs_refresh();
+			load_calc(prio, load);
+		}
+
+		for (; next < nr_files && files[next].sf_start <= t; next++) {
+			alloc_stripes(&files[next], load);
+			files[next].sf_end = t;
+		}
+
+		for (i = 0; i < nr_osts; i++) {
+			osts[i].so_demand = osts[i].so_bg;
+			osts[i].so_streams = 0;
+		}
+		for (i = 0; i < next; i++) {
+			struct sim_file *f = &files[i];
+
+			if (f->sf_size <= 0)
+				continue;
+			for (j = 0; j < f->sf_count; j++) {
+				osts[f->sf_osts[j]].so_demand += f->sf_rate;
+				osts[f->sf_osts[j]].so_streams++;
+			}
+		}
+
+		/* each file progresses at the rate of its slowest stripe */
+		for (i = 0; i < next; i++) {
+			struct sim_file *f = &files[i];
+			double share = 1.0;
+
+			if (f->sf_size <= 0)
+				continue;
+			for (j = 0; j < f->sf_count; j++) {
+				struct sim_ost *o = &osts[f->sf_osts[j]];
+
+				if (o->so_demand > o->so_bw &&
+				    o->so_bw / o->so_demand < share)
+					share = o->so_bw / o->so_demand;
+			}
+			f->sf_size -= f->sf_rate * share;
+			for (j = 0; j < f->sf_count; j++)
+				osts[f->sf_osts[j]].so_free -= f->sf_rate *
+							       share;
+			if (f->sf_size <= 0 || f->sf_count == 0) {
+				f->sf_size = 0;
+				/* sf_end becomes the completion time */
+				f->sf_end = t + 1 - f->sf_start;
+				done++;
+			}
+		}
+
+		if (next == nr_files && done == nr_files)
+			break;
+
+		for (i = 0; i < nr_osts; i++) {
+			double u = osts[i].so_demand / osts[i].so_bw;
+
+			util_sum += u;
+			util_sq += u * u;
+			if (u > umax)
+				umax = u;
+			if (u > 1.0)
+				over++;
+			osts[i].so_util_sum += u;
+		}
+		max_sum += umax;
+		samples++;
+	}
+
+	fmin = fmax = osts[0].so_free;
+	for (i = 1; i < nr_osts; i++) {
+		if (osts[i].so_free < fmin)
+			fmin = osts[i].so_free;
+		if (osts[i].so_free > fmax)
+			fmax = osts[i].so_free;
+	}
+
+	samples = samples ? samples : 1;
+	res->sr_util_mean = util_sum / samples / nr_osts;
+	res->sr_util_stddev = sqrt(util_sq / samples / nr_osts -
+				   res->sr_util_mean * res->sr_util_mean);
+	res->sr_util_maxmean = res->sr_util_mean > 0 ?
+		max_sum / samples / res->sr_util_mean : 0;
+	res->sr_over_pct = 100.0 * over / samples / nr_osts;
+	res->sr_free_spread = 100.0 * (fmax - fmin) / ost_size;
+	res->sr_slowdown = 0;
+	for (i = 0; i < nr_files; i++)
+		res->sr_slowdown += files[i].sf_end;
+	res->sr_slowdown /= nr_files;
+
+	if (verbose)
+		for (i = 0; i < nr_osts; i++)
+			printf("  OST%04x util %5.1f%% free %5.1f%%\n", i,
+			       100.0 * osts[i].so_util_sum / samples,
+			       100.0 * osts[i].so_free / ost_size);
+}
+
+static void report(const char *name, struct sim_result *r)
+{
+	printf("%-12s %8.3f %8.3f %8.2f %8.2f%% %8.2f%% %9.1f\n", name,
+	       r->sr_util_mean, r->sr_util_stddev, r->sr_util_maxmean,
+	       r->sr_over_pct, r->sr_free_spread, r->sr_slowdown);
+}
+
+int main(int argc, char **argv)
+{
+	struct sim_result space, loaded;
+	struct sim_file *orig;
+	unsigned int seed = 1;
+	int count = 2000;
+	int c;
+
+	while ((c = getopt(argc, argv, "a:b:B:f:H:n:p:s:S:v")) != -1) {
+		switch (c) {
+		case 'a':
+			maxage = atoi(optarg);
+			break;
+		case 'b':
+			ost_bw = atof(optarg);
+			break;
+		case 'B':
+			hot_bg = atof(optarg);
+			break;
+		case 'f':
+			count = atoi(optarg);
+			break;
+		case 'H':
+			nr_hot = atoi(optarg);
+			break;
+		case 'n':
+			nr_osts = atoi(optarg);
+			break;
+		case 'p':
+			prio_load = (atoi(optarg) << 8) / 100;
+			break;
+		case 's':
+			ost_size = atof(optarg) * 1024;
+			break;
+		case 'S':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (nr_osts < 2 || nr_osts > MAX_OSTS || nr_hot < 0 ||
+	    nr_hot > nr_osts || maxage < 1 || count < 1 || ost_bw <= 0 ||
+	    prio_load > 256)
+		usage(argv[0]);
+
+	if (optind < argc)
+		trace_load(argv[optind]);
+	else
+		trace_generate(count, seed);
+	if (!nr_files) {
+		fprintf(stderr, "empty trace\n");
+		return EINVAL;
+	}
+
+	/* simulate() consumes the trace, keep a pristine copy */
+	orig = malloc(nr_files * sizeof(*files));
+	if (!orig) {
+		perror("malloc");
+		return ENOMEM;
+	}
+	memcpy(orig, files, nr_files * sizeof(*files));
+
+	printf("%d OSTs (%d hot), %d files, maxage %ds, prio_load %u%%\n",
+	       nr_osts, nr_hot, nr_files, maxage,
+	       (prio_load * 100 + 255) >> 8);
+	if (verbose)
+		printf("space-only:\n");
+	simulate(0, &space);
+	memcpy(files, orig, nr_files * sizeof(*files));
+	if (verbose)
+		printf("load-aware:\n");
+	simulate(prio_load, &loaded);
+
+	printf("%-12s %8s %8s %8s %9s %9s %9s\n", "policy", "util",
+	       "stddev", "max/mean", "overload", "freespr", "avg_time");
+	report("space-only", &space);
+	report("load-aware", &loaded);
+
+	free(orig);
+	free(files);
+	return 0;
+}
@@ -5020,6 +5020,113 @@ test_407() {
 }
 run_test 407 "Check for double RESTORE records in llog"
 
+# print the number of HSM requests of type $1 in state $2
+get_request_total() {
+	do_facet $SINGLEMDS "$LCTL get_param -n $HSM_PARAM.actions" |
+		grep -c "action=$1 .*status=$2"
+}
+
+test_408() {
+	local nr=200
+	local -a fids
+	local f
+	local fid
+	local fid2
+	local i
+
+	mkdir -p $DIR/$tdir
+	copytool setup
+	cdt_disable
+	stack_trap cdt_enable EXIT
+
+	for ((i = 0; i < nr; i++)); do
+		fids[$i]=$(create_empty_file "$DIR/$tdir/$tfile-$i")
+	done
+	$LFS hsm_archive --archive $HSM_ARCHIVE_NUMBER $DIR/$tdir/$tfile-* ||
+		error "archive of $nr files failed"
+	wait_request_state ${fids[$((nr - 1))]} ARCHIVE WAITING
+	(( $(get_request_total ARCHIVE WAITING) == nr )) ||
+		error "$(get_request_total ARCHIVE WAITING) waiting for $nr"
+
+	# a request already queued for a FID is found, not queued again
+	$LFS hsm_archive --archive $HSM_ARCHIVE_NUMBER $DIR/$tdir/$tfile-* ||
+		error "second archive of $nr files failed"
+	(( $(get_request_total ARCHIVE WAITING) == nr )) ||
+		error "duplicate archive requests queued"
+
+	# cancel by FID finds the queued request of each file
+	for ((i = 0; i < nr; i += 2)); do
+		$LFS hsm_cancel $DIR/$tdir/$tfile-$i ||
+			error "cancel $tfile-$i failed"
+	done
+	(( $(get_request_total CANCEL WAITING) == nr / 2 )) ||
+		error "$(get_request_total CANCEL WAITING) cancels for $((nr / 2))"
+
+	# nothing to cancel for a file without a request
+	fid=$(create_empty_file "$DIR/$tdir/$tfile-none")
+	$LFS hsm_cancel $DIR/$tdir/$tfile-none
+	assert_request_count $fid CANCEL 0
+
+	cdt_enable
+	wait_all_done $((nr * 2))
+	for ((i = 1; i < nr; i += 2)); do
+		wait_request_state ${fids[$i]} ARCHIVE SUCCEED
+	done
+
+	# a request that goes back to waiting must be sent again, even
+	# though a newer request was queued after it
+	f=$DIR/$tdir/$tfile-retry
+	fid=$(create_empty_file "$f")
+#define OBD_FAIL_MDS_HSM_CT_REGISTER_NET	0x14d
+	do_facet $SINGLEAGT $LCTL set_param fail_loc=0x14d
+	$LFS hsm_archive --archive $HSM_ARCHIVE_NUMBER $f
+	wait_for_loop_period
+	wait_request_state $fid ARCHIVE WAITING
+
+	fid2=$(create_empty_file "$f-new")
+	do_facet $SINGLEAGT $LCTL set_param fail_loc=0
+	$LFS hsm_archive --archive $HSM_ARCHIVE_NUMBER $f-new
+	wait_request_state $fid2 ARCHIVE SUCCEED
+	wait_request_state $fid ARCHIVE SUCCEED
+}
+run_test 408 "FID index of active requests and incremental scans"
+
+test_409() {
+	local f=$DIR/$tdir/$tfile
+	local logfile=$(copytool_logfile $SINGLEAGT)
+	local fid
+	local sum
+	local sum2
+
+	copytool setup --streams 4 --chunk-size 1048576 -v
+
+	# several chunks and a partial last one
+	fid=$(create_file "$f" 1M 9 fsync /dev/urandom) ||
+		error "cannot create $f"
+	dd if=/dev/urandom bs=12345 count=1 >> $f || error "append $f failed"
+	sum=$(md5sum < $f)
+
+	$LFS hsm_archive --archive $HSM_ARCHIVE_NUMBER $f ||
+		error "could not archive file"
+	wait_request_state $fid ARCHIVE SUCCEED
+	do_facet $SINGLEAGT grep -q "with 4 streams" "$logfile" ||
+		error "archive was not copied with 4 streams"
+
+	$LFS hsm_release $f || error "could not release file"
+	check_hsm_flags $f "0x0000000d"
+
+	$LFS hsm_restore $f || error "could not restore file"
+	wait_request_state $fid RESTORE SUCCEED
+	(( $(do_facet $SINGLEAGT grep -c "with 4 streams" "$logfile") >= 2 )) ||
+		error "restore was not copied with 4 streams"
+
+	cancel_lru_locks osc
+	sum2=$(md5sum < $f)
+	[[ "$sum" == "$sum2" ]] ||
+		error "restored data differs: $sum2 != $sum"
+}
+run_test 409 "archive and restore with several copy streams"
+
 test_500()
 {
 	[ $MDS1_VERSION -lt $(version_code 2.6.92) ] &&
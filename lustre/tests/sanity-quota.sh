@@ -4607,6 +4607,200 @@ test_72()
 }
 run_test 72 "lfs quota --pool prints only pool's OSTs"
 
+test_73() {
+	local limit=20  # 20M
+	local testfile="$DIR/$tdir/$tfile-0"
+	local procf="osd-$(facet_fstype ost1).$FSNAME-OST0000.quota_slave"
+	local prefetch
+	local granted
+	local used
+	local i
+
+	prefetch=$(do_facet ost1 $LCTL get_param -n \
+		   $procf.prefetch_seconds 2>/dev/null)
+	[ -n "$prefetch" ] || skip "OST does not support quota prefetch"
+	mds_supports_qp
+
+	setup_quota_test || error "setup quota failed with $?"
+	stack_trap cleanup_quota_test EXIT
+	stack_trap "do_facet ost1 $LCTL set_param \
+		    $procf.prefetch_seconds=$prefetch" EXIT
+
+	do_facet ost1 $LCTL set_param $procf.prefetch_seconds=abc &&
+		error "invalid prefetch_seconds accepted"
+	# a long horizon makes every busy write pre-acquire a full qunit
+	do_facet ost1 $LCTL set_param $procf.prefetch_seconds=3600 ||
+		error "set prefetch_seconds failed"
+
+	# enable ost quota
+	set_ost_qtype $QTYPE || error "enable ost quota failed"
+
+	log "User quota (block hardlimit:$limit MB)"
+	$LFS setquota -u $TSTUSR -b 0 -B ${limit}M -i 0 -I 0 $DIR ||
+		error "set user quota failed"
+
+	# make sure the system is clean
+	used=$(getquota -u $TSTUSR global curspace)
+	[ $used -ne 0 ] && error "Used space($used) for user $TSTUSR isn't 0."
+
+	$LFS setstripe $testfile -c 1 -i 0 || error "setstripe $testfile failed"
+	chown $TSTUSR.$TSTUSR $testfile || error "chown $testfile failed"
+
+	# pre-acquire must not let the slave write past the limit
+	test_1_check_write $testfile "user" $limit
+	used=$(getquota -u $TSTUSR global curspace)
+	(( used <= limit * 1024 )) ||
+		error "used $used KB is over the limit $((limit * 1024)) KB"
+
+	# the pre-acquired space goes back to the master with the usage
+	rm -f $testfile
+	wait_delete_completed || error "wait_delete_completed failed"
+	sync_all_data || true
+	for ((i = 0; i < 30; i++)); do
+		granted=$(getgranted "0x0" "dt" $TSTID "usr")
+		[ "$granted" == "0" ] && break
+		sleep 1
+	done
+	[ "$granted" == "0" ] ||
+		error "granted $granted for $TSTUSR isn't 0 after rm"
+}
+run_test 73 "rate-based quota pre-acquire stays within the limit"
+
+# print "id hardlimit" for the IDs of the slave copy of the user global index
+test_74_slave_limits() {
+	local procf="osd-$(facet_fstype ost1).$FSNAME-OST0000"
+
+	do_facet ost1 $LCTL get_param -n $procf.quota_slave.limit_user |
+		awk '/id:/ { id = $3 } /limits:/ { print id, $4 + 0 }'
+}
+
+test_74() {
+	local base=60000
+	local nr=100
+	local found
+	local id
+	local i
+
+	setup_quota_test || error "setup quota failed with $?"
+	stack_trap cleanup_quota_test EXIT
+
+	# enable ost quota
+	set_ost_qtype $QTYPE || error "enable ost quota failed"
+
+	do_facet ost1 "ps -e -o comm=" | grep -q "^lquota_wb_" ||
+		error "no lquota_wb_ writeback thread on ost1"
+
+	# a burst of setquota is applied on the slave through the batched
+	# global index updates
+	stack_trap "for ((i = 0; i < $nr; i++)); do \
+		$LFS setquota -u \$(($base + i)) -B 0 $DIR; done" EXIT
+	for ((i = 0; i < nr; i++)); do
+		id=$((base + i))
+		$LFS setquota -u $id -B $((i + 1))M $DIR ||
+			error "set quota for $id failed"
+	done
+
+	for ((i = 0; i < 30; i++)); do
+		found=$(test_74_slave_limits |
+			awk -v base=$base -v nr=$nr '$1 >= base &&
+				$1 < base + nr && $2 == ($1 - base + 1) * 1024' |
+			wc -l)
+		(( found == nr )) && break
+		sleep 1
+	done
+	(( found == nr )) || {
+		test_74_slave_limits
+		error "$found of $nr limits applied on ost1"
+	}
+
+	# reintegration rewrites the whole index through the same workers
+	do_facet ost1 $LCTL set_param \
+		osd-*.$FSNAME-OST*.quota_slave.force_reint=1 ||
+		error "force reintegration failed"
+	wait_ost_reint "u" || error "reintegration failed"
+	found=$(test_74_slave_limits |
+		awk -v base=$base -v nr=$nr '$1 >= base && $1 < base + nr &&
+			$2 == ($1 - base + 1) * 1024' | wc -l)
+	(( found == nr )) ||
+		error "$found of $nr limits left on ost1 after reintegration"
+}
+run_test 74 "batched quota index writeback keeps every update"
+
+test_75() {
+	local limit=10  # 10M
+	local base=60100
+	local nr=16
+	local testfile="$DIR/$tdir/$tfile"
+	local batches
+	local granted
+	local used
+	local id
+	local i
+	local n
+
+	mds_supports_qp
+	do_facet mds1 "$LCTL get_param -n mdt.$FSNAME-MDT0000.exports.*.export" |
+		grep -q dqacq_batch || skip "QUOTA_DQACQ_BATCH not negotiated"
+
+	setup_quota_test || error "setup quota failed with $?"
+	stack_trap cleanup_quota_test EXIT
+
+	# enable ost quota
+	set_ost_qtype $QTYPE || error "enable ost quota failed"
+
+	stack_trap "for ((i = 0; i < $nr; i++)); do \
+		$LFS setquota -u \$(($base + i)) -B 0 $DIR; done" EXIT
+	for ((i = 0; i < nr; i++)); do
+		id=$((base + i))
+		$LFS setquota -u $id -b 0 -B ${limit}M -i 0 -I 0 $DIR ||
+			error "set quota for $id failed"
+		$LFS setstripe $testfile-$id -c 1 -i 0 ||
+			error "setstripe $testfile-$id failed"
+		chown $id:$id $testfile-$id || error "chown $testfile-$id failed"
+	done
+
+	batches=$(do_facet mds1 $LCTL get_param -n mds.MDS.*.stats |
+		  awk '/^quota_acquire_batch/ { sum += $2 } END { print sum + 0 }')
+
+	# every ID writes over its limit at once
+	for ((i = 0; i < nr; i++)); do
+		id=$((base + i))
+		runas -u $id -g $id $DD of=$testfile-$id count=$((limit + 2)) \
+			oflag=direct &
+	done
+	wait
+	sync_all_data || true
+
+	for ((i = 0; i < nr; i++)); do
+		id=$((base + i))
+		used=$(getquota -u $id global curspace)
+		(( used <= limit * 1024 )) ||
+			error "id $id used $used KB over its $limit MB limit"
+		(( used >= (limit - 1) * 1024 )) ||
+			error "id $id stopped at $used KB below its limit"
+	done
+
+	# the space granted for each ID goes back to the master
+	rm -f $testfile-*
+	wait_delete_completed || error "wait_delete_completed failed"
+	sync_all_data || true
+	for ((i = 0; i < nr; i++)); do
+		id=$((base + i))
+		for ((n = 0; n < 30; n++)); do
+			granted=$(getgranted "0x0" "dt" $id "usr")
+			[ "${granted:-0}" == "0" ] && break
+			sleep 1
+		done
+		[ "${granted:-0}" == "0" ] ||
+			error "granted $granted for $id isn't 0 after rm"
+	done
+
+	(( $(do_facet mds1 $LCTL get_param -n mds.MDS.*.stats |
+	     awk '/^quota_acquire_batch/ { sum += $2 } END { print sum + 0 }')
+	   > batches )) || error "no QUOTA_DQACQ_BATCH sent"
+}
+run_test 75 "batched quota acquire and release keep per-ID limits exact"
+
 quota_fini()
 {
 	do_nodes $(comma_list $(nodes_list)) "lctl set_param debug=-quota"
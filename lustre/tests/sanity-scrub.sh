@@ -1273,6 +1273,102 @@ test_16() {
 }
 run_test 16 "Initial OI scrub can rebuild crashed index objects"
 
+# OI scrub prefetch threads are only used by the full speed scanning that is
+# not driven by LFSCK, i.e. the auto triggered one, not "lctl lfsck_start".
+test_17_sub() {
+	local threads=$1
+	local mdts=$(comma_list $(mdts_nodes))
+	local -a position0
+	local -a position1
+	local count
+	local n
+
+	scrub_prep 1000 1
+	echo "starting MDTs with OI scrub disabled"
+	scrub_start_mds 2 "$MOUNT_OPTS_NOSCRUB"
+	scrub_check_flags 3 recreated,inconsistent
+	mount_client $MOUNT || error "(4) Fail to start client!"
+	scrub_enable_auto
+	full_scrub_ratio 0
+
+	do_nodes $mdts $LCTL set_param \
+		osd-ldiskfs.*.scrub_prefetch_threads=$threads
+	do_nodes $mdts $LCTL set_param debug=+lfsck
+	do_nodes $mdts $LCTL clear
+
+	#define OBD_FAIL_OSD_SCRUB_DELAY	 0x190
+	do_nodes $mdts $LCTL set_param fail_val=1 fail_loc=0x190
+
+	scrub_check_data 5
+	scrub_check_status 6 scanning
+
+	for n in $(seq $MDSCOUNT); do
+		count=$(do_facet mds$n $LCTL dk |
+			grep -c "OI scrub with $threads prefetch threads")
+		if [ $threads -eq 0 -a $count -ne 0 ]; then
+			error "(7) Expected no prefetch thread on mds$n"
+		fi
+		if [ $threads -ne 0 -a $count -eq 0 ]; then
+			error "(7) Expected $threads prefetch threads on mds$n"
+		fi
+	done
+
+	# Sleep 5 sec to guarantee at least one object processed by OI scrub
+	sleep 5
+	# Fail the OI scrub to guarantee there is at least one checkpoint
+	#define OBD_FAIL_OSD_SCRUB_FATAL	 0x192
+	do_nodes $mdts $LCTL set_param fail_loc=0x192
+	scrub_check_status 8 failed
+
+	for n in $(seq $MDSCOUNT); do
+		position0[$n]=$(scrub_status $n |
+			awk '/^last_checkpoint_position/ {print $2}')
+		position0[$n]=$((${position0[$n]} + 1))
+	done
+
+	#define OBD_FAIL_OSD_SCRUB_DELAY	 0x190
+	do_nodes $mdts $LCTL set_param fail_val=1 fail_loc=0x190
+
+	for n in $(seq $MDSCOUNT); do
+		# stat will re-trigger OI scrub
+		stat $DIR/$tdir/mds$n/sanity-scrub.sh ||
+			error "(9) Failed to stat mds$n/sanity-scrub.sh"
+	done
+	scrub_check_status 10 scanning
+
+	for n in $(seq $MDSCOUNT); do
+		position1[$n]=$(scrub_status $n |
+			awk '/^latest_start_position/ {print $2}')
+		if [ ${position0[$n]} -ne ${position1[$n]} ]; then
+			error "(11) Expected position ${position0[$n]}, but" \
+				"got ${position1[$n]}"
+		fi
+	done
+
+	do_nodes $mdts $LCTL set_param fail_loc=0 fail_val=0
+	do_nodes $mdts $LCTL set_param debug=-lfsck
+
+	scrub_check_status 12 completed
+	scrub_check_flags 13 ""
+	scrub_check_data 14
+}
+
+test_17() {
+	[ $(facet_fstype $SINGLEMDS) != "ldiskfs" ] &&
+		skip "ldiskfs only test" && return
+
+	do_facet $SINGLEMDS $LCTL get_param -n \
+		osd-ldiskfs.$(facet_svc $SINGLEMDS).scrub_prefetch_threads ||
+		{ skip "no OI scrub prefetch support" && return; }
+
+	echo "OI scrub with 4 prefetch threads"
+	test_17_sub 4
+
+	echo "OI scrub without prefetch threads"
+	test_17_sub 0
+}
+run_test 17 "OI scrub prefetch resumes from checkpoint and repairs"
+
 # restore MDS/OST size
 MDSSIZE=${SAVED_MDSSIZE}
 OSTSIZE=${SAVED_OSTSIZE}
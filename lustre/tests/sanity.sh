@@ -3022,6 +3022,39 @@ test_27N() {
 }
 run_test 27N "lctl pool_list on separate MGS gives correct pool name"
 
+test_27O() {
+	remote_ost_nodsh && skip "remote OST with nodsh"
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+
+	local threads=$(do_facet ost1 $LCTL get_param -n \
+			obdfilter.$FSNAME-OST0000.precreate_threads)
+	local batch=$(do_facet ost1 $LCTL get_param -n \
+		      obdfilter.$FSNAME-OST0000.precreate_batch)
+
+	[ -n "$threads" ] || skip "no precreate_threads on OST"
+	(( threads > 0 )) || skip "no precreate helper threads running"
+
+	stack_trap "do_facet ost1 $LCTL set_param \
+		obdfilter.$FSNAME-OST0000.precreate_threads=$threads \
+		obdfilter.$FSNAME-OST0000.precreate_batch=$batch"
+	# small batches so every OST_CREATE is split between the threads
+	do_facet ost1 $LCTL set_param \
+		obdfilter.$FSNAME-OST0000.precreate_batch=8
+
+	do_facet ost1 $LCTL set_param \
+		obdfilter.$FSNAME-OST0000.precreate_threads=$((threads + 1)) &&
+		error "precreate_threads above started threads accepted"
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -i 0 -c 1 $DIR/$tdir || error "setstripe failed"
+	createmany -o $DIR/$tdir/$tfile 2000 || error "createmany failed"
+
+	local count=$(ls $DIR/$tdir | wc -l)
+	(( count == 2000 )) || error "found $count files, expected 2000"
+	unlinkmany $DIR/$tdir/$tfile 2000 || error "unlinkmany failed"
+}
+run_test 27O "parallel precreate on OST keeps objects consistent"
+
 # createtest also checks that device nodes are created and
 # then visible correctly (#2091)
 test_28() { # bug 2091
@@ -4100,6 +4133,58 @@ test_36h() {
 }
 run_test 36h "utime on file racing with OST BRW write =========="
 
+# print the number of FMD entries of all exports of obdfilter on ost1
+ost1_fmd_count() {
+	do_facet ost1 "$LCTL get_param -n obdfilter.*.exports.*.fmd_count" |
+		awk '{ cnt += $1 } END { print cnt + 0 }'
+}
+
+test_36i() {
+	remote_ost_nodsh && skip "remote OST with nodsh"
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+
+	local nr=256
+	local fmd
+	local fmd2
+	local max_num=$(do_facet ost1 "$LCTL get_param -n \
+			obdfilter.$FSNAME-OST0000.tgt_fmd_count")
+	local max_age=$(do_facet ost1 "$LCTL get_param -n \
+			obdfilter.$FSNAME-OST0000.tgt_fmd_seconds")
+
+	stack_trap "do_facet ost1 $LCTL set_param \
+		obdfilter.$FSNAME-OST0000.tgt_fmd_count=$max_num \
+		obdfilter.$FSNAME-OST0000.tgt_fmd_seconds=$max_age" EXIT
+	do_facet ost1 $LCTL set_param \
+		obdfilter.$FSNAME-OST0000.tgt_fmd_count=$((nr * 2)) \
+		obdfilter.$FSNAME-OST0000.tgt_fmd_seconds=600
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir || error "setstripe $tdir failed"
+	createmany -o $DIR/$tdir/f- $nr || error "create $nr files failed"
+
+	# every setattr of a new object adds one FMD
+	fmd=$(ost1_fmd_count)
+	touch $DIR/$tdir/f-* || error "touch failed"
+	fmd2=$(ost1_fmd_count)
+	echo "FMD: $fmd before touch, $fmd2 after"
+	(( fmd2 - fmd >= nr )) || error "$((fmd2 - fmd)) FMD added for $nr"
+
+	# FMD of known objects are found by FID and not added again
+	touch $DIR/$tdir/f-* || error "second touch failed"
+	fmd=$(ost1_fmd_count)
+	(( fmd == fmd2 )) || error "FMD count changed from $fmd2 to $fmd"
+
+	# lookups keep the per-export list below tgt_fmd_count
+	do_facet ost1 $LCTL set_param \
+		obdfilter.$FSNAME-OST0000.tgt_fmd_count=32
+	touch $DIR/$tdir/f-0 $DIR/$tdir/f-1 || error "touch f-0 failed"
+	fmd=$(do_facet ost1 "$LCTL get_param -n \
+		obdfilter.$FSNAME-OST0000.exports.*.fmd_count" | sort -n |
+		tail -n 1)
+	(( fmd <= 32 )) || error "$fmd FMD on one export over the limit 32"
+}
+run_test 36i "FMD lookup by FID"
+
 test_36i() {
 	[ $MDSCOUNT -lt 2 ] && skip_env "needs >= 2 MDTs"
 
@@ -8056,6 +8141,64 @@ test_64f() {
 }
 run_test 64f "check grant consumption (with grant allocation)"
 
+test_64g() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	[ "$CLIENTONLY" ] && skip "CLIENTONLY mode"
+
+	local osts=$(comma_list $(osts_nodes))
+	local clients=${CLIENTS:-$HOSTNAME}
+	local cli_grant
+	local srv_grant
+	local pending
+	local pids=""
+	local i
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir || error "lfs setstripe failed"
+
+	# many small RPCs committed in parallel release grant through the
+	# per-CPT caches of tgt_grant_commit(), direct IO allocates grant
+	# on the server side in tgt_grant_prepare_write()
+	for ((i = 0; i < 8; i++)); do
+		if ((i % 2)); then
+			dd if=/dev/zero of=$DIR/$tdir/$tfile.$i bs=64k \
+				count=64 oflag=direct &>/dev/null &
+		else
+			dd if=/dev/zero of=$DIR/$tdir/$tfile.$i bs=64k \
+				count=64 conv=fsync &>/dev/null &
+		fi
+		pids+=" $!"
+	done
+	for i in $pids; do
+		wait $i || error "dd $i failed"
+	done
+
+	do_nodes $clients sync
+
+	# reading tot_pending folds the cached released grant, nothing is
+	# pending once all writes are committed
+	wait_update_facet ost1 \
+		"$LCTL get_param -n obdfilter.$FSNAME-OST0000.tot_pending" \
+		0 30 || error "pending grant is not released"
+
+	cli_grant=$(grant_from_clients $clients)
+	srv_grant=$(grant_from_servers $osts)
+	for ((i = 0; i < 30 && cli_grant != srv_grant; i++)); do
+		sleep 1
+		cli_grant=$(grant_from_clients $clients)
+		srv_grant=$(grant_from_servers $osts)
+	done
+	(( cli_grant == srv_grant )) || {
+		do_nodes $osts "$LCTL get_param obdfilter.$FSNAME-OST*.tot*"
+		do_nodes $clients "$LCTL get_param osc.$FSNAME-*.cur_*_bytes"
+		error "grant mismatch: client $cli_grant, server $srv_grant"
+	}
+	echo "client grant $cli_grant == server grant $srv_grant"
+
+	rm -rf $DIR/$tdir || error "rm $DIR/$tdir failed"
+}
+run_test 64g "grant stays consistent with parallel committing writes"
+
 # bug 1414 - set/get directories' stripe info
 test_65a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
@@ -13151,6 +13294,66 @@ test_134b() {
 }
 run_test 134b "Server rejects lock request when reaching lock_limit_mb"
 
+test_134c() {
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+	do_facet mds1 $LCTL get_param -n ldlm.lock_export_hard_limit ||
+		skip "MDS does not support per-export lock limits"
+
+	local nid
+	local granted
+
+	if remote_mds; then
+		nid=$($LCTL list_nids | head -1 | sed "s/\./\\\./g")
+	else
+		nid="0@lo"
+	fi
+	local param="mdt.$FSNAME-MDT0000.exports.'$nid'.export"
+
+	mkdir -p $DIR/$tdir || error "failed to create $DIR/$tdir"
+	cancel_lru_locks mdc
+
+	# open and getattr locks are granted by the intent policy before
+	# they are given to the export, they must be accounted all the same
+	local nr=500
+	createmany -o $DIR/$tdir/f $nr ||
+		error "failed to create $nr files in $DIR/$tdir"
+	ls -l $DIR/$tdir > /dev/null
+	granted=$(do_facet mds1 $LCTL get_param -n $param |
+		  awk '/granted_locks:/ { print $2 }')
+	echo "granted locks after create: $granted"
+	[ -n "$granted" ] || error "no granted_locks in $param"
+	(( granted > 0 )) || error "granted_locks $granted after create"
+
+	cancel_lru_locks mdc
+	granted=$(do_facet mds1 $LCTL get_param -n $param |
+		  awk '/granted_locks:/ { print $2 }')
+	echo "granted locks after cancel: $granted"
+	(( granted >= 0 && granted < nr )) ||
+		error "granted_locks $granted after cancel"
+
+	# an export over its hard limit gets -EINPROGRESS for new locks
+	local hard=$(do_facet mds1 $LCTL get_param -n \
+		     ldlm.lock_export_hard_limit)
+
+	do_facet mds1 $LCTL set_param ldlm.lock_export_hard_limit=100
+	stack_trap "do_facet mds1 $LCTL set_param \
+		    ldlm.lock_export_hard_limit=$hard" EXIT
+
+	stat $DIR/$tdir/f* > /dev/null &
+	local stat_pid=$!
+
+	echo "Sleep $TIMEOUT seconds ..."
+	sleep $TIMEOUT
+	ps -p $stat_pid > /dev/null 2>&1 ||
+		error "stat finished over the export lock limit"
+	do_facet mds1 $LCTL set_param ldlm.lock_export_hard_limit=$hard
+	cancel_lru_locks mdc
+	wait $stat_pid || error "stat failed"
+
+	unlinkmany $DIR/$tdir/f $nr
+}
+run_test 134c "Server accounts and limits locks per export"
+
 test_135() {
 	remote_mds_nodsh && skip "remote MDS with nodsh"
 	[[ $MDS1_VERSION -lt $(version_code 2.13.50) ]] &&
@@ -14981,6 +15184,37 @@ test_160k() {
 }
 run_test 160k "Verify that changelog records are not lost"
 
+test_160l() {
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+
+	local mdt=$(facet_svc mds1)
+	local nr=10000
+
+	changelog_register || error "changelog_register failed"
+	stack_trap "changelog_deregister" EXIT
+
+	test_mkdir -c1 -i0 $DIR/$tdir || error "mkdir $DIR/$tdir failed"
+	createmany -m $DIR/$tdir/f $nr || error "createmany failed"
+
+	# the ring gives the same records in the same order as read()
+	$LFS changelog $mdt | awk '{ print $1 }' > $TMP/$tfile.read ||
+		error "read changelog failed"
+	stack_trap "rm -f $TMP/$tfile.*" EXIT
+	chlg_ring_test $mdt > $TMP/$tfile.ring || error "ring read failed"
+	(( $(wc -l < $TMP/$tfile.ring) >= nr )) ||
+		error "only $(wc -l < $TMP/$tfile.ring) records in ring"
+	cmp $TMP/$tfile.read $TMP/$tfile.ring ||
+		error "ring and read() records differ"
+
+	# more records than the smallest ring, so that the kernel waits for
+	# the reader to release some while the reader corrupts crh_tail
+	chlg_ring_test -t $mdt || error "bogus ring tail not rejected"
+
+	changelog_clear 0 || error "changelog_clear failed"
+	rm -rf $DIR/$tdir
+}
+run_test 160l "changelog records through the mmap'd ring"
+
 test_161a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 
@@ -18242,6 +18476,95 @@ test_230q() {
 }
 run_test 230q "dir auto split"
 
+test_230r() {
+	[ $MDSCOUNT -ge 2 ] || skip "needs >= 2 MDTs"
+	do_facet mds1 $LCTL get_param -n mdt.*-MDT0000.dir_restripe_status ||
+		skip "MDS does not support parallel dir restripe"
+
+	local mdts=$(comma_list $(mdts_nodes))
+	local saved_threshold=$(do_facet mds1 \
+			$LCTL get_param -n mdt.*-MDT0000.dir_split_count)
+	local saved_delta=$(do_facet mds1 \
+			$LCTL get_param -n mdt.*-MDT0000.dir_split_delta)
+	local saved_threads=$(do_facet mds1 \
+			$LCTL get_param -n mdt.*-MDT0000.dir_restripe_threads)
+	local saved_rate=$(do_facet mds1 \
+			$LCTL get_param -n mdt.*-MDT0000.dir_restripe_rate)
+	local threshold=1000
+	local total=$((threshold * 2))
+	local threads=8
+	local rate=200
+	local stripe_count=$MDSCOUNT
+	local migrated0
+	local migrated1
+	local nr_threads
+	local nr_files
+	local start
+	local elapsed
+
+	[ $stripe_count -gt 3 ] && stripe_count=3
+
+	stack_trap "do_nodes $mdts $LCTL set_param \
+		    mdt.*.dir_split_count=$saved_threshold"
+	stack_trap "do_nodes $mdts $LCTL set_param \
+		    mdt.*.dir_split_delta=$saved_delta"
+	stack_trap "do_nodes $mdts $LCTL set_param \
+		    mdt.*.dir_restripe_threads=$saved_threads"
+	stack_trap "do_nodes $mdts $LCTL set_param \
+		    mdt.*.dir_restripe_rate=$saved_rate"
+	stack_trap "do_nodes $mdts $LCTL set_param mdt.*.dir_restripe_nsonly=1"
+	do_nodes $mdts "$LCTL set_param mdt.*.enable_dir_auto_split=1"
+	do_nodes $mdts "$LCTL set_param mdt.*.dir_split_count=$threshold"
+	do_nodes $mdts "$LCTL set_param mdt.*.dir_split_delta=$((stripe_count - 1))"
+	do_nodes $mdts "$LCTL set_param mdt.*.dir_restripe_nsonly=0"
+	do_nodes $mdts "$LCTL set_param mdt.*.dir_restripe_threads=$threads"
+	do_nodes $mdts "$LCTL set_param mdt.*.dir_restripe_rate=$rate"
+	do_nodes $mdts "$LCTL set_param lod.*.mdt_hash=crush"
+
+	nr_threads=$(do_facet mds1 "ps -e -o comm=" | grep -c "^mdt_rsm_000_")
+	echo "$nr_threads restripe migrate threads on mds1"
+	[ $nr_threads -ge $threads ] ||
+		error "$nr_threads migrate threads on mds1 < $threads"
+
+	$LFS mkdir -i 0 -c 1 $DIR/$tdir || error "mkdir $tdir failed"
+	migrated0=$(do_facet mds1 $LCTL get_param -n \
+		    mdt.*-MDT0000.dir_restripe_status | awk '/^migrated:/ { print $2 }')
+
+	start=$SECONDS
+	createmany -m $DIR/$tdir/f $total || error "create sub files failed"
+
+	wait_update $HOSTNAME "$LFS getdirstripe -c $DIR/$tdir" \
+		"$stripe_count" 40 ||
+		error "stripe count $($LFS getdirstripe -c $DIR/$tdir) != $stripe_count"
+	do_facet mds1 $LCTL get_param mdt.*-MDT0000.dir_restripe_status
+	wait_update $HOSTNAME "$LFS getdirstripe -H $DIR/$tdir" "crush" 200 ||
+		error "stripe hash $($LFS getdirstripe -H $DIR/$tdir) != crush"
+	elapsed=$((SECONDS - start))
+
+	migrated1=$(do_facet mds1 $LCTL get_param -n \
+		    mdt.*-MDT0000.dir_restripe_status | awk '/^migrated:/ { print $2 }')
+	echo "$((migrated1 - migrated0)) sub files migrated in ${elapsed}s"
+	[ $migrated1 -gt $migrated0 ] || error "no sub file migrated"
+	[ $elapsed -ge $(((migrated1 - migrated0) / rate - 1)) ] ||
+		error "migrated faster than $rate files per second"
+
+	$LFS getdirstripe $DIR/$tdir
+	[ $($LFS getdirstripe -i $DIR/$tdir) -eq 0 ] ||
+		error "master stripe moved off MDT0000"
+
+	nr_files=$(ls $DIR/$tdir | wc -w)
+	[ $nr_files -eq $total ] || error "total sub files $nr_files != $total"
+
+	nr_files=$($LFS getstripe -m $DIR/$tdir/* | grep -w 0 | wc -l)
+	echo "$nr_files files on MDT0000 after split"
+	[ $nr_files -lt $((total * 2 / stripe_count)) ] ||
+		error "$nr_files files on MDT0000 after split"
+
+	nr_files=$($LFS find $DIR/$tdir -type f | wc -l)
+	[ $nr_files -eq $total ] || error "found $nr_files sub files != $total"
+}
+run_test 230r "dir auto split with parallel rate limited migration"
+
 test_231a()
 {
 	# For simplicity this test assumes that max_pages_per_rpc
@@ -23233,6 +23556,268 @@ test_424() {
 }
 run_test 424 "simulate ENOMEM in ptl_send_rpc bulk reply ME attach"
 
+deferred_destroy_stat() {
+	do_facet mds1 $LCTL get_param -n \
+		mdd.$(facet_svc mds1).deferred_destroy_stats |
+		awk '$1 == "'$1':" { print $2 }'
+}
+
+wait_deferred_destroy() {
+	local i
+
+	for ((i = 0; i < 60; i++)); do
+		(( $(deferred_destroy_stat pending) == 0 )) && return 0
+		sleep 1
+	done
+
+	return 1
+}
+
+test_425() {
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+
+	local threads=$(do_facet mds1 $LCTL get_param -n \
+			mdd.$(facet_svc mds1).deferred_destroy_threads)
+
+	[[ -n "$threads" ]] || skip "MDS does not defer destroys"
+	(( threads > 0 )) || skip "deferred destroy disabled"
+
+	local nr=100
+	local destroyed
+	local failed
+
+	test_mkdir -i0 -c1 $DIR/$tdir || error "mkdir $DIR/$tdir failed"
+	createmany -o $DIR/$tdir/f $nr || error "createmany failed"
+
+	destroyed=$(deferred_destroy_stat destroyed)
+	unlinkmany $DIR/$tdir/f $nr || error "unlinkmany failed"
+	wait_deferred_destroy || error "files not destroyed"
+	(( $(deferred_destroy_stat destroyed) >= destroyed + nr )) ||
+		error "not all files destroyed"
+
+	# destroys blocked by a write barrier are retried, not dropped
+	createmany -o $DIR/$tdir/f $nr || error "createmany failed"
+	destroyed=$(deferred_destroy_stat destroyed)
+	failed=$(deferred_destroy_stat failed)
+
+	# hold the destroy threads until the barrier is frozen
+	#define OBD_FAIL_MDS_DESTROY_DELAY	0x16a
+	do_facet mds1 $LCTL set_param fail_loc=0x8000016a fail_val=10
+	unlinkmany $DIR/$tdir/f $nr || error "unlinkmany failed"
+	do_facet mgs $LCTL barrier_freeze $FSNAME 30 ||
+		error "barrier_freeze failed"
+	stack_trap "do_facet mgs $LCTL barrier_thaw $FSNAME" EXIT
+
+	sleep 12
+	(( $(deferred_destroy_stat pending) > 0 )) ||
+		error "destroys done under the write barrier"
+	do_facet mgs $LCTL barrier_thaw $FSNAME || error "barrier_thaw failed"
+
+	wait_deferred_destroy ||
+		error "files not destroyed after barrier_thaw"
+	(( $(deferred_destroy_stat failed) == failed )) ||
+		error "destroys failed under the write barrier"
+	(( $(deferred_destroy_stat destroyed) >= destroyed + nr )) ||
+		error "not all files destroyed"
+}
+run_test 425 "deferred destroy of unlinked files"
+
+test_426() {
+	local count=$($LCTL get_param -n \
+		      llite.$FSNAME-*.opencache_threshold_count 2>/dev/null |
+		      head -n1)
+	[ -n "$count" ] || skip "client does not support the open cache"
+
+	local save="$TMP/$TESTSUITE-$TESTNAME.parameters"
+	local nr=20
+	local before
+	local after
+	local i
+
+	save_lustre_params client "llite.*.opencache_*" > $save
+	stack_trap "restore_lustre_params < $save; rm -f $save" EXIT
+	$LCTL set_param llite.*.opencache_threshold_count=5 \
+		llite.*.opencache_threshold_ms=1000 \
+		llite.*.opencache_max_ms=60000
+
+	touch $DIR/$tfile || error "touch $tfile failed"
+	cancel_lru_locks mdc
+
+	# from the 5th open on, the MDS open handle is cached at close
+	before=$(calc_stats mdc.*.stats mds_close)
+	for ((i = 0; i < nr; i++)); do
+		cat $DIR/$tfile > /dev/null || error "cat $tfile failed"
+	done
+	after=$(calc_stats mdc.*.stats mds_close)
+	echo "$((after - before)) closes for $nr opens"
+	(( after - before <= 5 )) ||
+		error "$((after - before)) closes with the open cache enabled"
+
+	# cancelling the OPEN lock closes the cached handle
+	before=$after
+	cancel_lru_locks mdc
+	after=$(calc_stats mdc.*.stats mds_close)
+	(( after - before == 1 )) ||
+		error "$((after - before)) closes on OPEN lock cancel != 1"
+
+	# write opens are never cached
+	before=$after
+	for ((i = 0; i < nr; i++)); do
+		echo $i >> $DIR/$tfile || error "append $tfile failed"
+	done
+	after=$(calc_stats mdc.*.stats mds_close)
+	(( after - before == nr )) ||
+		error "$((after - before)) closes for $nr write opens"
+
+	$LCTL set_param llite.*.opencache_threshold_count=0
+	cancel_lru_locks mdc
+	before=$(calc_stats mdc.*.stats mds_close)
+	for ((i = 0; i < nr; i++)); do
+		cat $DIR/$tfile > /dev/null || error "cat $tfile failed"
+	done
+	after=$(calc_stats mdc.*.stats mds_close)
+	(( after - before == nr )) ||
+		error "$((after - before)) closes with the open cache disabled"
+}
+run_test 426 "open cache keeps the handle of frequently opened files"
+
+# print the number of OST0000 objects owned by user $1
+ost_acct_inodes() {
+	do_facet ost1 $LCTL get_param -n \
+		osd-*.$FSNAME-OST0000.quota_slave.acct_user |
+		awk -v id=$1 '/id:/ { found = ($3 == id) }
+			found && /usage:/ { print $4 + 0; exit }'
+}
+
+test_427() {
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+
+	local osp=$FSNAME-OST0000-osc-MDT0000
+	local batch_max=$(do_facet mds1 $LCTL get_param -n \
+			  osp.$osp.sync_batch_max 2>/dev/null)
+	[ -n "$batch_max" ] || skip "MDS does not support setattr batching"
+
+	local nr=200
+	local rpcs
+	local recs
+	local inodes
+
+	stack_trap "do_facet mds1 $LCTL set_param \
+		    osp.$osp.sync_batch_max=$batch_max" EXIT
+	do_facet mds1 $LCTL set_param osp.$osp.sync_batch_max=64
+
+	test_mkdir -i 0 $DIR/$tdir || error "mkdir $tdir failed"
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir || error "setstripe $tdir failed"
+	createmany -o $DIR/$tdir/f- $nr || error "create $nr files failed"
+	do_facet mds1 $LCTL set_param -n osp.$osp.force_sync=1
+
+	rpcs=$(do_facet mds1 $LCTL get_param -n osp.$osp.sync_batch_rpcs)
+	recs=$(do_facet mds1 $LCTL get_param -n osp.$osp.sync_batch_recs)
+
+	chown -R $RUNAS_ID:$RUNAS_GID $DIR/$tdir || error "chown failed"
+	do_facet mds1 $LCTL set_param -n osp.$osp.force_sync=1
+
+	rpcs=$(($(do_facet mds1 $LCTL get_param -n \
+		  osp.$osp.sync_batch_rpcs) - rpcs))
+	recs=$(($(do_facet mds1 $LCTL get_param -n \
+		  osp.$osp.sync_batch_recs) - recs))
+	echo "$recs setattr changes sent in $rpcs batch RPCs"
+	(( recs > 0 && rpcs > 0 && rpcs < recs )) ||
+		error "$recs changes in $rpcs RPCs were not batched"
+
+	inodes=$(ost_acct_inodes $RUNAS_ID)
+	(( inodes >= nr )) ||
+		error "only ${inodes:-0} of $nr OST objects owned by $RUNAS_ID"
+
+	# with batching disabled, the changes go out one RPC per object
+	do_facet mds1 $LCTL set_param osp.$osp.sync_batch_max=0
+	rpcs=$(do_facet mds1 $LCTL get_param -n osp.$osp.sync_batch_rpcs)
+
+	chown -R 0:0 $DIR/$tdir || error "chown back failed"
+	do_facet mds1 $LCTL set_param -n osp.$osp.force_sync=1
+
+	(( $(do_facet mds1 $LCTL get_param -n osp.$osp.sync_batch_rpcs) ==
+	   rpcs )) || error "batch RPC sent with sync_batch_max=0"
+	inodes=$(ost_acct_inodes $RUNAS_ID)
+	(( ${inodes:-0} == 0 )) ||
+		error "$inodes OST objects still owned by $RUNAS_ID"
+
+	do_facet mds1 $LCTL set_param osp.$osp.sync_batch_max=65 &&
+		error "sync_batch_max over OST_SETATTR_BATCH_MAX accepted"
+	return 0
+}
+run_test 427 "batched setattr propagation to OSTs"
+
+test_428() {
+	local ns="ldlm.namespaces.$FSNAME-MDT0000-mdc-*"
+	local hot_max=$($LCTL get_param -n $ns.lru_hot_max 2>/dev/null |
+			head -n1)
+	[ -n "$hot_max" ] || skip "client does not support lru_hot_max"
+
+	local nr=64
+	local chances
+	local refaults
+	local before
+	local after
+	local i
+
+	stack_trap "$LCTL set_param $ns.lru_hot_max=$hot_max" EXIT
+	stack_trap "lru_resize_enable mdc" EXIT
+
+	test_mkdir -i 0 -c 1 $DIR/$tdir || error "mkdir $tdir failed"
+	createmany -o $DIR/$tdir/f- $nr || error "create $nr files failed"
+	touch $DIR/$tdir/hot || error "touch hot failed"
+
+	for hot_max in 3 0; do
+		$LCTL set_param $ns.lru_hot_max=$hot_max
+		cancel_lru_locks mdc
+		$LCTL set_param $ns.lru_size=$nr
+
+		# the oldest lock in the LRU is reused a few times
+		for ((i = 0; i < 5; i++)); do
+			stat $DIR/$tdir/hot > /dev/null || error "stat hot failed"
+		done
+		chances=$($LCTL get_param -n $ns.lru_second_chances)
+
+		# cold locks push the LRU over lru_size
+		for ((i = 0; i < nr; i++)); do
+			stat $DIR/$tdir/f-$i > /dev/null ||
+				error "stat f-$i failed"
+		done
+		chances=$(($($LCTL get_param -n $ns.lru_second_chances) -
+			   chances))
+
+		before=$(calc_stats mdc.$FSNAME-MDT0000-mdc-*.stats \
+			 ldlm_ibits_enqueue)
+		stat $DIR/$tdir/hot > /dev/null || error "stat hot failed"
+		after=$(calc_stats mdc.$FSNAME-MDT0000-mdc-*.stats \
+			ldlm_ibits_enqueue)
+		echo "lru_hot_max=$hot_max: $chances second chances," \
+		     "$((after - before)) enqueues for the hot file"
+
+		if (( hot_max > 0 )); then
+			(( chances > 0 )) || error "hot lock got no second chance"
+			(( after == before )) ||
+				error "hot lock canceled before cold locks"
+		else
+			(( chances == 0 )) ||
+				error "$chances second chances with lru_hot_max=0"
+			(( after > before )) ||
+				error "oldest lock kept with lru_hot_max=0"
+		fi
+	done
+
+	# locks of the first cold files were canceled from the LRU, taking
+	# them again counts as refaults
+	refaults=$($LCTL get_param -n $ns.lru_refaults)
+	for ((i = 0; i < nr / 2; i++)); do
+		stat $DIR/$tdir/f-$i > /dev/null || error "stat f-$i failed"
+	done
+	(( $($LCTL get_param -n $ns.lru_refaults) > refaults )) ||
+		error "no refault after LRU cancellation"
+}
+run_test 428 "LRU cancellation prefers one-shot locks"
+
 prep_801() {
 	[[ $MDS1_VERSION -lt $(version_code 2.9.55) ]] ||
 	[[ $OST1_VERSION -lt $(version_code 2.9.55) ]] &&
@@ -23985,6 +24570,55 @@ test_810() {
 }
 run_test 810 "partial page writes on ZFS (LU-11663)"
 
+test_811() {
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+	local mdt_trust=$(do_facet mds1 $LCTL get_param -n \
+			  mdt.$FSNAME-MDT0000.lsom_trust 2>/dev/null)
+	[ -n "$mdt_trust" ] || skip "MDS does not support lsom_trust"
+	$LCTL get_param -n mdc.$FSNAME-MDT0000-mdc-*.import |
+		grep -q lsom_trust || skip "lsom_trust not negotiated with MDS"
+
+	local save="$TMP/$TESTSUITE-$TESTNAME.parameters"
+	local before
+	local after
+	local size
+
+	save_lustre_params client "llite.*.lsom_trust" > $save
+	save_lustre_params mds1 "mdt.*.lsom_trust" >> $save
+	stack_trap "restore_lustre_params < $save; rm -f $save" EXIT
+	$LCTL set_param llite.*.lsom_trust=1
+	do_facet mds1 $LCTL set_param mdt.*.lsom_trust=1
+
+	mount_client $MOUNT2 || error "mount_client on $MOUNT2 failed"
+	stack_trap "umount_client $MOUNT2" EXIT
+
+	$LFS setstripe -c 1 -i 0 $DIR/$tfile || error "setstripe $tfile failed"
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=1 conv=fsync ||
+		error "write $tfile failed"
+	cancel_lru_locks mdc
+	cancel_lru_locks osc
+
+	# the getattr reply says LSOM is up to date, no glimpse needed
+	before=$(calc_stats $OSC.*$OSC*.stats ldlm_glimpse_enqueue)
+	size=$(stat -c %s $DIR/$tfile)
+	after=$(calc_stats $OSC.*$OSC*.stats ldlm_glimpse_enqueue)
+	(( size == 1048576 )) || error "size $size after getattr != 1048576"
+	(( after == before )) ||
+		error "$((after - before)) glimpses with trusted LSOM"
+
+	# grow the file from another mount, which leaves the MDC lock of
+	# this mount cached, so the next stat sends no getattr RPC
+	dd if=/dev/zero of=$DIR2/$tfile bs=1M count=1 seek=1 conv=notrunc ||
+		error "write $DIR2/$tfile failed"
+
+	before=$(calc_stats $OSC.*$OSC*.stats ldlm_glimpse_enqueue)
+	size=$(stat -c %s $DIR/$tfile)
+	after=$(calc_stats $OSC.*$OSC*.stats ldlm_glimpse_enqueue)
+	(( size == 2097152 )) || error "stale size $size != 2097152"
+	(( after > before )) || error "no glimpse with cached MDC lock"
+}
+run_test 811 "trust LSOM only from a fresh getattr reply"
+
 test_812a() {
 	[ $OST1_VERSION -lt $(version_code 2.12.51) ] &&
 		skip "OST < 2.12.51 doesn't support this fail_loc"
@@ -24336,6 +24970,53 @@ test_820() {
 }
 run_test 820 "update max EA from open intent"
 
+test_821() {
+	local ost=obdfilter.$FSNAME-OST0000
+	local nproc=16
+	local pids=""
+	local reqs
+	local commits
+	local i
+
+	do_facet ost1 "$LCTL get_param -n $ost.sync_group_requests" ||
+		skip "OST does not support sync group commit"
+
+	test_mkdir $DIR/$tdir
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir || error "lfs setstripe failed"
+
+	do_facet ost1 "$LCTL set_param -n $ost.sync_group_requests=0 \
+		$ost.sync_group_commits=0"
+	stack_trap "do_facet ost1 $LCTL set_param -n \
+		$ost.sync_group_requests=0 $ost.sync_group_commits=0"
+
+	# concurrent fsync of uncommitted writes should share journal commits
+	for ((i = 0; i < nproc; i++)); do
+		dd if=/dev/urandom of=$DIR/$tdir/$tfile.$i bs=4k count=50 \
+			oflag=sync &>/dev/null &
+		pids+=" $!"
+	done
+	for i in $pids; do
+		wait $i || error "dd $i failed"
+	done
+
+	reqs=$(do_facet ost1 "$LCTL get_param -n $ost.sync_group_requests")
+	commits=$(do_facet ost1 "$LCTL get_param -n $ost.sync_group_commits")
+	echo "$reqs sync requests released by $commits group commits"
+	(( reqs > 0 )) || error "no sync request used the group commit"
+	(( commits <= reqs )) ||
+		error "$commits commits started for $reqs sync requests"
+	(( commits < reqs )) ||
+		error "no commit was shared by sync requests"
+
+	# data written through the group commit must be intact
+	cancel_lru_locks osc
+	for ((i = 0; i < nproc; i++)); do
+		[[ $(stat -c %s $DIR/$tdir/$tfile.$i) == 204800 ]] ||
+			error "$tfile.$i has wrong size"
+	done
+}
+run_test 821 "sync requests share group commits on the OST"
+
 #
 # tests that do cleanup/setup should be run at the end
 #
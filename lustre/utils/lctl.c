@@ -375,7 +375,7 @@ command_t cmdlist[] = {
 	{"===  Changelogs ==", NULL, 0, "changelog user management"},
 	{"changelog_register", jt_changelog_register, 0,
 	 "register a new persistent changelog user, returns id\n"
-	 "usage: --device <mdtname> changelog_register [-n]"},
+	 "usage: --device <mdtname> changelog_register [-n] [-s]"},
 	{"changelog_deregister", jt_changelog_deregister, 0,
 	 "deregister an existing changelog user\n"
 	 "usage: --device <mdtname> changelog_deregister <id>"},
@@ -94,6 +94,7 @@ struct options {
 	int			 o_report_int;
 	unsigned long long	 o_bandwidth;
 	size_t			 o_chunk_size;
+	int			 o_streams;
 	enum ct_action		 o_action;
 	char			*o_event_fifo;
 	char			*o_mnt;
@@ -111,6 +112,7 @@ struct options opt = {
 	.o_copy_xattrs = 1,
 	.o_report_int = REPORT_INTERVAL_DEFAULT,
 	.o_chunk_size = ONE_MB,
+	.o_streams = 1,
 };
 
 /* hsm_copytool_private will hold an open FD on the lustre mount point
@@ -201,6 +203,8 @@ static void usage(const char *name, int rc)
 	"   -f, --event-fifo <path>   Write events stream to fifo\n"
 	"   -p, --hsm-root <path>     Target HSM mount point\n"
 	"   -q, --quiet               Produce less verbose output\n"
+	"   -s, --streams <n>         Number of parallel I/O streams used to\n"
+	"                             copy a single file (default 1)\n"
 	"   -u, --update-interval <s> Interval between progress reports sent\n"
 	"                             to Coordinator\n"
 	"   -v, --verbose             Produce more verbose output\n",
@@ -246,6 +250,7 @@ static int ct_parseopts(int argc, char * const *argv)
 	{ .val = 'p',	.name = "hsm_root",	.has_arg = required_argument },
 	{ .val = 'q',	.name = "quiet",	.has_arg = no_argument },
 	{ .val = 'r',	.name = "rebind",	.has_arg = no_argument },
+	{ .val = 's',	.name = "streams",	.has_arg = required_argument },
 	{ .val = 'u',	.name = "update-interval",
 						.has_arg = required_argument },
 	{ .val = 'u',	.name = "update_interval",
@@ -266,7 +271,7 @@ static int ct_parseopts(int argc, char * const *argv)
 	if (opt.o_archive_id == NULL)
 		return -ENOMEM;
 repeat:
-	while ((c = getopt_long(argc, argv, "A:b:c:f:hiMp:qru:v",
+	while ((c = getopt_long(argc, argv, "A:b:c:f:hiMp:qrs:u:v",
 				long_opts, NULL)) != -1) {
 		switch (c) {
 		case 'A': {
@@ -349,6 +354,15 @@ repeat:
 		case 'r':
 			opt.o_action = CA_REBIND;
 			break;
+		case 's':
+			opt.o_streams = atoi(optarg);
+			if (opt.o_streams < 1) {
+				rc = -EINVAL;
+				CT_ERROR(rc, "bad value for -%c '%s'", c,
+					 optarg);
+				return rc;
+			}
+			break;
 		case 'u':
 			opt.o_report_int = atoi(optarg);
 			if (opt.o_report_int < 0) {
@@ -571,6 +585,307 @@ static int ct_restore_stripe(const char *src, const char *dst, int dst_fd,
 	return rc;
 }
 
+/* Sleep if needed so that \a write_total bytes written since \a start_time
+ * honor the bandwidth limit. */
+static void ct_bandwidth_wait(time_t start_time, __u64 write_total,
+			      time_t *last_bw_print)
+{
+	unsigned long long	write_theory;
+	unsigned long long	excess;
+	struct timespec		delay;
+	time_t			now;
+	int			rc;
+
+	if (opt.o_bandwidth == 0)
+		return;
+
+	now = time(NULL);
+	write_theory = (now - start_time) * opt.o_bandwidth;
+	if (write_theory >= write_total)
+		return;
+
+	excess = write_total - write_theory;
+
+	delay.tv_sec = excess / opt.o_bandwidth;
+	delay.tv_nsec = (excess % opt.o_bandwidth) *
+		NSEC_PER_SEC / opt.o_bandwidth;
+
+	if (now >= *last_bw_print + opt.o_report_int) {
+		CT_TRACE("bandwith control: %lluB/s "
+			 "excess=%llu sleep for "
+			 "%lld.%09lds",
+			 (unsigned long long)opt.o_bandwidth,
+			 (unsigned long long)excess,
+			 (long long)delay.tv_sec,
+			 delay.tv_nsec);
+		*last_bw_print = now;
+	}
+
+	do {
+		rc = nanosleep(&delay, &delay);
+	} while (rc < 0 && errno == EINTR);
+	if (rc < 0)
+		CT_ERROR(errno, "delay for bandwidth "
+			 "control failed to sleep: "
+			 "residual=%lld.%09lds",
+			 (long long)delay.tv_sec,
+			 delay.tv_nsec);
+}
+
+/* State shared by the streams copying a single file in parallel. Each
+ * stream repeatedly takes the next chunk of the extent to copy, so the
+ * file is copied from its start whatever the number of streams. */
+struct ct_copy_streams {
+	pthread_mutex_t		 ccs_lock;
+	pthread_cond_t		 ccs_cond;
+	const char		*ccs_src;
+	const char		*ccs_dst;
+	int			 ccs_src_fd;
+	int			 ccs_dst_fd;
+	__u64			 ccs_next;	/* next offset to copy */
+	__u64			 ccs_end;	/* end of the extent */
+	__u64			 ccs_copied;	/* bytes copied */
+	time_t			 ccs_start_time;
+	time_t			 ccs_last_bw_print;
+	int			 ccs_running;	/* running streams */
+	int			 ccs_rc;	/* first error */
+};
+
+/* Copy [offset, offset + length) from src to dst, return the number of
+ * bytes copied, which is less than length at the end of src. */
+/* Whether copy_file_range() failed with \a rc only because it can't copy
+ * between these files, so that read/write must be used instead. Before
+ * Linux kernel 5.3 it only supported copies between filesystems of the
+ * same type (-EXDEV), and some filesystems reject it with -EINVAL or
+ * -EOPNOTSUPP. */
+static bool ct_copy_range_unsupported(int rc)
+{
+	return rc == -EXDEV || rc == -ENOSYS || rc == -EINVAL ||
+	       rc == -EOPNOTSUPP;
+}
+
+static ssize_t ct_copy_range(struct ct_copy_streams *ccs, char **buf,
+			     __u64 offset, size_t length)
+{
+	loff_t	 off_in = offset;
+	loff_t	 off_out = offset;
+	size_t	 done = 0;
+	ssize_t	 rsize;
+	ssize_t	 wsize;
+	int	 rc;
+
+	while (done < length) {
+		if (*buf == NULL) {
+			wsize = copy_file_range(ccs->ccs_src_fd, &off_in,
+						ccs->ccs_dst_fd, &off_out,
+						length - done, 0);
+			if (wsize == 0)
+				break;
+			if (wsize > 0) {
+				done += wsize;
+				continue;
+			}
+
+			rc = -errno;
+			if (!ct_copy_range_unsupported(rc)) {
+				CT_ERROR(rc, "copy_file_range failed for "
+					 "'%s' to '%s'", ccs->ccs_src,
+					 ccs->ccs_dst);
+				return rc;
+			}
+
+			/* fall back to read/write for this stream */
+			*buf = malloc(opt.o_chunk_size);
+			if (*buf == NULL)
+				return -ENOMEM;
+		}
+
+		rsize = pread(ccs->ccs_src_fd, *buf, length - done,
+			      offset + done);
+		if (rsize == 0)
+			/* EOF */
+			break;
+		if (rsize < 0) {
+			rc = -errno;
+			CT_ERROR(rc, "cannot read from '%s'", ccs->ccs_src);
+			return rc;
+		}
+
+		wsize = pwrite(ccs->ccs_dst_fd, *buf, rsize, offset + done);
+		if (wsize < 0) {
+			rc = -errno;
+			CT_ERROR(rc, "cannot write to '%s'", ccs->ccs_dst);
+			return rc;
+		}
+		done += wsize;
+	}
+
+	return done;
+}
+
+static void *ct_copy_stream(void *data)
+{
+	struct ct_copy_streams	*ccs = data;
+	char			*buf = NULL;
+	__u64			 offset;
+	__u64			 copied;
+	size_t			 length;
+	ssize_t			 rc;
+
+	while (1) {
+		pthread_mutex_lock(&ccs->ccs_lock);
+		if (ccs->ccs_rc != 0 || ccs->ccs_next >= ccs->ccs_end) {
+			pthread_mutex_unlock(&ccs->ccs_lock);
+			break;
+		}
+		offset = ccs->ccs_next;
+		length = ccs->ccs_end - offset;
+		if (length > opt.o_chunk_size)
+			length = opt.o_chunk_size;
+		ccs->ccs_next += length;
+		pthread_mutex_unlock(&ccs->ccs_lock);
+
+		rc = ct_copy_range(ccs, &buf, offset, length);
+
+		pthread_mutex_lock(&ccs->ccs_lock);
+		if (rc < 0) {
+			if (ccs->ccs_rc == 0)
+				ccs->ccs_rc = rc;
+		} else {
+			ccs->ccs_copied += rc;
+			/* short copy, src is shorter than expected */
+			if ((size_t)rc < length && ccs->ccs_end > offset + rc)
+				ccs->ccs_end = offset + rc;
+		}
+		copied = ccs->ccs_copied;
+		pthread_mutex_unlock(&ccs->ccs_lock);
+
+		if (rc < 0)
+			break;
+
+		ct_bandwidth_wait(ccs->ccs_start_time, copied,
+				  &ccs->ccs_last_bw_print);
+	}
+
+	pthread_mutex_lock(&ccs->ccs_lock);
+	ccs->ccs_running--;
+	pthread_cond_signal(&ccs->ccs_cond);
+	pthread_mutex_unlock(&ccs->ccs_lock);
+
+	free(buf);
+
+	return NULL;
+}
+
+/* Copy the extent with opt.o_streams threads, the calling thread only
+ * reports progress to the coordinator. */
+static int ct_copy_data_streams(struct hsm_copyaction_private *hcp,
+				const char *src, const char *dst,
+				int src_fd, int dst_fd,
+				__u64 offset, __u64 length)
+{
+	struct ct_copy_streams	 ccs = {
+		.ccs_src	= src,
+		.ccs_dst	= dst,
+		.ccs_src_fd	= src_fd,
+		.ccs_dst_fd	= dst_fd,
+		.ccs_next	= offset,
+		.ccs_end	= offset + length,
+	};
+	struct hsm_extent	 he;
+	pthread_t		*threads;
+	time_t			 last_report_time;
+	int			 streams;
+	int			 started;
+	int			 rc;
+	int			 rc2;
+
+	streams = opt.o_streams;
+	if (streams > (length + opt.o_chunk_size - 1) / opt.o_chunk_size)
+		streams = (length + opt.o_chunk_size - 1) / opt.o_chunk_size;
+
+	threads = calloc(streams, sizeof(*threads));
+	if (threads == NULL)
+		return -ENOMEM;
+
+	pthread_mutex_init(&ccs.ccs_lock, NULL);
+	pthread_cond_init(&ccs.ccs_cond, NULL);
+	ccs.ccs_start_time = ccs.ccs_last_bw_print = time(NULL);
+	last_report_time = ccs.ccs_start_time;
+
+	CT_TRACE("start copy of %ju bytes from '%s' to '%s' with %d streams",
+		 (uintmax_t)length, src, dst, streams);
+
+	pthread_mutex_lock(&ccs.ccs_lock);
+	for (started = 0; started < streams; started++) {
+		rc = pthread_create(&threads[started], NULL, ct_copy_stream,
+				    &ccs);
+		if (rc != 0) {
+			/* the streams already started copy everything */
+			CT_ERROR(-rc, "cannot start copy stream %d for '%s'",
+				 started, src);
+			break;
+		}
+		ccs.ccs_running++;
+	}
+
+	if (started == 0) {
+		ccs.ccs_rc = -rc;
+		goto out_unlock;
+	}
+
+	he.offset = offset;
+	he.length = 0;
+	while (ccs.ccs_running > 0) {
+		struct timespec	ts;
+		time_t		now;
+
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += opt.o_report_int > 0 ? opt.o_report_int : 1;
+		pthread_cond_timedwait(&ccs.ccs_cond, &ccs.ccs_lock, &ts);
+
+		now = time(NULL);
+		if (ccs.ccs_running == 0 || ccs.ccs_rc != 0 ||
+		    now < last_report_time + opt.o_report_int)
+			continue;
+
+		last_report_time = now;
+		CT_TRACE("%%%ju ", (uintmax_t)(100 * ccs.ccs_copied / length));
+		/* only give the length of the write since the last
+		 * progress report */
+		he.length = ccs.ccs_copied - (he.offset - offset);
+		pthread_mutex_unlock(&ccs.ccs_lock);
+		rc = llapi_hsm_action_progress(hcp, &he, length, 0);
+		pthread_mutex_lock(&ccs.ccs_lock);
+		if (rc < 0) {
+			/* Action has been canceled or something wrong
+			 * is happening. Stop copying data. */
+			CT_ERROR(rc, "progress ioctl for copy"
+				 " '%s'->'%s' failed", src, dst);
+			if (ccs.ccs_rc == 0)
+				ccs.ccs_rc = rc;
+		}
+		he.offset += he.length;
+	}
+
+out_unlock:
+	rc = ccs.ccs_rc;
+	pthread_mutex_unlock(&ccs.ccs_lock);
+
+	while (started-- > 0) {
+		rc2 = pthread_join(threads[started], NULL);
+		if (rc2 != 0)
+			CT_ERROR(-rc2, "cannot join copy stream %d for '%s'",
+				 started, src);
+	}
+
+	pthread_cond_destroy(&ccs.ccs_cond);
+	pthread_mutex_destroy(&ccs.ccs_lock);
+	free(threads);
+
+	return rc;
+}
+
 static int ct_copy_data(struct hsm_copyaction_private *hcp, const char *src,
 			const char *dst, int src_fd, int dst_fd,
 			const struct hsm_action_item *hai, long hal_flags)
@@ -642,6 +957,12 @@ static int ct_copy_data(struct hsm_copyaction_private *hcp, const char *src,
 
 	errno = 0;
 
+	if (opt.o_streams > 1 && length > opt.o_chunk_size) {
+		rc = ct_copy_data_streams(hcp, src, dst, src_fd, dst_fd,
+					  offset, length);
+		goto out;
+	}
+
 	buf = malloc(opt.o_chunk_size);
 	if (buf == NULL) {
 		rc = -ENOMEM;
@@ -665,11 +986,7 @@ static int ct_copy_data(struct hsm_copyaction_private *hcp, const char *src,
 		if (wsize != -1)
 			goto fini_fastcopy;
 		rc = -errno;
-		/* Before Linux kernel 5.3 copy_file_range only supported
-		 * file copies between filesystems of the same type. In
-		 * that case copy_file_range() will return -EXDEV.
-		 */
-		if (rc != -EXDEV && rc != -ENOSYS) {
+		if (!ct_copy_range_unsupported(rc)) {
 			CT_ERROR(rc, "copy_file_range failed for '%s' to '%s'",
 				 src, dst);
 			break;
@@ -699,47 +1016,8 @@ fini_fastcopy:
 		write_total += wsize;
 		offset += wsize;
 
-		now = time(NULL);
 		/* sleep if needed, to honor bandwidth limits */
-		if (opt.o_bandwidth != 0) {
-			unsigned long long write_theory;
-
-			write_theory = (now - start_time) * opt.o_bandwidth;
-
-			if (write_theory < write_total) {
-				unsigned long long	excess;
-				struct timespec		delay;
-
-				excess = write_total - write_theory;
-
-				delay.tv_sec = excess / opt.o_bandwidth;
-				delay.tv_nsec = (excess % opt.o_bandwidth) *
-					NSEC_PER_SEC / opt.o_bandwidth;
-
-				if (now >= last_bw_print + opt.o_report_int) {
-					CT_TRACE("bandwith control: %lluB/s "
-						 "excess=%llu sleep for "
-						 "%lld.%09lds",
-						 (unsigned long long)opt.o_bandwidth,
-						 (unsigned long long)excess,
-						 (long long)delay.tv_sec,
-						 delay.tv_nsec);
-					last_bw_print = now;
-				}
-
-				do {
-					rc = nanosleep(&delay, &delay);
-				} while (rc < 0 && errno == EINTR);
-				if (rc < 0) {
-					CT_ERROR(errno, "delay for bandwidth "
-						 "control failed to sleep: "
-						 "residual=%lld.%09lds",
-						 (long long)delay.tv_sec,
-						 delay.tv_nsec);
-					rc = 0;
-				}
-			}
-		}
+		ct_bandwidth_wait(start_time, write_total, &last_bw_print);
 
 		now = time(NULL);
 		if (now >= last_report_time + opt.o_report_int) {
@@ -37,6 +37,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 
 #include <lustre/lustreapi.h>
 #include <linux/lustre/lustre_ioctl.h>
@@ -58,6 +59,8 @@ static int chlg_dev_path(char *path, size_t path_len, const char *device)
 
 #define CHANGELOG_PRIV_MAGIC 0xCA8E1080
 #define CHANGELOG_BUFFER_SZ  4096
+/* record area of the ring mapped with CHANGELOG_FLAG_RING */
+#define CHANGELOG_RING_SZ    (8 << 20)
 
 /**
  * Record state for efficient changelog consumption.
@@ -76,6 +79,12 @@ struct changelog_private {
 	size_t				 clp_buf_len;
 	/* Current position in buffer */
 	char				*clp_buf_pos;
+	/* Record ring mapped with CHANGELOG_FLAG_RING */
+	struct changelog_ring_hdr	*clp_ring;
+	size_t				 clp_ring_len;
+	/* Ring position of the next record to return, records before it
+	 * and after crh_tail are the batch not released yet */
+	__u64				 clp_ring_pos;
 	/* Read buffer with records read from system */
 	char				 clp_buf[0];
 };
@@ -159,6 +168,24 @@ int llapi_changelog_start(void **priv, enum changelog_send_flag flags,
 					  "CHANGELOG_FLAG_FOLLOW");
 	}
 
+	if (flags & CHANGELOG_FLAG_RING) {
+		void *ring;
+
+		cp->clp_ring_len = sysconf(_SC_PAGESIZE) + CHANGELOG_RING_SZ;
+		ring = mmap(NULL, cp->clp_ring_len, PROT_READ | PROT_WRITE,
+			    MAP_SHARED, cp->clp_fd, 0);
+		if (ring == MAP_FAILED) {
+			rc = -errno;
+			llapi_error(LLAPI_MSG_ERROR, rc,
+				    "cannot map changelog ring of '%s'",
+				    device);
+			*priv = NULL;
+			goto out_close;
+		}
+		cp->clp_ring = ring;
+		cp->clp_ring_pos = 0;
+	}
+
 	return 0;
 
 out_close:
@@ -176,12 +203,156 @@ int llapi_changelog_fini(void **priv)
 	if (!cp || (cp->clp_magic != CHANGELOG_PRIV_MAGIC))
 		return -EINVAL;
 
+	if (cp->clp_ring)
+		munmap(cp->clp_ring, cp->clp_ring_len);
 	close(cp->clp_fd);
 	free(cp);
 	*priv = NULL;
 	return 0;
 }
 
+/**
+ * Give the ring records up to clp_ring_pos back to the kernel.
+ */
+static void chlg_ring_release(struct changelog_private *cp)
+{
+	struct changelog_ring_hdr *hdr = cp->clp_ring;
+
+	if (hdr->crh_tail == cp->clp_ring_pos)
+		return;
+
+	/* records are read before the kernel may overwrite them */
+	__atomic_store_n(&hdr->crh_tail, cp->clp_ring_pos, __ATOMIC_RELEASE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&hdr->crh_flags, __ATOMIC_ACQUIRE) &
+	    CHANGELOG_RING_WAKEUP)
+		ioctl(cp->clp_fd, OBD_IOC_CHLG_RING_WAKE);
+}
+
+/**
+ * Get the next ring record, waiting for one if needed.
+ *
+ * @param[in]  cp   Changelog reader.
+ * @param[out] rec  Next record, not released yet.
+ * @return 1 if a record was returned, 0 on EOF, negated errno on failure.
+ */
+static int chlg_ring_next(struct changelog_private *cp,
+			  struct changelog_rec **rec)
+{
+	struct changelog_ring_hdr *hdr = cp->clp_ring;
+	struct pollfd pfd = { .fd = cp->clp_fd, .events = POLLIN };
+	struct changelog_ring_rec *crr;
+	__u64 size = hdr->crh_data_size;
+	__u64 head;
+	__u32 flags;
+
+	for (;;) {
+		head = __atomic_load_n(&hdr->crh_head, __ATOMIC_ACQUIRE);
+		if (cp->clp_ring_pos != head) {
+			crr = (struct changelog_ring_rec *)
+			      ((char *)hdr + hdr->crh_data_offset +
+			       cp->clp_ring_pos % size);
+			if (crr->crr_len == 0) {
+				/* end of the area skipped by the kernel */
+				cp->clp_ring_pos += size -
+						    cp->clp_ring_pos % size;
+				continue;
+			}
+			if (crr->crr_len > CR_MAXSIZE)
+				return -EPROTO;
+
+			*rec = crr->crr_rec;
+			cp->clp_ring_pos += changelog_ring_rec_size(crr->crr_len);
+			return 1;
+		}
+
+		/* nothing left to wait for, let the kernel fill the ring */
+		chlg_ring_release(cp);
+
+		flags = __atomic_load_n(&hdr->crh_flags, __ATOMIC_ACQUIRE);
+		if (flags & CHANGELOG_RING_ERROR)
+			return hdr->crh_error;
+		if (flags & CHANGELOG_RING_EOF) {
+			/* records added before EOF was set */
+			if (__atomic_load_n(&hdr->crh_head, __ATOMIC_ACQUIRE) !=
+			    cp->clp_ring_pos)
+				continue;
+			return 0;
+		}
+
+		if (poll(&pfd, 1, -1) < 0 && errno != EINTR)
+			return -errno;
+	}
+}
+
+/**
+ * Receive a batch of changelog records from a reader started with
+ * CHANGELOG_FLAG_RING, waiting for at least one.
+ *
+ * Records point into the ring mapped from the kernel, they are neither
+ * copied nor converted to the format asked for at start, so they have to
+ * be accessed with the changelog_rec_*() helpers. They are valid until
+ * the next llapi_changelog_recv_batch() or llapi_changelog_release_batch()
+ * call.
+ *
+ * @param[in]  priv     Opaque changelog reader structure.
+ * @param[out] recs     Array of \a nr_recs records to fill.
+ * @param[in]  nr_recs  Size of \a recs.
+ * @return number of records returned, 0 on EOF, negated errno on failure.
+ */
+int llapi_changelog_recv_batch(void *priv, struct changelog_rec **recs,
+			       int nr_recs)
+{
+	struct changelog_private *cp = priv;
+	struct changelog_ring_hdr *hdr;
+	int count = 0;
+	int rc;
+
+	if (!cp || cp->clp_magic != CHANGELOG_PRIV_MAGIC || !cp->clp_ring ||
+	    !recs || nr_recs <= 0)
+		return -EINVAL;
+
+	hdr = cp->clp_ring;
+	chlg_ring_release(cp);
+
+	rc = chlg_ring_next(cp, &recs[count]);
+	if (rc <= 0)
+		return rc;
+
+	/* take whatever else is in the ring without waiting */
+	for (count = 1; count < nr_recs; count++) {
+		if (cp->clp_ring_pos ==
+		    __atomic_load_n(&hdr->crh_head, __ATOMIC_ACQUIRE))
+			break;
+		rc = chlg_ring_next(cp, &recs[count]);
+		if (rc < 0)
+			return rc;
+		if (rc == 0)
+			break;
+	}
+
+	return count;
+}
+
+/**
+ * Release the records of the last llapi_changelog_recv_batch() call, so
+ * that the kernel can reuse their room in the ring.
+ *
+ * @param[in]  priv  Opaque changelog reader structure.
+ * @return 0 on success, negated errno on failure.
+ */
+int llapi_changelog_release_batch(void *priv)
+{
+	struct changelog_private *cp = priv;
+
+	if (!cp || cp->clp_magic != CHANGELOG_PRIV_MAGIC || !cp->clp_ring)
+		return -EINVAL;
+
+	chlg_ring_release(cp);
+
+	return 0;
+}
+
 static ssize_t chlg_read_bulk(struct changelog_private *cp)
 {
 	ssize_t rd_bytes;
@@ -256,6 +427,21 @@ int llapi_changelog_recv(void *priv, struct changelog_rec **rech)
 			rec_extra_fmt |= CLFE_XATTR;
 	}
 
+	if (cp->clp_ring) {
+		/* copy out of the ring, no system call unless it is empty */
+		rc = chlg_ring_next(cp, &tmp);
+		if (rc <= 0) {
+			rc = rc == 0 ? 1 : rc;
+			goto out_free;
+		}
+
+		memcpy(*rech, tmp, changelog_rec_size(tmp) + tmp->cr_namelen);
+		chlg_ring_release(cp);
+		changelog_remap_rec(*rech, rec_fmt, rec_extra_fmt);
+
+		return 0;
+	}
+
 	if (cp->clp_buf + cp->clp_buf_len <= cp->clp_buf_pos) {
 		ssize_t refresh;
 
@@ -298,6 +484,11 @@ int llapi_changelog_free(struct changelog_rec **rech)
 int llapi_changelog_in_buf(void *priv)
 {
 	struct changelog_private *cp = priv;
+
+	if (cp->clp_ring)
+		return __atomic_load_n(&cp->clp_ring->crh_head,
+				       __ATOMIC_ACQUIRE) != cp->clp_ring_pos;
+
 	if (cp->clp_buf + cp->clp_buf_len > cp->clp_buf_pos)
 		return 1;
 	return 0;
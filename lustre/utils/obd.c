@@ -5402,14 +5402,17 @@ int jt_changelog_register(int argc, char **argv)
 	int			 c;
 	int			 rc;
 
-	if (argc > 2)
+	if (argc > 3)
 		return CMD_HELP;
 
-	while ((c = getopt(argc, argv, "hn")) >= 0) {
+	while ((c = getopt(argc, argv, "hns")) >= 0) {
 		switch (c) {
 		case 'n':
 			print_name_only = true;
 			break;
+		case 's':
+			data.ioc_u32_2 |= CLU_F_SHARDS;
+			break;
 		case 'h':
 		default:
 			return CMD_HELP;
@@ -626,6 +626,9 @@ check_obd_connect_data(void)
 	CHECK_DEFINE_64X(OBD_CONNECT2_ENCRYPT);
 	CHECK_DEFINE_64X(OBD_CONNECT2_FIDMAP);
 	CHECK_DEFINE_64X(OBD_CONNECT2_GETATTR_PFID);
+	CHECK_DEFINE_64X(OBD_CONNECT2_LSOM_TRUST);
+	CHECK_DEFINE_64X(OBD_CONNECT2_DQACQ_BATCH);
+	CHECK_DEFINE_64X(OBD_CONNECT2_SETATTR_BATCH);
 
 	CHECK_VALUE_X(OBD_CKSUM_CRC32);
 	CHECK_VALUE_X(OBD_CKSUM_ADLER);
@@ -734,6 +737,7 @@ check_obdo(void)
 	CHECK_DEFINE_64X(OBD_MD_FLLAZYSIZE);
 	CHECK_DEFINE_64X(OBD_MD_FLLAZYBLOCKS);
 	CHECK_DEFINE_64X(OBD_MD_ENCCTX);
+	CHECK_DEFINE_64X(OBD_MD_FLLAZYTRUST);
 
 	CHECK_CVALUE_X(OBD_FL_INLINEDATA);
 	CHECK_CVALUE_X(OBD_FL_OBDMDEXISTS);
@@ -905,8 +909,8 @@ check_obd_statfs(void)
 	CHECK_MEMBER(obd_statfs, os_state);
 	CHECK_MEMBER(obd_statfs, os_fprecreated);
 	CHECK_MEMBER(obd_statfs, os_granted);
-	CHECK_MEMBER(obd_statfs, os_spare3);
-	CHECK_MEMBER(obd_statfs, os_spare4);
+	CHECK_MEMBER(obd_statfs, os_io_rate);
+	CHECK_MEMBER(obd_statfs, os_io_inflight);
 	CHECK_MEMBER(obd_statfs, os_spare5);
 	CHECK_MEMBER(obd_statfs, os_spare6);
 	CHECK_MEMBER(obd_statfs, os_spare7);
@@ -1071,6 +1075,19 @@ check_ost_body(void)
 	CHECK_MEMBER(ost_body, oa);
 }
 
+static void
+check_ost_setattr_rec(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(ost_setattr_rec);
+	CHECK_MEMBER(ost_setattr_rec, osr_oi);
+	CHECK_MEMBER(ost_setattr_rec, osr_valid);
+	CHECK_MEMBER(ost_setattr_rec, osr_uid);
+	CHECK_MEMBER(ost_setattr_rec, osr_gid);
+	CHECK_MEMBER(ost_setattr_rec, osr_projid);
+	CHECK_MEMBER(ost_setattr_rec, osr_rc);
+}
+
 static void
 check_ll_fid(void)
 {
@@ -2756,6 +2773,7 @@ main(int argc, char **argv)
 	CHECK_VALUE(OST_QUOTA_ADJUST_QUNIT);
 	CHECK_VALUE(OST_LADVISE);
 	CHECK_VALUE(OST_FALLOCATE);
+	CHECK_VALUE(OST_SETATTR_BATCH);
 	CHECK_VALUE(OST_LAST_OPC);
 
 	CHECK_DEFINE_64X(OBD_OBJECT_EOF);
@@ -2911,6 +2929,7 @@ main(int argc, char **argv)
 
 	CHECK_VALUE(QUOTA_DQACQ);
 	CHECK_VALUE(QUOTA_DQREL);
+	CHECK_VALUE(QUOTA_DQACQ_BATCH);
 	CHECK_VALUE(QUOTA_LAST_OPC);
 
 	CHECK_VALUE(MGS_CONNECT);
@@ -2979,6 +2998,7 @@ main(int argc, char **argv)
 	check_obd_idx_read();
 	check_niobuf_remote();
 	check_ost_body();
+	check_ost_setattr_rec();
 	check_ll_fid();
 	check_mds_op_bias();
 	check_mdt_body();
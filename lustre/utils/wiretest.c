@@ -132,7 +132,9 @@ void lustre_assert_wire_constants(void)
 		 (long long)OST_LADVISE);
 	LASSERTF(OST_FALLOCATE == 22, "found %lld\n",
 		 (long long)OST_FALLOCATE);
-	LASSERTF(OST_LAST_OPC == 23, "found %lld\n",
+	LASSERTF(OST_SETATTR_BATCH == 24, "found %lld\n",
+		 (long long)OST_SETATTR_BATCH);
+	LASSERTF(OST_LAST_OPC == 25, "found %lld\n",
 		 (long long)OST_LAST_OPC);
 	LASSERTF(OBD_OBJECT_EOF == 0xffffffffffffffffULL, "found 0x%.16llxULL\n",
 		 OBD_OBJECT_EOF);
@@ -384,7 +386,9 @@ void lustre_assert_wire_constants(void)
 		 (long long)QUOTA_DQACQ);
 	LASSERTF(QUOTA_DQREL == 602, "found %lld\n",
 		 (long long)QUOTA_DQREL);
-	LASSERTF(QUOTA_LAST_OPC == 603, "found %lld\n",
+	LASSERTF(QUOTA_DQACQ_BATCH == 603, "found %lld\n",
+		 (long long)QUOTA_DQACQ_BATCH);
+	LASSERTF(QUOTA_LAST_OPC == 604, "found %lld\n",
 		 (long long)QUOTA_LAST_OPC);
 	LASSERTF(MGS_CONNECT == 250, "found %lld\n",
 		 (long long)MGS_CONNECT);
@@ -1403,6 +1407,12 @@ void lustre_assert_wire_constants(void)
 		 OBD_CONNECT2_FIDMAP);
 	LASSERTF(OBD_CONNECT2_GETATTR_PFID== 0x20000ULL, "found 0x%.16llxULL\n",
 		 OBD_CONNECT2_GETATTR_PFID);
+	LASSERTF(OBD_CONNECT2_LSOM_TRUST == 0x10000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_LSOM_TRUST);
+	LASSERTF(OBD_CONNECT2_DQACQ_BATCH == 0x20000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_DQACQ_BATCH);
+	LASSERTF(OBD_CONNECT2_SETATTR_BATCH == 0x40000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_SETATTR_BATCH);
 	LASSERTF(OBD_CKSUM_CRC32 == 0x00000001UL, "found 0x%.8xUL\n",
 		(unsigned)OBD_CKSUM_CRC32);
 	LASSERTF(OBD_CKSUM_ADLER == 0x00000002UL, "found 0x%.8xUL\n",
@@ -1665,6 +1675,8 @@ void lustre_assert_wire_constants(void)
 		 OBD_MD_FLLAZYBLOCKS);
 	LASSERTF(OBD_MD_ENCCTX == (0x2000000000000000ULL), "found 0x%.16llxULL\n",
 		 OBD_MD_ENCCTX);
+	LASSERTF(OBD_MD_FLLAZYTRUST == (0x8000000000000000ULL), "found 0x%.16llxULL\n",
+		 OBD_MD_FLLAZYTRUST);
 	BUILD_BUG_ON(OBD_FL_INLINEDATA != 0x00000001);
 	BUILD_BUG_ON(OBD_FL_OBDMDEXISTS != 0x00000002);
 	BUILD_BUG_ON(OBD_FL_DELORPHAN != 0x00000004);
@@ -1993,14 +2005,14 @@ void lustre_assert_wire_constants(void)
 		 (long long)(int)offsetof(struct obd_statfs, os_granted));
 	LASSERTF((int)sizeof(((struct obd_statfs *)0)->os_granted) == 4, "found %lld\n",
 		 (long long)(int)sizeof(((struct obd_statfs *)0)->os_granted));
-	LASSERTF((int)offsetof(struct obd_statfs, os_spare3) == 116, "found %lld\n",
-		 (long long)(int)offsetof(struct obd_statfs, os_spare3));
-	LASSERTF((int)sizeof(((struct obd_statfs *)0)->os_spare3) == 4, "found %lld\n",
-		 (long long)(int)sizeof(((struct obd_statfs *)0)->os_spare3));
-	LASSERTF((int)offsetof(struct obd_statfs, os_spare4) == 120, "found %lld\n",
-		 (long long)(int)offsetof(struct obd_statfs, os_spare4));
-	LASSERTF((int)sizeof(((struct obd_statfs *)0)->os_spare4) == 4, "found %lld\n",
-		 (long long)(int)sizeof(((struct obd_statfs *)0)->os_spare4));
+	LASSERTF((int)offsetof(struct obd_statfs, os_io_rate) == 116, "found %lld\n",
+		 (long long)(int)offsetof(struct obd_statfs, os_io_rate));
+	LASSERTF((int)sizeof(((struct obd_statfs *)0)->os_io_rate) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct obd_statfs *)0)->os_io_rate));
+	LASSERTF((int)offsetof(struct obd_statfs, os_io_inflight) == 120, "found %lld\n",
+		 (long long)(int)offsetof(struct obd_statfs, os_io_inflight));
+	LASSERTF((int)sizeof(((struct obd_statfs *)0)->os_io_inflight) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct obd_statfs *)0)->os_io_inflight));
 	LASSERTF((int)offsetof(struct obd_statfs, os_spare5) == 124, "found %lld\n",
 		 (long long)(int)offsetof(struct obd_statfs, os_spare5));
 	LASSERTF((int)sizeof(((struct obd_statfs *)0)->os_spare5) == 4, "found %lld\n",
@@ -2351,6 +2363,34 @@ void lustre_assert_wire_constants(void)
 	LASSERTF((int)sizeof(((struct ost_body *)0)->oa) == 208, "found %lld\n",
 		 (long long)(int)sizeof(((struct ost_body *)0)->oa));
 
+	/* Checks for struct ost_setattr_rec */
+	LASSERTF((int)sizeof(struct ost_setattr_rec) == 40, "found %lld\n",
+		 (long long)(int)sizeof(struct ost_setattr_rec));
+	LASSERTF((int)offsetof(struct ost_setattr_rec, osr_oi) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct ost_setattr_rec, osr_oi));
+	LASSERTF((int)sizeof(((struct ost_setattr_rec *)0)->osr_oi) == 16, "found %lld\n",
+		 (long long)(int)sizeof(((struct ost_setattr_rec *)0)->osr_oi));
+	LASSERTF((int)offsetof(struct ost_setattr_rec, osr_valid) == 16, "found %lld\n",
+		 (long long)(int)offsetof(struct ost_setattr_rec, osr_valid));
+	LASSERTF((int)sizeof(((struct ost_setattr_rec *)0)->osr_valid) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct ost_setattr_rec *)0)->osr_valid));
+	LASSERTF((int)offsetof(struct ost_setattr_rec, osr_uid) == 24, "found %lld\n",
+		 (long long)(int)offsetof(struct ost_setattr_rec, osr_uid));
+	LASSERTF((int)sizeof(((struct ost_setattr_rec *)0)->osr_uid) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ost_setattr_rec *)0)->osr_uid));
+	LASSERTF((int)offsetof(struct ost_setattr_rec, osr_gid) == 28, "found %lld\n",
+		 (long long)(int)offsetof(struct ost_setattr_rec, osr_gid));
+	LASSERTF((int)sizeof(((struct ost_setattr_rec *)0)->osr_gid) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ost_setattr_rec *)0)->osr_gid));
+	LASSERTF((int)offsetof(struct ost_setattr_rec, osr_projid) == 32, "found %lld\n",
+		 (long long)(int)offsetof(struct ost_setattr_rec, osr_projid));
+	LASSERTF((int)sizeof(((struct ost_setattr_rec *)0)->osr_projid) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ost_setattr_rec *)0)->osr_projid));
+	LASSERTF((int)offsetof(struct ost_setattr_rec, osr_rc) == 36, "found %lld\n",
+		 (long long)(int)offsetof(struct ost_setattr_rec, osr_rc));
+	LASSERTF((int)sizeof(((struct ost_setattr_rec *)0)->osr_rc) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ost_setattr_rec *)0)->osr_rc));
+
 	/* Checks for struct ll_fid */
 	LASSERTF((int)sizeof(struct ll_fid) == 16, "found %lld\n",
 		 (long long)(int)sizeof(struct ll_fid));